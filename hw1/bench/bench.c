@@ -0,0 +1,265 @@
+//Benchmark driver for argo (built and run by "make bench", over the documents of bench/corpus.sh).
+//Each document is read into memory once, and then parsed into argo values, validated, canonicalized,
+//pretty printed (to /dev/null), hashed, and canonicalized with sorted keys in turn, each RUNS times.
+//The best time of each is reported as MB/s of input and millions of values/s, one line per document
+//and operation, so that the output of two builds can be compared line by line. A document whose name
+//ends in ".ndjson" is handled as newline-delimited JSON, the way --lines handles it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "input.h"
+#include "arena.h"
+#include "events.h"
+#include "lines.h"
+#include "validity.h"
+#include "hash.h"
+#include "sort.h"
+
+//Number of times each operation is timed, unless -r is given
+#define BENCH_RUNS 5
+
+//Indent used for the pretty printing operation
+#define BENCH_INDENT 4
+
+/*
+ * A document being benchmarked.
+ */
+typedef struct bench_doc {
+    const char *name;                // File the document was read from.
+    char *buf;                       // Its bytes.
+    size_t len;                      // Number of bytes.
+    bool lines;                      // Nonzero if it is newline-delimited JSON.
+    unsigned long values;            // Number of values in it (members are counted once, by their values).
+} BENCH_DOC;
+
+/*
+ * An operation that is timed.
+ */
+typedef struct bench_op {
+    const char *name;
+    int (*run)(BENCH_DOC *d, FILE *out);
+} BENCH_OP;
+
+//Count a value of any kind
+static int count_value(void *ctx) {(*(unsigned long *)ctx)++; return 0;}
+static int count_string(void *ctx, ARGO_STRING *s) {return count_value(ctx);}
+static int count_number(void *ctx, ARGO_NUMBER *n) {return count_value(ctx);}
+static int count_basic(void *ctx, ARGO_BASIC b) {return count_value(ctx);}
+
+static const ARGO_HANDLER counter = {
+    count_value, NULL, count_value, NULL, NULL, count_string, count_number, count_basic
+};
+
+//Parse a document into argo values, one record at a time for newline-delimited JSON
+static int run_parse(BENCH_DOC *d, FILE *out){
+    ARGO_INPUT in;
+    int ret;
+    argo_input_open_mem(&in, d->buf, d->len);
+    argo_arena_reset(&argo_value_arena);
+    if (!d->lines) ret = argo_read_value_input(&in) == NULL ? -1 : 0;
+    else {
+        ARGO_LINES r;
+        ARGO_INPUT *rec;
+        argo_lines_open(&r, &in);
+        while ((rec = argo_lines_next(&r)) != NULL){
+            argo_lines_check(&r, argo_read_value_input(rec) == NULL ? -1 : 0);
+            argo_arena_reset(&argo_value_arena);
+        }
+        ret = argo_lines_close(&r);
+    }
+    argo_input_close(&in);
+    return ret;
+}
+
+//Validate a document, as -v does
+static int run_validate(BENCH_DOC *d, FILE *out){
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, d->buf, d->len);
+    int ret = d->lines ? argo_validate_lines(&in) : argo_validate(&in);
+    argo_input_close(&in);
+    return ret;
+}
+
+//Canonicalize a document, as -c does (pretty printing if global_options says so)
+static int run_write(BENCH_DOC *d, FILE *out){
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, d->buf, d->len);
+    level = 0;
+    int ret = d->lines ? argo_write_lines(&in, out) : argo_write_events(&in, out);
+    argo_input_close(&in);
+    return ret;
+}
+
+static int run_canonicalize(BENCH_DOC *d, FILE *out){
+    global_options = CANONICALIZE_OPTION;
+    return run_write(d, out);
+}
+
+static int run_pretty(BENCH_DOC *d, FILE *out){
+    global_options = CANONICALIZE_OPTION | PRETTY_PRINT_OPTION | BENCH_INDENT;
+    return run_write(d, out);
+}
+
+//Canonicalize a document with the members of its objects sorted, as --sort-keys does
+static int run_sorted(BENCH_DOC *d, FILE *out){
+    ARGO_INPUT in;
+    int ret;
+    global_options = CANONICALIZE_OPTION;
+    argo_utf8_strings = 1;
+    argo_input_open_mem(&in, d->buf, d->len);
+    argo_arena_reset(&argo_value_arena);
+    if (!d->lines) ret = argo_write_sorted(&in, out);
+    else {
+        ARGO_LINES r;
+        ARGO_INPUT *rec;
+        argo_lines_open(&r, &in);
+        while ((rec = argo_lines_next(&r)) != NULL){
+            argo_lines_check(&r, argo_write_sorted(rec, out));
+            argo_arena_reset(&argo_value_arena);
+        }
+        ret = argo_lines_close(&r);
+    }
+    argo_input_close(&in);
+    argo_utf8_strings = 0;
+    return ret;
+}
+
+//Hash a document's canonical form (each record's, for newline-delimited JSON), as --hash does
+static int run_hash(BENCH_DOC *d, FILE *out){
+    ARGO_INPUT in;
+    ARGO_HASHER h;
+    ARGO_DIGEST digest;
+    int ret;
+    if (argo_hasher_open(&h, 64)) return -1;
+    argo_input_open_mem(&in, d->buf, d->len);
+    if (!d->lines) ret = argo_hash_events(&h, &in, &digest);
+    else {
+        ARGO_LINES r;
+        ARGO_INPUT *rec;
+        argo_lines_open(&r, &in);
+        while ((rec = argo_lines_next(&r)) != NULL) argo_lines_check(&r, argo_hash_events(&h, rec, &digest));
+        ret = argo_lines_close(&r);
+    }
+    argo_input_close(&in);
+    argo_hasher_close(&h);
+    return ret;
+}
+
+static const BENCH_OP ops[] = {
+    {"parse", run_parse},
+    {"validate", run_validate},
+    {"canonicalize", run_canonicalize},
+    {"pretty", run_pretty},
+    {"hash", run_hash},
+    {"sort-keys", run_sorted}
+};
+
+//Check whether a string ends with a suffix
+static bool ends_with(const char *s, const char *suffix){
+    size_t n = 0, m = 0;
+    while (*(s+n) != 0) n++;
+    while (*(suffix+m) != 0) m++;
+    if (m > n) return false;
+    while (m > 0) if (*(s + --n) != *(suffix + --m)) return false;
+    return true;
+}
+
+//Read a whole file into a document, and count its values. Returns nonzero if it can't be read or isn't valid
+static int load(BENCH_DOC *d, const char *name){
+    FILE *f = fopen(name, "r");
+    d->name = name;
+    d->buf = NULL;
+    d->len = 0;
+    d->lines = ends_with(name, ".ndjson");
+    d->values = 0;
+    if (f == NULL || fseek(f, 0, SEEK_END) || (long)(d->len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)){
+        fprintf(stderr, "Error: Can't read %s\n", name);
+        if (f != NULL) fclose(f);
+        return -1;
+    }
+    d->buf = malloc(d->len + 1);
+    if (d->buf == NULL || fread(d->buf, 1, d->len, f) != d->len){
+        fprintf(stderr, "Error: Can't read %s\n", name);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, d->buf, d->len);
+    int ret;
+    if (!d->lines) ret = argo_parse_events(&in, &counter, &d->values);
+    else {
+        ARGO_LINES r;
+        ARGO_INPUT *rec;
+        argo_lines_open(&r, &in);
+        while ((rec = argo_lines_next(&r)) != NULL) argo_lines_check(&r, argo_parse_events(rec, &counter, &d->values));
+        ret = argo_lines_close(&r);
+    }
+    argo_input_close(&in);
+    if (ret) fprintf(stderr, "Error: %s is not valid\n", name);
+    return ret;
+}
+
+//Seconds since some fixed point
+static double now(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+//Just the last part of a path
+static const char *base_name(const char *path){
+    const char *s = path;
+    for (; *path != 0; path++) if (*path == '/') s = path + 1;
+    return s;
+}
+
+int main(int argc, char **argv){
+    int runs = BENCH_RUNS, i = 1, ret = 0;
+    if (argc > 2 && *(*(argv+1)) == '-' && *(*(argv+1)+1) == 'r'){
+        runs = atoi(*(argv+2));
+        i = 3;
+    }
+    if (i >= argc || runs < 1){
+        fprintf(stderr, "usage: %s [-r RUNS] FILE...\n", *argv);
+        return EXIT_FAILURE;
+    }
+    FILE *out = fopen("/dev/null", "w");
+    if (out == NULL){
+        fprintf(stderr, "Error: Can't open /dev/null\n");
+        return EXIT_FAILURE;
+    }
+    printf("# argo benchmark, best of %d runs\n", runs);
+    printf("# %-14s %-13s %10s %8s %16s\n", "document", "operation", "MB", "MB/s", "M values/s");
+    for (; i < argc; i++){
+        BENCH_DOC d;
+        size_t op;
+        if (load(&d, *(argv+i))) {ret = EXIT_FAILURE; free(d.buf); continue;}
+        for (op = 0; op < sizeof(ops) / sizeof(*ops); op++){
+            double best = -1;
+            int run;
+            for (run = 0; run < runs; run++){
+                double start = now();
+                if ((ops+op)->run(&d, out)){
+                    fprintf(stderr, "Error: %s failed on %s\n", (ops+op)->name, d.name);
+                    ret = EXIT_FAILURE;
+                    break;
+                }
+                double t = now() - start;
+                if (best < 0 || t < best) best = t;
+            }
+            if (run < runs) continue;
+            printf("  %-14s %-13s %10.2f %8.1f %16.2f\n", base_name(d.name), (ops+op)->name,
+                   d.len / 1e6, d.len / best / 1e6, d.values / best / 1e6);
+            fflush(stdout);
+        }
+        free(d.buf);
+    }
+    fclose(out);
+    return ret;
+}
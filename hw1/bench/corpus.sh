@@ -0,0 +1,84 @@
+#!/bin/sh
+# Corpus generator for the argo benchmark (see bench/bench.c and "make bench").
+# Each document stresses a different part of the parser and writer:
+#   numbers.json    records of integers and floats (from bench/numbers.awk, as for bench/numbers.sh)
+#   strings.json    records of strings full of escapes, \u escapes and UTF-8
+#   deep.json       chains of objects and arrays nested hundreds deep
+#   wide.json       objects with a thousand members each
+#   array.json      one large array of short scalars
+#   records.ndjson  newline-delimited records of mixed values, one per line
+# The documents are generated with a fixed seed, so the same SCALE always gives the same bytes.
+# They are only generated again if DIR holds documents of another scale.
+#
+# usage: bench/corpus.sh DIR [SCALE]
+DIR=${1:?usage: bench/corpus.sh DIR [SCALE]}
+SCALE=${2:-1}
+SRC=$(dirname "$0")
+
+mkdir -p "$DIR" || exit 1
+[ "$(cat "$DIR/scale" 2>/dev/null)" = "$SCALE" ] && exit 0
+rm -f "$DIR/scale"
+
+awk -v records=$((20000 * SCALE)) -f "$SRC/numbers.awk" "$SRC/../rsrc/numbers.json" > "$DIR/numbers.json" || exit 1
+
+awk -v records=$((40000 * SCALE)) 'BEGIN {
+    srand(321);
+    split("plain text|tab\\there|line\\nbreak|\\\"quoted\\\"|back\\\\slash|caf\\u00e9|\\ud83d\\ude00 smile|na\303\257ve|\346\227\245\346\234\254\350\252\236|\\/slashed\\/|\\u0000nul|mixed \\\"\\u00e9\\\" \303\251", piece, "|");
+    printf "[\n";
+    for (r = 0; r < records; r++) {
+        text = "";
+        for (p = 0; p < 8; p++) text = text piece[int(rand() * 12) + 1] " ";
+        printf "%s{\"id\": \"r%d\", \"title\": \"%s\", \"body\": \"%s%s\"}", (r > 0 ? ",\n" : ""), r, piece[r % 12 + 1], text, text;
+    }
+    printf "\n]\n";
+}' > "$DIR/strings.json" || exit 1
+
+awk -v chains=$((2000 * SCALE)) 'BEGIN {
+    depth = 500;
+    printf "[\n";
+    for (c = 0; c < chains; c++) {
+        printf "%s", (c > 0 ? ",\n" : "");
+        for (d = 0; d < depth; d++) printf "%s", (d % 2 ? "[" : "{\"next\": ");
+        printf "%d", c;
+        for (d = depth - 1; d >= 0; d--) printf "%s", (d % 2 ? "]" : "}");
+    }
+    printf "\n]\n";
+}' > "$DIR/deep.json" || exit 1
+
+awk -v objects=$((200 * SCALE)) 'BEGIN {
+    srand(322);
+    printf "[\n";
+    for (o = 0; o < objects; o++) {
+        printf "%s{", (o > 0 ? ",\n" : "");
+        for (k = 0; k < 1000; k++) printf "%s\"field_%d\": %d", (k > 0 ? ", " : ""), k, int(rand() * 100000);
+        printf "}";
+    }
+    printf "\n]\n";
+}' > "$DIR/wide.json" || exit 1
+
+awk -v values=$((1000000 * SCALE)) 'BEGIN {
+    srand(323);
+    printf "[";
+    for (i = 0; i < values; i++) {
+        kind = i % 6;
+        if (kind == 0) v = int(rand() * 1000);
+        else if (kind == 1) v = (rand() < 0.5 ? "true" : "false");
+        else if (kind == 2) v = "null";
+        else if (kind == 3) v = sprintf("\"s%d\"", int(rand() * 100));
+        else if (kind == 4) v = sprintf("%.2f", rand() * 100);
+        else v = -int(rand() * 100000);
+        printf "%s%s", (i > 0 ? (i % 16 ? "," : ",\n") : ""), v;
+    }
+    printf "]\n";
+}' > "$DIR/array.json" || exit 1
+
+awk -v records=$((100000 * SCALE)) 'BEGIN {
+    srand(324);
+    for (r = 0; r < records; r++) {
+        printf "{\"id\": %d, \"user\": \"user%d\", \"active\": %s, \"score\": %.3f, \"tags\": [\"t%d\", \"t%d\"], \"geo\": {\"lat\": %.5f, \"lon\": %.5f}, \"note\": %s}\n",
+            r, int(rand() * 10000), (rand() < 0.5 ? "true" : "false"), rand() * 100, int(rand() * 50), int(rand() * 50),
+            (rand() - 0.5) * 180, (rand() - 0.5) * 360, (rand() < 0.8 ? "null" : "\"see \\\"docs\\\"\"");
+    }
+}' > "$DIR/records.ndjson" || exit 1
+
+echo "$SCALE" > "$DIR/scale"
@@ -0,0 +1,30 @@
+# Generator of the numbers-heavy benchmark document, shared by bench/numbers.sh and bench/corpus.sh.
+# It reads the keys of rsrc/numbers.json, and prints an array of RECORDS objects with one member per key,
+# whose values are random integers and floats (with and without exponents) like those in telemetry data.
+# The seed is fixed, so the same RECORDS always gives the same bytes.
+#
+# usage: awk -v records=RECORDS -f bench/numbers.awk rsrc/numbers.json
+{
+    line = $0;
+    while (match(line, /"[^"]*":/)) {
+        key[++n] = substr(line, RSTART + 1, RLENGTH - 3);
+        line = substr(line, RSTART + RLENGTH);
+    }
+}
+END {
+    srand(320);
+    printf "[\n";
+    for (r = 0; r < records; r++) {
+        printf "%s{", (r > 0 ? ",\n" : "");
+        for (k = 1; k <= n; k++) {
+            kind = k % 4;
+            if (kind == 0) v = sprintf("%d", int((rand() - 0.5) * 2000000000));
+            else if (kind == 1) v = sprintf("%.6f", (rand() - 0.5) * 1000);
+            else if (kind == 2) v = sprintf("%.15g", rand() * 1e6);
+            else v = sprintf("%.3fe%d", rand() * 10, int(rand() * 40) - 20);
+            printf "%s\"%s\": %s", (k > 1 ? ", " : ""), key[k], v;
+        }
+        printf "}";
+    }
+    printf "\n]\n";
+}
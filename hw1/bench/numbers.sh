@@ -0,0 +1,38 @@
+#!/bin/sh
+# Numbers-heavy benchmark for the argo number parser.
+# rsrc/numbers.json is scaled up into an array of RECORDS objects with the same keys
+# (see bench/numbers.awk). The document is then validated and canonicalized with ARGO,
+# and the throughput is reported in MB/s and numbers/s (best of RUNS runs).
+#
+# usage: bench/numbers.sh [RECORDS] [ARGO] [RUNS]
+RECORDS=${1:-100000}
+ARGO=${2:-bin/argo}
+RUNS=${3:-5}
+DIR=$(dirname "$0")
+DATA=${TMPDIR:-/tmp}/argo_numbers_bench.json
+
+awk -v records="$RECORDS" -f "$DIR/numbers.awk" "$DIR/../rsrc/numbers.json" > "$DATA"
+
+BYTES=$(wc -c < "$DATA")
+NUMBERS=$(( RECORDS * $(grep -o '"[^"]*":' "$DIR/../rsrc/numbers.json" | wc -l) ))
+
+# Time a command (reading the benchmark document on stdin), printing the best time in seconds
+best_time() {
+    best=""
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s.%N)
+        "$@" < "$DATA" > /dev/null || { echo "argo failed" >&2; exit 1; }
+        end=$(date +%s.%N)
+        best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t; else print $3 }')
+        i=$((i + 1))
+    done
+    echo "$best"
+}
+
+echo "$RECORDS records, $NUMBERS numbers, $BYTES bytes"
+for mode in -v -c; do
+    t=$(best_time "$ARGO" $mode) || exit 1
+    echo "$t" | awk -v mode="$mode" -v bytes="$BYTES" -v numbers="$NUMBERS" \
+        '{ printf "argo %s: %.3f s, %.1f MB/s, %.2f M numbers/s\n", mode, $1, bytes / $1 / 1e6, numbers / $1 / 1e6 }'
+done
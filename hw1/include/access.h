@@ -0,0 +1,49 @@
+//This header file contains functions for looking inside argo values once they have been read.
+//Members of an object are found by name through a hash index, which is built the first time
+//an object with enough members is searched, so only objects that are actually queried pay for one.
+//Elements of an array are indexed by position, through the array of them that the parser records
+#ifndef ACCESS_H
+#define ACCESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "argo.h"
+
+//Objects with fewer members than this are searched linearly, without building an index
+#define ARGO_INDEX_THRESHOLD 8
+
+/*
+ * A slot of a member index. An empty slot has a NULL member. The hash of the
+ * member's name is kept so that most mismatches are found without comparing names.
+ */
+typedef struct argo_member_slot {
+    uint64_t hash;                   // Hash of the member's name.
+    struct argo_value *member;       // Member in this slot, or NULL if the slot is empty.
+} ARGO_MEMBER_SLOT;
+
+/*
+ * Open-addressing (linear probing) hash table of the members of an object, allocated
+ * from the arena of the context the object was read in, along with the object itself. The table is at most half full.
+ * Members with the same name are all indexed, in list order along the probe sequence,
+ * so a lookup finds the first of them, as a linear search would.
+ */
+typedef struct argo_member_index {
+    size_t mask;                     // Number of slots minus one (the number of slots is a power of two).
+    size_t count;                    // Number of members indexed.
+    ARGO_MEMBER_SLOT slots[];        // The slots themselves.
+} ARGO_MEMBER_INDEX;
+
+uint64_t argo_hash_bytes(const unsigned char *key, size_t length);
+uint64_t argo_hash_chars(const ARGO_CHAR *key, size_t length);
+int argo_object_index(ARGO_VALUE *obj);
+int argo_ctx_object_index(ARGO_CTX *cx, ARGO_VALUE *obj);
+ARGO_VALUE *argo_object_get(ARGO_VALUE *obj, const char *key);
+ARGO_VALUE *argo_ctx_object_get(ARGO_CTX *cx, ARGO_VALUE *obj, const char *key);
+ARGO_VALUE *argo_object_get_bytes(ARGO_VALUE *obj, const unsigned char *key, size_t length);
+ARGO_VALUE *argo_ctx_object_get_bytes(ARGO_CTX *cx, ARGO_VALUE *obj, const unsigned char *key, size_t length);
+ARGO_VALUE *argo_object_get_hashed(ARGO_VALUE *obj, const unsigned char *key, size_t length, uint64_t hash);
+ARGO_VALUE *argo_ctx_object_get_hashed(ARGO_CTX *cx, ARGO_VALUE *obj, const unsigned char *key, size_t length, uint64_t hash);
+size_t argo_array_len(ARGO_VALUE *arr);
+ARGO_VALUE *argo_array_at(ARGO_VALUE *arr, size_t i);
+
+#endif
@@ -0,0 +1,53 @@
+//This header file contains the arena that argo values are allocated from.
+//The arena is a list of chunks that is grown on demand, so the size of a document
+//is no longer limited by a fixed array, and it can be reset in O(1) between documents
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "argo.h"
+
+//Size in bytes of the first chunk of an arena. Each new chunk is twice the size of the
+//previous one, up to ARGO_ARENA_MAX_CHUNK (larger requests get a chunk of their own)
+#define ARGO_ARENA_FIRST_CHUNK (1 << 14)
+#define ARGO_ARENA_MAX_CHUNK (1 << 24)
+
+//Every allocation from an arena is aligned to this many bytes
+#define ARGO_ARENA_ALIGN 16
+
+/*
+ * A chunk of arena memory. The usable space follows the header, and "used" bytes
+ * of it have been handed out since the arena was last reset.
+ */
+typedef struct argo_chunk {
+    struct argo_chunk *next;         // Next chunk in the arena (kept across resets for reuse).
+    size_t size;                     // Number of usable bytes in this chunk.
+    size_t used;                     // Number of bytes handed out from this chunk.
+} ARGO_CHUNK;
+
+/*
+ * An arena owns a list of chunks. Allocations are carved out of "current" until it is
+ * full, at which point the next chunk is reused (or a new one is added). Resetting only
+ * rewinds to the first chunk, so it takes constant time no matter how much was allocated.
+ */
+typedef struct argo_arena {
+    ARGO_CHUNK *first;               // First chunk, NULL until something is allocated.
+    ARGO_CHUNK *current;             // Chunk that allocations are currently carved from.
+    size_t used;                     // Bytes handed out since the last reset.
+    size_t peak;                     // Largest value "used" has reached.
+    size_t values;                   // ARGO_VALUEs handed out since the last reset.
+    size_t peak_values;              // Largest value "values" has reached.
+    size_t reserved;                 // Total bytes held in chunks.
+    size_t generation;               // Number of times the arena has been reset (so that tables of its space can tell when they are stale).
+    bool adopted;                    // Whether chunks of other arenas have been adopted since the last reset.
+} ARGO_ARENA;
+
+void *argo_arena_alloc(ARGO_ARENA *a, size_t size);
+void argo_arena_reset(ARGO_ARENA *a);
+void argo_arena_free(ARGO_ARENA *a);
+void argo_arena_adopt(ARGO_ARENA *a, ARGO_ARENA *from);
+ARGO_VALUE *argo_value_alloc(void);
+ARGO_VALUE *argo_ctx_value_alloc(ARGO_CTX *cx);
+
+#endif
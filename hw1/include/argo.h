@@ -15,7 +15,7 @@
  */
 #define USAGE(program_name, retcode) do { \
 fprintf(stderr, "USAGE: %s %s\n", program_name, \
-"[-h] [-c|-v] [-p INDENT]\n" \
+"[-h] [-c|-v] [-p INDENT] [-q QUERY] [--lines] [-j N] [--depth N] [--hash|--hash128] [--sort-keys]\n" \
 "   -h       Help: displays this help menu.\n" \
 "   -v       Validate: the program reads from standard input and checks whether\n" \
 "            it is syntactically correct JSON.  If there is any error, then a message\n" \
@@ -33,6 +33,24 @@ fprintf(stderr, "USAGE: %s %s\n", program_name, \
 "            number of additional spaces to be output at the beginning of a line for each\n" \
 "            for each increase in indentation level.  If no value is specified, then a\n" \
 "            default value of 4 is used.\n" \
+"   -q       Query: the input is read as for -c, but only the values selected by\n" \
+"            QUERY are output, each on a line of its own.  QUERY is a JSON Pointer\n" \
+"            (such as /a/0/b) or a simple JSONPath (such as $.a[0].b or $.a[*]).\n" \
+"            As with -c, the values are pretty printed if -p is also given.\n" \
+"   --lines  Lines: the input is newline-delimited JSON, with one value on each line.\n" \
+"            Each line is validated, canonicalized, or queried on its own, and each\n" \
+"            invalid line is reported without stopping the others from being processed.\n" \
+"   -j       Jobs: with --lines, the lines are divided among N processes that run in\n" \
+"            parallel.  Otherwise, if the input is a large array, its elements are.\n" \
+"            The output is in the same order as it would be without -j.\n" \
+"   --depth  Depth: input with arrays and objects nested more than N deep is an error.\n" \
+"   --hash   Hash: the input is read as for -c, but instead of the canonical JSON, a\n" \
+"            64-bit hash of it (XXH64) is output in hexadecimal.  With --lines, there is\n" \
+"            a hash for each record, and with -q, for each value selected.  --hash128\n" \
+"            outputs a 128-bit hash (XXH3-128) instead.\n" \
+"   --sort-keys\n" \
+"            Sort keys: the members of each object are output (or hashed) in order\n" \
+"            of their names, so that their order in the input doesn't matter.\n" \
 ); \
 exit(retcode); \
 } while(0)
@@ -54,7 +72,8 @@ typedef enum {
     ARGO_NUMBER_TYPE = 2,
     ARGO_STRING_TYPE = 3,
     ARGO_OBJECT_TYPE = 4,
-    ARGO_ARRAY_TYPE = 5
+    ARGO_ARRAY_TYPE = 5,
+    ARGO_UTF8_TYPE = 6                 // A string, held as an ARGO_UTF8 (see below).
 } ARGO_VALUE_TYPE;
 
 /*
@@ -80,6 +99,37 @@ typedef struct argo_string {
     ARGO_CHAR *content;              // Unicode code points (not null terminated).
 } ARGO_STRING;
 
+/*
+ * Compact alternative to ARGO_STRING, used for string values when the parser is
+ * asked for it (see argo_utf8_strings in options.h).  The text is kept as the bytes
+ * of the string literal (which is UTF-8), with escape sequences replaced by the
+ * characters they stand for, rather than as one 4-byte ARGO_CHAR per character.
+ * Strings of up to ARGO_UTF8_INLINE bytes are stored in the structure itself.
+ * Longer strings either point straight into the input buffer, if the literal has no
+ * escapes and the buffer outlives the parse, or are copied into the value arena.
+ * Either way, no separate allocation is made for the text of a string.
+ */
+#define ARGO_UTF8_INLINE 24
+
+typedef enum {
+    ARGO_UTF8_SHORT,                   // Text is in "inline_bytes".
+    ARGO_UTF8_SLICE,                   // Text is a slice of the input buffer.
+    ARGO_UTF8_COPY                     // Text was copied into the value arena.
+} ARGO_UTF8_STORAGE;
+
+typedef struct argo_utf8 {
+    union {
+	const unsigned char *bytes;                   // Text, unless it is stored inline.
+	unsigned char inline_bytes[ARGO_UTF8_INLINE]; // Text of a short string.
+    } text;
+    size_t length;                     // Length of the text in bytes.
+    char storage;                      // One of ARGO_UTF8_STORAGE.
+    char ascii;                        // Nonzero if every byte of the text is below 0x80.
+} ARGO_UTF8;
+
+//Pointer to the text of an ARGO_UTF8, wherever it is stored
+#define argo_utf8_bytes(s) ((s)->storage == ARGO_UTF8_SHORT ? (s)->text.inline_bytes : (s)->text.bytes)
+
 /*
  * Structure used to hold a number.
  * The "text_value" field holds a printable/parseable representation of the number
@@ -120,11 +170,13 @@ typedef struct argo_number {
  * which both the "next" and "prev" fields point back to the sentinel object itself.
  *
  * Note that the collection of members of an object is supposed to be regarded as unordered,
- * which would permit it to be represented using a hash map or similar data structure,
- * which we are not doing here.
+ * which would permit it to be represented using a hash map or similar data structure.
+ * The list remains the representation, but lookups by name with argo_object_get (see
+ * access.h) build a hash index of the members the first time they are needed.
  */
 typedef struct argo_object {
     struct argo_value *member_list;
+    struct argo_member_index *index;   // Hash index of the members, NULL until it is built.
 } ARGO_OBJECT;
 
 /*
@@ -134,11 +186,14 @@ typedef struct argo_object {
  * structure serves as the sentinel at the head of the list.
  *
  * Note that elements of an array do not have any name, so the "name" field in each
- * of the elements will be NULL.  Arrays could be represented as actual arrays,
- * but we are not doing that here.
+ * of the elements will be NULL.  As well as being linked into the list, the elements
+ * of an array that is read by the parser are recorded in order in the "elements"
+ * array, so that they can be indexed and scanned directly (see argo_array_at in access.h).
  */
 typedef struct argo_array {
     struct argo_value *element_list;
+    struct argo_value **elements;      // The elements in order (NULL if the array is empty).
+    size_t length;                     // Number of elements.
 } ARGO_ARRAY;
 
 /*
@@ -160,11 +215,19 @@ typedef struct argo_value {
 	struct argo_object object;
 	struct argo_array array;
 	struct argo_string string;
+	struct argo_utf8 utf8;
 	struct argo_number number;
 	ARGO_BASIC basic;
     } content;
 } ARGO_VALUE;
 
+/*
+ * The state that argo's parsers and writers keep while they read or write a document
+ * (see ctx.h). It is passed to each of their functions, so that several documents can be
+ * read or written at once.
+ */
+typedef struct argo_ctx ARGO_CTX;
+
 /*
  * The following value is the maximum number of digits that will be printed
  * for a floating point value.
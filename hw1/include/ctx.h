@@ -0,0 +1,50 @@
+//This header file contains the context that argo's parsers and writers keep their state in.
+//Each function that reads or writes a document takes the context to use as its first argument,
+//so a document can be parsed or written in each of several threads at once, as long as each of them
+//has a context of its own. The functions that don't take a context (those of global.h among them)
+//use the default context, whose state is the variables of global.h
+#ifndef CTX_H
+#define CTX_H
+
+#include <stddef.h>
+#include "argo.h"
+#include "arena.h"
+#include "intern.h"
+
+/*
+ * The state of the parsers and writers, and the scratch space that the parsers reuse
+ * for every document. An ARGO_CTX is set up with argo_ctx_init, which gives the same
+ * state as a process starts with (its values go in an arena of its own), and its space
+ * is given back with argo_ctx_free.
+ */
+struct argo_ctx {
+    int lines_read;                  // Lines read, counting the one being read (argo_lines_read).
+    int chars_read;                  // Characters read on the current line (argo_chars_read).
+    int level;                       // Nesting of the value being written (level).
+    int options;                     // Options, as in global_options (only pretty printing is used).
+    int utf8_strings;                // Nonzero to read strings as ARGO_UTF8 (argo_utf8_strings).
+    int max_depth;                   // Deepest that containers may be nested, or zero for no limit (argo_max_depth).
+    ARGO_ARENA *arena;               // Arena that values are allocated from.
+    ARGO_INTERN *names;              // Table that member names are interned in.
+    ARGO_ARENA own_arena;            // The arena, unless it is argo_value_arena.
+    ARGO_INTERN own_names;           // The table, unless it is argo_names.
+    ARGO_VALUE **element_stack;      // Elements of the arrays being read by argo_ctx_read_value (see argo.c).
+    size_t element_count;
+    size_t element_capacity;
+    struct read_frame *frame_stack;  // Containers being read by argo_ctx_read_value.
+    size_t frame_count;
+    size_t frame_capacity;
+    size_t *tape_stack;              // Containers being written from a tape (see tape.c).
+    size_t tape_depth;
+    size_t tape_size;
+    unsigned char *decoded;          // Space that escaped strings are decoded into (see utf8.c).
+    size_t decoded_size;
+    ARGO_STRING name_scratch;        // Space that member names are read into.
+};
+
+void argo_ctx_init(ARGO_CTX *cx);
+void argo_ctx_free(ARGO_CTX *cx);
+ARGO_CTX *argo_default_ctx_enter(void);
+void argo_default_ctx_leave(ARGO_CTX *cx);
+
+#endif
@@ -0,0 +1,22 @@
+//This header file contains the float formatter used by the argo writer. It finds the shortest
+//string of decimal digits that reads back as exactly the same double (the Ryu algorithm),
+//and writes it into a caller-supplied buffer in argo's canonical "0.ddde+x" form
+#ifndef DTOA_H
+#define DTOA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//Size of a buffer that can hold any formatted double ("-0." + 17 digits + "e-324", with room to spare)
+#define ARGO_DOUBLE_BUFFER 32
+
+//Number of entries in the tables of 125-bit powers of five and their reciprocals (see pow5.c)
+#define ARGO_POW5_INV_ENTRIES 292
+#define ARGO_POW5_ENTRIES 326
+
+extern const uint64_t argo_pow5_inv_split[ARGO_POW5_INV_ENTRIES][2];
+extern const uint64_t argo_pow5_split[ARGO_POW5_ENTRIES][2];
+
+int argo_format_double(double value, char *buf);
+
+#endif
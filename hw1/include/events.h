@@ -0,0 +1,54 @@
+//This header file contains the event-driven (SAX style) interface to the argo parser.
+//Instead of building a tree of argo values, the parser reports each token to a set of
+//callbacks as soon as it is read, so only the nesting of the open containers is kept in memory
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "argo.h"
+#include "input.h"
+#include "writer.h"
+
+//Initial number of open containers that the parser's stack has room for (it is grown on demand)
+#define ARGO_EVENT_STACK 64
+
+/*
+ * Callbacks invoked by argo_parse_events. Any of them can be NULL, in which case
+ * the event is ignored. Each callback returns zero to continue parsing, or nonzero to
+ * stop the parse (which then fails). The strings and numbers passed to the callbacks
+ * are only valid until the callback returns, since the parser reuses their space.
+ */
+typedef struct argo_handler {
+    int (*start_object)(void *ctx);
+    int (*end_object)(void *ctx);
+    int (*start_array)(void *ctx);
+    int (*end_array)(void *ctx);
+    int (*key)(void *ctx, ARGO_STRING *name);       // Name of the next member of the current object.
+    int (*string)(void *ctx, ARGO_STRING *s);
+    int (*number)(void *ctx, ARGO_NUMBER *n);
+    int (*basic)(void *ctx, ARGO_BASIC b);
+} ARGO_HANDLER;
+
+/*
+ * State of the streaming writer used by argo_write_events. It only needs to know
+ * whether a separator is due before the next value, and whether that value follows a key.
+ */
+typedef struct argo_event_writer {
+    ARGO_WRITER out;                 // Writer that collects the JSON until it is flushed.
+    ARGO_CTX *cx;                    // Context of the parse, whose level tracks the nesting of the output.
+    int need_comma;                  // Nonzero if a value was already written at this level.
+    int after_key;                   // Nonzero if the next value is the value of a member.
+} ARGO_EVENT_WRITER;
+
+int argo_parse_events(ARGO_INPUT *in, const ARGO_HANDLER *h, void *ctx);
+int argo_ctx_parse_events(ARGO_CTX *cx, ARGO_INPUT *in, const ARGO_HANDLER *h, void *ctx);
+int argo_validate(ARGO_INPUT *in);
+int argo_ctx_validate(ARGO_CTX *cx, ARGO_INPUT *in);
+int argo_write_events(ARGO_INPUT *in, FILE *out);
+int argo_ctx_write_events(ARGO_CTX *cx, ARGO_INPUT *in, FILE *out);
+
+//Handler that writes canonical (or pretty printed) JSON to an ARGO_EVENT_WRITER
+extern const ARGO_HANDLER argo_writer_handler;
+
+#endif
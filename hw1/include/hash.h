@@ -0,0 +1,83 @@
+//This header file contains hashing of JSON values by their canonical form.
+//The canonical JSON (as -c writes it, without pretty printing) is passed straight from the writer's
+//buffer to the hash as it is produced, so it is never held in full. The 64-bit hash is XXH64 (with
+//a seed of zero), so it is the same as the XXH64 of the output of -c; the 128-bit hash is XXH3-128
+//(also with a seed of zero)
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "argo.h"
+#include "input.h"
+#include "writer.h"
+#include "events.h"
+#include "query.h"
+
+//Number of bytes taken in by each round of XXH64, and by each round of XXH3
+#define ARGO_HASH_STRIPE 32
+#define ARGO_HASH_WIDE_STRIPE 64
+
+//Number of bytes of input that XXH3 holds before taking them in
+#define ARGO_HASH_BUFFER 256
+
+//Space needed for the hexadecimal form of a digest, including the terminating null character
+#define ARGO_DIGEST_HEX 33
+
+/*
+ * State of a hash that is given its input a run at a time. For XXH64, whole stripes
+ * are taken in as soon as they are complete, and the bytes of a partial one are kept
+ * until the next run of input completes it (or the hash is finished). XXH3 takes in
+ * its buffer only once more input follows it, since it finishes with its last stripe.
+ */
+typedef struct argo_hash {
+    uint64_t acc[8];                 // Accumulators: the first four for XXH64, all of them for XXH3.
+    unsigned char buffer[ARGO_HASH_BUFFER];  // Bytes that haven't been taken in yet.
+    size_t held;                     // Number of bytes in buffer.
+    unsigned char last[ARGO_HASH_WIDE_STRIPE];  // For XXH3, the last stripe that was taken in.
+    size_t stripes;                  // For XXH3, the number of stripes taken in since the accumulators were scrambled.
+    uint64_t total;                  // Number of bytes hashed so far.
+    int bits;                        // 64 or 128.
+} ARGO_HASH;
+
+/*
+ * A finished hash. Only low is used for a 64-bit hash.
+ */
+typedef struct argo_digest {
+    uint64_t low;
+    uint64_t high;
+    int bits;
+} ARGO_DIGEST;
+
+/*
+ * Hasher of values and documents, which can be used for any number of them. It
+ * writes their canonical form with a writer whose sink is the hash, so the space
+ * of the writer's buffer is only allocated once.
+ */
+typedef struct argo_hasher {
+    ARGO_EVENT_WRITER w;             // Writer of the canonical form, for argo_writer_handler or argo_writer_value.
+    ARGO_HASH hash;                  // Hash of what has been written so far.
+} ARGO_HASHER;
+
+void argo_hash_init(ARGO_HASH *h, int bits);
+void argo_hash_update(ARGO_HASH *h, const void *bytes, size_t n);
+void argo_hash_final(ARGO_HASH *h, ARGO_DIGEST *d);
+void argo_digest_hex(ARGO_DIGEST *d, char *hex);
+
+int argo_hasher_open(ARGO_HASHER *h, int bits);
+int argo_hasher_close(ARGO_HASHER *h);
+int argo_hash_events(ARGO_HASHER *h, ARGO_INPUT *in, ARGO_DIGEST *d);
+int argo_ctx_hash_events(ARGO_CTX *cx, ARGO_HASHER *h, ARGO_INPUT *in, ARGO_DIGEST *d);
+int argo_hash_value(ARGO_HASHER *h, ARGO_VALUE *v, ARGO_DIGEST *d);
+int argo_ctx_hash_value(ARGO_CTX *cx, ARGO_HASHER *h, ARGO_VALUE *v, ARGO_DIGEST *d);
+
+void argo_writer_digest(ARGO_WRITER *w, ARGO_DIGEST *d);
+int argo_hash_query_to(ARGO_HASHER *h, ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w);
+int argo_ctx_hash_query_to(ARGO_CTX *cx, ARGO_HASHER *h, ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w);
+int argo_hash_write(ARGO_INPUT *in, FILE *out);
+int argo_ctx_hash_write(ARGO_CTX *cx, ARGO_INPUT *in, FILE *out);
+int argo_hash_query(ARGO_QUERY *q, ARGO_INPUT *in, FILE *out);
+int argo_ctx_hash_query(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_INPUT *in, FILE *out);
+
+#endif
@@ -0,0 +1,83 @@
+//This header file contains the input layer used by the argo parser. Instead of calling
+//fgetc/ungetc once per character, the parser reads from a contiguous span of bytes that
+//is either a caller-supplied buffer, a mmap'd regular file, or a block buffer that is
+//refilled from a stream with large fread calls
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "argo.h"
+
+//Size of the refill buffer used when the input can't be mapped (ie, a pipe or terminal)
+#define ARGO_INPUT_BLOCK (1 << 16)
+
+//Number of already consumed bytes kept at the front of the buffer on every refill,
+//so that argo_ungetc can always step back over the last byte that was read
+#define ARGO_INPUT_LOOKBACK 1
+
+/*
+ * An ARGO_INPUT is a window of bytes that the parser reads from.
+ * The bytes in buf[pos..len) have not been consumed yet. When the window runs out
+ * and src is non-NULL, argo_input_refill() slides the unconsumed bytes to the front
+ * of the block buffer and reads the next block from src. Mapped files and memory
+ * buffers hold the entire input in buf, so src is NULL for them.
+ */
+typedef struct argo_input {
+    const unsigned char *buf;        // Bytes currently available to the parser.
+    size_t pos;                      // Offset in buf of the next byte to be read.
+    size_t len;                      // Number of valid bytes in buf.
+    FILE *src;                       // Stream used to refill buf, NULL if buf holds all of the input.
+    FILE *origin;                    // Stream the input was opened on (NULL for memory buffers).
+    unsigned char *block;            // Refill buffer owned by this input (NULL if not refilling).
+    size_t block_size;               // Capacity of the refill buffer.
+    size_t map_len;                  // Length of the mapped region, 0 if the input isn't mapped.
+    bool exact;                      // Nonzero if the stream must not be read past the value being parsed.
+    bool stable;                     // Nonzero if buf outlives the input, so values may point into it.
+    struct argo_index *index;        // Structural index of the buffer (see structural.h), built on first use.
+} ARGO_INPUT;
+
+int argo_input_open_mem(ARGO_INPUT *in, const char *buf, size_t len);
+int argo_input_open_file(ARGO_INPUT *in, FILE *f, bool exact);
+void argo_input_close(ARGO_INPUT *in);
+long argo_input_refill(ARGO_INPUT *in, size_t need);
+
+ARGO_VALUE *argo_read_value_input(ARGO_INPUT *in);
+ARGO_VALUE *argo_read_value_mem(const char *buf, size_t len);
+int argo_read_string_input(ARGO_STRING *s, ARGO_INPUT *in);
+int argo_read_number_input(ARGO_NUMBER *n, ARGO_INPUT *in);
+ARGO_VALUE *argo_ctx_read_value(ARGO_CTX *cx, ARGO_INPUT *in);
+int argo_ctx_read_string(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in);
+int argo_ctx_read_number(ARGO_CTX *cx, ARGO_NUMBER *n, ARGO_INPUT *in);
+
+/*
+ * Return the next byte of input (as an unsigned value) and advance past it,
+ * or EOF if there is no more input.
+ */
+static inline int argo_getc(ARGO_INPUT *in){
+    if (in->pos < in->len) return *(in->buf + in->pos++);
+    if (in->src == NULL || argo_input_refill(in, 1) <= 0) return EOF;
+    return *(in->buf + in->pos++);
+}
+
+/*
+ * Step back over the byte that was most recently returned by argo_getc.
+ * Only a single byte of pushback is guaranteed, which is all the parser needs.
+ * Pushing back EOF is a no-op, the same as it is for ungetc.
+ */
+static inline void argo_ungetc(int c, ARGO_INPUT *in){
+    if (c != EOF && in->pos > 0) in->pos--;
+}
+
+/*
+ * Return the byte that is "ahead" bytes past the next one without consuming anything,
+ * or EOF if the input ends before that.
+ */
+static inline int argo_peek(ARGO_INPUT *in, size_t ahead){
+    if (in->pos + ahead < in->len) return *(in->buf + in->pos + ahead);
+    if (in->src == NULL || argo_input_refill(in, ahead+1) <= (long)ahead) return EOF;
+    return *(in->buf + in->pos + ahead);
+}
+
+#endif
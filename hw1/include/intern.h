@@ -0,0 +1,60 @@
+//This header file contains the table that member names are interned in.
+//Within a document, every member with the same name shares a single copy of it in the arena the document is read into,
+//so records with the same keys don't each store them, and two interned names are the same if and only if
+//their content pointers are. Each copy also keeps its hash, and the bytes it is written out as
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "argo.h"
+
+//Number of slots that an intern table starts with (it doubles whenever it is half full)
+#define ARGO_INTERN_SLOTS 64
+
+//A table that has grown past this many slots is given back when the document it was for is done with
+#define ARGO_INTERN_KEEP (1 << 12)
+
+//Capacity of an interned name, which marks it as one (its space belongs to the table, and it is never grown or freed)
+#define ARGO_INTERNED ((size_t)-1)
+
+/*
+ * The single copy of an interned name, allocated from the arena of a context. Members
+ * with the name point their name's content at "chars", and the rest is found from there.
+ */
+typedef struct argo_interned_name {
+    uint64_t hash;                   // argo_hash_chars of the name.
+    size_t length;                   // Number of characters in the name.
+    const unsigned char *plain;      // Bytes of the name, if every character is written as itself (NULL otherwise).
+    ARGO_CHAR chars[];               // Characters of the name.
+} ARGO_INTERNED_NAME;
+
+/*
+ * Open-addressing (linear probing) hash table of the names interned for the current
+ * document of a context. The names live in the context's arena, so the table empties
+ * itself the first time it is used after the arena has been reset.
+ */
+typedef struct argo_intern {
+    ARGO_INTERNED_NAME **slots;      // The slots (NULL if empty).
+    size_t mask;                     // Number of slots minus one (zero before the table is first used).
+    size_t count;                    // Number of names in the table.
+    size_t generation;               // Generation of the arena that the names belong to.
+} ARGO_INTERN;
+
+//Table of the member names of the document being read in the default context (see ctx.h)
+ARGO_INTERN argo_names;
+
+//Check whether a name is interned, and get its single copy if it is
+#define argo_name_interned(s) ((s)->capacity == ARGO_INTERNED)
+#define argo_interned(s) ((ARGO_INTERNED_NAME *)((char *)(s)->content - offsetof(ARGO_INTERNED_NAME, chars)))
+
+int argo_intern_name(ARGO_STRING *name, const ARGO_CHAR *chars, size_t length);
+int argo_ctx_intern_name(ARGO_CTX *cx, ARGO_STRING *name, const ARGO_CHAR *chars, size_t length);
+uint64_t argo_name_hash(ARGO_STRING *name);
+bool argo_name_equal(ARGO_STRING *a, ARGO_STRING *b);
+bool argo_ctx_name_equal(ARGO_CTX *cx, ARGO_STRING *a, ARGO_STRING *b);
+void argo_intern_free(void);
+void argo_ctx_intern_free(ARGO_CTX *cx);
+
+#endif
@@ -0,0 +1,63 @@
+//This header file contains the on-demand (lazy) interface to a JSON document.
+//Rather than parsing the whole document up front, a cursor is moved over the raw bytes of the input,
+//and only the values that are actually visited are parsed. A container that isn't looked inside is
+//stepped over in one go by matching its brackets, 64 bytes at a time (see structural.h), so finding a
+//few members of a large document costs about as much as reading the bytes in front of them
+#ifndef LAZY_H
+#define LAZY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "argo.h"
+
+//Returned in place of a value when there is none (such as a missing member)
+#define ARGO_LAZY_NONE ((size_t)-1)
+
+/*
+ * A document that is open for on-demand reading. A value in it is referred to by
+ * the offset of its first byte, and the value of the whole document is found with
+ * argo_lazy_root. The bytes are not copied, so they must outlive the document.
+ * Only the parts of the document that are visited are checked: a value that is
+ * skipped only has to have matching brackets (and strings that end).
+ */
+typedef struct argo_lazy {
+    const unsigned char *buf;        // Bytes of the document.
+    size_t len;                      // Number of bytes.
+    ARGO_STRING name;                // Space for a member name that has to be unescaped to be compared.
+} ARGO_LAZY;
+
+/*
+ * Iterator over the elements of an array, or the members of an object, of a lazy
+ * document. Each element is only stepped over (not parsed) when the next one is asked for.
+ */
+typedef struct argo_lazy_iter {
+    ARGO_LAZY *doc;                  // Document the container is in.
+    size_t pos;                      // Offset of the element (or member name) returned last, or of the container before the first.
+    size_t value;                    // Offset of the value returned last (ARGO_LAZY_NONE before the first).
+    bool object;                     // Nonzero if the container is an object.
+} ARGO_LAZY_ITER;
+
+void argo_lazy_open(ARGO_LAZY *d, const char *buf, size_t len);
+void argo_lazy_close(ARGO_LAZY *d);
+size_t argo_lazy_root(ARGO_LAZY *d);
+
+ARGO_VALUE_TYPE argo_lazy_type(ARGO_LAZY *d, size_t v);
+size_t argo_lazy_skip(ARGO_LAZY *d, size_t v);
+size_t argo_lazy_object_get(ARGO_LAZY *d, size_t v, const char *key);
+size_t argo_ctx_lazy_object_get(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, const char *key);
+size_t argo_lazy_object_get_bytes(ARGO_LAZY *d, size_t v, const unsigned char *key, size_t length);
+size_t argo_ctx_lazy_object_get_bytes(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, const unsigned char *key, size_t length);
+size_t argo_lazy_array_at(ARGO_LAZY *d, size_t v, size_t i);
+
+int argo_lazy_iter_open(ARGO_LAZY_ITER *it, ARGO_LAZY *d, size_t v);
+size_t argo_lazy_iter_next(ARGO_LAZY_ITER *it, size_t *name);
+
+int argo_lazy_basic(ARGO_LAZY *d, size_t v, ARGO_BASIC *b);
+int argo_lazy_number(ARGO_LAZY *d, size_t v, ARGO_NUMBER *n);
+int argo_ctx_lazy_number(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, ARGO_NUMBER *n);
+int argo_lazy_string(ARGO_LAZY *d, size_t v, ARGO_STRING *s);
+int argo_ctx_lazy_string(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, ARGO_STRING *s);
+ARGO_VALUE *argo_lazy_value(ARGO_LAZY *d, size_t v);
+ARGO_VALUE *argo_ctx_lazy_value(ARGO_CTX *cx, ARGO_LAZY *d, size_t v);
+
+#endif
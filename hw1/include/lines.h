@@ -0,0 +1,56 @@
+//This header file contains the newline-delimited JSON (NDJSON) mode of argo.
+//The input is a series of records, one JSON value per line, each of which is parsed (and
+//validated, canonicalized, or queried) on its own, reusing the same space for every record
+#ifndef LINES_H
+#define LINES_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "input.h"
+#include "query.h"
+
+//Size of the chunks of whole lines handed out to worker processes with -j (a chunk is bigger if a line is)
+#define ARGO_LINES_CHUNK (1 << 22)
+
+/*
+ * Reader of the records of newline-delimited JSON. Each line is read from the underlying
+ * input without being copied (a stream input's buffer grows to hold the longest line), and
+ * the record is parsed from a memory input over it. Blank lines are skipped. An invalid record
+ * doesn't stop the reader: it is reported, counted, and reading goes on with the next line.
+ */
+typedef struct argo_lines {
+    ARGO_INPUT *in;                  // Input the lines are read from.
+    ARGO_INPUT record;               // Input over the current record.
+    struct argo_index *index;        // Structural index kept for the next record, if record doesn't have it.
+    unsigned long line;              // Line number of the current record.
+    unsigned long records;           // Number of records read so far (blank lines aren't records).
+    unsigned long failed;            // Number of records that were invalid.
+} ARGO_LINES;
+
+/*
+ * A worker process of the -j mode, which handles one chunk of lines (or of the
+ * elements of an array, see split.h) at a time.
+ * Its output and error messages are written to temporary files that are copied
+ * out once it has finished with its chunk.
+ */
+typedef struct lines_worker {
+    pid_t pid;                       // Process handling the worker's current chunk.
+    int out;                         // File descriptor of the file holding the output of the chunk.
+    int err;                         // File descriptor of the file holding the error messages for the chunk.
+    unsigned long line;              // Number of the first line of the chunk.
+} LINES_WORKER;
+
+void argo_lines_open(ARGO_LINES *r, ARGO_INPUT *in);
+ARGO_INPUT *argo_lines_next(ARGO_LINES *r);
+int argo_lines_check(ARGO_LINES *r, int ret);
+int argo_lines_close(ARGO_LINES *r);
+
+int argo_validate_lines(ARGO_INPUT *in);
+int argo_write_lines(ARGO_INPUT *in, FILE *out);
+int argo_query_lines(ARGO_QUERY *q, ARGO_INPUT *in, FILE *out);
+
+int argo_worker_sink(void *ctx, const unsigned char *bytes, size_t len);
+int argo_worker_drain(int fd, FILE *to);
+
+#endif
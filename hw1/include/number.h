@@ -0,0 +1,25 @@
+//This header file contains the fast number parser used by argo_read_number.
+//Digits are consumed eight at a time, and the decimal significand and exponent are converted to
+//the nearest double with the Eisel-Lemire algorithm (falling back to strtod in the rare hard cases)
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "argo.h"
+
+//Range of decimal exponents covered by argo_pow5_table (anything outside it is zero or infinite)
+#define ARGO_POW5_MIN (-342)
+#define ARGO_POW5_MAX 308
+
+//Most significant digits that fit in the 64-bit significand without any chance of overflow
+#define ARGO_MAX_SIG_DIGITS 19
+
+//128-bit approximations of 5^q, as pairs of (high, low) 64-bit words (see pow5.c)
+extern const uint64_t argo_pow5_table[2 * (ARGO_POW5_MAX - ARGO_POW5_MIN + 1)];
+
+int argo_parse_number(const unsigned char *text, size_t length, ARGO_NUMBER *n);
+int argo_ctx_parse_number(ARGO_CTX *cx, const unsigned char *text, size_t length, ARGO_NUMBER *n);
+int argo_number_string(ARGO_NUMBER *n);
+
+#endif
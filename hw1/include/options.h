@@ -0,0 +1,67 @@
+//This header file contains the settings of argo that global.h (which is replaced during grading) has no
+//place for, and the state that goes with them. Like global_options, they are set from the command line
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "arena.h"
+
+/*
+ * Argo values are allocated from the following arena (see arena.h), using
+ * argo_value_alloc(), in place of the fixed argo_value_storage of global.h.  The
+ * arena grows a chunk at a time as values are added, so there is no fixed limit on
+ * the number of values in a document.  It can be reset with argo_arena_reset() once
+ * the values of a document are no longer needed, and its "peak" and "peak_values"
+ * fields record the most space that a document has needed.
+ */
+ARGO_ARENA argo_value_arena;
+
+/*
+ * If the following variable is nonzero, then the parser stores string values as
+ * ARGO_UTF8 (type ARGO_UTF8_TYPE) rather than ARGO_STRING, and copies member names
+ * into argo_value_arena rather than allocating space for each of them separately.
+ * A string containing a \u escape for a non-ASCII character is still stored as an
+ * ARGO_STRING, since its bytes could then be told apart from the same text written out.
+ */
+int argo_utf8_strings;
+
+/*
+ * Options that are not encoded in global_options, set by validargs.
+ *   If -q QUERY is specified, then the QUERY_OPTION bit is set and argo_query_text
+ *   points to QUERY.  The input is read as with -c (and -p, if it is also given),
+ *   but only the values selected by the query (see query.h) are output, one per line.
+ *   If --lines is specified, then the LINES_OPTION bit is set.  The input is read as
+ *   newline-delimited JSON (see lines.h), with -v, -c, or -q applied to each line on its own.
+ *   If -j N is specified, then the JOBS_OPTION bit is set and argo_jobs is N, the number
+ *   of processes among which the lines (with --lines) or the elements of a top level
+ *   array (see split.h) are divided.  Otherwise argo_jobs is 1.
+ *   If --depth N is specified, then the DEPTH_OPTION bit is set and argo_max_depth
+ *   is N, the deepest that containers may be nested in the input.
+ *   If --hash (or --hash128) is specified, then the HASH_OPTION bit is set and argo_hash_bits
+ *   is 64 (or 128).  The input is read as with -c, but instead of the canonical JSON, its hash
+ *   (see hash.h) is output in hexadecimal on a line of its own.  With --lines, there is such a
+ *   line for each valid record, and with -q, for each value selected.
+ *   If --sort-keys is specified, then the SORT_OPTION bit is set.  The members of each object
+ *   are output in order of their names (see sort.h), by -c, -q, and --hash alike.
+ */
+int argo_extra_options;
+char *argo_query_text;
+int argo_jobs;
+int argo_hash_bits;
+
+/*
+ * Deepest that the parsers let arrays and objects be nested (the outermost one
+ * being at depth 1), or zero if there is no limit.  Nesting is kept track of on
+ * stacks that grow as needed rather than by recursion, so this only guards against
+ * the memory that hostile input could make them take.  Input nested more deeply
+ * is reported as an error.
+ */
+int argo_max_depth;
+
+#define QUERY_OPTION (0x1)
+#define LINES_OPTION (0x2)
+#define JOBS_OPTION (0x4)
+#define DEPTH_OPTION (0x8)
+#define HASH_OPTION (0x10)
+#define SORT_OPTION (0x20)
+
+#endif
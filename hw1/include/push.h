@@ -0,0 +1,71 @@
+//This header file contains the push (incremental) interface to the argo parser.
+//Input is fed to the parser in chunks of any size as it arrives (for example, from a non-blocking
+//socket), and the parser keeps its state from one chunk to the next, so nothing has to be
+//buffered until a whole message has arrived. Tokens may be split anywhere between chunks
+#ifndef PUSH_H
+#define PUSH_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "argo.h"
+#include "events.h"
+
+//Initial number of open containers, and of completed values, that the parser has room for (both grow on demand)
+#define ARGO_PARSER_STACK 64
+
+/*
+ * State of the handler that builds argo values from the events of a push parser.
+ * Values are allocated from the arena of a context, just as argo_ctx_read_value allocates them.
+ * Each member is linked into its container as soon as it is complete, so a container
+ * is ready to use as soon as it is closed.
+ */
+typedef struct argo_builder {
+    ARGO_CTX *cx;                    // Context whose arena values are built in (set by each call that feeds the parser).
+    ARGO_VALUE **open;               // Containers being built, innermost last.
+    size_t depth;                    // Number of containers being built.
+    size_t size;                     // Capacity of open.
+    ARGO_STRING name;                // Name for the next value, if it is a member (content is NULL otherwise).
+    ARGO_VALUE **values;             // Completed top level values, in the order they were read.
+    size_t count;                    // Number of values in values.
+    size_t taken;                    // Number of those that have been taken by argo_parser_value.
+    size_t capacity;                 // Capacity of values.
+} ARGO_BUILDER;
+
+/*
+ * A push parser. The input is a sequence of JSON values (separated by whitespace where
+ * that is needed to tell them apart), which are reported to a handler as a sequence of
+ * events, as argo_parse_events reports them. A token that is cut off by the end of a
+ * chunk is kept until the rest of it arrives. Strings (and member names) that arrive whole
+ * are decoded straight from the chunk they are in, without being copied.
+ */
+typedef struct argo_parser {
+    const ARGO_HANDLER *handler;     // Handler that events are reported to.
+    void *ctx;                       // Passed unchanged to the handler.
+    int state;                       // What the parser expects next (see push.c).
+    int token;                       // Kind of token that was cut off by the end of a chunk, or zero if none.
+    bool escaped;                    // Nonzero if the cut off token is a string whose next byte is escaped.
+    unsigned char *text;             // Bytes of the cut off token received so far.
+    size_t length;                   // Number of bytes in text.
+    size_t size;                     // Capacity of text.
+    char *stack;                     // Opening characters of the open containers.
+    size_t depth;                    // Number of open containers.
+    size_t stack_size;               // Capacity of stack.
+    ARGO_STRING scratch;             // Space that strings are decoded into before they are reported.
+    struct argo_index *index;        // Structural index used to decode strings, reused for each of them.
+    int line;                        // Line of input that the parser has reached (for error messages).
+    int error;                       // Nonzero once the input has turned out to be invalid.
+    ARGO_BUILDER build;              // State of the value builder, if events aren't reported to another handler.
+} ARGO_PARSER;
+
+int argo_parser_open(ARGO_PARSER *p, const ARGO_HANDLER *h, void *ctx);
+int argo_parser_feed(ARGO_PARSER *p, const char *buf, size_t len);
+int argo_ctx_parser_feed(ARGO_CTX *cx, ARGO_PARSER *p, const char *buf, size_t len);
+int argo_parser_finish(ARGO_PARSER *p);
+int argo_ctx_parser_finish(ARGO_CTX *cx, ARGO_PARSER *p);
+ARGO_VALUE *argo_parser_value(ARGO_PARSER *p);
+void argo_parser_close(ARGO_PARSER *p);
+
+//Handler that builds argo values from events, with an ARGO_BUILDER as its context
+extern const ARGO_HANDLER argo_builder_handler;
+
+#endif
@@ -0,0 +1,59 @@
+//This header file contains the query engine, which selects values inside a document.
+//A query is given either as a JSON Pointer ("/a/b/0") or as a simple JSONPath ("$.a.b[0]", "$.a[*]"),
+//and is compiled once into a program of steps that can then be run against any number of documents
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "argo.h"
+#include "input.h"
+#include "writer.h"
+
+//Kinds of step in a compiled query
+typedef enum {
+    ARGO_STEP_NAME,                    // Member of an object with the given name (JSONPath .name or ['name']).
+    ARGO_STEP_INDEX,                   // Element of an array (JSONPath [n], counting from the end if negative).
+    ARGO_STEP_TOKEN,                   // JSON Pointer token: a member name, or an element if the value is an array.
+    ARGO_STEP_WILDCARD                 // Every member or element (JSONPath .* or [*]).
+} ARGO_STEP_KIND;
+
+/*
+ * One step of a compiled query. Names are kept decoded (with the escapes of the
+ * query syntax replaced), along with their hash, so that member indexes can be
+ * searched without hashing the name again for every document.
+ */
+typedef struct argo_step {
+    ARGO_STEP_KIND kind;
+    const unsigned char *name;       // Name of the member (NAME and TOKEN steps).
+    size_t length;                   // Number of bytes in name.
+    uint64_t hash;                   // argo_hash_bytes of name.
+    long index;                      // Position of the element (INDEX steps, and TOKEN steps that are
+                                     // array indexes; -1 for other TOKEN steps).
+} ARGO_STEP;
+
+/*
+ * A compiled query. The steps are followed in order from the value that the query is
+ * run against. The decoded names are stored in the same allocation, after the steps.
+ */
+typedef struct argo_query {
+    size_t count;                    // Number of steps.
+    int multiple;                    // Nonzero if the query has a wildcard, so it can select several values.
+    ARGO_STEP steps[];               // The steps themselves.
+} ARGO_QUERY;
+
+ARGO_QUERY *argo_query_compile(const char *expr);
+void argo_query_free(ARGO_QUERY *q);
+size_t argo_query_eval(ARGO_QUERY *q, ARGO_VALUE *root, int (*match)(void *ctx, ARGO_VALUE *v), void *ctx);
+size_t argo_ctx_query_eval(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_VALUE *root, int (*match)(void *ctx, ARGO_VALUE *v), void *ctx);
+ARGO_VALUE *argo_query_first(ARGO_QUERY *q, ARGO_VALUE *root);
+ARGO_VALUE *argo_ctx_query_first(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_VALUE *root);
+ARGO_VALUE *argo_query(ARGO_VALUE *root, const char *expr);
+ARGO_VALUE *argo_ctx_query(ARGO_CTX *cx, ARGO_VALUE *root, const char *expr);
+int argo_query_write_to(ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w);
+int argo_ctx_query_write_to(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w);
+int argo_query_write(ARGO_QUERY *q, ARGO_INPUT *in, FILE *out);
+int argo_ctx_query_write(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_INPUT *in, FILE *out);
+
+#endif
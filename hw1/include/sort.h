@@ -0,0 +1,27 @@
+//This header file contains the sorted-keys canonical form of argo values.
+//The members of every object are put in order of their names (by code point, with a name coming
+//before the longer names that it begins), so that documents that differ only in the order of their
+//members have the same canonical form. The members of a wide object are sorted by their names a byte
+//of a character at a time (most significant first), dealing them into buckets by that byte, and only
+//the few members that end up together in a bucket are sorted by comparing their names
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "argo.h"
+#include "input.h"
+
+//Number of members at or below which they are sorted by insertion rather than dealt into buckets
+#define ARGO_SORT_SMALL 16
+
+//Number of buckets that members are dealt into: one for names that have ended, and one for each value of a byte
+#define ARGO_SORT_BUCKETS 257
+
+int argo_sort_members(ARGO_VALUE *v);
+ARGO_VALUE *argo_read_value_canonical(ARGO_INPUT *in);
+ARGO_VALUE *argo_ctx_read_value_canonical(ARGO_CTX *cx, ARGO_INPUT *in);
+int argo_write_sorted(ARGO_INPUT *in, FILE *out);
+int argo_ctx_write_sorted(ARGO_CTX *cx, ARGO_INPUT *in, FILE *out);
+
+#endif
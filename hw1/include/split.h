@@ -0,0 +1,35 @@
+//This header file contains the -j mode for a document that is one large array.
+//The top level elements of the array are found by a structural pre-scan (64 bytes at a time, as in
+//structural.h), and runs of them are handed out to worker processes, whose output is spliced back together.
+//When the array is read into argo values, the runs are read by threads instead, each into an arena of its own,
+//and their elements are spliced together into one array
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "input.h"
+#include "lines.h"
+
+//Size of the runs of elements handed out to worker processes (a run is bigger if an element is)
+#define ARGO_SPLIT_CHUNK ARGO_LINES_CHUNK
+
+/*
+ * A run of consecutive top level elements of an array. Its bytes run from the first
+ * byte after the '[' or ',' in front of its first element, up to and including the ','
+ * after its last element (or the ']' that closes the array, for the last run).
+ */
+typedef struct argo_slice {
+    size_t start;                    // Buffer offset of the first byte of the run.
+    size_t end;                      // Buffer offset just past the ',' or ']' that ends the run.
+    unsigned long line;              // Line that the run starts on.
+} ARGO_SLICE;
+
+int argo_split_array(const unsigned char *buf, size_t len, size_t chunk, ARGO_SLICE **slices, size_t *count);
+int argo_validate_split(ARGO_INPUT *in);
+int argo_write_split(ARGO_INPUT *in, FILE *out);
+ARGO_VALUE *argo_read_value_split(ARGO_INPUT *in);
+ARGO_VALUE *argo_ctx_read_value_split(ARGO_CTX *cx, ARGO_INPUT *in);
+
+#endif
@@ -0,0 +1,60 @@
+//This header file contains the structural index ("stage 1") of the argo parser.
+//Blocks of 64 input bytes are classified at once with SSE2/AVX2 (or a lookup table if neither
+//is available), producing one bit per byte for each class of character that the parser cares about
+#ifndef STRUCTURAL_H
+#define STRUCTURAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "input.h"
+
+//Number of bytes classified at once, one per bit of a mask
+#define ARGO_BLOCK_SIZE 64
+//Number of blocks indexed at a time (the index covers a window of 8K bytes of input)
+#define ARGO_INDEX_BLOCKS 128
+
+/*
+ * Raw classification of one 64-byte block. Bit i of each mask is set if byte i
+ * of the block belongs to the class. These don't depend on anything outside the block.
+ * The index only classifies blocks into ws, nl and special, which is all it keeps.
+ */
+typedef struct argo_block_masks {
+    uint64_t ws;                     // ' ', '\t', '\n', '\r'
+    uint64_t nl;                     // '\n'
+    uint64_t quote;                  // '"', whether or not it is escaped
+    uint64_t bslash;                 // '\\'
+    uint64_t ctrl;                   // Bytes below 0x20
+    uint64_t op;                     // '{', '}', '[', ']', ':', ',', whether or not they are in a string
+    uint64_t special;                // quote | bslash | ctrl: the bytes that end a verbatim run in a string
+} ARGO_BLOCK_MASKS;
+
+/*
+ * Index of a window of input. Block i of the window starts at buffer offset
+ * base + 64*i. The masks only depend on the bytes themselves, not on whether
+ * they are inside a string, so the parser uses them where it already knows
+ * which it is: to skip the whitespace between tokens, and to copy the runs of
+ * a string that need no decoding. (Unescaped quotes and the structural
+ * characters outside of strings are found from ARGO_BLOCK_MASKS, with
+ * argo_find_escaped and argo_prefix_xor, by the scans that skip whole values.)
+ */
+typedef struct argo_index {
+    size_t base;                     // Buffer offset of the first byte in the window.
+    size_t end;                      // Buffer offset just past the last indexed byte.
+    uint64_t ws[ARGO_INDEX_BLOCKS];          // Whitespace.
+    uint64_t nl[ARGO_INDEX_BLOCKS];          // Newlines (for keeping the line count).
+    uint64_t special[ARGO_INDEX_BLOCKS];     // Quotes, backslashes, and control characters (these end a verbatim run in a string).
+} ARGO_INDEX;
+
+void argo_classify_block(const unsigned char *p, ARGO_BLOCK_MASKS *m);
+uint64_t argo_find_escaped(uint64_t bslash, uint64_t *prev_escaped);
+uint64_t argo_prefix_xor(uint64_t x);
+
+int argo_next_token(ARGO_CTX *cx, ARGO_INPUT *in);
+size_t argo_string_span(ARGO_INPUT *in);
+void argo_index_invalidate(ARGO_INPUT *in);
+void argo_index_attach(ARGO_INPUT *in, ARGO_INDEX *x);
+ARGO_INDEX *argo_index_detach(ARGO_INPUT *in);
+void argo_index_free(ARGO_INPUT *in);
+
+#endif
@@ -0,0 +1,150 @@
+//This header file contains the binary tape format for argo documents.
+//A document is saved as a flat array of 64-bit entries followed by the text of its strings.
+//Entries refer to each other and to the text by offset, never by pointer, so a saved tape can be
+//mapped straight back into memory and read where it lies, without being parsed again.
+//A tape can also be built straight from the input, as a compact alternative to a tree of argo values
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "argo.h"
+#include "input.h"
+#include "writer.h"
+#include "events.h"
+
+//First bytes of a tape file, and the version of the format it is in
+#define ARGO_TAPE_MAGIC "ARGOTAPE"
+#define ARGO_TAPE_VERSION 1
+
+//Written in the header in the byte order of the machine that saved the tape, so that a tape from a machine with another order is refused
+#define ARGO_TAPE_ORDER 0x01020304
+
+//Returned in place of an entry when there is none (such as a missing member)
+#define ARGO_TAPE_NONE ((size_t)-1)
+
+//Tag (top byte) and payload (the other 56 bits) of an entry
+#define argo_tape_tag(e) ((int)((e) >> 56))
+#define argo_tape_payload(e) ((e) & 0x00FFFFFFFFFFFFFFULL)
+
+//Payload of a member name entry for a member whose name has no content (see argo_writer_value)
+#define ARGO_TAPE_NO_TEXT 0x00FFFFFFFFFFFFFFULL
+
+//Largest count that the start of a container records (longer containers are counted when asked)
+#define ARGO_TAPE_MAX_COUNT 0xFFFFFF
+
+/*
+ * Tags of the entries on a tape. Every value takes one entry, apart from numbers,
+ * which take two (the second holds the bits of the int or double). The start of a
+ * container holds the number of its elements (or members) in bits 32-55, and the
+ * index of the entry just after its end in bits 0-31, so it can be skipped in one step.
+ * The end holds the index of the start. Each member of an object is a name (a string
+ * entry) followed by its value. A string entry holds the offset of its text, which is
+ * a 32-bit length followed by that many bytes (or characters, for a wide string).
+ */
+typedef enum {
+    ARGO_TAPE_NULL = 'n',
+    ARGO_TAPE_TRUE = 't',
+    ARGO_TAPE_FALSE = 'f',
+    ARGO_TAPE_INT = 'l',               // Next entry is a long.
+    ARGO_TAPE_DOUBLE = 'd',            // Next entry is the bits of a double.
+    ARGO_TAPE_BYTES = '"',             // String whose characters are all below 0x100, one byte each.
+    ARGO_TAPE_WIDE = 'w',              // String with larger characters, four bytes each.
+    ARGO_TAPE_OBJECT = '{',
+    ARGO_TAPE_OBJECT_END = '}',
+    ARGO_TAPE_ARRAY = '[',
+    ARGO_TAPE_ARRAY_END = ']'
+} ARGO_TAPE_TAG;
+
+/*
+ * Header at the start of a tape file. It is followed by the entries, and then by
+ * the text of the strings, so the size of the file is given by the header.
+ */
+typedef struct argo_tape_header {
+    char magic[8];                   // ARGO_TAPE_MAGIC (without its null terminator).
+    uint32_t version;                // ARGO_TAPE_VERSION.
+    uint32_t order;                  // ARGO_TAPE_ORDER, as stored by the machine that saved the tape.
+    uint64_t entries;                // Number of entries.
+    uint64_t text;                   // Number of bytes of string text.
+} ARGO_TAPE_HEADER;
+
+/*
+ * A tape that is open for reading. A value on the tape is referred to by the
+ * index of its first entry, and the value of the whole document is entry 0
+ * (if the tape holds several documents, each follows the one before it).
+ */
+typedef struct argo_tape {
+    const uint64_t *entries;         // The entries.
+    size_t count;                    // Number of entries.
+    const unsigned char *text;       // Text of the strings.
+    size_t length;                   // Number of bytes of text.
+    void *map;                       // Mapping of the tape file, or NULL if the tape wasn't loaded from one.
+    size_t map_len;                  // Length of the mapping.
+    bool owned;                      // Nonzero if the entries and text were built in memory (and are freed on close).
+} ARGO_TAPE;
+
+/*
+ * State of a tape being built, either from a value (by argo_tape_save) or from the
+ * events of a parser (with argo_tape_handler). The starts of the containers that are
+ * still open are stacked, so that each can be given its end once it is closed.
+ */
+typedef struct argo_tape_builder {
+    uint64_t *entries;               // Entries so far.
+    size_t count;                    // Number of entries.
+    size_t size;                     // Capacity of entries.
+    unsigned char *text;             // Text of the strings so far.
+    size_t length;                   // Number of bytes of text.
+    size_t capacity;                 // Capacity of text.
+    size_t *open;                    // Indexes of the starts of the open containers, innermost last.
+    size_t depth;                    // Number of open containers.
+    size_t open_size;                // Capacity of open.
+    struct save_frame *saved;        // Where argo_tape_save is in each open container (see tape.c).
+    size_t saved_size;               // Capacity of saved.
+} ARGO_TAPE_BUILDER;
+
+/*
+ * Iterator over the elements of an array, or the members of an object, on a tape.
+ * The entries are visited in order, with each nested container skipped in one step.
+ */
+typedef struct argo_tape_iter {
+    ARGO_TAPE *tape;                 // Tape the container is on.
+    size_t pos;                      // Index of the next element (or of the name of the next member).
+    size_t end;                      // Index of the end of the container.
+    bool object;                     // Nonzero if the container is an object.
+} ARGO_TAPE_ITER;
+
+void argo_tape_builder_open(ARGO_TAPE_BUILDER *b);
+int argo_tape_builder_finish(ARGO_TAPE_BUILDER *b, ARGO_TAPE *t);
+void argo_tape_builder_close(ARGO_TAPE_BUILDER *b);
+int argo_read_tape(ARGO_TAPE *t, ARGO_INPUT *in);
+
+int argo_tape_save(ARGO_VALUE *v, FILE *out);
+int argo_tape_dump(ARGO_TAPE *t, FILE *out);
+int argo_tape_load(ARGO_TAPE *t, FILE *f);
+int argo_tape_open_mem(ARGO_TAPE *t, const void *buf, size_t len);
+void argo_tape_close(ARGO_TAPE *t);
+
+ARGO_VALUE_TYPE argo_tape_type(ARGO_TAPE *t, size_t v);
+size_t argo_tape_next(ARGO_TAPE *t, size_t v);
+ARGO_BASIC argo_tape_basic(ARGO_TAPE *t, size_t v);
+int argo_tape_number(ARGO_TAPE *t, size_t v, ARGO_NUMBER *n);
+const unsigned char *argo_tape_bytes(ARGO_TAPE *t, size_t v, size_t *length);
+int argo_tape_chars(ARGO_TAPE *t, size_t v, ARGO_STRING *out);
+size_t argo_tape_array_len(ARGO_TAPE *t, size_t v);
+size_t argo_tape_array_at(ARGO_TAPE *t, size_t v, size_t i);
+size_t argo_tape_object_get(ARGO_TAPE *t, size_t v, const char *key);
+size_t argo_tape_object_get_bytes(ARGO_TAPE *t, size_t v, const unsigned char *key, size_t length);
+
+int argo_tape_iter_open(ARGO_TAPE_ITER *it, ARGO_TAPE *t, size_t v);
+size_t argo_tape_iter_next(ARGO_TAPE_ITER *it, size_t *name);
+
+int argo_tape_writer_value(ARGO_WRITER *w, ARGO_TAPE *t, size_t v);
+int argo_ctx_tape_writer_value(ARGO_CTX *cx, ARGO_WRITER *w, ARGO_TAPE *t, size_t v);
+int argo_tape_write_value(ARGO_TAPE *t, size_t v, FILE *f);
+
+//Handler that adds the values read by a parser to a tape, with an ARGO_TAPE_BUILDER as its context
+extern const ARGO_HANDLER argo_tape_handler;
+
+#endif
@@ -0,0 +1,21 @@
+//This header file contains the functions for the compact ARGO_UTF8 string representation
+//(the structure itself is defined in argo.h, since it is part of ARGO_VALUE).
+//Strings are kept as bytes, short ones inline, and long ones without escapes as slices of the input
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "argo.h"
+#include "input.h"
+#include "writer.h"
+
+int argo_read_utf8_value(ARGO_CTX *cx, ARGO_VALUE *v, ARGO_INPUT *in);
+int argo_read_name(ARGO_CTX *cx, ARGO_STRING *name, ARGO_INPUT *in);
+int argo_utf8_set(ARGO_CTX *cx, ARGO_UTF8 *s, const unsigned char *bytes, size_t length, bool borrow);
+int argo_utf8_to_string(ARGO_UTF8 *s, ARGO_STRING *out);
+int argo_utf8_equal(ARGO_UTF8 *s, const char *text, size_t length);
+int argo_writer_utf8(ARGO_WRITER *w, ARGO_UTF8 *s);
+int argo_write_utf8(ARGO_UTF8 *s, FILE *f);
+
+#endif
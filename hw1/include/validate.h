@@ -0,0 +1,15 @@
+//This header file contains the strict checks that -v makes on the contents of strings.
+//Rather than being decoded, a string is stepped over in runs of ordinary bytes (found 64 bytes at a
+//time, see structural.h), each of which is checked to be well-formed UTF-8 in one go (32 bytes at a
+//time with AVX2, using lookup tables indexed by the nibbles of each byte and the one before it)
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "input.h"
+
+bool argo_utf8_valid(const unsigned char *p, size_t n);
+int argo_validate_string_rest(ARGO_CTX *cx, ARGO_INPUT *in);
+
+#endif
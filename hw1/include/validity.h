@@ -1,6 +1,7 @@
 //This header file will be used to make the numParser function available to all source files
 #include <stdbool.h>
 #include "argo.h"
+#include "input.h"
 #ifndef VALIDITY_H
 #define VALIDITY_H
 
@@ -8,7 +9,6 @@
 
 int numParser(char* arg1);
 double reverseNum(long num);
-double parseExp(ARGO_NUMBER* n, int* expPointer, FILE *f);
 //level is used to keep track of which level a argo value 
 //is in the data structure representing a json file
 //A level of 0 or 1 indicates that the argo value is on the highest level
@@ -22,17 +22,20 @@ int level;
 #define is_first_exp(b, c) ((b)>0 && (c)==0)
 //Use is_close_comma to determine if a , } or ] appears
 #define is_close_comma(c) ((c) == ',' || (c) == '}' || (c) == ']')
+//Use is_value_end to determine if a char (or the end of the input) can follow a number or basic value
+#define is_value_end(c) (is_close_comma(c) || argo_is_whitespace(c) || (c) == EOF)
+//Use is_number_char to determine if a char can appear in a JSON number
+#define is_number_char(c) (argo_is_digit(c) || (c) == ARGO_PERIOD || argo_is_exponent(c) || (c) == ARGO_MINUS || (c) == ARGO_PLUS)
 //Use is_dot_exp_neg to determine if this char is one of those 3 chars
 #define is_dot_exp_neg(c) ((c) == '.' || (c) == '-' || (c) == 'e')
 #define is_lowercase_hex(c) ((c) >= 'a' && (c) <= 'f')
 //Declare function prototypes here
-//This will be used to detect if pretty print is enabled. If so, then it'll print a 
-//newline ot the output stream along with necessary indentation
-void pretty_newline_detector(FILE *f);
-void write_float(double value, FILE *f);
-void parseUnicode(ARGO_STRING* n, FILE *f);
-bool isUnicode(FILE *f, int count);
-int argo_read_array(ARGO_ARRAY *n, FILE *f);
-int argo_read_objectArray(ARGO_VALUE *n, FILE *f);
-int argo_read_basic(char basic, ARGO_BASIC *n, FILE *f);
+int argo_read_string_append(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in);
+int argo_read_string_rest(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in);
+int argo_append_span(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in);
+int argo_append_bytes(ARGO_STRING *s, const unsigned char *bytes, size_t count);
+void parseUnicode(ARGO_STRING* n, ARGO_INPUT *in);
+bool isUnicode(ARGO_INPUT *in);
+int argo_read_objectArray(ARGO_CTX *cx, ARGO_VALUE *n, ARGO_INPUT *in);
+int argo_read_basic(ARGO_CTX *cx, char basic, ARGO_BASIC *n, ARGO_INPUT *in);
 #endif
\ No newline at end of file
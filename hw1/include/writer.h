@@ -0,0 +1,109 @@
+//This header file contains the output layer used by the argo writer. Instead of calling fprintf
+//once per character, output is collected in a large buffer that is handed to the stream (or to
+//another consumer of the output) with a single call each time it fills up
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "argo.h"
+
+//Size of the output buffer
+#define ARGO_WRITER_BUFFER (1 << 16)
+
+//Value of the mark of a writer when nothing is held back (see argo_writer_mark)
+#define ARGO_NO_MARK ((size_t)-1)
+
+//Characters that are written as themselves (see argo_writer_char)
+#define is_plain_char(c) ((c) >= 31 && (c) < 0xFF && (c) != ARGO_QUOTE && (c) != ARGO_BSLASH)
+
+//Length of the longest run of indentation that is written with a single copy (longer ones take several)
+#define ARGO_INDENT_RUN 256
+
+//A container that argo_writer_value is in the middle of writing
+typedef struct argo_writer_frame {
+    ARGO_VALUE *container;           // The container.
+    ARGO_VALUE *child;               // Member or element being written.
+} ARGO_WRITER_FRAME;
+
+/*
+ * An ARGO_WRITER collects output in buf. When buf is full (or the writer is flushed),
+ * its contents are passed to sink, if there is one, and written to out otherwise.
+ * Pretty printing is decided once, when the writer is opened, from the options of a
+ * context (those of the default context, which are global_options, for argo_writer_open).
+ * Output after a mark is held back (the buffer grows to hold it if need be) until it
+ * is either committed or discarded, so that a value can be withdrawn if it turns out
+ * to be invalid part way through.
+ */
+typedef struct argo_writer {
+    unsigned char *buf;              // Output that hasn't been flushed yet.
+    size_t len;                      // Number of bytes in buf.
+    size_t size;                     // Capacity of buf.
+    FILE *out;                       // Stream that output is flushed to, if there is no sink.
+    int (*sink)(void *ctx, const unsigned char *bytes, size_t len);  // Consumer of flushed output (or NULL).
+    void *sink_ctx;                  // Passed unchanged to sink.
+    int indent;                      // Spaces per level of nesting when pretty printing, -1 otherwise.
+    int error;                       // Nonzero once output has failed.
+    size_t mark;                     // Offset in buf of the output held back, or ARGO_NO_MARK.
+    ARGO_WRITER_FRAME *frames;       // Containers being written by argo_writer_value, innermost last.
+    size_t depth;                    // Number of frames in use.
+    size_t frames_size;              // Capacity of frames.
+} ARGO_WRITER;
+
+int argo_writer_open(ARGO_WRITER *w, FILE *out);
+int argo_ctx_writer_open(ARGO_CTX *cx, ARGO_WRITER *w, FILE *out);
+int argo_writer_open_sink(ARGO_WRITER *w, int (*sink)(void *, const unsigned char *, size_t), void *ctx);
+int argo_ctx_writer_open_sink(ARGO_CTX *cx, ARGO_WRITER *w, int (*sink)(void *, const unsigned char *, size_t), void *ctx);
+int argo_writer_flush(ARGO_WRITER *w);
+int argo_writer_close(ARGO_WRITER *w);
+void argo_writer_write(ARGO_WRITER *w, const void *bytes, size_t n);
+void argo_writer_newline(ARGO_WRITER *w);
+void argo_ctx_writer_newline(ARGO_CTX *cx, ARGO_WRITER *w);
+void argo_writer_char(ARGO_WRITER *w, ARGO_CHAR c);
+
+int argo_writer_value(ARGO_WRITER *w, ARGO_VALUE *v);
+int argo_ctx_writer_value(ARGO_CTX *cx, ARGO_WRITER *w, ARGO_VALUE *v);
+int argo_ctx_write_value(ARGO_CTX *cx, ARGO_VALUE *v, FILE *f);
+int argo_writer_string(ARGO_WRITER *w, ARGO_STRING *s);
+int argo_writer_number(ARGO_WRITER *w, ARGO_NUMBER *n);
+int argo_writer_basic(ARGO_WRITER *w, ARGO_BASIC b);
+
+//Make room for at least n (<= ARGO_WRITER_BUFFER) more bytes, and return where they go
+static inline unsigned char *argo_writer_reserve(ARGO_WRITER *w, size_t n){
+    if (w->size - w->len < n) argo_writer_flush(w);
+    return w->buf + w->len;
+}
+
+//Append one byte to the output
+static inline void argo_writer_put(ARGO_WRITER *w, unsigned char c){
+    if (w->len == w->size) argo_writer_flush(w);
+    *(w->buf + w->len++) = c;
+}
+
+//Append a run of bytes to the output
+static inline void argo_writer_bytes(ARGO_WRITER *w, const void *bytes, size_t n){
+    if (w->size - w->len < n){
+        argo_writer_write(w, bytes, n);
+        return;
+    }
+    __builtin_memcpy(w->buf + w->len, bytes, n);
+    w->len += n;
+}
+
+//Start holding back output, so that everything written from here on can be discarded
+static inline void argo_writer_mark(ARGO_WRITER *w){
+    w->mark = w->len;
+}
+
+//Let the output held back since the mark be flushed
+static inline void argo_writer_commit(ARGO_WRITER *w){
+    w->mark = ARGO_NO_MARK;
+}
+
+//Throw away the output written since the mark
+static inline void argo_writer_discard(ARGO_WRITER *w){
+    if (w->mark != ARGO_NO_MARK) w->len = w->mark;
+    w->mark = ARGO_NO_MARK;
+}
+
+#endif
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "arena.h"
+#include "access.h"
+#include "intern.h"
+#include "ctx.h"
+
+//FNV-1a parameters (64 bit)
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+//Home slot of a hash (the high bits are folded in, since FNV mixes the low bits poorly)
+#define home_slot(hash, mask) (((hash) ^ ((hash) >> 29)) & (mask))
+
+/**
+ * @brief  Hash the bytes of a member name.
+ * @details  Each byte is hashed as the character with that value, so the
+ * result is the same as argo_hash_chars for a name read from those bytes
+ * (which is how the parser represents text without \u escapes).
+ *
+ * @param key  Bytes of the name.
+ * @param length  Number of bytes.
+ * @return  The hash.
+ */
+uint64_t argo_hash_bytes(const unsigned char *key, size_t length){
+    uint64_t hash = FNV_OFFSET;
+    size_t i;
+    for (i = 0; i < length; i++) hash = (hash ^ *(key+i)) * FNV_PRIME;
+    return hash;
+}
+
+/**
+ * @brief  Hash the characters of a member name.
+ *
+ * @param key  Characters of the name.
+ * @param length  Number of characters.
+ * @return  The hash.
+ */
+uint64_t argo_hash_chars(const ARGO_CHAR *key, size_t length){
+    uint64_t hash = FNV_OFFSET;
+    size_t i;
+    for (i = 0; i < length; i++) hash = (hash ^ (uint32_t)*(key+i)) * FNV_PRIME;
+    return hash;
+}
+
+//Check whether a member's name is exactly the given bytes
+static bool name_equal(ARGO_STRING *name, const unsigned char *key, size_t length){
+    size_t i;
+    if (name->length != length) return false;
+    //An interned name may have its bytes at hand, which can be compared all at once
+    if (argo_name_interned(name) && argo_interned(name)->plain != NULL) return __builtin_memcmp(argo_interned(name)->plain, key, length) == 0;
+    for (i = 0; i < length; i++){
+        if (*(name->content+i) != *(key+i)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief  Build the hash index of an object's members, if it doesn't already have one.
+ * @details  The index is allocated from argo_value_arena, so this is for objects
+ * read in the default context (argo_ctx_object_index indexes an object read in another
+ * context, from that context's arena). It reflects the members at the time it is built,
+ * so it must not be built until the object is complete. argo_object_get builds it when
+ * it is first needed, so this only has to be called to build it in advance.
+ *
+ * @param obj  Value of type ARGO_OBJECT_TYPE.
+ * @return  Zero if successful, nonzero if obj isn't an object or space couldn't be allocated.
+ */
+int argo_object_index(ARGO_VALUE *obj){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_object_index(cx, obj);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Build the hash index of an object read in a context, allocating it from the context's arena, so that it is freed along with the object (see argo_object_index)
+int argo_ctx_object_index(ARGO_CTX *cx, ARGO_VALUE *obj){
+    if (obj == NULL || obj->type != ARGO_OBJECT_TYPE) return -1;
+    if (obj->content.object.index != NULL) return 0;
+    ARGO_VALUE *sentinel = obj->content.object.member_list;
+    ARGO_VALUE *m;
+    size_t count = 0, slots = 1;
+    for (m = sentinel->next; m != sentinel; m = m->next) count++;
+    while (slots < 2 * count) slots *= 2;
+    ARGO_MEMBER_INDEX *index = argo_arena_alloc(cx->arena, sizeof(ARGO_MEMBER_INDEX) + slots * sizeof(ARGO_MEMBER_SLOT));
+    if (index == NULL) return -1;
+    index->mask = slots - 1;
+    index->count = count;
+    __builtin_memset(index->slots, 0, slots * sizeof(ARGO_MEMBER_SLOT));
+    for (m = sentinel->next; m != sentinel; m = m->next){
+        uint64_t hash = argo_name_hash(&m->name);
+        size_t i = home_slot(hash, index->mask);
+        while ((index->slots + i)->member != NULL) i = (i + 1) & index->mask;
+        (index->slots + i)->hash = hash;
+        (index->slots + i)->member = m;
+    }
+    obj->content.object.index = index;
+    debug("Indexed %lu members in %lu slots\n", count, slots);
+    return 0;
+}
+
+/**
+ * @brief  Find the member of an object with a given name, whose hash is already known.
+ * @details  This is argo_object_get_bytes for callers that look up the same
+ * name repeatedly (such as compiled queries), so they only hash it once.
+ *
+ * @param obj  Value of type ARGO_OBJECT_TYPE.
+ * @param key  Bytes of the name.
+ * @param length  Number of bytes in the name.
+ * @param hash  argo_hash_bytes(key, length).
+ * @return  The member, or NULL if there is no member with the name (or obj isn't an object).
+ */
+ARGO_VALUE *argo_object_get_hashed(ARGO_VALUE *obj, const unsigned char *key, size_t length, uint64_t hash){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    ARGO_VALUE *member = argo_ctx_object_get_hashed(cx, obj, key, length, hash);
+    argo_default_ctx_leave(cx);
+    return member;
+}
+
+//Find the member of an object read in a context, whose hash is already known (see argo_object_get_hashed)
+ARGO_VALUE *argo_ctx_object_get_hashed(ARGO_CTX *cx, ARGO_VALUE *obj, const unsigned char *key, size_t length, uint64_t hash){
+    if (obj == NULL || obj->type != ARGO_OBJECT_TYPE) return NULL;
+    ARGO_MEMBER_INDEX *index = obj->content.object.index;
+    if (index == NULL){
+        ARGO_VALUE *sentinel = obj->content.object.member_list;
+        ARGO_VALUE *m = sentinel->next;
+        size_t scanned;
+        for (scanned = 0; m != sentinel && scanned < ARGO_INDEX_THRESHOLD; scanned++, m = m->next){
+            if (name_equal(&m->name, key, length)) return m;
+        }
+        if (m == sentinel) return NULL;
+        //A wide object is worth indexing; if that fails, then the rest of it is still searched linearly
+        if (argo_ctx_object_index(cx, obj)){
+            for (; m != sentinel; m = m->next){
+                if (name_equal(&m->name, key, length)) return m;
+            }
+            return NULL;
+        }
+        index = obj->content.object.index;
+    }
+    size_t i = home_slot(hash, index->mask);
+    ARGO_MEMBER_SLOT *slot;
+    while ((slot = index->slots + i)->member != NULL){
+        if (slot->hash == hash && name_equal(&slot->member->name, key, length)) return slot->member;
+        i = (i + 1) & index->mask;
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Find the member of an object with a given name.
+ * @details  The name is given as bytes, which match a member name whose characters
+ * have the same values. Objects with fewer than ARGO_INDEX_THRESHOLD members are
+ * searched linearly. Larger objects are indexed on their first lookup (see
+ * argo_object_index), after which each lookup takes constant time on average.
+ * If several members have the name, then the first of them is found. The index
+ * is allocated from argo_value_arena; an object read in another context is searched
+ * with argo_ctx_object_get_bytes.
+ *
+ * @param obj  Value of type ARGO_OBJECT_TYPE.
+ * @param key  Bytes of the name.
+ * @param length  Number of bytes in the name.
+ * @return  The member, or NULL if there is no member with the name (or obj isn't an object).
+ */
+ARGO_VALUE *argo_object_get_bytes(ARGO_VALUE *obj, const unsigned char *key, size_t length){
+    return argo_object_get_hashed(obj, key, length, argo_hash_bytes(key, length));
+}
+
+//Find the member of an object read in a context with a given name (see argo_object_get_bytes)
+ARGO_VALUE *argo_ctx_object_get_bytes(ARGO_CTX *cx, ARGO_VALUE *obj, const unsigned char *key, size_t length){
+    return argo_ctx_object_get_hashed(cx, obj, key, length, argo_hash_bytes(key, length));
+}
+
+/**
+ * @brief  Find the member of an object with a given name.
+ * @details  See argo_object_get_bytes.
+ *
+ * @param obj  Value of type ARGO_OBJECT_TYPE.
+ * @param key  Name of the member, as a null-terminated string.
+ * @return  The member, or NULL if there is no member with the name (or obj isn't an object).
+ */
+ARGO_VALUE *argo_object_get(ARGO_VALUE *obj, const char *key){
+    size_t length = 0;
+    while (*(key+length) != '\0') length++;
+    return argo_object_get_bytes(obj, (const unsigned char *)key, length);
+}
+
+//Find the member of an object read in a context with a given name (see argo_object_get)
+ARGO_VALUE *argo_ctx_object_get(ARGO_CTX *cx, ARGO_VALUE *obj, const char *key){
+    size_t length = 0;
+    while (*(key+length) != '\0') length++;
+    return argo_ctx_object_get_bytes(cx, obj, (const unsigned char *)key, length);
+}
+
+/**
+ * @brief  Get the number of elements of an array.
+ *
+ * @param arr  Value of type ARGO_ARRAY_TYPE.
+ * @return  The number of elements, or zero if arr isn't an array.
+ */
+size_t argo_array_len(ARGO_VALUE *arr){
+    if (arr == NULL || arr->type != ARGO_ARRAY_TYPE) return 0;
+    return arr->content.array.length;
+}
+
+/**
+ * @brief  Get an element of an array by its position.
+ * @details  The elements recorded by the parser are stored contiguously,
+ * so this takes constant time, and scanning them in order with it doesn't
+ * follow the links of the element list.
+ *
+ * @param arr  Value of type ARGO_ARRAY_TYPE.
+ * @param i  Position of the element, starting from zero.
+ * @return  The element, or NULL if there is no element at that position (or arr isn't an array).
+ */
+ARGO_VALUE *argo_array_at(ARGO_VALUE *arr, size_t i){
+    if (arr == NULL || arr->type != ARGO_ARRAY_TYPE || i >= arr->content.array.length) return NULL;
+    return *(arr->content.array.elements + i);
+}
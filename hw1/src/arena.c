@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "arena.h"
+
+//Round a size up to the arena alignment
+#define arena_round(n) (((n) + ARGO_ARENA_ALIGN - 1) & ~(size_t)(ARGO_ARENA_ALIGN - 1))
+//The usable space of a chunk starts right after its (rounded up) header
+#define chunk_data(c) ((char *)(c) + arena_round(sizeof(ARGO_CHUNK)))
+
+//Allocate a new chunk with room for at least "size" bytes, and link it in after "prev"
+static ARGO_CHUNK *arena_add_chunk(ARGO_ARENA *a, ARGO_CHUNK *prev, size_t size){
+    size_t chunkSize = prev == NULL ? ARGO_ARENA_FIRST_CHUNK : prev->size * 2;
+    if (chunkSize > ARGO_ARENA_MAX_CHUNK) chunkSize = ARGO_ARENA_MAX_CHUNK;
+    if (chunkSize < size) chunkSize = size;
+    ARGO_CHUNK *c = malloc(arena_round(sizeof(ARGO_CHUNK)) + chunkSize);
+    if (c == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for argo values\n");
+        return NULL;
+    }
+    c->size = chunkSize;
+    c->used = 0;
+    if (prev == NULL){
+        c->next = NULL;
+        a->first = c;
+    }
+    else{
+        c->next = prev->next;
+        prev->next = c;
+    }
+    a->reserved += chunkSize;
+    debug("Added a %lu byte chunk to the arena\n", chunkSize);
+    return c;
+}
+
+/**
+ * @brief  Allocate space from an arena.
+ * @details  The space is aligned to ARGO_ARENA_ALIGN bytes and is not initialized.
+ * It stays valid until the arena is reset or freed; there is no way to free
+ * an individual allocation.
+ *
+ * @param a  Arena to allocate from.
+ * @param size  Number of bytes needed.
+ * @return  A pointer to the space, or NULL if more memory couldn't be obtained.
+ */
+void *argo_arena_alloc(ARGO_ARENA *a, size_t size){
+    size = arena_round(size);
+    ARGO_CHUNK *c = a->current;
+    if (c == NULL){
+        c = a->first != NULL ? a->first : arena_add_chunk(a, NULL, size);
+        if (c == NULL) return NULL;
+        c->used = 0;
+    }
+    //If the current chunk is full, move on to the next one, reusing chunks left over from before a reset
+    while (c->size - c->used < size){
+        if (c->next != NULL && c->next->size >= size) c = c->next;
+        else if ((c = arena_add_chunk(a, c, size)) == NULL) return NULL;
+        c->used = 0;
+    }
+    a->current = c;
+    void *p = chunk_data(c) + c->used;
+    c->used += size;
+    a->used += size;
+    if (a->used > a->peak) a->peak = a->used;
+    return p;
+}
+
+/**
+ * @brief  Reset an arena so that its space can be reused.
+ * @details  All of the space previously allocated from the arena becomes invalid.
+ * The chunks themselves are kept, so the next document does not need to
+ * allocate them again. This takes constant time.
+ *
+ * @param a  Arena to reset.
+ */
+void argo_arena_reset(ARGO_ARENA *a){
+    a->current = NULL;
+    a->used = 0;
+    a->values = 0;
+    a->generation++;
+    a->adopted = false;
+}
+
+/**
+ * @brief  Return all of the chunks of an arena to the system.
+ *
+ * @param a  Arena to free.
+ */
+void argo_arena_free(ARGO_ARENA *a){
+    ARGO_CHUNK *c = a->first;
+    while (c != NULL){
+        ARGO_CHUNK *next = c->next;
+        free(c);
+        c = next;
+    }
+    a->first = NULL;
+    a->reserved = 0;
+    argo_arena_reset(a);
+}
+
+/**
+ * @brief  Move all of the space of one arena into another, along with the values in it.
+ * @details  The values stay where they are, and from then on belong to "a": they are
+ * freed with it, and become invalid when it is reset. "from" is left empty. This lets
+ * values be read into arenas of their own (by several threads at once, say) and then
+ * kept together. The names interned in the other arena's table are no longer the only
+ * copies of themselves, so until "a" is reset, names in it are compared by their characters.
+ *
+ * @param a  Arena to move the space into.
+ * @param from  Arena to move the space out of.
+ */
+void argo_arena_adopt(ARGO_ARENA *a, ARGO_ARENA *from){
+    ARGO_CHUNK *last = from->first;
+    if (last == NULL) return;
+    //The chunks go in front of those of "a", which carries on allocating from its current chunk (or, if
+    //nothing has been allocated from it since it was reset, from the last of them, which isn't full yet)
+    while (last->next != NULL) last = last->next;
+    last->next = a->first;
+    a->first = from->first;
+    if (a->current == NULL) a->current = last;
+    a->used += from->used;
+    a->values += from->values;
+    a->reserved += from->reserved;
+    if (a->used > a->peak) a->peak = a->used;
+    if (a->values > a->peak_values) a->peak_values = a->values;
+    a->adopted = true;
+    from->first = NULL;
+    from->reserved = 0;
+    argo_arena_reset(from);
+}
+
+/**
+ * @brief  Allocate a new ARGO_VALUE from argo_value_arena.
+ * @details  The value is zeroed, so it has no type, no name, and no links.
+ *
+ * @return  A pointer to the value, or NULL if memory couldn't be obtained.
+ */
+ARGO_VALUE *argo_value_alloc(void){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    ARGO_VALUE *v = argo_ctx_value_alloc(cx);
+    argo_default_ctx_leave(cx);
+    return v;
+}
+
+/**
+ * @brief  Allocate a new ARGO_VALUE from the arena of a context.
+ * @details  The value is zeroed, as by argo_value_alloc.
+ *
+ * @param cx  Context whose arena the value is allocated from.
+ * @return  A pointer to the value, or NULL if memory couldn't be obtained.
+ */
+ARGO_VALUE *argo_ctx_value_alloc(ARGO_CTX *cx){
+    ARGO_ARENA *a = cx->arena;
+    ARGO_VALUE *v = argo_arena_alloc(a, sizeof(ARGO_VALUE));
+    if (v == NULL) return NULL;
+    *v = (ARGO_VALUE){0};
+    a->values++;
+    if (a->values > a->peak_values) a->peak_values = a->values;
+    return v;
+}
@@ -3,10 +3,36 @@
 #include "validity.h"
 #include "argo.h"
 #include "global.h"
+#include "options.h"
 #include "debug.h"
+#include "ctx.h"
+#include "input.h"
+#include "arena.h"
+#include "structural.h"
+#include "utf8.h"
+#include "number.h"
+#include "writer.h"
 //Use stdbool to be able to declare and use boolean variables
 #include <stdbool.h> 
 
+//What the innermost container being read is looking for next
+typedef enum {
+    READ_MEMBER,                     // The name of a member (objects only).
+    READ_VALUE,                      // A value (for an object, the ':' before it first).
+    READ_NEXT                        // A ',' or the end of the container.
+} READ_STATE;
+
+//A container that is being read. Nested containers are read without recursing, by keeping a frame for each of them
+//on the context's frame_stack, with the innermost on top. The elements of the arrays being read are kept on its
+//element_stack in the same way: each array records where its elements start, and moves them into the arena once it is closed
+typedef struct read_frame {
+    ARGO_VALUE *n;                   // The container.
+    ARGO_VALUE *head;                // Last member or element added so far (the sentinel if there is none yet).
+    ARGO_VALUE *newValue;            // Member or element being read.
+    size_t elementBase;              // Where the elements of an array start on the context's element_stack.
+    READ_STATE state;                // What is being looked for.
+} READ_FRAME;
+
 /**
  * @brief  Read JSON input from a specified input stream, parse it,
  * and return a data structure representing the corresponding value.
@@ -16,42 +42,88 @@
  * successfully parsed, then a pointer to a data structure representing
  * the corresponding value is returned.  See the assignment handout for
  * information on the JSON syntax standard and how parsing can be
- * accomplished.  As discussed in the assignment handout, the returned
- * pointer must be to one of the elements of the argo_value_storage
- * array that is defined in the const.h header file.
+ * accomplished.  The returned value, and all of the values it contains,
+ * are allocated from argo_value_arena, which is defined in global.h.
  * In case of an error (these include failure of the input to conform
  * to the JSON standard, premature EOF on the input stream, as well as
  * other I/O errors), a one-line error message is output to standard error
  * and a NULL pointer value is returned.
  *
+ * The input is mapped into memory if it is a regular file, and read in large
+ * blocks otherwise (see input.c). In the latter case, bytes following the value
+ * may have been consumed from the stream when this function returns.
+ *
  * @param f  Input stream from which JSON is to be read.
  * @return  A valid pointer if the operation is completely successful,
  * NULL if there is any error.
  */
 ARGO_VALUE *argo_read_value(FILE *f) {
-    argo_lines_read++;
+    ARGO_INPUT in;
+    if (argo_input_open_file(&in, f, false)) return NULL;
+    ARGO_VALUE *value = argo_read_value_input(&in);
+    argo_input_close(&in);
+    return value;
+}
+
+/**
+ * @brief  Parse a JSON value from a caller-supplied buffer.
+ * @details  Same as argo_read_value, but the input is the "len" bytes
+ * starting at "buf" rather than a stream. The buffer is not copied.
+ *
+ * @param buf  Bytes to be parsed.
+ * @param len  Number of bytes in buf.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_read_value_mem(const char *buf, size_t len) {
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, buf, len);
+    ARGO_VALUE *value = argo_read_value_input(&in);
+    argo_input_close(&in);
+    return value;
+}
+
+//Parse a JSON value from an input, in the default context
+ARGO_VALUE *argo_read_value_input(ARGO_INPUT *in) {
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    ARGO_VALUE *value = argo_ctx_read_value(cx, in);
+    argo_default_ctx_leave(cx);
+    return value;
+}
+
+/**
+ * @brief  Parse a JSON value from an input, keeping the parser's state in a context.
+ * @details  This is the actual implementation of argo_read_value. The value, and all
+ * of the values it contains, are allocated from the context's arena, and the lines and
+ * characters read are counted in the context (so errors are reported with its line count).
+ *
+ * @param cx  Context to use.
+ * @param in  Input from which JSON is to be read.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_ctx_read_value(ARGO_CTX *cx, ARGO_INPUT *in) {
+    cx->lines_read++;
+    cx->element_count = 0; //Drop anything left on element_stack by an earlier parse that failed
     bool invalidChar = false;
-    ARGO_VALUE newArg;
-    newArg.name.content = ARGO_NULL; //name is null unless value is a member
-    //Add the newValue to the argo_values storage array before proceeding
-    *(argo_value_storage+argo_next_value) = newArg;
-    ARGO_VALUE* newValue = argo_value_storage+argo_next_value;
-    argo_next_value++;
-    char first = fgetc(f); 
+    //Allocate the new value from the arena before proceeding (its name is null unless it is a member)
+    ARGO_VALUE* newValue = argo_ctx_value_alloc(cx);
+    if (newValue == NULL) return NULL;
+    int first = argo_next_token(cx, in); 
     while(!invalidChar && first != EOF){
-        argo_chars_read++;
+        cx->chars_read++;
         if(argo_is_whitespace(first)){
             debug("Whitespace reached\n");
-            //If a  newline is reached, increment argo_lines_read and reset argo_chars_read
-            if (first == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
+            //If a  newline is reached, increment lines_read and reset chars_read
+            if (first == ARGO_LF) {cx->lines_read++; cx->chars_read = 0;}
         }
         else if (argo_is_digit(first) || first == ARGO_MINUS){
             debug("Number reached\n");
             // Create and allocate a argo value for a number type, then let argo_read_number create the necessary argo_number;
             newValue->type = ARGO_NUMBER_TYPE;
             // unget this digit so that it can be parsed in the argo read number function
-            ungetc(first, f);
-            if (argo_read_number(&newValue->content.number, f) == -1) invalidChar = true;
+            argo_ungetc(first, in);
+            if (argo_ctx_read_number(cx, &newValue->content.number, in) == -1) invalidChar = true;
             break;
         }
         else if (first == ARGO_LBRACE || first == ARGO_LBRACK){
@@ -59,35 +131,39 @@ ARGO_VALUE *argo_read_value(FILE *f) {
             //Create and allocate a argo value for a object type, then let argo_read_objectArray create the necessary argo_object
             newValue->type = (first == ARGO_LBRACE ? ARGO_OBJECT_TYPE : ARGO_ARRAY_TYPE);
             //Initialize the member or element list as a dummy node
-            ARGO_VALUE h; 
-            h.type = ARGO_NO_TYPE;
-            *(argo_value_storage+argo_next_value) = h;
-            if (first == ARGO_LBRACE) newValue->content.object.member_list = argo_value_storage + argo_next_value;
-            else newValue->content.array.element_list = argo_value_storage + argo_next_value;
-            argo_next_value++;
-            if (argo_read_objectArray(newValue, f) == -1) invalidChar = true;
+            ARGO_VALUE* h = argo_ctx_value_alloc(cx);
+            if (h == NULL) return NULL;
+            if (first == ARGO_LBRACE) newValue->content.object.member_list = h;
+            else newValue->content.array.element_list = h;
+            if (argo_read_objectArray(cx, newValue, in) == -1) invalidChar = true;
             break;
         }
         else if (first == ARGO_QUOTE){ 
             debug("String reached\n");
             newValue->type = ARGO_STRING_TYPE;
-            ungetc(ARGO_QUOTE, f);
-            if (argo_read_string(&newValue->content.string, f) == -1) invalidChar = true;
+            argo_ungetc(ARGO_QUOTE, in);
+            //In compact mode, argo_read_utf8_value decides which representation the string gets
+            if ((cx->utf8_strings ? argo_read_utf8_value(cx, newValue, in) : argo_ctx_read_string(cx, &newValue->content.string, in)) == -1) invalidChar = true;
             break;
         }
         else if (first == 'n' || first == 't' || first == 'f'){
             debug("Basic reached\n");
             //Create and allocate a argo value for a basic type, then let argo_read_basic create the necessary argo_basic
             newValue->type = ARGO_BASIC_TYPE;
-            if (argo_read_basic(first, &newValue->content.basic, f) == -1) invalidChar = true;
+            if (argo_read_basic(cx, first, &newValue->content.basic, in) == -1) invalidChar = true;
             break;
         }
         else{
-            fprintf(f, "Error: Invalid char at line %d", argo_lines_read);
+            fprintf(stderr, "Error: Invalid char at line %d\n", cx->lines_read);
             invalidChar = true;
             break;
         }
-        if (!invalidChar) first = fgetc(f);
+        if (!invalidChar) first = argo_next_token(cx, in);
+    }
+    //Input without a value is as incomplete as an unterminated container
+    if (first == EOF){
+        fprintf(stderr, "Error: Premature EOF at line %d\n", cx->lines_read);
+        invalidChar = true;
     }
     //If a invalid char was found, then print a specific message to stderr before returning a null pointer;
     if (invalidChar) return NULL;
@@ -113,23 +189,54 @@ ARGO_VALUE *argo_read_value(FILE *f) {
  * nonzero if there is any error.
  */
 int argo_read_string(ARGO_STRING *s, FILE *f) {
-    debug("Reached start of argo read string\n");
-    if (fgetc(f) != ARGO_QUOTE){
-        fprintf(f, "Error: Not a valid string\n");
-        return -1;
-    }
+    ARGO_INPUT in;
+    //Open the stream in exact mode, so that nothing after the closing quote is consumed
+    if (argo_input_open_file(&in, f, true)) return -1;
+    int ret = argo_read_string_input(s, &in);
+    argo_input_close(&in);
+    return ret;
+}
+
+//Parse a JSON string literal from an input, in the default context
+int argo_read_string_input(ARGO_STRING *s, ARGO_INPUT *in) {
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_read_string(cx, s, in);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Parse a JSON string literal from an input (the actual implementation of argo_read_string)
+int argo_ctx_read_string(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in) {
     //Reset the length and capacity fields
     s->capacity = 0;
     s->length = 0;
-    char nextChar = fgetc(f);
+    return argo_read_string_append(cx, s, in);
+}
+
+//Parse a JSON string literal from an input, appending its content to a string that is already
+//initialized (this lets a caller reuse the same string, and its space, for many literals)
+int argo_read_string_append(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in) {
+    debug("Reached start of argo read string\n");
+    if (argo_getc(in) != ARGO_QUOTE){
+        fprintf(stderr, "Error: Not a valid string\n");
+        return -1;
+    }
+    return argo_read_string_rest(cx, s, in);
+}
+
+//Parse the rest of a JSON string literal (after its opening quote), appending its content to a string
+int argo_read_string_rest(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in) {
+    //Runs of ordinary characters are copied in bulk; the loop below only sees quotes, backslashes and control characters
+    if (argo_append_span(cx, s, in)) return -1;
+    int nextChar = argo_getc(in);
     //Loop until the end of the file is reached, or a end quote is found
     while(nextChar != ARGO_QUOTE){
         if (nextChar == EOF){
-            fprintf(stderr, "Error: A closing quote for a string was not found on line %d\n.", argo_lines_read);
+            fprintf(stderr, "Error: A closing quote for a string was not found on line %d\n.", cx->lines_read);
             return -1;
         }
         if (nextChar == ARGO_BSLASH){
-            char after = fgetc(f);
+            int after = argo_getc(in);
             switch (after){
                 case ARGO_T: argo_append_char(s, (ARGO_CHAR)ARGO_HT);break;
                 case ARGO_R: argo_append_char(s, (ARGO_CHAR)ARGO_CR);break;
@@ -140,7 +247,7 @@ int argo_read_string(ARGO_STRING *s, FILE *f) {
                 case ARGO_N: argo_append_char(s, (ARGO_CHAR)ARGO_LF); break;
                 //If u, then check if four hex digits follow 
                 case ARGO_U: {
-                    parseUnicode(s,f);
+                    parseUnicode(s,in);
                     break;
                 }
                 //If none of these, then add the backslash and the next char to content, and update i and nextChar 
@@ -154,26 +261,61 @@ int argo_read_string(ARGO_STRING *s, FILE *f) {
         //If a newline is found (ie, the ascii 10, not "\n"), then print error and return -1
         else if (nextChar == ARGO_LF){
             debug("Reached newline error\n");
-            argo_lines_read++; 
-            fprintf(stderr, "Error: Newline found in member on line %d\n", argo_lines_read);
+            cx->lines_read++; 
+            fprintf(stderr, "Error: Newline found in member on line %d\n", cx->lines_read);
             return -1;
         }
         else argo_append_char(s, nextChar);
         debug("In argo string: %c\n", nextChar);
-        nextChar = fgetc(f);
+        if (argo_append_span(cx, s, in)) return -1;
+        nextChar = argo_getc(in);
     }
     debug("String succesfully parsed\n");
     return 0;
 }
 
-void parseUnicode(ARGO_STRING* n, FILE *f){
+//Append the run of input that the index says can be copied verbatim into a string, and consume it
+int argo_append_span(ARGO_CTX *cx, ARGO_STRING *s, ARGO_INPUT *in){
+    size_t span = argo_string_span(in);
+    while (span > 0){
+        if (argo_append_bytes(s, in->buf + in->pos, span)) return -1;
+        in->pos += span;
+        cx->chars_read += span;
+        //The run only continues if it was cut short by the end of the indexed window
+        if (in->pos < in->index->end) break;
+        span = argo_string_span(in);
+    }
+    return 0;
+}
+
+//Append a run of bytes (each one a code point below 0x100) to a string, growing it at most once
+int argo_append_bytes(ARGO_STRING *s, const unsigned char *bytes, size_t count){
+    if (s->length + count > s->capacity){
+        size_t capacity = s->capacity == 0 ? 10 : s->capacity * 2;
+        if (capacity < s->length + count) capacity = s->length + count;
+        ARGO_CHAR *content = realloc(s->capacity == 0 ? NULL : s->content, capacity * sizeof(ARGO_CHAR));
+        if (content == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for string text\n");
+            return -1;
+        }
+        s->content = content;
+        s->capacity = capacity;
+    }
+    ARGO_CHAR *dest = s->content + s->length;
+    size_t i;
+    for (i = 0; i < count; i++) *(dest+i) = *(bytes+i);
+    s->length += count;
+    return 0;
+}
+
+void parseUnicode(ARGO_STRING* n, ARGO_INPUT *in){
     int i;
-    bool isValid = isUnicode(f, 1);
+    bool isValid = isUnicode(in);
     debug("%d\n", isValid);
     if (isValid){
         int number = 0;
         for (i = 3; i>=0; i--){
-            char nextChar = fgetc(f);
+            int nextChar = argo_getc(in);
             //Get the power of 16 that this parsed char should be multiplied by
             int power = 1; 
             int j = i;
@@ -190,25 +332,19 @@ void parseUnicode(ARGO_STRING* n, FILE *f){
     }
     else{
         for (i=0; i<4; i++){
-            argo_append_char(n, fgetc(f));
+            argo_append_char(n, argo_getc(in));
         }
     }
 }
-bool isUnicode(FILE *f, int count){
-    char nextChar = fgetc(f);
-    debug("Count: %d, Char: %c\n", count, nextChar);
-    if (count == 4){
-        ungetc(nextChar, f);
-        return argo_is_hex(nextChar);
-    }
-    else{
-        if(argo_is_hex(nextChar)){
-            bool isValid = isUnicode(f, ++count);
-            ungetc(nextChar, f);
-            return isValid;
-        } 
-        else{ungetc(nextChar, f); return false;}
+//Check whether the next four chars of input are hex digits, without consuming any of them
+bool isUnicode(ARGO_INPUT *in){
+    int count;
+    for (count = 0; count < 4; count++){
+        int nextChar = argo_peek(in, count);
+        debug("Count: %d, Char: %c\n", count, nextChar);
+        if (!argo_is_hex(nextChar)) return false;
     }
+    return true;
 }
 /**
  * @brief  Read JSON input from a specified input stream, attempt to
@@ -228,348 +364,335 @@ bool isUnicode(FILE *f, int count){
  * other I/O errors), a one-line error message is output to standard error
  * and a NULL pointer value is returned.
  *
+ * The number is converted with argo_parse_number (see number.c), which gives the
+ * correctly rounded floating point value. To save an allocation per number, the
+ * textual representation is only made on demand, by argo_number_string.
+ *
  * @param f  Input stream from which JSON is to be read.
  * @return  Zero if the operation is completely successful,
  * nonzero if there is any error.
  */
 int argo_read_number(ARGO_NUMBER *n, FILE *f){
-    int digitCounter = 0, dotIndex = 0, expIndex = 0; //Use dotIndex and expIndex to keep track of where a "." or exponent appears in this number, if any
-    bool charReached = false; //Use charReachedto break out of the parsing loop if whitespace/a closing bracket/comma is reached
-    char firstDigit = fgetc(f);
-    long int num = 0;
-    bool isNeg = false;
-    //Reset length and capacity
-    n->string_value.capacity = 0;
-    n->string_value.length = 0;
+    ARGO_INPUT in;
+    //Open the stream in exact mode, so that the character that ends the number is left on the stream
+    if (argo_input_open_file(&in, f, true)) return -1;
+    int ret = argo_read_number_input(n, &in);
+    argo_input_close(&in);
+    return ret;
+}
 
-    while (firstDigit != EOF && !charReached){
-        debug("Digit in this iteration of the read number loop: %c\n", firstDigit);
-        debug("Digit counter in this iteration: %d\n Exp index: %d\n Dot index: %d\n", digitCounter, expIndex, dotIndex);
-        argo_chars_read++;
-        if (argo_is_digit(firstDigit)){
-            if (num == (long)0 && digitCounter > 0 && dotIndex == 0){
-                fprintf(stderr, "Error: Numbers with leading zeros are not allowed\n");
-                return -1;
-            }
-            argo_append_char(&n->string_value, firstDigit);
-            int digit = firstDigit-48;
-            num = (num*10) + digit;
-        }
-        else if (digitCounter == 0  && firstDigit == ARGO_MINUS) {
-            isNeg = true; 
-            argo_append_char(&n->string_value, firstDigit); 
-            firstDigit = fgetc(f); 
-            continue;
-        }
-        //If a "." is found, use dotIndex to note the iteration it was found in (and allow for errors if multiple . appear)
-        //A valid dot is one that appears once following one or more digits
-        else if (dotIndex == 0 && firstDigit == ARGO_PERIOD) {dotIndex = digitCounter; 
-            argo_append_char(&n->string_value, firstDigit); 
-            firstDigit = fgetc(f); 
-            continue;
-        }
-        else if (argo_is_whitespace(firstDigit)) {
-            //If a newline is reached, increment lines read and reset chars read 
-            if (firstDigit == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
-            //Break out of the loop if 1)whitespace reached and 2) one or more digits have been parsed already
-            if (digitCounter>0) {charReached = true;  break;} else {firstDigit = fgetc(f); continue;}
-        }
-        //If an exponent is reached, break out of the loop and note its index
-        //A valid exponent is one that appears once following one or more digits, and that doesn't immediately follow a "."
-        else if (is_first_exp(digitCounter, expIndex) && (dotIndex == 0 || dotIndex != digitCounter-1) && argo_is_exponent(firstDigit)){
-            debug("Reached exp\n");
-            argo_append_char(&n->string_value, firstDigit); 
-            expIndex = digitCounter;
-            break;
-        }
-        //If comma, }, or ] reached and one or more digits have been parsed, break out of the loop (using charReached), and unget
-        else if (is_close_comma(firstDigit) && digitCounter>0){
-            charReached = true;
-            ungetc(firstDigit, f);
-            break;
-        }
-        //If invalid char, break out of the loop (conditions below will make sure a error is noted)
-        else break;
+//Parse a JSON number from an input, in the default context
+int argo_read_number_input(ARGO_NUMBER *n, ARGO_INPUT *in){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_read_number(cx, n, in);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
 
-        firstDigit = fgetc(f);
-        digitCounter++;
-    }
-    //If the loop terminated without stopping at whitespace/comma/}/], print an error and return null
-    if (!charReached && expIndex==0){
-        fprintf(stderr, "Error at line %d\n", argo_lines_read);
-        return -1;  
+//Parse a JSON number from an input (the actual implementation of argo_read_number)
+int argo_ctx_read_number(ARGO_CTX *cx, ARGO_NUMBER *n, ARGO_INPUT *in){
+    //Find the run of characters that could be part of the number, refilling the buffer if it reaches the end,
+    //so that the whole number can be converted at once from contiguous memory
+    size_t run = 0;
+    while (true){
+        while (in->pos + run < in->len && is_number_char(*(in->buf + in->pos + run))) run++;
+        if (in->pos + run < in->len || in->src == NULL) break;
+        argo_input_refill(in, run + 1);
     }
-    else{
-        debug("Number before parsing: %ld\n", num);
-        //If a period or exponent appears, the number is only a valid float
-        if (dotIndex != 0 || expIndex != 0) {n->valid_float = 1; n->valid_int = 0;} else {n->valid_int = 1; n->valid_float = 1;}
-        n->valid_string = 1;
-        int exp = 0;
-        if (expIndex != 0) {if(parseExp(n, &exp, f) == -1) return -1;}
-        if (dotIndex != 0) exp-=(digitCounter - dotIndex);
-        debug("Value of exp: %d\n", exp);
-        double number = (isNeg ? -1 * num : num);
-        while(exp != 0){
-            debug("Value of number in loop: %f\n", number);
-            exp < 0 ? (number/=10.0) : (number*=10);
-            exp<0 ? exp++ : exp--;
+    //The number must be followed by whitespace, a comma, a closing bracket, or the end of the input
+    if (in->pos + run < in->len){
+        int after = *(in->buf + in->pos + run);
+        if (!argo_is_whitespace(after) && !is_close_comma(after)){
+            fprintf(stderr, "Error: Invalid char in number at line %d\n", cx->lines_read);
+            return -1;
         }
-        if (n->valid_float != 0) n->float_value = number; 
-        if (n->valid_int != 0) n->int_value = number;
-        debug("Number after parsing: %f\n", number);
-        return 0;
     }
+    if (argo_ctx_parse_number(cx, in->buf + in->pos, run, n)) return -1;
+    in->pos += run;
+    cx->chars_read += run;
+    return 0;
 }
-double parseExp(ARGO_NUMBER* n, int* expPointer, FILE *f){
-    char nextChar = fgetc(f);
-    bool invalid = false, isNeg = false;
-    int digitCounter = 0, tenths = 1;
-    long int num = 0;
-    while(nextChar != EOF || !invalid){
-        if (digitCounter == 0 && nextChar == ARGO_MINUS){
-            argo_append_char(&n->string_value, nextChar);
-            isNeg = true;
-            nextChar = fgetc(f);
-            continue;
-        }
-        else if (argo_is_digit(nextChar)){
-            argo_append_char(&n->string_value, nextChar); 
-            int digit = nextChar-48;
-            num = (num*10) + (digit*tenths);
-            tenths*=10;
-        }
-        else if (argo_is_whitespace(nextChar)) {
-            //If a newline is reached, increment lines read and reset chars read 
-            if (nextChar == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
-            //Break out of the loop if 1)whitespace reached and 2) one or more digits have been parsed already
-            if (digitCounter>0) break; else {nextChar = fgetc(f); continue;}
-        }
-        //If comma, }, or ] reached and one or more digits read, break out of the loop (using charReached), and unget
-        else if (is_close_comma(nextChar) && digitCounter > 0){
-            ungetc(nextChar, f);
-            break;
+
+//Push an element of the array being read onto the context's element_stack
+static int push_element(ARGO_CTX *cx, ARGO_VALUE *v){
+    if (cx->element_count == cx->element_capacity){
+        size_t capacity = cx->element_capacity == 0 ? 1024 : cx->element_capacity * 2;
+        ARGO_VALUE **grown = realloc(cx->element_stack, capacity * sizeof(ARGO_VALUE *));
+        if (grown == NULL){
+            fprintf(stderr, "[%d] Failed to allocate space for array elements\n", cx->lines_read);
+            return -1;
         }
-        else {invalid = true; break;}
+        cx->element_stack = grown;
+        cx->element_capacity = capacity;
+    }
+    *(cx->element_stack + cx->element_count++) = v;
+    return 0;
+}
+
+//Move the elements of a complete array (those above "base" on element_stack) into the arena
+static int finish_elements(ARGO_CTX *cx, ARGO_ARRAY *a, size_t base){
+    a->length = cx->element_count - base;
+    a->elements = NULL;
+    if (a->length == 0) return 0;
+    a->elements = argo_arena_alloc(cx->arena, a->length * sizeof(ARGO_VALUE *));
+    if (a->elements == NULL) return -1;
+    __builtin_memcpy(a->elements, cx->element_stack + base, a->length * sizeof(ARGO_VALUE *));
+    cx->element_count = base;
+    return 0;
+}
 
-        nextChar = fgetc(f);
-        digitCounter++;
+//Push a frame for a container whose sentinel has been allocated, as long as that doesn't nest containers deeper than argo_max_depth
+static int open_frame(ARGO_CTX *cx, ARGO_VALUE *n){
+    if (cx->max_depth > 0 && cx->frame_count >= (size_t)cx->max_depth){
+        fprintf(stderr, "Error: Nesting is deeper than %d on line %d\n", cx->max_depth, cx->lines_read);
+        return -1;
+    }
+    if (cx->frame_count == cx->frame_capacity){
+        size_t capacity = cx->frame_capacity == 0 ? 64 : cx->frame_capacity * 2;
+        READ_FRAME *grown = realloc(cx->frame_stack, capacity * sizeof(READ_FRAME));
+        if (grown == NULL){
+            fprintf(stderr, "[%d] Failed to allocate space for nesting depth %lu\n", cx->lines_read, cx->frame_count);
+            return -1;
+        }
+        cx->frame_stack = grown;
+        cx->frame_capacity = capacity;
     }
-    if (invalid || nextChar == EOF) {fprintf(stderr, "Error parsing exponent at line %d\n", argo_lines_read); return -1;}
-    *expPointer = isNeg ? -1*num : num;
+    READ_FRAME *f = cx->frame_stack + cx->frame_count++;
+    f->n = n;
+    f->head = n->type == ARGO_OBJECT_TYPE ? n->content.object.member_list : n->content.array.element_list;
+    f->head->next = f->head; f->head->prev = f->head; //Initialize the member or element list before parsing
+    f->newValue = NULL;
+    f->elementBase = cx->element_count; //Elements of an array are also recorded on element_stack
+    f->state = n->type == ARGO_OBJECT_TYPE ? READ_MEMBER : READ_VALUE;
     return 0;
 }
 
-int argo_read_objectArray(ARGO_VALUE *n, FILE *f){
+//Add the value that has just been read to the member or element list of a container
+static int link_value(ARGO_CTX *cx, READ_FRAME *f){
+    f->head->next = f->newValue;
+    f->head->next->prev = f->head;
+    f->head = f->head->next;
+    if (f->n->type == ARGO_ARRAY_TYPE && push_element(cx, f->newValue)) return -1;
+    f->state = READ_NEXT;
+    return 0;
+}
+
+//Once done reading a container, link the tail's next back to the sentinel, and the sentinel's prev to the tail
+static int finish_frame(ARGO_CTX *cx, READ_FRAME *f){
+    ARGO_VALUE* sentinel = f->n->type == ARGO_OBJECT_TYPE ? f->n->content.object.member_list : f->n->content.array.element_list;
+    sentinel->prev = f->head;
+    f->head->next = sentinel;
+    if (f->n->type == ARGO_ARRAY_TYPE) return finish_elements(cx, &f->n->content.array, f->elementBase);
+    return 0;
+}
+
+int argo_read_objectArray(ARGO_CTX *cx, ARGO_VALUE *root, ARGO_INPUT *in){
     debug("Object read function reached\n");
-    bool member; //Use to indicate what to search for (in order of member, then value, then next and repeat)
-    if (n->type == ARGO_OBJECT_TYPE) member = true; //member is only used for objects-- contains the logic to parse a member's name
-    else member = false;
-    bool success = false; //success is used to end the parsing when a closing } or ] is found
-    bool value = true, next = true;
-    ARGO_VALUE* head = n->type == ARGO_OBJECT_TYPE ? n->content.object.member_list:n->content.array.element_list;
-    ARGO_VALUE* sentinel = head;
-    head->next = head; head->prev = head; //Initialize the member or element list before parsing
-    char nextChar = fgetc(f);
-    while(nextChar != EOF && !success){
-        //If this argo value is an object, create and add a argo_value to the argo_value array, and update its name
-        if (member){
+    //Containers nested in this one are read by the same loop, with a frame on frame_stack for each one that is open.
+    //Each frame moves from reading a member's name, to its value, to the next ',' (or the end) and around again
+    cx->frame_count = 0;
+    if (open_frame(cx, root)) return -1;
+    int nextChar = argo_next_token(cx, in);
+    while (true){
+        READ_FRAME *f = cx->frame_stack + cx->frame_count - 1;
+        ARGO_VALUE *n = f->n;
+        bool done = false; //done is set once the innermost container has been read (possibly as an empty one)
+        if (nextChar == EOF){
+            //The input ended before the container did. This is reported as the event parser reports it:
+            //by what was expected next, a member's name, the ':' after it, or a value
+            if (f->state == READ_MEMBER) fprintf(stderr, "Error: Expected a member name at line %d\n", cx->lines_read);
+            else if (f->state == READ_VALUE && n->type == ARGO_OBJECT_TYPE) fprintf(stderr, "Error: Expected ':' at line %d\n", cx->lines_read);
+            else fprintf(stderr, "Error: Premature EOF at line %d\n", cx->lines_read);
+            return -1;
+        }
+        //If this argo value is an object, allocate a argo_value from the arena, and update its name
+        else if (f->state == READ_MEMBER){
             debug("Member reached\n");
-            ARGO_VALUE newVal; 
             //Parse the file until a quote appears: print & return error if any invalid chars found
-            while(nextChar != ARGO_QUOTE){
+            while(!done && nextChar != ARGO_QUOTE){
                 if (argo_is_whitespace(nextChar)){
-                    //If a newline is reached, increment lines read and reset chars read 
-                    if (nextChar == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
+                    //If a newline is reached, increment lines read and reset chars read
+                    if (nextChar == ARGO_LF) {cx->lines_read++; cx->chars_read = 0;}
                 }
-                else if (nextChar == ARGO_RBRACE && head == sentinel) return 0;//If closing brace reached with no member found, set next and prev and return 0
-                else {fprintf(stderr, "Error: Next member not found on line %d\n", argo_lines_read); return -1;}
+                else if (nextChar == ARGO_RBRACE && f->head == n->content.object.member_list) done = true; //If closing brace reached with no member found, the object is empty
+                else {fprintf(stderr, "Error: Next member not found on line %d\n", cx->lines_read); return -1;}
+                debug("%c\n", nextChar);
+                if (!done) nextChar = argo_next_token(cx, in);
+            }
+            if (!done){
                 debug("%c\n", nextChar);
-                nextChar = fgetc(f);
+                argo_ungetc(nextChar, in);
+                //Once a quote is found, allow argo_read_string to create a member
+                if ((f->newValue = argo_ctx_value_alloc(cx)) == NULL) return -1;
+                if (argo_read_name(cx, &(f->newValue->name), in) == -1) return -1;
+                f->state = READ_VALUE;
+                nextChar = argo_next_token(cx, in);
             }
-            debug("%c\n", nextChar);
-            ungetc(nextChar, f);
-            //Once a quote is found, allow argo_read_string to create a member
-            if (argo_read_string(&(newVal.name), f) == -1) return -1;
-            //Add the argo val to the array using the provided counter (dont increment this as itll be needed later)
-            *(argo_value_storage + argo_next_value) = newVal;
-            //Set member to false and value to true
-            member = false; 
-            value = true; 
-            nextChar = fgetc(f);
         }
         //If value, then repeat what is done in the main argo_read_value, but first looking for a : (if object)
         //value is used for both arrays and objects
-        else if (value){
+        else if (f->state == READ_VALUE){
             debug("Value reached\n");
-            //If this value is an object, then it'll have already been added to the argo value array due to its name being parsed
-            //If not, then a new argo value must be initialized and added to storage
-            ARGO_VALUE* newValue;
-            if (n->type == ARGO_OBJECT_TYPE) newValue = argo_value_storage + argo_next_value;
-            else{
-                ARGO_VALUE j; 
-                j.name.content = ARGO_NULL;
-                *(argo_value_storage + argo_next_value) = j;
-                newValue = argo_value_storage + argo_next_value;
-            }
-            ++argo_next_value; //If object, then increment the next counter to the next open spot after retrieving the value. If array, increment after adding in & retrieving newValue
+            //If this value is an object, then it'll have already been allocated due to its name being parsed
+            //If not, then a new argo value (with a null name) must be allocated from the arena
+            if (n->type == ARGO_ARRAY_TYPE) f->newValue = argo_ctx_value_alloc(cx);
+            ARGO_VALUE* newValue = f->newValue;
+            if (newValue == NULL) return -1;
+            bool value = true, opened = false;
 
             if (n->type == ARGO_OBJECT_TYPE){
                 debug("Reached the start of colon parsing. First char is: %c\n", nextChar);
                 while(nextChar != ARGO_COLON){
                     //If whitespace, continue looking for a colon
                     if (argo_is_whitespace(nextChar)){
-                        //If a  newline is reached, increment argo_lines_read and reset argo_chars_read
-                        if (nextChar == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
+                        //If a  newline is reached, increment lines_read and reset chars_read
+                        if (nextChar == ARGO_LF) {cx->lines_read++; cx->chars_read = 0;}
                     }
                     //If an invalid char (or EOF reached) is found, print an error and return
                     else if (nextChar != ARGO_COLON){
-                        fprintf(f, "Error: ':' not found for member on line %d", argo_lines_read);
+                        fprintf(stderr, "Error: Expected ':' at line %d\n", cx->lines_read);
                         return -1;
                     }
-                    nextChar = fgetc(f);
+                    nextChar = argo_next_token(cx, in);
                 }
-                nextChar = fgetc(f); //if a colon was succesfully found, then advance to the next char to start searching for a value
+                nextChar = argo_next_token(cx, in); //if a colon was succesfully found, then advance to the next char to start searching for a value
             }
             while (nextChar != EOF){
                 debug("Char in this iteration: %c\n", nextChar);
                 if(argo_is_whitespace(nextChar)){
-                    //If a  newline is reached, increment argo_lines_read and reset argo_chars_read
-                    if (nextChar == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
+                    //If a  newline is reached, increment lines_read and reset chars_read
+                    if (nextChar == ARGO_LF) {cx->lines_read++; cx->chars_read = 0;}
                 }
                 else if (argo_is_digit(nextChar) || nextChar == ARGO_MINUS){
                     debug("Argo read number reached\n");
                     newValue->type = ARGO_NUMBER_TYPE;
                     // unget this digit so that it can be parsed in the argo read number function
-                    ungetc(nextChar, f);
-                    if (argo_read_number(&newValue->content.number, f) != -1) value = false;  //Set value to false to signal that this is a valid value
+                    argo_ungetc(nextChar, in);
+                    if (argo_ctx_read_number(cx, &newValue->content.number, in) != -1) value = false;  //Set value to false to signal that this is a valid value
                     break;
                 }
                 else if (nextChar == ARGO_LBRACE || nextChar == ARGO_LBRACK){
                     newValue->type = (nextChar == ARGO_LBRACE ? ARGO_OBJECT_TYPE : ARGO_ARRAY_TYPE);
-                    ARGO_VALUE g;
-                    g.type = ARGO_NO_TYPE;
-                    *(argo_value_storage + argo_next_value) = g;
                     //Make sure to initialize the sentinel of the member or element list with a dummy node
-                    if (nextChar == ARGO_LBRACE) newValue->content.object.member_list = argo_value_storage + argo_next_value;
-                    else newValue->content.array.element_list = argo_value_storage + argo_next_value;
-                    argo_next_value++;
-                    //Create and allocate a argo value for a object type, then let argo_read_objectArray create the necessary argo_object
-                    if (argo_read_objectArray(newValue, f) != -1) value = false;  //Set value to false to break out of the loop and signal that this is a valid value
+                    ARGO_VALUE* g = argo_ctx_value_alloc(cx);
+                    if (g == NULL) return -1;
+                    if (nextChar == ARGO_LBRACE) newValue->content.object.member_list = g;
+                    else newValue->content.array.element_list = g;
+                    //Rather than recursing, the new container gets a frame of its own, and is added to this one once it has been read
+                    if (open_frame(cx, newValue)) return -1;
+                    opened = true;
                     break;
                }
                 else if (nextChar == ARGO_QUOTE){ 
                     newValue->type = ARGO_STRING_TYPE;
-                    ungetc(ARGO_QUOTE, f);
-                    if (argo_read_string(&newValue->content.string, f) != -1) value = false;
+                    argo_ungetc(ARGO_QUOTE, in);
+                    if ((cx->utf8_strings ? argo_read_utf8_value(cx, newValue, in) : argo_ctx_read_string(cx, &newValue->content.string, in)) != -1) value = false;
                     break;
                 }
                 else if (nextChar == 'n' || nextChar == 't' || nextChar == 'f'){
                     debug("Reached basic type\n");
                     //Create and allocate a argo value for a basic type, then let argo_read_basic create the necessary argo_basic
                     newValue->type = ARGO_BASIC_TYPE;
-                    if (argo_read_basic(nextChar, &newValue->content.basic, f) != -1) value = false;
+                    if (argo_read_basic(cx, nextChar, &newValue->content.basic, in) != -1) value = false;
                     break;
                 }
-                else if (n->type == ARGO_ARRAY_TYPE && nextChar == ARGO_RBRACK && head==sentinel) return 0; //Case for empty array
-                else {fprintf(stderr, "Error: Invalid character found on line %d\n", argo_lines_read); break;}
-                nextChar = fgetc(f); //If a value wasn't found yet, continue parsing the file in search for one 
+                else if (n->type == ARGO_ARRAY_TYPE && nextChar == ARGO_RBRACK && f->head == n->content.array.element_list) {done = true; break;} //Case for empty array
+                else {fprintf(stderr, "Error: Invalid character found on line %d\n", cx->lines_read); break;}
+                nextChar = argo_next_token(cx, in); //If a value wasn't found yet, continue parsing the file in search for one 
+            }
+            if (opened){
+                nextChar = argo_next_token(cx, in);
+                continue;
             }
             //If the end of the file was reached without finding a value or an invalid value was found, then print and return error
-            if (nextChar == EOF || value){
-                if (nextChar == EOF) fprintf(stderr, "Error: Reached end of file while parsing.\n");
+            if (!done && (nextChar == EOF || value)){
+                if (nextChar == EOF) fprintf(stderr, "Error: Premature EOF at line %d\n", cx->lines_read);
                 return -1;
             }
             debug("Value successfully parsed\n");
-            //If a value was succesfully parsed and added, then add this value to the member list, set next to true and increment argo_next_value
-            head->next = newValue;
-            head->next->prev = head;
-            head = head->next;
-            next = true;
+            //If a value was succesfully parsed and added, then add this value to the member list, and search for what comes next
+            if (!done && link_value(cx, f)) return -1;
         }
         //If next, search for a comma or closing brace
-        //If comma, then set member to true
+        //If comma, then go back to reading a member for an object or a value for an array
         //If bracket reached, then proceed to putting the argo values in this object's member list
-        else if (next){
+        else {
             debug("Next reached\n");
-            nextChar = fgetc(f);
+            nextChar = argo_next_token(cx, in);
             char close = n->type == ARGO_OBJECT_TYPE ? ARGO_RBRACE : ARGO_RBRACK;
-            while(nextChar != EOF && !success){
+            while(nextChar != EOF && !done){
                 debug("Char in this iteration of next: %c\n", nextChar);
                 if(argo_is_whitespace(nextChar)){
-                    //If a  newline is reached, increment argo_lines_read and reset argo_chars_read
-                    if (nextChar == ARGO_LF) {argo_lines_read++; argo_chars_read = 0;}
-                    nextChar = fgetc(f);
+                    //If a  newline is reached, increment lines_read and reset chars_read
+                    if (nextChar == ARGO_LF) {cx->lines_read++; cx->chars_read = 0;}
+                    nextChar = argo_next_token(cx, in);
                 }
                 else if (nextChar == ARGO_COMMA){
-                    //If a comma is found, set member to true for an object or value to true for array and break out of the loop
-                    if (n->type == ARGO_OBJECT_TYPE) member = true;
-                    else value=true;
-                    nextChar = fgetc(f);
+                    f->state = n->type == ARGO_OBJECT_TYPE ? READ_MEMBER : READ_VALUE;
+                    nextChar = argo_next_token(cx, in);
                     break;
                 }
-                else if (nextChar == close) success = true;
+                else if (nextChar == close) done = true;
                 else{
-                    fprintf(stderr,"Error: No ',' or '}' found\n");
+                    fprintf(stderr, "Error: Expected ',' or '%c' at line %d\n", close, cx->lines_read);
                     return -1;
                 }
             }
-            //If the end of the file was reached, print and return error
-            if (nextChar == EOF){
-                fprintf(stderr,"Error: No ',' or '}' found\n");
+            //If the end of the file was reached before a ',' or the end of the container, print and return error
+            //(after a ',', it is reported as the end of the input where a member or value was due, at the top of the loop)
+            if (nextChar == EOF && f->state == READ_NEXT){
+                fprintf(stderr, "Error: Expected ',' or '%c' at line %d\n", close, cx->lines_read);
                 return -1;
             }
-        }
+            if (done && finish_frame(cx, f)) return -1;
+        }
+        if (!done) continue;
+        //The innermost container is complete, so add it to the one it is in (if any), which then looks for what comes next
+        if (--cx->frame_count == 0) return 0;
+        f = cx->frame_stack + cx->frame_count - 1;
+        nextChar = n->type == ARGO_OBJECT_TYPE ? ARGO_LBRACE : ARGO_LBRACK;
+        if (link_value(cx, f)) return -1;
     }
-    //Once done looping through the object, link the tail's next back to the sentinel, and the sentinel's prev to the tail
-    sentinel->prev = head;
-    head->next = sentinel;
-    return 0;
 }
 
-int argo_read_basic(char basic, ARGO_BASIC *n, FILE *f){
+int argo_read_basic(ARGO_CTX *cx, char basic, ARGO_BASIC *n, ARGO_INPUT *in){
     bool isInvalid = false;
-    char second = fgetc(f);
-    char third = fgetc(f);
-    char fourth = fgetc(f);
-    char fifth = fgetc(f); //Use fifth to make sure that this value is valid
+    int second = argo_getc(in);
+    int third = argo_getc(in);
+    int fourth = argo_getc(in);
+    int fifth = argo_getc(in); //Use fifth to make sure that this value is valid
+    int after = fifth; //The char after the literal, which is put back if the literal is valid
 
-    if (second == ARGO_LF) {argo_lines_read++; argo_chars_read=0;}
-    if (third == ARGO_LF) {argo_lines_read++; argo_chars_read=0;}
-    if (fourth == ARGO_LF) {argo_lines_read++; argo_chars_read=0;}
-    if (fifth == ARGO_LF) {argo_lines_read++; argo_chars_read=0;}
+    if (second == ARGO_LF) {cx->lines_read++; cx->chars_read=0;}
+    if (third == ARGO_LF) {cx->lines_read++; cx->chars_read=0;}
+    if (fourth == ARGO_LF) {cx->lines_read++; cx->chars_read=0;}
     switch(basic){
         case (ARGO_T):{ 
             //If the fifth char is a comma, closing bracket, or whitespace, then this is a valid basic type
-            if (second == 'r' && third == 'u' && fourth=='e' && (is_close_comma(fifth) || argo_is_whitespace(fifth))){
-                *n = ARGO_TRUE;
-                ungetc(fifth, f);
-            }
+            if (second == 'r' && third == 'u' && fourth=='e' && is_value_end(fifth)) *n = ARGO_TRUE;
             else isInvalid = true;
             break;
         }
         case(ARGO_F):{
-            char sixth = fgetc(f);
-            if (sixth == ARGO_LF) {argo_lines_read++; argo_chars_read=0;}
-            if (second == 'a' && third == 'l' && fourth=='s' && fifth == 'e'&& (is_close_comma(sixth) || argo_is_whitespace(sixth))){
-                *n = ARGO_FALSE;
-                ungetc(sixth, f);
-            }
+            if (fifth == ARGO_LF) {cx->lines_read++; cx->chars_read=0;}
+            after = argo_getc(in);
+            if (second == 'a' && third == 'l' && fourth=='s' && fifth == 'e'&& is_value_end(after)) *n = ARGO_FALSE;
             else isInvalid = true;
             break;
         }
         case('n'):{
-            if (second == 'u' && third == 'l' && fourth=='l' && (is_close_comma(fifth) || argo_is_whitespace(fifth))){
-                *n = ARGO_NULL;
-                ungetc(fifth, f);
-            } 
+            if (second == 'u' && third == 'l' && fourth=='l' && is_value_end(fifth)) *n = ARGO_NULL;
             else isInvalid = true;
             break;
         }
     }
     if (isInvalid){
-        fprintf(f, "Error: Invalid char at line %d\n", argo_lines_read);
+        if (after == ARGO_LF) {cx->lines_read++; cx->chars_read=0;}
+        fprintf(stderr, "Error: Invalid char at line %d\n", cx->lines_read);
         return -1;
     }
+    //A newline after the literal is counted when it is read again, so it isn't counted here
+    argo_ungetc(after, in);
     return 0;
 }
 
@@ -587,76 +710,31 @@ int argo_read_basic(char basic, ARGO_BASIC *n, FILE *f){
  * nonzero if there is any error.
  */
 int argo_write_value(ARGO_VALUE *v, FILE *f) {
-    //If name is not null, print out the name using argo_write_string
-    if (v->name.content != ARGO_NULL){
-        argo_write_string(&(v->name), f);
-        //If pretty print is specified, then print a single space following the ':'
-        global_options >= 0x30000000 ? fprintf(f, "%s", ": ") : fprintf(f, "%c", ':');
-    }
-
-    //Make sure to set and disable isTopLevel as a 
-    switch(v->type){
-        case (ARGO_NO_TYPE): break;
-        //If a argo value is on the top level (ie, level=0) & pretty print is enabled, then print out a 
-        //single newline after the value is printed along w/the required indentation
-        //This will be handled by pretty_newline_detector
-        case (ARGO_BASIC_TYPE):{
-            ARGO_BASIC r = v->content.basic;
-            fprintf(f, "%s", (r == ARGO_NULL ? ARGO_NULL_TOKEN : r == ARGO_TRUE ? ARGO_TRUE_TOKEN : ARGO_FALSE_TOKEN));
-            if (level == 0) pretty_newline_detector(f);
-            break;
-        }
-        case(ARGO_NUMBER_TYPE): {
-            argo_write_number(&(v->content.number), f);
-            if (level == 0) pretty_newline_detector(f);
-            break;
-        }
-        case(ARGO_STRING_TYPE): {
-            argo_write_string(&(v->content.string), f);
-            if (level == 0) pretty_newline_detector(f);
-            break;
-        }
-        case ARGO_OBJECT_TYPE: 
-        case ARGO_ARRAY_TYPE: {
-            //If level > 0, that means this array or object is nested, meaning 
-            //Increment the level when an object or array reached
-            level++;
-            char open = (v-> type == ARGO_OBJECT_TYPE ? '{' : '[');
-            char close = (v-> type == ARGO_OBJECT_TYPE ? '}' : ']');
-            //If pretty print is specified, then print a single newline after a opening bracket
-            //pretty_newline_detector will handle this
-            fprintf(f, "%c", open);
-            pretty_newline_detector(f);
-
-            ARGO_VALUE* sentinel= (v->type == ARGO_ARRAY_TYPE ?
-                                   v->content.array.element_list
-                                  :v->content.object.member_list);
-            
-            //Get the actual head of the circular linked list 
-            ARGO_VALUE* head = sentinel->next;
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_write_value(cx, v, f);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
 
-            //Recursively traverse the object, and terminate when the sentinel is reached by comparing the addresses
-            while (head != sentinel){
-                argo_write_value(head, f);
-                head = head->next;
-                //If this isn't the last element in the array or object, then add a comma
-                if (head != sentinel){
-                    fprintf(f, "%c", ARGO_COMMA);
-                    pretty_newline_detector(f);
-                }
-            }
-            //Decrease the top level after this object/array's members have been printed
-            //This is so that the closing { or ] is at the previous indentation level
-            level--;
-            //If pretty print is enabled, then a newline should be printed right after the last member 
-            //is printed: pretty_newline_detector will handle this
-            pretty_newline_detector(f);
-            fprintf(f, "%c", close); 
-            break;
-        }
-    }
-    if (level == 0 && global_options >= (CANONICALIZE_OPTION + PRETTY_PRINT_OPTION)) fprintf(f, "\n");//Make sure a newline is printed at the end of the object when pretty print is enabled
-    return 0;
+/**
+ * @brief  Write canonical JSON representing a value to an output stream,
+ * keeping the writer's state in a context.
+ * @details  This is the actual implementation of argo_write_value. The value is
+ * pretty printed if the context's options select it, and its nesting is tracked
+ * with the context's level, which should be zero for a value at the top level.
+ *
+ * @param cx  Context to use.
+ * @param v  Data structure representing a value.
+ * @param f  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_ctx_write_value(ARGO_CTX *cx, ARGO_VALUE *v, FILE *f) {
+    //All of the output is collected by a writer, so it reaches the stream in a few large pieces
+    ARGO_WRITER w;
+    if (argo_ctx_writer_open(cx, &w, f)) return -1;
+    int ret = argo_ctx_writer_value(cx, &w, v);
+    return argo_writer_close(&w) || ret ? -1 : 0;
 }
 
 /**
@@ -680,58 +758,10 @@ int argo_write_value(ARGO_VALUE *v, FILE *f) {
  * nonzero if there is any error.
  */
 int argo_write_string(ARGO_STRING *s, FILE *f) {
-    int length = s->length;
-    ARGO_CHAR* text = s->content;
-    int i =0;
-    fprintf(f, "\""); //Make sure to start and end the string in quotations
-    while(i<length){
-       //Have to loop through elements to check what each one is:
-       //Each element that is printed out must be greater than unicode 
-       //control U+001F (aka 31 in dec), and less than U+O0FF (which is 195 191 (aka 0xFF) in dec)
-       // '\' (dec 92) and " (dec 34) must be printed as escape seq (see switch case below)
-       int c = *(text+i);
-       if (c<0xFF){
-           //Finally, check if this char is an escape sequence such as '\n'
-           //If it is, print it as '\n' rather than as a newline, for example
-           switch(c){
-               //Newline
-               case(10): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_N); break;
-               //Backspace
-               case(8): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_B); break;
-               //Horz tab
-               case(ARGO_HT): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_T); break;
-               //Form feed
-               case(ARGO_FF): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_F); break;
-               //Carriage Return
-               case(ARGO_CR): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_R); break;
-               //Double Quote
-               case(ARGO_QUOTE): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_QUOTE); break;
-               //Back slash
-               case(ARGO_BSLASH): fprintf(f, "%c%c", ARGO_BSLASH, ARGO_BSLASH); break;
-               //If the char is less than 1f and not one of the escapes above, print it using \u
-               default: {
-                   if (c<31){
-                        if (c<=16) fprintf(f, "%c%c%c%c%c%x", ARGO_BSLASH, ARGO_U, ARGO_DIGIT0, ARGO_DIGIT0, ARGO_DIGIT0, c);
-                        else fprintf(f, "%c%c%c%c%x", ARGO_BSLASH, ARGO_U, ARGO_DIGIT0, ARGO_DIGIT0, c);
-                   }
-                   else fprintf(f, "%c", c); 
-                   break;
-               }
-           }
-       }
-       //If the char is greater than or equal to 0x00FF, it has to be printed in unicode format (ie, '\u', followed by 0s (as needed) and the char's value in hex)
-       else{
-            //A number can be printed in hexadecimal format by using %x (for lowercase) or %X (uppercase) 
-            //Make sure to check how many hex digits are in the char, so that the appropriate amounts of 0s can be printed out
-            if (c==0xff) fprintf(f, "%c%c%c%c%x", ARGO_BSLASH, ARGO_U, ARGO_DIGIT0, ARGO_DIGIT0, c); //If 2 digits, print out 2 0s
-            else if (c <= 0xfff) fprintf(f, "%c%c%c%x", ARGO_BSLASH, ARGO_U, ARGO_DIGIT0, c); //If c has 3 digits, then pad/hardcode in 1 zero
-            else fprintf(f, "%c%c%x", ARGO_BSLASH, ARGO_U, c); //If c has 4 digits, then no 0s need to be manually printed
-       }
-       i++;
-    }
-    fprintf(f, "\""); //Make sure to start and end the string in quotations
-    //Return 0 if success
-    return 0;
+    ARGO_WRITER w;
+    if (argo_writer_open(&w, f)) return -1;
+    int ret = argo_writer_string(&w, s);
+    return argo_writer_close(&w) || ret ? -1 : 0;
 }
 
 /**
@@ -753,59 +783,8 @@ int argo_write_string(ARGO_STRING *s, FILE *f) {
  * nonzero if there is any error.
  */
 int argo_write_number(ARGO_NUMBER *n, FILE *f) {
-    //Get the valid int and valid float fields to use 
-    int valid_int = n->valid_int;
-    int valid_float = n->valid_float;
-
-    if (valid_int != 0) fprintf(f, "%ld", n->int_value);
-    //If valid_float, then normalize the float value of 
-    //this argo_num and print it out to the output stream
-    else if (valid_float != 0) write_float(n->float_value, f);
-    //Print error to stderr if neither
-    else return -1;
-
-    return 0;
-}
-void pretty_newline_detector(FILE *f){
-     //If this value is on the top level (ie, level=0) & pretty print is enabled, then print out a 
-    //single newline after the value along w/the required indentation
-    if (global_options >= 0x30000000){
-        //Check if  pretty print is enabled (with, or without a indent arg)
-        int indent = (global_options - 0x30000000)*level;
-        if (indent>0) fprintf(f, "\n%*c", indent, ' ');
-        else fprintf(f, "\n");
-    }
+    ARGO_WRITER w;
+    if (argo_writer_open(&w, f)) return -1;
+    int ret = argo_writer_number(&w, n);
+    return argo_writer_close(&w) || ret ? -1 : 0;
 }
-void write_float(double value, FILE *f){
-    int exp = 0;
-    int loop_count;
-    bool isNegative = (value < 0 ? true : false); //Keeps track of the sign of the number
-    value = (isNegative ? value*-1 : value); //Perform abs() on the value, if negative
-    //If float>1, then keep diving by 10 until its less than 1
-    if (value >= 1){
-        while (value >= 1){
-            value/=10;
-            exp++;
-        }
-    }
-    //If less than 0.1, then do the opposite (ie, mult until >0.1)
-    else if (value > 0.0){
-        while(value<0.1){
-            value*=10;
-            exp--;
-        }
-    }
-    //Since the float has been normalized, it will always start with "0.", so that can be printed out first
-    isNegative ? fprintf(f, "%s", "-0.") : fprintf(f, "%s", "0.");
-    //In order to ensure precision, each digit can be printed out using a loop that constantly 
-    //moves the next digit to be printed to be in front of the decimal point
-    for (loop_count=16; loop_count > 0; loop_count--){
-        //First, get the digit to be printed by multiplying 10 to move the digit up, and cast to an int
-        //This is so that the proper digit can be printed, and then subtracted out from the value to repeat the
-        //process on the next (now new tenths place) digit
-        int digit = (int)(value*=10);
-        fprintf(f, "%d", digit);
-        value-=digit;
-    }
-    if(exp != 0) fprintf(f, "%c%d",'e', exp);
-}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "validity.h"
+#include "ctx.h"
+
+//The default context, which the functions that don't take a context use. Its values go in argo_value_arena and its
+//names in argo_names, and the rest of its state is the variables of global.h: they are copied into it when it is
+//entered, and back out when it is left
+static ARGO_CTX default_ctx = {.arena = &argo_value_arena, .names = &argo_names};
+
+//Number of times the default context has been entered and not yet left. It is entered again when a function that
+//uses it calls another one (or a callback does), and its state is only copied when the outermost of them starts and ends
+static int default_depth;
+
+/**
+ * @brief  Set up a context, with the same state that a process starts with.
+ * @details  The context gets an arena and a table of names of its own, so the values
+ * read with it are only freed along with it. Nothing is allocated until it is used.
+ *
+ * @param cx  Context to set up.
+ */
+void argo_ctx_init(ARGO_CTX *cx){
+    __builtin_memset(cx, 0, sizeof(ARGO_CTX));
+    cx->arena = &cx->own_arena;
+    cx->names = &cx->own_names;
+}
+
+/**
+ * @brief  Give back the space of a context: its arena (and so the values in it),
+ * its table of names, and the scratch space of its parsers.
+ * @details  The context is left as argo_ctx_init leaves it, so it can be used again.
+ *
+ * @param cx  Context to free.
+ */
+void argo_ctx_free(ARGO_CTX *cx){
+    argo_ctx_intern_free(cx);
+    argo_arena_free(cx->arena);
+    free(cx->element_stack);
+    free(cx->frame_stack);
+    free(cx->tape_stack);
+    free(cx->decoded);
+    free(cx->name_scratch.content);
+    argo_ctx_init(cx);
+}
+
+/**
+ * @brief  Enter the default context, to call a function that takes a context in place
+ * of one that doesn't.
+ * @details  Unless the default context has already been entered, its state is set from
+ * argo_lines_read, argo_chars_read, level, global_options, argo_utf8_strings and
+ * argo_max_depth. The default context belongs to no thread in particular, so only one
+ * thread at a time may use it.
+ *
+ * @return  The default context, to be passed to argo_default_ctx_leave once the call is done.
+ */
+ARGO_CTX *argo_default_ctx_enter(void){
+    ARGO_CTX *cx = &default_ctx;
+    if (default_depth++ > 0) return cx;
+    cx->lines_read = argo_lines_read;
+    cx->chars_read = argo_chars_read;
+    cx->level = level;
+    cx->options = global_options;
+    cx->utf8_strings = argo_utf8_strings;
+    cx->max_depth = argo_max_depth;
+    return cx;
+}
+
+/**
+ * @brief  Leave the default context.
+ * @details  If it was entered only once, then its state is copied back to the variables
+ * that argo_default_ctx_enter set it from.
+ *
+ * @param cx  What argo_default_ctx_enter returned.
+ */
+void argo_default_ctx_leave(ARGO_CTX *cx){
+    if (--default_depth > 0) return;
+    argo_lines_read = cx->lines_read;
+    argo_chars_read = cx->chars_read;
+    level = cx->level;
+    global_options = cx->options;
+    argo_utf8_strings = cx->utf8_strings;
+    argo_max_depth = cx->max_depth;
+}
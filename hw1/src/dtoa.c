@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "debug.h"
+#include "dtoa.h"
+
+//Layout of an IEEE double
+#define DOUBLE_MANTISSA_BITS 52
+#define DOUBLE_EXPONENT_BITS 11
+#define DOUBLE_BIAS 1023
+
+//Number of bits in the entries of the power of five tables
+#define POW5_INV_BITCOUNT 125
+#define POW5_BITCOUNT 125
+
+//Pairs of decimal digits, so that the digits of the result can be written two at a time
+static const char digit_pairs[200] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+//ceil(log2(5^e)) (for 0 <= e <= 3528), and floor(log10(2^e)) and floor(log10(5^e)) (for 0 <= e <= 1650)
+static inline int32_t pow5bits(int32_t e) {return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;}
+static inline uint32_t log10_pow2(int32_t e) {return ((uint32_t)e * 78913) >> 18;}
+static inline uint32_t log10_pow5(int32_t e) {return ((uint32_t)e * 732923) >> 20;}
+
+//Number of times that 5 divides value
+static inline uint32_t pow5_factor(uint64_t value){
+    uint32_t count = 0;
+    while (value % 5 == 0){
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+static inline bool multiple_of_pow5(uint64_t value, uint32_t p) {return pow5_factor(value) >= p;}
+static inline bool multiple_of_pow2(uint64_t value, uint32_t p) {return (value & (((uint64_t)1 << p) - 1)) == 0;}
+
+//(m * mul) >> j, where mul is a 128-bit table entry and j >= 64
+static inline uint64_t mul_shift(uint64_t m, const uint64_t *mul, int32_t j){
+    unsigned __int128 b0 = (unsigned __int128)m * *mul;
+    unsigned __int128 b2 = (unsigned __int128)m * *(mul+1);
+    return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+//Number of decimal digits in v (which has at most 17)
+static inline int decimal_length(uint64_t v){
+    int length = 1;
+    while (v >= 10){
+        v /= 10;
+        length++;
+    }
+    return length;
+}
+
+/*
+ * Ryu: find the shortest decimal significand (*digits, with the value being *digits * 10^*exp10)
+ * that lies strictly within the interval of real numbers that round to the given double,
+ * choosing the one closest to the exact value if there are several. The interval bounds
+ * and the value itself are scaled by a power of ten with 125-bit table entries,
+ * and then digits are removed for as long as the bounds still differ.
+ */
+static void shortest(uint64_t ieeeMantissa, uint32_t ieeeExponent, uint64_t *digits, int32_t *exp10){
+    int32_t e2;
+    uint64_t m2;
+    if (ieeeExponent == 0){
+        e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = ieeeMantissa;
+    }
+    else{
+        e2 = (int32_t)ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = ((uint64_t)1 << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+    }
+    //Round to even: the bounds of the interval are included only if the mantissa is even
+    bool acceptBounds = (m2 & 1) == 0;
+    uint64_t mv = 4 * m2;
+    //The interval below a power of two is half as wide (except at the smallest exponent)
+    uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false, vrIsTrailingZeros = false;
+    if (e2 >= 0){
+        uint32_t q = log10_pow2(e2) - (e2 > 3);
+        e10 = (int32_t)q;
+        int32_t k = POW5_INV_BITCOUNT + pow5bits((int32_t)q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        const uint64_t *mul = *(argo_pow5_inv_split + q);
+        vr = mul_shift(4 * m2, mul, i);
+        vp = mul_shift(4 * m2 + 2, mul, i);
+        vm = mul_shift(4 * m2 - 1 - mmShift, mul, i);
+        if (q <= 21){
+            //Only one of mv, mv + 2, and mv - 1 - mmShift can be a multiple of 5, if any
+            if (mv % 5 == 0) vrIsTrailingZeros = multiple_of_pow5(mv, q);
+            else if (acceptBounds) vmIsTrailingZeros = multiple_of_pow5(mv - 1 - mmShift, q);
+            else vp -= multiple_of_pow5(mv + 2, q);
+        }
+    }
+    else{
+        uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+        e10 = (int32_t)q + e2;
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = pow5bits(i) - POW5_BITCOUNT;
+        int32_t j = (int32_t)q - k;
+        const uint64_t *mul = *(argo_pow5_split + i);
+        vr = mul_shift(4 * m2, mul, j);
+        vp = mul_shift(4 * m2 + 2, mul, j);
+        vm = mul_shift(4 * m2 - 1 - mmShift, mul, j);
+        if (q <= 1){
+            //mv has at least q trailing zero bits, so vr is exact
+            vrIsTrailingZeros = true;
+            if (acceptBounds) vmIsTrailingZeros = mmShift == 1;
+            else vp--;
+        }
+        else if (q < 63) vrIsTrailingZeros = multiple_of_pow2(mv, q);
+    }
+
+    int32_t removed = 0;
+    uint8_t lastRemovedDigit = 0;
+    uint64_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros){
+        //General case, where the exact value (or the lower bound) may have been cut off at a zero
+        while (vp / 10 > vm / 10){
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros){
+            while (vm % 10 == 0){
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        //If the exact value ends in ...50...0, then round to even
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) lastRemovedDigit = 4;
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    }
+    else{
+        //Common case: remove two digits at a time while possible, then one at a time
+        bool roundUp = false;
+        if (vp / 100 > vm / 100){
+            roundUp = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10){
+            roundUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || roundUp);
+    }
+    *digits = output;
+    *exp10 = e10 + removed;
+}
+
+/**
+ * @brief  Format a double in argo's canonical form.
+ * @details  The form is an optional '-', then "0.", then the significant digits,
+ * then 'e' and the exponent unless it is zero (so the value is 0.ddd times ten
+ * to the exponent). The digits are the shortest ones that read back as the same
+ * double, so no digits beyond those needed for a round trip are written. Zero is
+ * written as "0.0". No terminating null byte is written.
+ *
+ * @param value  Number to format.
+ * @param buf  Buffer of at least ARGO_DOUBLE_BUFFER bytes to write the text into.
+ * @return  The length of the text, or -1 if the value is infinite or not a number,
+ * which can't be represented in JSON.
+ */
+int argo_format_double(double value, char *buf){
+    uint64_t bits;
+    __builtin_memcpy(&bits, &value, 8);
+    uint64_t ieeeMantissa = bits & (((uint64_t)1 << DOUBLE_MANTISSA_BITS) - 1);
+    uint32_t ieeeExponent = (bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1);
+    bool isNegative = bits >> 63;
+    if (ieeeExponent == (1u << DOUBLE_EXPONENT_BITS) - 1) return -1;
+    char *p = buf;
+    //Negative zero is written the same as zero, as it always has been
+    if (ieeeExponent == 0 && ieeeMantissa == 0){
+        *p++ = ARGO_DIGIT0;
+        *p++ = ARGO_PERIOD;
+        *p++ = ARGO_DIGIT0;
+        return p - buf;
+    }
+    uint64_t digits;
+    int32_t exp10;
+    shortest(ieeeMantissa, ieeeExponent, &digits, &exp10);
+    //Trailing zeros aren't significant (they can be left over when the value is an integer)
+    while (digits % 10 == 0){
+        digits /= 10;
+        exp10++;
+    }
+    int length = decimal_length(digits);
+    if (isNegative) *p++ = ARGO_MINUS;
+    *p++ = ARGO_DIGIT0;
+    *p++ = ARGO_PERIOD;
+    //Write the digits from the last one back, two at a time
+    char *q = p + length;
+    while (digits >= 100){
+        int pair = (digits % 100) * 2;
+        digits /= 100;
+        *--q = *(digit_pairs + pair + 1);
+        *--q = *(digit_pairs + pair);
+    }
+    if (digits >= 10){
+        *--q = *(digit_pairs + digits * 2 + 1);
+        *--q = *(digit_pairs + digits * 2);
+    }
+    else *--q = ARGO_DIGIT0 + digits;
+    p += length;
+    //The digits are the significand of 0.ddd, so the exponent moves up by their number
+    int32_t exp = exp10 + length;
+    if (exp != 0){
+        *p++ = ARGO_E;
+        if (exp < 0){
+            *p++ = ARGO_MINUS;
+            exp = -exp;
+        }
+        if (exp >= 100) *p++ = ARGO_DIGIT0 + exp / 100;
+        if (exp >= 10) *p++ = ARGO_DIGIT0 + (exp / 10) % 10;
+        *p++ = ARGO_DIGIT0 + exp % 10;
+    }
+    return p - buf;
+}
@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "structural.h"
+#include "events.h"
+#include "validate.h"
+
+//What the parser expects to read next
+enum event_state {EXPECT_VALUE, EXPECT_FIRST_VALUE, EXPECT_FIRST_KEY, EXPECT_KEY, AFTER_VALUE};
+
+//Invoke a callback (if the handler has one), evaluating to true if the callback asked to stop
+#define emit(h, cb, ctx, ...) ((h)->cb != NULL && (h)->cb((ctx), ##__VA_ARGS__) != 0)
+
+/*
+ * Stack of the containers that are currently open. Each entry is the opening
+ * character of the container ('{' or '['). Nesting up to ARGO_EVENT_STACK deep
+ * doesn't need any allocation at all.
+ */
+typedef struct event_stack {
+    char *types;
+    size_t depth;
+    size_t size;
+    char space[ARGO_EVENT_STACK];
+} EVENT_STACK;
+
+//Push an opening character onto the stack, doubling its size if it is full (and refusing to nest deeper than the context allows)
+static int event_push(ARGO_CTX *cx, EVENT_STACK *st, char open){
+    if (cx->max_depth > 0 && st->depth >= (size_t)cx->max_depth){
+        fprintf(stderr, "Error: Nesting is deeper than %d at line %d\n", cx->max_depth, cx->lines_read);
+        return -1;
+    }
+    if (st->depth == st->size){
+        char *grown = malloc(st->size * 2);
+        if (grown == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for nesting depth %lu\n", st->depth);
+            return -1;
+        }
+        __builtin_memcpy(grown, st->types, st->size);
+        if (st->types != st->space) free(st->types);
+        st->types = grown;
+        st->size *= 2;
+    }
+    *(st->types + st->depth++) = open;
+    return 0;
+}
+
+//Read a string literal (whose opening quote is next) into scratch, or only check it if it is being validated
+static int event_string(ARGO_CTX *cx, ARGO_INPUT *in, ARGO_STRING *scratch, bool validate){
+    if (validate){
+        argo_getc(in);
+        return argo_validate_string_rest(cx, in);
+    }
+    scratch->length = 0;
+    return argo_read_string_append(cx, scratch, in);
+}
+
+//Parse one JSON value into events (the actual implementation of argo_parse_events). If "validate" is set,
+//then the handler doesn't see the strings (nor member names), which are checked with argo_validate_string_rest
+static int parse_events(ARGO_CTX *cx, ARGO_INPUT *in, const ARGO_HANDLER *h, void *ctx, bool validate){
+    cx->lines_read++;
+    EVENT_STACK st;
+    st.types = st.space;
+    st.depth = 0;
+    st.size = ARGO_EVENT_STACK;
+    //Strings (and member names) are all read into the same space, which is only freed at the end
+    ARGO_STRING scratch = {0};
+    int state = EXPECT_VALUE;
+    int ret = -1;
+    int c;
+
+    while (true){
+        if (state == AFTER_VALUE){
+            //A complete top level value has been read
+            if (st.depth == 0) {ret = 0; break;}
+            char open = *(st.types + st.depth - 1);
+            c = argo_next_token(cx, in);
+            if (c == ARGO_COMMA) {state = (open == ARGO_LBRACE ? EXPECT_KEY : EXPECT_VALUE); continue;}
+            if (c != (open == ARGO_LBRACE ? ARGO_RBRACE : ARGO_RBRACK)){
+                fprintf(stderr, "Error: Expected ',' or '%c' at line %d\n", open == ARGO_LBRACE ? ARGO_RBRACE : ARGO_RBRACK, cx->lines_read);
+                break;
+            }
+            st.depth--;
+            if (open == ARGO_LBRACE ? emit(h, end_object, ctx) : emit(h, end_array, ctx)) break;
+            continue;
+        }
+        if (state == EXPECT_FIRST_VALUE || state == EXPECT_FIRST_KEY){
+            //A container may be closed right after it is opened
+            c = argo_next_token(cx, in);
+            if (c == (state == EXPECT_FIRST_KEY ? ARGO_RBRACE : ARGO_RBRACK)){
+                st.depth--;
+                if (state == EXPECT_FIRST_KEY ? emit(h, end_object, ctx) : emit(h, end_array, ctx)) break;
+                state = AFTER_VALUE;
+                continue;
+            }
+            argo_ungetc(c, in);
+            state = (state == EXPECT_FIRST_KEY ? EXPECT_KEY : EXPECT_VALUE);
+        }
+        if (state == EXPECT_KEY){
+            c = argo_next_token(cx, in);
+            if (c != ARGO_QUOTE){
+                fprintf(stderr, "Error: Expected a member name at line %d\n", cx->lines_read);
+                break;
+            }
+            argo_ungetc(c, in);
+            if (event_string(cx, in, &scratch, validate) == -1) break;
+            if (argo_next_token(cx, in) != ARGO_COLON){
+                fprintf(stderr, "Error: Expected ':' at line %d\n", cx->lines_read);
+                break;
+            }
+            if (emit(h, key, ctx, &scratch)) break;
+        }
+        //Anything else is the start of a value
+        c = argo_next_token(cx, in);
+        if (c == ARGO_LBRACE || c == ARGO_LBRACK){
+            if (event_push(cx, &st, c) == -1) break;
+            if (c == ARGO_LBRACE ? emit(h, start_object, ctx) : emit(h, start_array, ctx)) break;
+            state = (c == ARGO_LBRACE ? EXPECT_FIRST_KEY : EXPECT_FIRST_VALUE);
+            continue;
+        }
+        else if (c == ARGO_QUOTE){
+            argo_ungetc(c, in);
+            if (event_string(cx, in, &scratch, validate) == -1) break;
+            if (emit(h, string, ctx, &scratch)) break;
+        }
+        else if (argo_is_digit(c) || c == ARGO_MINUS){
+            argo_ungetc(c, in);
+            ARGO_NUMBER n = {0};
+            int failed = argo_ctx_read_number(cx, &n, in) == -1 || emit(h, number, ctx, &n);
+            //The number's text isn't kept once it has been reported
+            if (n.string_value.capacity != 0) free(n.string_value.content);
+            if (failed) break;
+        }
+        else if (c == 'n' || c == 't' || c == 'f'){
+            ARGO_BASIC b;
+            if (argo_read_basic(cx, c, &b, in) == -1) break;
+            if (emit(h, basic, ctx, b)) break;
+        }
+        else{
+            if (c == EOF) fprintf(stderr, "Error: Premature EOF at line %d\n", cx->lines_read);
+            else fprintf(stderr, "Error: Invalid char at line %d\n", cx->lines_read);
+            break;
+        }
+        state = AFTER_VALUE;
+    }
+    if (st.types != st.space) free(st.types);
+    if (scratch.capacity != 0) free(scratch.content);
+    return ret;
+}
+
+/**
+ * @brief  Parse one JSON value from an input, reporting it to a handler as a
+ * sequence of events rather than building argo values.
+ * @details  Objects are reported as start_object, then a key event followed by
+ * the events for the member's value for each member, then end_object. Arrays are
+ * reported the same way, minus the keys. The parser is iterative, so the memory it
+ * uses only grows with the nesting depth of the input (plus the length of the
+ * longest string), and not with the size of the input.
+ * In case of an error (these include failure of the input to conform to the JSON
+ * standard, premature EOF, as well as other I/O errors), a one-line error message
+ * is output to standard error. The handler may already have seen events for
+ * the part of the input before the error.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @param h  Callbacks to invoke for each event.
+ * @param ctx  Passed unchanged to every callback.
+ * @return  Zero if the operation is completely successful, nonzero if there
+ * is any error or a callback stopped the parse.
+ */
+int argo_parse_events(ARGO_INPUT *in, const ARGO_HANDLER *h, void *ctx){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = parse_events(cx, in, h, ctx, false);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+/**
+ * @brief  Parse one JSON value from an input into events, keeping the parser's state in a context.
+ * @details  See argo_parse_events. The lines and characters read are counted in the
+ * context, and containers may be nested as deep as its max_depth allows.
+ *
+ * @param cx  Context to use.
+ * @param in  Input from which JSON is to be read.
+ * @param h  Callbacks to invoke for each event.
+ * @param ctx  Passed unchanged to every callback.
+ * @return  Zero if the operation is completely successful, nonzero if there
+ * is any error or a callback stopped the parse.
+ */
+int argo_ctx_parse_events(ARGO_CTX *cx, ARGO_INPUT *in, const ARGO_HANDLER *h, void *ctx){
+    return parse_events(cx, in, h, ctx, false);
+}
+
+/**
+ * @brief  Check that an input is syntactically correct JSON, without building
+ * any argo values.
+ * @details  Strings aren't decoded, but they are checked more strictly than the
+ * parsers that read them do (see argo_validate_string_rest): they must be UTF-8,
+ * and hold no control characters or unknown escapes.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @return  Zero if the input is valid, nonzero if there is any error.
+ */
+int argo_validate(ARGO_INPUT *in){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_validate(cx, in);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Check that an input is syntactically correct JSON, keeping the parser's state in a context (see argo_validate)
+int argo_ctx_validate(ARGO_CTX *cx, ARGO_INPUT *in){
+    const ARGO_HANDLER none = {0};
+    return parse_events(cx, in, &none, NULL, true);
+}
+
+//Write the separator that is due before a value or member name (if any)
+static void writer_separator(ARGO_EVENT_WRITER *w){
+    if (w->after_key) w->after_key = 0;
+    else if (w->need_comma){
+        argo_writer_put(&w->out, ARGO_COMMA);
+        argo_ctx_writer_newline(w->cx, &w->out);
+    }
+}
+
+//Finish writing a value: top level values are followed by newlines when pretty printing
+static int writer_value_end(ARGO_EVENT_WRITER *w){
+    w->need_comma = 1;
+    if (w->cx->level == 0 && w->out.indent >= 0) argo_writer_put(&w->out, ARGO_LF);
+    return w->out.error;
+}
+
+//Open an object or array, one level further in
+static int writer_open(ARGO_EVENT_WRITER *w, char open){
+    writer_separator(w);
+    w->cx->level++;
+    argo_writer_put(&w->out, open);
+    argo_ctx_writer_newline(w->cx, &w->out);
+    w->need_comma = 0;
+    return 0;
+}
+
+//Close an object or array, going back to the level of its opening character
+static int writer_close(ARGO_EVENT_WRITER *w, char close){
+    w->cx->level--;
+    argo_ctx_writer_newline(w->cx, &w->out);
+    argo_writer_put(&w->out, close);
+    return writer_value_end(w);
+}
+
+static int writer_start_object(void *ctx) {return writer_open(ctx, ARGO_LBRACE);}
+static int writer_end_object(void *ctx) {return writer_close(ctx, ARGO_RBRACE);}
+static int writer_start_array(void *ctx) {return writer_open(ctx, ARGO_LBRACK);}
+static int writer_end_array(void *ctx) {return writer_close(ctx, ARGO_RBRACK);}
+
+static int writer_key(void *ctx, ARGO_STRING *name){
+    ARGO_EVENT_WRITER *w = ctx;
+    writer_separator(w);
+    argo_writer_string(&w->out, name);
+    //If pretty print is specified, then print a single space following the ':'
+    if (w->out.indent >= 0) argo_writer_bytes(&w->out, ": ", 2);
+    else argo_writer_put(&w->out, ARGO_COLON);
+    w->after_key = 1;
+    return 0;
+}
+
+static int writer_string(void *ctx, ARGO_STRING *s){
+    ARGO_EVENT_WRITER *w = ctx;
+    writer_separator(w);
+    argo_writer_string(&w->out, s);
+    if (w->cx->level == 0) argo_ctx_writer_newline(w->cx, &w->out);
+    return writer_value_end(w);
+}
+
+static int writer_number(void *ctx, ARGO_NUMBER *n){
+    ARGO_EVENT_WRITER *w = ctx;
+    writer_separator(w);
+    if (argo_writer_number(&w->out, n) != 0) return -1;
+    if (w->cx->level == 0) argo_ctx_writer_newline(w->cx, &w->out);
+    return writer_value_end(w);
+}
+
+static int writer_basic(void *ctx, ARGO_BASIC b){
+    ARGO_EVENT_WRITER *w = ctx;
+    writer_separator(w);
+    argo_writer_basic(&w->out, b);
+    if (w->cx->level == 0) argo_ctx_writer_newline(w->cx, &w->out);
+    return writer_value_end(w);
+}
+
+const ARGO_HANDLER argo_writer_handler = {
+    writer_start_object, writer_end_object, writer_start_array, writer_end_array,
+    writer_key, writer_string, writer_number, writer_basic
+};
+
+/**
+ * @brief  Write canonical JSON for the value read from an input, as it is being parsed.
+ * @details  The output is the same as reading the value with argo_read_value and
+ * writing it with argo_write_value (including pretty printing, as selected by
+ * global_options), but no argo values are built, so the size of the input is
+ * not limited by memory. If the input turns out to be invalid, then the output
+ * written so far is left as is and an error is reported.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @param out  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_write_events(ARGO_INPUT *in, FILE *out){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_write_events(cx, in, out);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Write canonical JSON for the value read from an input as it is being parsed, keeping the state of the parser
+//and the writer in a context (see argo_write_events)
+int argo_ctx_write_events(ARGO_CTX *cx, ARGO_INPUT *in, FILE *out){
+    ARGO_EVENT_WRITER w;
+    if (argo_ctx_writer_open(cx, &w.out, out)) return -1;
+    w.cx = cx;
+    w.need_comma = 0;
+    w.after_key = 0;
+    cx->level = 0;
+    int ret = parse_events(cx, in, &argo_writer_handler, &w, false);
+    //Whatever was written before an error is still flushed, as it would have been without the buffer
+    return argo_writer_close(&w.out) || ret ? -1 : 0;
+}
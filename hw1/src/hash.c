@@ -0,0 +1,644 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "writer.h"
+#include "events.h"
+#include "query.h"
+#include "sort.h"
+#include "hash.h"
+
+//The primes of XXH64
+#define PRIME_1 0x9E3779B185EBCA87ULL
+#define PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME_3 0x165667B19E3779F9ULL
+#define PRIME_4 0x85EBCA77C2B2AE63ULL
+#define PRIME_5 0x27D4EB2F165667C5ULL
+
+//The further constants of XXH3
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME_MX1 0x165667919E3779F9ULL
+#define PRIME_MX2 0x9FB21C651E98DF25ULL
+
+//Number of bytes of the secret of XXH3, and of the stripes that are taken in between scramblings of its accumulators
+#define SECRET_SIZE 192
+#define BLOCK_STRIPES ((SECRET_SIZE - ARGO_HASH_WIDE_STRIPE) / 8)
+
+//Longest input that XXH3 hashes without its accumulators
+#define SHORT_MAX 240
+
+#define rotl(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+//The default secret of XXH3, which is the one it uses with a seed of zero
+static const unsigned char secret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+//Read 8 (or 4) bytes as a little-endian number, whatever the order of the machine
+static inline uint64_t read_64(const unsigned char *p){
+    uint64_t x;
+    __builtin_memcpy(&x, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+static inline uint64_t read_32(const unsigned char *p){
+    uint32_t x;
+    __builtin_memcpy(&x, p, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap32(x);
+#endif
+    return x;
+}
+
+//Mix 8 bytes of input into an accumulator
+static inline uint64_t hash_round(uint64_t acc, uint64_t input){
+    acc += input * PRIME_2;
+    acc = rotl(acc, 31);
+    return acc * PRIME_1;
+}
+
+//Mix an accumulator into the hash, once the input has ended
+static inline uint64_t hash_merge(uint64_t h, uint64_t acc){
+    h ^= hash_round(0, acc);
+    return h * PRIME_1 + PRIME_4;
+}
+
+//Take in whole stripes of XXH64
+static void hash_stripes(ARGO_HASH *h, const unsigned char *p, size_t stripes){
+    uint64_t a = *h->acc, b = *(h->acc+1), c = *(h->acc+2), d = *(h->acc+3);
+    size_t i;
+    for (i = 0; i < stripes; i++, p += ARGO_HASH_STRIPE){
+        a = hash_round(a, read_64(p));
+        b = hash_round(b, read_64(p+8));
+        c = hash_round(c, read_64(p+16));
+        d = hash_round(d, read_64(p+24));
+    }
+    *h->acc = a; *(h->acc+1) = b; *(h->acc+2) = c; *(h->acc+3) = d;
+}
+
+//The final mixing of XXH64, which XXH3 also uses for its shortest inputs
+static inline uint64_t hash_avalanche(uint64_t x){
+    x ^= x >> 33;
+    x *= PRIME_2;
+    x ^= x >> 29;
+    x *= PRIME_3;
+    x ^= x >> 32;
+    return x;
+}
+
+//Finish XXH64, with a seed of zero
+static uint64_t hash_final_64(ARGO_HASH *h){
+    uint64_t *acc = h->acc, x;
+    const unsigned char *p = h->buffer, *end = h->buffer + h->held;
+    if (h->total >= ARGO_HASH_STRIPE){
+        x = rotl(*acc, 1) + rotl(*(acc+1), 7) + rotl(*(acc+2), 12) + rotl(*(acc+3), 18);
+        x = hash_merge(x, *acc);
+        x = hash_merge(x, *(acc+1));
+        x = hash_merge(x, *(acc+2));
+        x = hash_merge(x, *(acc+3));
+    }
+    else x = PRIME_5;
+    x += h->total;
+    for (; p + 8 <= end; p += 8){
+        x ^= hash_round(0, read_64(p));
+        x = rotl(x, 27) * PRIME_1 + PRIME_4;
+    }
+    if (p + 4 <= end){
+        x ^= read_32(p) * PRIME_1;
+        x = rotl(x, 23) * PRIME_2 + PRIME_3;
+        p += 4;
+    }
+    for (; p < end; p++){
+        x ^= *p * PRIME_5;
+        x = rotl(x, 11) * PRIME_1;
+    }
+    return hash_avalanche(x);
+}
+
+//The final mixing of XXH3
+static inline uint64_t wide_avalanche(uint64_t x){
+    x ^= x >> 37;
+    x *= PRIME_MX1;
+    return x ^ (x >> 32);
+}
+
+//Multiply two 64-bit numbers, and fold the 128-bit product into 64 bits
+static inline uint64_t mul_fold(uint64_t a, uint64_t b){
+    __uint128_t m = (__uint128_t)a * b;
+    return (uint64_t)m ^ (uint64_t)(m >> 64);
+}
+
+//Mix 16 bytes of input with 16 bytes of the secret
+static inline uint64_t mix_16(const unsigned char *p, const unsigned char *s){
+    return mul_fold(read_64(p) ^ read_64(s), read_64(p+8) ^ read_64(s+8));
+}
+
+//Mix 32 bytes of input, in two runs of 16, into both halves of a 128-bit hash
+static inline void mix_32(uint64_t *low, uint64_t *high, const unsigned char *p, const unsigned char *q,
+        const unsigned char *s){
+    *low += mix_16(p, s);
+    *low ^= read_64(q) + read_64(q+8);
+    *high += mix_16(q, s+16);
+    *high ^= read_64(p) + read_64(p+8);
+}
+
+//Take in one stripe of XXH3, with the part of the secret at s
+static inline void wide_stripe(uint64_t *acc, const unsigned char *p, const unsigned char *s){
+    int i;
+    for (i = 0; i < 8; i++){
+        uint64_t data = read_64(p + 8*i), key = data ^ read_64(s + 8*i);
+        *(acc + (i ^ 1)) += data;
+        *(acc+i) += (key & 0xFFFFFFFF) * (key >> 32);
+    }
+}
+
+//Take in whole stripes of XXH3, scrambling the accumulators each time a block of them is complete
+static void wide_stripes(uint64_t *acc, size_t *done, const unsigned char *p, size_t stripes){
+    size_t i;
+    int j;
+    for (i = 0; i < stripes; i++, p += ARGO_HASH_WIDE_STRIPE){
+        wide_stripe(acc, p, secret + 8 * *done);
+        if (++*done < BLOCK_STRIPES) continue;
+        for (j = 0; j < 8; j++){
+            uint64_t x = *(acc+j);
+            x ^= x >> 47;
+            x ^= read_64(secret + SECRET_SIZE - ARGO_HASH_WIDE_STRIPE + 8*j);
+            *(acc+j) = x * PRIME32_1;
+        }
+        *done = 0;
+    }
+}
+
+//Fold the accumulators of XXH3 into one half of the hash
+static uint64_t wide_merge(uint64_t *acc, const unsigned char *s, uint64_t x){
+    int i;
+    for (i = 0; i < 4; i++) x += mul_fold(*(acc + 2*i) ^ read_64(s + 16*i), *(acc + 2*i + 1) ^ read_64(s + 16*i + 8));
+    return wide_avalanche(x);
+}
+
+//XXH3-128 of an input of no more than 16 bytes
+static void wide_final_16(const unsigned char *p, size_t len, ARGO_DIGEST *d){
+    if (len == 0){
+        d->low = hash_avalanche(read_64(secret+64) ^ read_64(secret+72));
+        d->high = hash_avalanche(read_64(secret+80) ^ read_64(secret+88));
+    }
+    else if (len <= 3){
+        uint32_t low = ((uint32_t)*p << 16) | ((uint32_t)*(p + (len >> 1)) << 24) | *(p + len - 1) | (uint32_t)(len << 8);
+        uint32_t high = __builtin_bswap32(low);
+        high = (high << 13) | (high >> 19);
+        d->low = hash_avalanche(low ^ (read_32(secret) ^ read_32(secret+4)));
+        d->high = hash_avalanche(high ^ (read_32(secret+8) ^ read_32(secret+12)));
+    }
+    else if (len <= 8){
+        uint64_t x = (read_32(p) + (read_32(p + len - 4) << 32)) ^ (read_64(secret+16) ^ read_64(secret+24));
+        __uint128_t m = (__uint128_t)x * (PRIME_1 + (len << 2));
+        uint64_t low = m, high = m >> 64;
+        high += low << 1;
+        low ^= high >> 3;
+        low ^= low >> 35;
+        low *= PRIME_MX2;
+        d->low = low ^ (low >> 28);
+        d->high = wide_avalanche(high);
+    }
+    else {
+        uint64_t y = read_64(p + len - 8);
+        __uint128_t m = (__uint128_t)(read_64(p) ^ y ^ read_64(secret+32) ^ read_64(secret+40)) * PRIME_1;
+        uint64_t low = m, high = m >> 64;
+        low += (uint64_t)(len - 1) << 54;
+        y ^= read_64(secret+48) ^ read_64(secret+56);
+        high += y + (y & 0xFFFFFFFF) * (PRIME32_2 - 1);
+        low ^= __builtin_bswap64(high);
+        m = (__uint128_t)low * PRIME_2;
+        d->low = wide_avalanche((uint64_t)m);
+        d->high = wide_avalanche((uint64_t)(m >> 64) + high * PRIME_2);
+    }
+}
+
+//XXH3-128 of an input of no more than SHORT_MAX bytes
+static void wide_final_short(const unsigned char *p, size_t len, ARGO_DIGEST *d){
+    uint64_t low = len * PRIME_1, high = 0;
+    size_t i;
+    if (len <= 16){
+        wide_final_16(p, len, d);
+        return;
+    }
+    if (len <= 128){
+        for (i = (len - 1) / 32; i > 0; i--) mix_32(&low, &high, p + 16*i, p + len - 16*(i+1), secret + 32*i);
+        mix_32(&low, &high, p, p + len - 16, secret);
+    }
+    else {
+        for (i = 0; i < 4; i++) mix_32(&low, &high, p + 32*i, p + 32*i + 16, secret + 32*i);
+        low = wide_avalanche(low);
+        high = wide_avalanche(high);
+        for (i = 4; i < len / 32; i++) mix_32(&low, &high, p + 32*i, p + 32*i + 16, secret + 3 + 32*(i-4));
+        //The last 32 bytes are taken in again, the other way around and with a seed of zero
+        mix_32(&low, &high, p + len - 16, p + len - 32, secret + 136 - 17 - 16);
+    }
+    d->low = wide_avalanche(low + high);
+    d->high = 0 - wide_avalanche(low * PRIME_1 + high * PRIME_4 + len * PRIME_2);
+}
+
+//Finish XXH3-128, with a seed of zero
+static void wide_final(ARGO_HASH *h, ARGO_DIGEST *d){
+    uint64_t acc[8];
+    size_t done = h->stripes;
+    unsigned char last[ARGO_HASH_WIDE_STRIPE];
+    if (h->total <= SHORT_MAX){
+        wide_final_short(h->buffer, h->held, d);
+        return;
+    }
+    //The stripes still held are taken in by a copy of the accumulators, which are left as they were
+    __builtin_memcpy(acc, h->acc, sizeof(acc));
+    if (h->held >= ARGO_HASH_WIDE_STRIPE){
+        wide_stripes(acc, &done, h->buffer, (h->held - 1) / ARGO_HASH_WIDE_STRIPE);
+        __builtin_memcpy(last, h->buffer + h->held - ARGO_HASH_WIDE_STRIPE, ARGO_HASH_WIDE_STRIPE);
+    }
+    else {
+        //The last stripe begins in what was taken in before
+        __builtin_memcpy(last, h->last + h->held, ARGO_HASH_WIDE_STRIPE - h->held);
+        __builtin_memcpy(last + ARGO_HASH_WIDE_STRIPE - h->held, h->buffer, h->held);
+    }
+    wide_stripe(acc, last, secret + SECRET_SIZE - ARGO_HASH_WIDE_STRIPE - 7);
+    d->low = wide_merge(acc, secret + 11, h->total * PRIME_1);
+    d->high = wide_merge(acc, secret + SECRET_SIZE - ARGO_HASH_WIDE_STRIPE - 11, ~(h->total * PRIME_2));
+}
+
+/**
+ * @brief  Start a hash.
+ *
+ * @param h  Hash to start.
+ * @param bits  Size of the hash: 128, or 64 for anything else.
+ */
+void argo_hash_init(ARGO_HASH *h, int bits){
+    h->bits = bits == 128 ? 128 : 64;
+    h->held = 0;
+    h->total = 0;
+    h->stripes = 0;
+    if (h->bits == 64){
+        *h->acc = PRIME_1 + PRIME_2;
+        *(h->acc+1) = PRIME_2;
+        *(h->acc+2) = 0;
+        *(h->acc+3) = 0 - PRIME_1;
+        return;
+    }
+    *h->acc = PRIME32_3;
+    *(h->acc+1) = PRIME_1;
+    *(h->acc+2) = PRIME_2;
+    *(h->acc+3) = PRIME_3;
+    *(h->acc+4) = PRIME_4;
+    *(h->acc+5) = PRIME32_2;
+    *(h->acc+6) = PRIME_5;
+    *(h->acc+7) = PRIME32_1;
+}
+
+//Add a run of bytes to XXH3. The buffer is only taken in once more input comes after it, so that
+//the last stripe is always at hand when the hash is finished
+static void wide_update(ARGO_HASH *h, const unsigned char *p, size_t n){
+    while (n > 0){
+        if (h->held == ARGO_HASH_BUFFER){
+            wide_stripes(h->acc, &h->stripes, h->buffer, ARGO_HASH_BUFFER / ARGO_HASH_WIDE_STRIPE);
+            __builtin_memcpy(h->last, h->buffer + ARGO_HASH_BUFFER - ARGO_HASH_WIDE_STRIPE, ARGO_HASH_WIDE_STRIPE);
+            h->held = 0;
+        }
+        //Long runs are taken in where they are, and not copied to the buffer first
+        if (h->held == 0 && n > ARGO_HASH_BUFFER){
+            size_t whole = (n - 1) / ARGO_HASH_BUFFER * ARGO_HASH_BUFFER;
+            wide_stripes(h->acc, &h->stripes, p, whole / ARGO_HASH_WIDE_STRIPE);
+            __builtin_memcpy(h->last, p + whole - ARGO_HASH_WIDE_STRIPE, ARGO_HASH_WIDE_STRIPE);
+            p += whole;
+            n -= whole;
+        }
+        size_t take = ARGO_HASH_BUFFER - h->held;
+        if (take > n) take = n;
+        __builtin_memcpy(h->buffer + h->held, p, take);
+        h->held += take;
+        p += take;
+        n -= take;
+    }
+}
+
+/**
+ * @brief  Add a run of bytes to a hash.
+ * @details  The result doesn't depend on how the input is divided into runs.
+ *
+ * @param h  Hash to add to.
+ * @param bytes  Bytes to add.
+ * @param n  Number of bytes.
+ */
+void argo_hash_update(ARGO_HASH *h, const void *bytes, size_t n){
+    const unsigned char *p = bytes;
+    h->total += n;
+    if (h->bits == 128){
+        wide_update(h, p, n);
+        return;
+    }
+    //Complete the stripe that was left partial, if there is one
+    if (h->held > 0){
+        size_t take = ARGO_HASH_STRIPE - h->held;
+        if (take > n) take = n;
+        __builtin_memcpy(h->buffer + h->held, p, take);
+        h->held += take;
+        p += take;
+        n -= take;
+        if (h->held < ARGO_HASH_STRIPE) return;
+        hash_stripes(h, h->buffer, 1);
+        h->held = 0;
+    }
+    hash_stripes(h, p, n / ARGO_HASH_STRIPE);
+    p += n - n % ARGO_HASH_STRIPE;
+    h->held = n % ARGO_HASH_STRIPE;
+    __builtin_memcpy(h->buffer, p, h->held);
+}
+
+/**
+ * @brief  Finish a hash.
+ * @details  The hash itself is left as it was, so more can still be added to it.
+ *
+ * @param h  Hash to finish.
+ * @param d  Digest to set to the result.
+ */
+void argo_hash_final(ARGO_HASH *h, ARGO_DIGEST *d){
+    d->bits = h->bits;
+    if (h->bits == 128){
+        wide_final(h, d);
+        return;
+    }
+    d->low = hash_final_64(h);
+    d->high = 0;
+}
+
+/**
+ * @brief  Write a digest in hexadecimal, the high half (if there is one) first.
+ *
+ * @param d  Digest to write.
+ * @param hex  Space for at least ARGO_DIGEST_HEX characters, which is set to
+ * the hexadecimal digits followed by a null character.
+ */
+void argo_digest_hex(ARGO_DIGEST *d, char *hex){
+    const char *digits = "0123456789abcdef";
+    int i, n = 0;
+    if (d->bits == 128){
+        for (i = 60; i >= 0; i -= 4) *(hex + n++) = *(digits + ((d->high >> i) & 0xF));
+    }
+    for (i = 60; i >= 0; i -= 4) *(hex + n++) = *(digits + ((d->low >> i) & 0xF));
+    *(hex+n) = 0;
+}
+
+//Sink of a hasher's writer, which adds the output to the hash
+static int hash_sink(void *ctx, const unsigned char *bytes, size_t len){
+    argo_hash_update(ctx, bytes, len);
+    return 0;
+}
+
+/**
+ * @brief  Open a hasher, which hashes the canonical form of values.
+ * @details  The canonical form is the one without pretty printing, whatever
+ * global_options says.
+ *
+ * @param h  Hasher to open.
+ * @param bits  Size of the hashes: 128, or 64 for anything else.
+ * @return  Zero if successful, nonzero if space for its writer couldn't be allocated.
+ */
+int argo_hasher_open(ARGO_HASHER *h, int bits){
+    if (argo_writer_open_sink(&h->w.out, hash_sink, &h->hash)) return -1;
+    h->w.out.indent = -1;
+    argo_hash_init(&h->hash, bits);
+    return 0;
+}
+
+/**
+ * @brief  Close a hasher, freeing the space of its writer.
+ *
+ * @param h  Hasher to close.
+ * @return  Zero (hashing can't fail once the hasher is open).
+ */
+int argo_hasher_close(ARGO_HASHER *h){
+    //Whatever is left in the buffer belongs to a value that wasn't finished
+    h->w.out.len = 0;
+    return argo_writer_close(&h->w.out);
+}
+
+//Empty a hasher's writer and start its hash again, for the next value
+static void hasher_reset(ARGO_HASHER *h){
+    h->w.out.len = 0;
+    h->w.out.error = 0;
+    h->w.out.mark = ARGO_NO_MARK;
+    h->w.out.depth = 0;
+    h->w.need_comma = 0;
+    h->w.after_key = 0;
+    argo_hash_init(&h->hash, h->hash.bits);
+}
+
+//Hash what is left in a hasher's writer, and finish the hash
+static int hasher_final(ARGO_HASHER *h, ARGO_DIGEST *d){
+    if (argo_writer_flush(&h->w.out)) return -1;
+    argo_hash_final(&h->hash, d);
+    return 0;
+}
+
+/**
+ * @brief  Hash the canonical form of the value read from an input, as it is being parsed.
+ * @details  The input is parsed as by argo_write_events, and no argo values are built.
+ *
+ * @param h  Hasher to use.
+ * @param in  Input from which JSON is to be read.
+ * @param d  Digest to set to the hash, if the input is valid.
+ * @return  Zero if successful, nonzero if the input is invalid.
+ */
+int argo_hash_events(ARGO_HASHER *h, ARGO_INPUT *in, ARGO_DIGEST *d){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_hash_events(cx, h, in, d);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Hash the canonical form of the value read from an input in a context, as it is being parsed (see argo_hash_events)
+int argo_ctx_hash_events(ARGO_CTX *cx, ARGO_HASHER *h, ARGO_INPUT *in, ARGO_DIGEST *d){
+    int saved = cx->level;
+    hasher_reset(h);
+    h->w.cx = cx;
+    cx->level = 0;
+    int ret = argo_ctx_parse_events(cx, in, &argo_writer_handler, &h->w);
+    cx->level = saved;
+    if (ret) return -1;
+    return hasher_final(h, d);
+}
+
+/**
+ * @brief  Hash the canonical form of a value, which can be anywhere in a tree of argo values.
+ * @details  The value's name, if it is a member, isn't part of its canonical form, so
+ * equal values have equal hashes wherever they are. Hashing a value doesn't change it,
+ * so the hash of any part of a tree can be had whenever it is needed.
+ *
+ * @param h  Hasher to use.
+ * @param v  Value to hash.
+ * @param d  Digest to set to the hash.
+ * @return  Zero if successful, nonzero if the value can't be written as JSON.
+ */
+int argo_hash_value(ARGO_HASHER *h, ARGO_VALUE *v, ARGO_DIGEST *d){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_hash_value(cx, h, v, d);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Hash the canonical form of a value, writing it with the state of a context (see argo_hash_value)
+int argo_ctx_hash_value(ARGO_CTX *cx, ARGO_HASHER *h, ARGO_VALUE *v, ARGO_DIGEST *d){
+    ARGO_VALUE copy = *v;
+    int saved = cx->level;
+    copy.name.content = NULL;
+    hasher_reset(h);
+    cx->level = 0;
+    int ret = argo_ctx_writer_value(cx, &h->w.out, &copy);
+    cx->level = saved;
+    if (ret) return -1;
+    return hasher_final(h, d);
+}
+
+/**
+ * @brief  Write a digest in hexadecimal, on a line of its own.
+ *
+ * @param w  Writer to write to.
+ * @param d  Digest to write.
+ */
+void argo_writer_digest(ARGO_WRITER *w, ARGO_DIGEST *d){
+    char hex[ARGO_DIGEST_HEX];
+    argo_digest_hex(d, hex);
+    argo_writer_bytes(w, hex, d->bits / 4);
+    argo_writer_put(w, ARGO_LF);
+}
+
+/*
+ * State of argo_hash_query_to, while its query is run.
+ */
+typedef struct hash_query {
+    ARGO_CTX *cx;
+    ARGO_HASHER *h;
+    ARGO_WRITER *w;
+} HASH_QUERY;
+
+//Callback for argo_hash_query_to, which writes the hash of each selected value
+static int hash_match(void *ctx, ARGO_VALUE *v){
+    HASH_QUERY *hq = ctx;
+    ARGO_DIGEST d;
+    if (argo_ctx_hash_value(hq->cx, hq->h, v, &d)) return -1;
+    argo_writer_digest(hq->w, &d);
+    return 0;
+}
+
+/**
+ * @brief  Write the hashes of the values selected from a value by a query.
+ * @details  This is argo_query_write_to with the hash of each selected value
+ * written in place of the value.
+ *
+ * @param h  Hasher to use.
+ * @param q  Compiled query.
+ * @param root  Value to run the query against.
+ * @param w  Writer to which the hashes are written.
+ * @return  Zero if successful, nonzero if writing has failed.
+ */
+int argo_hash_query_to(ARGO_HASHER *h, ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_hash_query_to(cx, h, q, root, w);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Write the hashes of the values selected by a query from a value read in a context (see argo_hash_query_to)
+int argo_ctx_hash_query_to(ARGO_CTX *cx, ARGO_HASHER *h, ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w){
+    HASH_QUERY hq = {cx, h, w};
+    size_t count = argo_ctx_query_eval(cx, q, root, hash_match, &hq);
+    debug("Query selected %lu values to hash\n", count);
+    return w->error;
+}
+
+/**
+ * @brief  Read a value from an input and write the hash of its canonical form.
+ * @details  The hash has argo_hash_bits bits, and is written in hexadecimal on a line
+ * of its own. Nothing is written if the input is invalid.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @param out  Output stream to which the hash is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_hash_write(ARGO_INPUT *in, FILE *out){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_hash_write(cx, in, out);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Read a value from an input in a context and write the hash of its canonical form (see argo_hash_write)
+int argo_ctx_hash_write(ARGO_CTX *cx, ARGO_INPUT *in, FILE *out){
+    ARGO_HASHER h;
+    ARGO_DIGEST d;
+    char hex[ARGO_DIGEST_HEX];
+    if (argo_hasher_open(&h, argo_hash_bits)) return -1;
+    int ret;
+    //Members can only be sorted once the whole value has been read
+    if (argo_extra_options & SORT_OPTION){
+        ARGO_VALUE *root = argo_ctx_read_value_canonical(cx, in);
+        ret = root == NULL ? -1 : argo_ctx_hash_value(cx, &h, root, &d);
+    }
+    else ret = argo_ctx_hash_events(cx, &h, in, &d);
+    argo_hasher_close(&h);
+    if (ret) return -1;
+    argo_digest_hex(&d, hex);
+    return fprintf(out, "%s\n", hex) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief  Read a value from an input and write the hashes of the values selected from it by a query.
+ * @details  See argo_hash_query_to. The hashes have argo_hash_bits bits.
+ *
+ * @param q  Compiled query.
+ * @param in  Input from which JSON is to be read.
+ * @param out  Output stream to which the hashes are to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_hash_query(ARGO_QUERY *q, ARGO_INPUT *in, FILE *out){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_hash_query(cx, q, in, out);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Read a value from an input in a context and write the hashes of the values selected from it by a query (see argo_hash_query)
+int argo_ctx_hash_query(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_INPUT *in, FILE *out){
+    ARGO_VALUE *root = argo_ctx_read_value_canonical(cx, in);
+    if (root == NULL) return -1;
+    ARGO_HASHER h;
+    ARGO_WRITER w;
+    if (argo_hasher_open(&h, argo_hash_bits)) return -1;
+    if (argo_ctx_writer_open(cx, &w, out)){
+        argo_hasher_close(&h);
+        return -1;
+    }
+    argo_ctx_hash_query_to(cx, &h, q, root, &w);
+    argo_hasher_close(&h);
+    return argo_writer_close(&w);
+}
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "input.h"
+#include "structural.h"
+
+/**
+ * @brief  Set up an input that reads from a caller-supplied buffer.
+ * @details  The buffer is not copied, so it must stay valid (and unmodified)
+ * for as long as the input is being read from, as well as for as long as any
+ * ARGO_UTF8 strings parsed from it are in use (these may point into the buffer).
+ *
+ * @param in  Input to initialize.
+ * @param buf  Bytes to be parsed.
+ * @param len  Number of bytes in buf.
+ * @return  Zero (this can't fail).
+ */
+int argo_input_open_mem(ARGO_INPUT *in, const char *buf, size_t len){
+    in->buf = (const unsigned char *)buf;
+    in->pos = 0;
+    in->len = len;
+    in->src = NULL;
+    in->origin = NULL;
+    in->block = NULL;
+    in->block_size = 0;
+    in->map_len = 0;
+    in->exact = false;
+    in->stable = buf != NULL;
+    in->index = NULL;
+    return 0;
+}
+
+/**
+ * @brief  Set up an input that reads from a stream.
+ * @details  If the stream is a regular file, then the whole file is mapped into
+ * memory and the parser reads it in place, starting from the stream's current
+ * position. Otherwise (pipes, terminals, etc) the input is refilled from the
+ * stream in blocks of ARGO_INPUT_BLOCK bytes. If "exact" is set, then an unmappable
+ * stream is read one byte at a time and the unconsumed bytes are pushed back when the
+ * input is closed, so that the caller can keep reading from the stream afterwards.
+ *
+ * @param in  Input to initialize.
+ * @param f  Stream from which JSON is to be read.
+ * @param exact  Nonzero if the stream must be left positioned right after the parsed text.
+ * @return  Zero if successful, nonzero if the refill buffer couldn't be allocated.
+ */
+int argo_input_open_file(ARGO_INPUT *in, FILE *f, bool exact){
+    argo_input_open_mem(in, NULL, 0);
+    in->origin = f;
+    in->exact = exact;
+    struct stat st;
+    long offset = ftell(f);
+    //Only regular, seekable files with something left to read are mapped
+    if (offset >= 0 && fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > offset){
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+        if (map != MAP_FAILED){
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            in->buf = map;
+            in->pos = offset;
+            in->len = st.st_size;
+            in->map_len = st.st_size;
+            debug("Mapped %ld bytes of input starting at offset %ld\n", (long)st.st_size, offset);
+            return 0;
+        }
+    }
+    //If the file couldn't be mapped, then fall back to refilling a block buffer from the stream
+    in->block_size = exact ? 16 : ARGO_INPUT_BLOCK;
+    in->block = malloc(in->block_size);
+    if (in->block == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for the input buffer\n");
+        return -1;
+    }
+    in->buf = in->block;
+    in->src = f;
+    return 0;
+}
+
+/**
+ * @brief  Release the resources held by an input.
+ * @details  For a mapped file, the stream is repositioned to just after the last byte
+ * consumed by the parser. For an exact stream input, the bytes that were read ahead
+ * but not consumed are pushed back onto the stream.
+ *
+ * @param in  Input to close.
+ */
+void argo_input_close(ARGO_INPUT *in){
+    if (in->map_len != 0){
+        if (in->origin != NULL) fseek(in->origin, in->pos, SEEK_SET);
+        munmap((void *)in->buf, in->map_len);
+    }
+    else if (in->block != NULL){
+        //Push back in reverse order so that the next fgetc sees the first unconsumed byte
+        if (in->exact){
+            size_t i = in->len;
+            while (i > in->pos) ungetc(*(in->block + --i), in->origin);
+        }
+        free(in->block);
+    }
+    argo_index_free(in);
+    argo_input_open_mem(in, NULL, 0);
+}
+
+/**
+ * @brief  Make at least "need" unconsumed bytes available in the input buffer.
+ * @details  The unconsumed bytes (and ARGO_INPUT_LOOKBACK bytes of already consumed input,
+ * so that argo_ungetc keeps working) are moved to the start of the block buffer, and
+ * the rest of the buffer is filled from the stream. The buffer is grown if "need" does
+ * not fit into it. Once the stream reaches end of file, the input stops refilling.
+ *
+ * @param in  Input to refill.
+ * @param need  Number of unconsumed bytes that the caller wants available.
+ * @return  The number of unconsumed bytes available, which is less than "need" only
+ * if the input has ended.
+ */
+long argo_input_refill(ARGO_INPUT *in, size_t need){
+    if (in->src == NULL) return in->len - in->pos;
+    size_t keep = in->pos < ARGO_INPUT_LOOKBACK ? in->pos : ARGO_INPUT_LOOKBACK;
+    size_t start = in->pos - keep;
+    if (start > 0){
+        __builtin_memmove(in->block, in->block + start, in->len - start);
+        in->len -= start;
+        in->pos = keep;
+    }
+    while (in->len - in->pos < need){
+        //Grow the block if the requested lookahead (plus the lookback) doesn't fit in it
+        if (in->len == in->block_size){
+            unsigned char *grown = realloc(in->block, in->block_size * 2);
+            if (grown == NULL) break;
+            in->block = grown;
+            in->block_size *= 2;
+        }
+        size_t got = 0;
+        if (in->exact){
+            //Read only as many bytes as were asked for, so that the stream isn't read past the value
+            int c;
+            while (in->len + got < in->block_size && in->len + got - in->pos < need && (c = fgetc(in->src)) != EOF){
+                *(in->block + in->len + got) = c;
+                got++;
+            }
+        }
+        else got = fread(in->block + in->len, 1, in->block_size - in->len, in->src);
+        in->len += got;
+        if (got == 0 || feof(in->src) || ferror(in->src)){
+            //Stop refilling once the stream has ended, so argo_getc can return EOF without a library call
+            if (in->len - in->pos < need || feof(in->src) || ferror(in->src)) in->src = NULL;
+            break;
+        }
+    }
+    in->buf = in->block;
+    //The bytes have moved (and the padded last block of the index now has real data in it)
+    argo_index_invalidate(in);
+    return in->len - in->pos;
+}
@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "arena.h"
+#include "access.h"
+#include "writer.h"
+#include "intern.h"
+
+//Home slot of a hash (folded as for the member index, see access.c)
+#define home_slot(hash, mask) (((hash) ^ ((hash) >> 29)) & (mask))
+
+//Empty the table of a context if the names in it were allocated before its arena was last reset
+static int intern_check(ARGO_CTX *cx){
+    ARGO_INTERN *t = cx->names;
+    if (t->mask != 0 && t->generation == cx->arena->generation) return 0;
+    if (t->mask + 1 > ARGO_INTERN_KEEP) argo_ctx_intern_free(cx);
+    if (t->mask == 0){
+        t->slots = calloc(ARGO_INTERN_SLOTS, sizeof(ARGO_INTERNED_NAME *));
+        if (t->slots == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for member names\n");
+            return -1;
+        }
+        t->mask = ARGO_INTERN_SLOTS - 1;
+    }
+    else __builtin_memset(t->slots, 0, (t->mask + 1) * sizeof(ARGO_INTERNED_NAME *));
+    t->count = 0;
+    t->generation = cx->arena->generation;
+    return 0;
+}
+
+//Double the number of slots of a table, moving each name to its slot in the new one
+static int intern_grow(ARGO_INTERN *t){
+    size_t mask = 2 * t->mask + 1, i;
+    ARGO_INTERNED_NAME **slots = calloc(mask + 1, sizeof(ARGO_INTERNED_NAME *));
+    if (slots == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for member names\n");
+        return -1;
+    }
+    for (i = 0; i <= t->mask; i++){
+        ARGO_INTERNED_NAME *e = *(t->slots+i);
+        if (e == NULL) continue;
+        size_t j = home_slot(e->hash, mask);
+        while (*(slots+j) != NULL) j = (j + 1) & mask;
+        *(slots+j) = e;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->mask = mask;
+    return 0;
+}
+
+/**
+ * @brief  Set a member name to the interned copy of some text, interning the text if it isn't already.
+ * @details  The first time a name is seen in a document, it is copied into argo_value_arena,
+ * along with its hash and (if all of its characters are written as themselves) the bytes it
+ * is written out as. Every later member with the same name shares that copy. An empty name
+ * keeps NULL content, as the parser has always given it.
+ *
+ * @param name  Name to set.
+ * @param chars  Characters of the name (which can be reused once this returns).
+ * @param length  Number of characters.
+ * @return  Zero if successful, nonzero if space couldn't be allocated.
+ */
+int argo_intern_name(ARGO_STRING *name, const ARGO_CHAR *chars, size_t length){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_intern_name(cx, name, chars, length);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Set a member name to the interned copy of some text in the table of a context, copying the text into its arena (see argo_intern_name)
+int argo_ctx_intern_name(ARGO_CTX *cx, ARGO_STRING *name, const ARGO_CHAR *chars, size_t length){
+    ARGO_INTERN *t = cx->names;
+    name->capacity = 0;
+    name->length = length;
+    name->content = NULL;
+    if (length == 0) return 0;
+    if (intern_check(cx)) return -1;
+    uint64_t hash = argo_hash_chars(chars, length);
+    size_t i = home_slot(hash, t->mask);
+    ARGO_INTERNED_NAME *e;
+    while ((e = *(t->slots+i)) != NULL){
+        if (e->hash == hash && e->length == length && __builtin_memcmp(e->chars, chars, length * sizeof(ARGO_CHAR)) == 0) break;
+        i = (i + 1) & t->mask;
+    }
+    if (e == NULL){
+        size_t plain;
+        for (plain = 0; plain < length && is_plain_char(*(chars+plain)); plain++);
+        e = argo_arena_alloc(cx->arena, sizeof(ARGO_INTERNED_NAME) + length * sizeof(ARGO_CHAR) + (plain == length ? length : 0));
+        if (e == NULL) return -1;
+        e->hash = hash;
+        e->length = length;
+        __builtin_memcpy(e->chars, chars, length * sizeof(ARGO_CHAR));
+        e->plain = NULL;
+        if (plain == length){
+            unsigned char *bytes = (unsigned char *)(e->chars + length);
+            for (plain = 0; plain < length; plain++) *(bytes+plain) = *(chars+plain);
+            e->plain = bytes;
+        }
+        *(t->slots+i) = e;
+        if (++t->count * 2 > t->mask + 1 && intern_grow(t)) return -1;
+    }
+    name->capacity = ARGO_INTERNED;
+    name->content = e->chars;
+    return 0;
+}
+
+/**
+ * @brief  Get the hash of a member name (argo_hash_chars of its characters).
+ * @details  An interned name already knows its hash, so it isn't computed again.
+ *
+ * @param name  Name to hash.
+ * @return  The hash.
+ */
+uint64_t argo_name_hash(ARGO_STRING *name){
+    if (argo_name_interned(name)) return argo_interned(name)->hash;
+    return argo_hash_chars(name->content, name->length);
+}
+
+/**
+ * @brief  Check whether two member names are the same.
+ * @details  Two names interned for the document being read in the default context are
+ * compared by pointer, unless values from another arena have been moved into its arena
+ * (see argo_arena_adopt). Otherwise, their characters are compared.
+ *
+ * @param a  First name.
+ * @param b  Second name.
+ * @return  Nonzero if the names have the same characters.
+ */
+bool argo_name_equal(ARGO_STRING *a, ARGO_STRING *b){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    bool ret = argo_ctx_name_equal(cx, a, b);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Check whether two member names are the same, comparing them by pointer if both were interned for the document being read in a context
+bool argo_ctx_name_equal(ARGO_CTX *cx, ARGO_STRING *a, ARGO_STRING *b){
+    if (a->length != b->length) return false;
+    if (a->content == b->content || a->length == 0) return true;
+    if (argo_name_interned(a) && argo_name_interned(b) && cx->names->generation == cx->arena->generation && !cx->arena->adopted) return false;
+    return __builtin_memcmp(a->content, b->content, a->length * sizeof(ARGO_CHAR)) == 0;
+}
+
+/**
+ * @brief  Give back the space of the table of interned names.
+ * @details  The names themselves are in argo_value_arena, so they go with it.
+ * This must only be done between documents, since a name interned again after
+ * it would no longer be shared with the members that already have it.
+ */
+void argo_intern_free(void){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    argo_ctx_intern_free(cx);
+    argo_default_ctx_leave(cx);
+}
+
+//Give back the space of the table of interned names of a context (see argo_intern_free)
+void argo_ctx_intern_free(ARGO_CTX *cx){
+    free(cx->names->slots);
+    cx->names->slots = NULL;
+    cx->names->mask = 0;
+    cx->names->count = 0;
+}
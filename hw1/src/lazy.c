@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "number.h"
+#include "structural.h"
+#include "lazy.h"
+
+//Byte at an offset of a document, or EOF past its end
+#define lazy_byte(d, p) ((p) < (d)->len ? *((d)->buf + (p)) : EOF)
+
+//Report that a document isn't valid JSON where a cursor has been moved to, and return ARGO_LAZY_NONE
+static size_t lazy_error(const char *what, size_t p){
+    fprintf(stderr, "Error: %s at byte %lu\n", what, p);
+    return ARGO_LAZY_NONE;
+}
+
+//Offset of the first byte at or after p that isn't whitespace
+static inline size_t skip_ws(ARGO_LAZY *d, size_t p){
+    while (p < d->len && argo_is_whitespace(*(d->buf + p))) p++;
+    return p;
+}
+
+//Offset just past the string starting at p, found by looking for a quote that isn't escaped
+static size_t skip_string(ARGO_LAZY *d, size_t p){
+    size_t q = p + 1;
+    while (q < d->len){
+        const unsigned char *quote = __builtin_memchr(d->buf + q, ARGO_QUOTE, d->len - q);
+        if (quote == NULL) break;
+        size_t end = quote - d->buf, run = 0;
+        //The quote is escaped if it follows an odd number of backslashes
+        while (end - run > p + 1 && *(d->buf + end - run - 1) == ARGO_BSLASH) run++;
+        if (run % 2 == 0) return end + 1;
+        q = end + 1;
+    }
+    return lazy_error("Unterminated string", p);
+}
+
+//Offset just past the number or basic value starting at p
+static size_t skip_scalar(ARGO_LAZY *d, size_t p){
+    size_t q = p;
+    while (q < d->len && !is_value_end(*(d->buf + q)) && *(d->buf + q) != ARGO_COLON) q++;
+    return q > p ? q : lazy_error("Expected a value", p);
+}
+
+//Offset just past the object or array starting at p. The document is classified 64 bytes at a time,
+//as the structural index does it, and only the brackets outside of strings are looked at to keep the depth
+static size_t skip_container(ARGO_LAZY *d, size_t p){
+    unsigned char padded[ARGO_BLOCK_SIZE];
+    uint64_t prev_escaped = 0, prev_in_string = 0;
+    size_t pos = p, depth = 0;
+    while (pos < d->len){
+        const unsigned char *b = d->buf + pos;
+        size_t avail = d->len - pos, i;
+        //The last block is padded with NUL bytes, which are neither quotes nor brackets
+        if (avail < ARGO_BLOCK_SIZE){
+            for (i = 0; i < ARGO_BLOCK_SIZE; i++) *(padded+i) = i < avail ? *(b+i) : 0;
+            b = padded;
+        }
+        ARGO_BLOCK_MASKS m;
+        argo_classify_block(b, &m);
+        uint64_t escaped = argo_find_escaped(m.bslash, &prev_escaped);
+        uint64_t in_string = argo_prefix_xor(m.quote & ~escaped) ^ prev_in_string;
+        prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+        uint64_t ops = m.op & ~in_string;
+        while (ops != 0){
+            int bit = __builtin_ctzll(ops);
+            int c = *(b + bit);
+            if (c == ARGO_LBRACE || c == ARGO_LBRACK) depth++;
+            else if ((c == ARGO_RBRACE || c == ARGO_RBRACK) && --depth == 0) return pos + bit + 1;
+            ops &= ops - 1;
+        }
+        pos += ARGO_BLOCK_SIZE;
+    }
+    return lazy_error("Premature EOF in a container that starts", p);
+}
+
+/**
+ * @brief  Open a document in a buffer for on-demand reading.
+ * @details  Nothing is read until a value is asked for. The buffer is not copied.
+ *
+ * @param d  Document to set up.
+ * @param buf  Bytes of the document.
+ * @param len  Number of bytes in buf.
+ */
+void argo_lazy_open(ARGO_LAZY *d, const char *buf, size_t len){
+    d->buf = (const unsigned char *)buf;
+    d->len = len;
+    d->name.capacity = 0;
+    d->name.length = 0;
+    d->name.content = NULL;
+}
+
+/**
+ * @brief  Give back the space used by a document opened with argo_lazy_open.
+ * @details  The buffer itself belongs to the caller.
+ *
+ * @param d  Document to close.
+ */
+void argo_lazy_close(ARGO_LAZY *d){
+    if (d->name.capacity != 0) free(d->name.content);
+    d->name.capacity = 0;
+    d->name.content = NULL;
+}
+
+/**
+ * @brief  Find the value of a whole document.
+ *
+ * @param d  Document to look in.
+ * @return  Offset of the value, or ARGO_LAZY_NONE if the document is empty.
+ */
+size_t argo_lazy_root(ARGO_LAZY *d){
+    size_t p = skip_ws(d, 0);
+    return p < d->len ? p : lazy_error("Premature EOF", p);
+}
+
+/**
+ * @brief  Get the type of a value of a lazy document, from its first byte.
+ *
+ * @param d  Document the value is in.
+ * @param v  Offset of the value.
+ * @return  The type, or ARGO_NO_TYPE if no value starts at v.
+ */
+ARGO_VALUE_TYPE argo_lazy_type(ARGO_LAZY *d, size_t v){
+    int c = lazy_byte(d, v);
+    if (c == ARGO_LBRACE) return ARGO_OBJECT_TYPE;
+    if (c == ARGO_LBRACK) return ARGO_ARRAY_TYPE;
+    if (c == ARGO_QUOTE) return ARGO_STRING_TYPE;
+    if (argo_is_digit(c) || c == ARGO_MINUS) return ARGO_NUMBER_TYPE;
+    if (c == 'n' || c == 't' || c == 'f') return ARGO_BASIC_TYPE;
+    return ARGO_NO_TYPE;
+}
+
+/**
+ * @brief  Step over a value of a lazy document without parsing it.
+ * @details  An object or array is stepped over by matching its brackets (see skip_container),
+ * so the time taken grows with its size in bytes rather than with the number of values in it.
+ * Nothing in it is checked apart from its brackets and the ends of its strings.
+ *
+ * @param d  Document the value is in.
+ * @param v  Offset of the value.
+ * @return  Offset just past the value, or ARGO_LAZY_NONE if it doesn't end.
+ */
+size_t argo_lazy_skip(ARGO_LAZY *d, size_t v){
+    switch (argo_lazy_type(d, v)){
+        case ARGO_OBJECT_TYPE:
+        case ARGO_ARRAY_TYPE: return skip_container(d, v);
+        case ARGO_STRING_TYPE: return skip_string(d, v);
+        case ARGO_NUMBER_TYPE:
+        case ARGO_BASIC_TYPE: return skip_scalar(d, v);
+        default: return lazy_error("Expected a value", v);
+    }
+}
+
+//Move on from the element or member ending just before p to the next one, returning its offset
+//(or ARGO_LAZY_NONE, with *end set, once the closing bracket is reached)
+static size_t next_element(ARGO_LAZY *d, size_t p, int close, bool *end){
+    p = skip_ws(d, p);
+    *end = lazy_byte(d, p) == close;
+    if (*end) return ARGO_LAZY_NONE;
+    if (lazy_byte(d, p) != ARGO_COMMA) return lazy_error(close == ARGO_RBRACE ? "Expected ',' or '}'" : "Expected ',' or ']'", p);
+    return skip_ws(d, p + 1);
+}
+
+//Check whether the member name starting at p (and ending just before "end") is exactly the given bytes.
+//Names without escapes or non-ASCII bytes are compared where they lie; others are unescaped first, and compared
+//a character per byte of the key, as argo_object_get compares them (unescaping them with the state of context cx)
+static bool lazy_name_equal(ARGO_CTX *cx, ARGO_LAZY *d, size_t p, size_t end, const unsigned char *key, size_t length){
+    const unsigned char *text = d->buf + p + 1;
+    size_t n = end - p - 2, i;
+    for (i = 0; i < n && *(text+i) != ARGO_BSLASH && *(text+i) < 0x80; i++);
+    if (i == n) return n == length && __builtin_memcmp(text, key, length) == 0;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, (const char *)d->buf + p, end - p);
+    d->name.length = 0;
+    int ret = argo_read_string_append(cx, &d->name, &in);
+    argo_input_close(&in);
+    if (ret || d->name.length != length) return false;
+    for (i = 0; i < length; i++){
+        if (*(d->name.content+i) != *(key+i)) return false;
+    }
+    return true;
+}
+
+//Read the name of a member starting at p, returning the offset of its value (with *end set just past the name)
+static size_t member_value(ARGO_LAZY *d, size_t p, size_t *end){
+    if (lazy_byte(d, p) != ARGO_QUOTE) return lazy_error("Expected a member name", p);
+    if ((*end = skip_string(d, p)) == ARGO_LAZY_NONE) return ARGO_LAZY_NONE;
+    size_t q = skip_ws(d, *end);
+    if (lazy_byte(d, q) != ARGO_COLON) return lazy_error("Expected ':'", q);
+    return skip_ws(d, q + 1);
+}
+
+/**
+ * @brief  Find the member of an object of a lazy document with a given name.
+ * @details  The members are searched in order, and the first with the name is found,
+ * as argo_object_get finds it. The value of each member before it is stepped over
+ * without being parsed, and nothing after it is looked at.
+ *
+ * @param d  Document the object is in.
+ * @param v  Offset of the object.
+ * @param key  Bytes of the name.
+ * @param length  Number of bytes in the name.
+ * @return  Offset of the member's value, or ARGO_LAZY_NONE if there is no member with the name.
+ */
+size_t argo_lazy_object_get_bytes(ARGO_LAZY *d, size_t v, const unsigned char *key, size_t length){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    size_t value = argo_ctx_lazy_object_get_bytes(cx, d, v, key, length);
+    argo_default_ctx_leave(cx);
+    return value;
+}
+
+//Find the member of an object of a lazy document with a given name, unescaping names in a context (see argo_lazy_object_get_bytes)
+size_t argo_ctx_lazy_object_get_bytes(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, const unsigned char *key, size_t length){
+    if (argo_lazy_type(d, v) != ARGO_OBJECT_TYPE) return ARGO_LAZY_NONE;
+    size_t p = skip_ws(d, v + 1), name_end, value;
+    bool end = lazy_byte(d, p) == ARGO_RBRACE;
+    while (!end && p != ARGO_LAZY_NONE){
+        if ((value = member_value(d, p, &name_end)) == ARGO_LAZY_NONE) return ARGO_LAZY_NONE;
+        if (lazy_name_equal(cx, d, p, name_end, key, length)) return value;
+        if ((p = argo_lazy_skip(d, value)) == ARGO_LAZY_NONE) return ARGO_LAZY_NONE;
+        p = next_element(d, p, ARGO_RBRACE, &end);
+    }
+    return ARGO_LAZY_NONE;
+}
+
+/**
+ * @brief  Find the member of an object of a lazy document with a given name.
+ * @details  See argo_lazy_object_get_bytes.
+ *
+ * @param d  Document the object is in.
+ * @param v  Offset of the object.
+ * @param key  Name of the member (null terminated).
+ * @return  Offset of the member's value, or ARGO_LAZY_NONE if there is no member with the name.
+ */
+size_t argo_lazy_object_get(ARGO_LAZY *d, size_t v, const char *key){
+    size_t length = 0;
+    while (*(key+length) != '\0') length++;
+    return argo_lazy_object_get_bytes(d, v, (const unsigned char *)key, length);
+}
+
+//Find the member of an object of a lazy document with a given name, in a context (see argo_lazy_object_get)
+size_t argo_ctx_lazy_object_get(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, const char *key){
+    size_t length = 0;
+    while (*(key+length) != '\0') length++;
+    return argo_ctx_lazy_object_get_bytes(cx, d, v, (const unsigned char *)key, length);
+}
+
+/**
+ * @brief  Get an element of an array of a lazy document by its position.
+ * @details  The elements before it are stepped over without being parsed.
+ *
+ * @param d  Document the array is in.
+ * @param v  Offset of the array.
+ * @param i  Position of the element (from zero).
+ * @return  Offset of the element, or ARGO_LAZY_NONE if there is no such element.
+ */
+size_t argo_lazy_array_at(ARGO_LAZY *d, size_t v, size_t i){
+    if (argo_lazy_type(d, v) != ARGO_ARRAY_TYPE) return ARGO_LAZY_NONE;
+    size_t p = skip_ws(d, v + 1);
+    bool end = lazy_byte(d, p) == ARGO_RBRACK;
+    for (; !end && p != ARGO_LAZY_NONE; i--){
+        if (i == 0) return p;
+        if ((p = argo_lazy_skip(d, p)) == ARGO_LAZY_NONE) return ARGO_LAZY_NONE;
+        p = next_element(d, p, ARGO_RBRACK, &end);
+    }
+    return ARGO_LAZY_NONE;
+}
+
+/**
+ * @brief  Start iterating over the elements of an array, or the members of an object, of a lazy document.
+ *
+ * @param it  Iterator to set up.
+ * @param d  Document the container is in.
+ * @param v  Offset of the container.
+ * @return  Zero if successful, nonzero if v isn't an array or object.
+ */
+int argo_lazy_iter_open(ARGO_LAZY_ITER *it, ARGO_LAZY *d, size_t v){
+    ARGO_VALUE_TYPE type = argo_lazy_type(d, v);
+    if (type != ARGO_OBJECT_TYPE && type != ARGO_ARRAY_TYPE) return -1;
+    it->doc = d;
+    it->pos = v;
+    it->value = ARGO_LAZY_NONE;
+    it->object = type == ARGO_OBJECT_TYPE;
+    return 0;
+}
+
+/**
+ * @brief  Get the next element of an array, or the value of the next member of an object, of a lazy document.
+ * @details  The value returned last is stepped over (if it wasn't looked inside, without being parsed) to find it.
+ *
+ * @param it  Iterator to advance.
+ * @param name  If not NULL, set to the offset of the member's name (for an object).
+ * @return  Offset of the element or value, or ARGO_LAZY_NONE once there are no more
+ * (or the document turns out not to be valid).
+ */
+size_t argo_lazy_iter_next(ARGO_LAZY_ITER *it, size_t *name){
+    ARGO_LAZY *d = it->doc;
+    int close = it->object ? ARGO_RBRACE : ARGO_RBRACK;
+    size_t p, name_end;
+    bool end = false;
+    if (it->pos == ARGO_LAZY_NONE) return ARGO_LAZY_NONE;
+    if (it->value == ARGO_LAZY_NONE){
+        p = skip_ws(d, it->pos + 1);
+        end = lazy_byte(d, p) == close;
+    }
+    else if ((p = argo_lazy_skip(d, it->value)) != ARGO_LAZY_NONE) p = next_element(d, p, close, &end);
+    if (p == ARGO_LAZY_NONE || end){
+        it->pos = ARGO_LAZY_NONE;
+        return ARGO_LAZY_NONE;
+    }
+    it->pos = p;
+    it->value = it->object ? member_value(d, p, &name_end) : p;
+    if (it->value == ARGO_LAZY_NONE) it->pos = ARGO_LAZY_NONE;
+    if (name != NULL) *name = it->object ? p : ARGO_LAZY_NONE;
+    return it->value;
+}
+
+/**
+ * @brief  Read a basic value (true, false, or null) of a lazy document.
+ *
+ * @param d  Document the value is in.
+ * @param v  Offset of the value.
+ * @param b  Set to the value.
+ * @return  Zero if successful, nonzero if v isn't a basic value.
+ */
+int argo_lazy_basic(ARGO_LAZY *d, size_t v, ARGO_BASIC *b){
+    size_t end = argo_lazy_type(d, v) == ARGO_BASIC_TYPE ? skip_scalar(d, v) : ARGO_LAZY_NONE;
+    if (end == ARGO_LAZY_NONE) return -1;
+    if (end - v == 4 && __builtin_memcmp(d->buf + v, "null", 4) == 0) *b = ARGO_NULL;
+    else if (end - v == 4 && __builtin_memcmp(d->buf + v, "true", 4) == 0) *b = ARGO_TRUE;
+    else if (end - v == 5 && __builtin_memcmp(d->buf + v, "false", 5) == 0) *b = ARGO_FALSE;
+    else {
+        lazy_error("Invalid basic value", v);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Read a number of a lazy document.
+ *
+ * @param d  Document the value is in.
+ * @param v  Offset of the value.
+ * @param n  Set to the number, as argo_read_number sets it.
+ * @return  Zero if successful, nonzero if v isn't a valid number.
+ */
+int argo_lazy_number(ARGO_LAZY *d, size_t v, ARGO_NUMBER *n){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_lazy_number(cx, d, v, n);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Read a number of a lazy document, in a context (see argo_lazy_number)
+int argo_ctx_lazy_number(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, ARGO_NUMBER *n){
+    size_t end = argo_lazy_type(d, v) == ARGO_NUMBER_TYPE ? skip_scalar(d, v) : ARGO_LAZY_NONE;
+    if (end == ARGO_LAZY_NONE) return -1;
+    return argo_ctx_parse_number(cx, d->buf + v, end - v, n);
+}
+
+/**
+ * @brief  Read a string of a lazy document, appending its characters to a string.
+ * @details  The string is unescaped as argo_read_string does it. As with
+ * argo_read_string_append, "s" must already be initialized (it may be empty).
+ *
+ * @param d  Document the value is in.
+ * @param v  Offset of the value.
+ * @param s  String to append to.
+ * @return  Zero if successful, nonzero if v isn't a valid string.
+ */
+int argo_lazy_string(ARGO_LAZY *d, size_t v, ARGO_STRING *s){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_lazy_string(cx, d, v, s);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Read a string of a lazy document, appending its characters to a string, in a context (see argo_lazy_string)
+int argo_ctx_lazy_string(ARGO_CTX *cx, ARGO_LAZY *d, size_t v, ARGO_STRING *s){
+    size_t end = argo_lazy_type(d, v) == ARGO_STRING_TYPE ? skip_string(d, v) : ARGO_LAZY_NONE;
+    if (end == ARGO_LAZY_NONE) return -1;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, (const char *)d->buf + v, end - v);
+    int ret = argo_read_string_append(cx, s, &in);
+    argo_input_close(&in);
+    return ret;
+}
+
+/**
+ * @brief  Parse a value of a lazy document (and everything in it) into argo values.
+ * @details  This is how a part of a document is turned into a tree that the rest of
+ * argo can work with. The value is fully checked, as argo_read_value would check it,
+ * and its argo values are allocated from argo_value_arena (argo_ctx_lazy_value allocates
+ * them from the arena of another context).
+ *
+ * @param d  Document the value is in.
+ * @param v  Offset of the value.
+ * @return  The value, or NULL if it isn't valid.
+ */
+ARGO_VALUE *argo_lazy_value(ARGO_LAZY *d, size_t v){
+    size_t end = argo_lazy_skip(d, v);
+    if (end == ARGO_LAZY_NONE) return NULL;
+    return argo_read_value_mem((const char *)d->buf + v, end - v);
+}
+
+//Parse a value of a lazy document into argo values allocated from the arena of a context (see argo_lazy_value)
+ARGO_VALUE *argo_ctx_lazy_value(ARGO_CTX *cx, ARGO_LAZY *d, size_t v){
+    size_t end = argo_lazy_skip(d, v);
+    if (end == ARGO_LAZY_NONE) return NULL;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, (const char *)d->buf + v, end - v);
+    ARGO_VALUE *value = argo_ctx_read_value(cx, &in);
+    argo_input_close(&in);
+    return value;
+}
@@ -0,0 +1,419 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "arena.h"
+#include "structural.h"
+#include "events.h"
+#include "query.h"
+#include "hash.h"
+#include "sort.h"
+#include "lines.h"
+
+//Find the next line of input (without its newline) and consume it. Returns zero once the input has ended
+static int next_line(ARGO_INPUT *in, const unsigned char **line, size_t *length){
+    //Bytes already searched for a newline, counting from in->pos (which a refill can move)
+    size_t scanned = 0;
+    while (true){
+        const unsigned char *start = in->buf + in->pos;
+        size_t avail = in->len - in->pos;
+        const unsigned char *nl = scanned < avail ? __builtin_memchr(start + scanned, ARGO_LF, avail - scanned) : NULL;
+        if (nl != NULL){
+            *line = start;
+            *length = nl - start;
+            in->pos += *length + 1;
+            return 1;
+        }
+        scanned = avail;
+        //The block buffer is grown if the line doesn't fit in it, so the line is never copied
+        if (in->src == NULL || argo_input_refill(in, avail + 1) <= (long)avail){
+            if (avail == 0) return 0;
+            //The last line doesn't have to end with a newline
+            *line = in->buf + in->pos;
+            *length = avail;
+            in->pos += avail;
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief  Start reading the records of newline-delimited JSON from an input.
+ *
+ * @param r  Reader to initialize.
+ * @param in  Input from which the lines are to be read.
+ */
+void argo_lines_open(ARGO_LINES *r, ARGO_INPUT *in){
+    r->in = in;
+    argo_input_open_mem(&r->record, NULL, 0);
+    r->index = NULL;
+    r->line = 0;
+    r->records = 0;
+    r->failed = 0;
+}
+
+/**
+ * @brief  Move on to the next record.
+ * @details  Lines that hold nothing but whitespace are skipped (but still counted
+ * as lines). argo_lines_read is set so that errors in the record are reported with
+ * its line number. The structural index of the previous record is reused.
+ *
+ * @param r  Reader to read from.
+ * @return  Input over the record, valid until the next call, or NULL once there are no more records.
+ */
+ARGO_INPUT *argo_lines_next(ARGO_LINES *r){
+    const unsigned char *line;
+    size_t length;
+    while (true){
+        //The previous record's input is done with, but its index is kept for this one
+        if (r->record.index != NULL) r->index = argo_index_detach(&r->record);
+        argo_input_close(&r->record);
+        if (!next_line(r->in, &line, &length)) return NULL;
+        r->line++;
+        argo_input_open_mem(&r->record, (const char *)line, length);
+        argo_index_attach(&r->record, r->index);
+        r->index = NULL;
+        //Parsers count the line they start on, so the count is left at the line before the record
+        ARGO_CTX *cx = argo_default_ctx_enter();
+        cx->lines_read = r->line - 1;
+        cx->chars_read = 0;
+        int c = argo_next_token(cx, &r->record);
+        argo_default_ctx_leave(cx);
+        if (c != EOF){
+            argo_ungetc(c, &r->record);
+            r->records++;
+            return &r->record;
+        }
+    }
+}
+
+/**
+ * @brief  Finish a record, checking that nothing but whitespace follows its value.
+ * @details  If the record is invalid, then this is reported on standard error
+ * (after whatever the parser reported), along with the number of the record.
+ *
+ * @param r  Reader that returned the record.
+ * @param ret  Result of parsing the record: zero if its value was valid, nonzero otherwise.
+ * @return  Zero if the record is valid, nonzero otherwise.
+ */
+int argo_lines_check(ARGO_LINES *r, int ret){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    if (ret == 0 && argo_next_token(cx, &r->record) != EOF){
+        fprintf(stderr, "Error: Unexpected text after the value at line %d\n", cx->lines_read);
+        ret = -1;
+    }
+    argo_default_ctx_leave(cx);
+    if (ret != 0){
+        fprintf(stderr, "Error: Record %lu (line %lu) is invalid\n", r->records, r->line);
+        r->failed++;
+    }
+    return ret;
+}
+
+/**
+ * @brief  Stop reading records, releasing the space held by the reader.
+ *
+ * @param r  Reader to close. The input it read from is left open.
+ * @return  Zero if every record was valid, nonzero otherwise.
+ */
+int argo_lines_close(ARGO_LINES *r){
+    argo_input_close(&r->record);
+    free(r->index);
+    r->index = NULL;
+    debug("Read %lu records from %lu lines, %lu of them invalid\n", r->records, r->line, r->failed);
+    return r->failed != 0 ? -1 : 0;
+}
+
+//Validate, canonicalize (if there is a writer), or query (if there is also a query) each record that a reader returns.
+//With HASH_OPTION, the hashes of the records (or of the values selected from them) are written instead, and with
+//SORT_OPTION, the values of the records are built so that the members of their objects can be sorted
+static int run_records(ARGO_LINES *r, ARGO_EVENT_WRITER *w, ARGO_QUERY *q){
+    ARGO_INPUT *rec;
+    ARGO_HASHER hasher, *h = NULL;
+    if (w != NULL && (argo_extra_options & HASH_OPTION)){
+        if (argo_hasher_open(&hasher, argo_hash_bits)) return -1;
+        h = &hasher;
+    }
+    while ((rec = argo_lines_next(r)) != NULL){
+        if (w == NULL) argo_lines_check(r, argo_validate(rec));
+        else if (q != NULL){
+            ARGO_VALUE *root = argo_read_value_canonical(rec);
+            if (argo_lines_check(r, root == NULL ? -1 : 0) == 0){
+                if (h != NULL) argo_hash_query_to(h, q, root, &w->out);
+                else argo_query_write_to(q, root, &w->out);
+            }
+            argo_arena_reset(&argo_value_arena);
+        }
+        else if (argo_extra_options & SORT_OPTION){
+            //Members can only be sorted once the whole record has been read
+            ARGO_VALUE *root = argo_read_value_canonical(rec);
+            ARGO_DIGEST d;
+            if (argo_lines_check(r, root == NULL ? -1 : 0) == 0){
+                level = 0;
+                if (h != NULL){
+                    if (argo_hash_value(h, root, &d) == 0) argo_writer_digest(&w->out, &d);
+                }
+                else if (argo_writer_value(&w->out, root) == 0 && w->out.indent < 0) argo_writer_put(&w->out, ARGO_LF);
+            }
+            argo_arena_reset(&argo_value_arena);
+        }
+        else if (h != NULL){
+            ARGO_DIGEST d;
+            if (argo_lines_check(r, argo_hash_events(h, rec, &d)) == 0) argo_writer_digest(&w->out, &d);
+        }
+        else{
+            ARGO_CTX *cx = argo_default_ctx_enter();
+            w->cx = cx;
+            w->need_comma = 0;
+            w->after_key = 0;
+            cx->level = 0;
+            argo_writer_mark(&w->out);
+            int ret = argo_ctx_parse_events(cx, rec, &argo_writer_handler, w);
+            argo_default_ctx_leave(cx);
+            if (argo_lines_check(r, ret)){
+                argo_writer_discard(&w->out);
+                continue;
+            }
+            //Pretty printed values already end with a newline
+            if (w->out.indent < 0) argo_writer_put(&w->out, ARGO_LF);
+            argo_writer_commit(&w->out);
+        }
+    }
+    if (h != NULL) argo_hasher_close(h);
+    return argo_lines_close(r);
+}
+
+/**
+ * @brief  Sink for the writer of a worker process (see argo_writer_open_sink), which
+ * writes straight to a file descriptor.
+ *
+ * @param ctx  Pointer to the file descriptor.
+ * @param bytes  Output to write.
+ * @param len  Number of bytes of output.
+ * @return  Zero if all of the output was written, nonzero otherwise.
+ */
+int argo_worker_sink(void *ctx, const unsigned char *bytes, size_t len){
+    int fd = *(int *)ctx;
+    while (len > 0){
+        ssize_t n = write(fd, bytes, len);
+        if (n < 0) return -1;
+        bytes += n;
+        len -= n;
+    }
+    return 0;
+}
+
+//Find the next chunk of whole lines, of about ARGO_LINES_CHUNK bytes, and consume it. Returns zero once the input has ended
+static int next_chunk(ARGO_INPUT *in, const unsigned char **chunk, size_t *length){
+    size_t want = ARGO_LINES_CHUNK;
+    while (true){
+        //One byte more than the chunk is asked for, to tell whether the input ends with the chunk
+        long avail = argo_input_refill(in, want + 1);
+        if (avail <= 0) return 0;
+        const unsigned char *start = in->buf + in->pos;
+        size_t end = (size_t)avail;
+        //Unless the input ends first, the chunk ends just after the last newline in it
+        if (end > want){
+            end = want;
+            while (end > 0 && *(start + end - 1) != ARGO_LF) end--;
+            //A line longer than the chunk makes the chunk bigger
+            if (end == 0){
+                want *= 2;
+                continue;
+            }
+        }
+        *chunk = start;
+        *length = end;
+        in->pos += end;
+        return 1;
+    }
+}
+
+//Count the lines of a chunk, and how many of them are records (ie, not blank), as argo_lines_next would
+static void count_lines(const unsigned char *p, size_t length, unsigned long *lines, unsigned long *records){
+    const unsigned char *end = p + length;
+    while (p < end){
+        const unsigned char *nl = __builtin_memchr(p, ARGO_LF, end - p);
+        if (nl == NULL) nl = end;
+        (*lines)++;
+        while (p < nl && argo_is_whitespace(*p)) p++;
+        if (p < nl) (*records)++;
+        p = nl + 1;
+    }
+}
+
+//Handle one chunk in a worker process, numbering its lines and records from the given ones, and exit
+static void run_chunk(LINES_WORKER *wk, const unsigned char *chunk, size_t length, unsigned long line, unsigned long records, ARGO_QUERY *q, bool validate){
+    ARGO_INPUT in;
+    ARGO_LINES r;
+    ARGO_EVENT_WRITER w;
+    //Error messages are collected along with the output, so that they come out in order too
+    if (dup2(wk->err, STDERR_FILENO) < 0 || (!validate && argo_writer_open_sink(&w.out, argo_worker_sink, &wk->out))) _exit(2);
+    argo_input_open_mem(&in, (const char *)chunk, length);
+    argo_lines_open(&r, &in);
+    r.line = line;
+    r.records = records;
+    int ret = run_records(&r, validate ? NULL : &w, q);
+    if (!validate && argo_writer_close(&w.out)) ret = -1;
+    _exit(ret ? 1 : 0);
+}
+
+/**
+ * @brief  Copy what a worker process wrote to one of its files to a stream, then
+ * empty the file for the worker's next chunk.
+ *
+ * @param fd  File descriptor of the file.
+ * @param to  Stream to copy to.
+ * @return  Zero if successful, nonzero if the file couldn't be read or emptied, or the stream written.
+ */
+int argo_worker_drain(int fd, FILE *to){
+    unsigned char block[ARGO_INPUT_BLOCK];
+    ssize_t got;
+    int ret = 0;
+    if (lseek(fd, 0, SEEK_SET) < 0) return -1;
+    while ((got = read(fd, block, sizeof(block))) > 0){
+        if (fwrite(block, 1, got, to) != (size_t)got) ret = -1;
+    }
+    if (got < 0 || ftruncate(fd, 0) || lseek(fd, 0, SEEK_SET) < 0) ret = -1;
+    return ret;
+}
+
+/*
+ * Split the input into chunks of whole lines and hand them out, in order, to "jobs"
+ * worker processes. Each worker has its own copy of the parser's state (including
+ * argo_value_arena), so the records of different chunks are handled in parallel
+ * without sharing anything. A worker writes its output and error messages to
+ * temporary files, which are copied out in the order of the chunks as the workers
+ * finish, so the output is the same as that of a single process.
+ */
+static int run_parallel(ARGO_INPUT *in, FILE *out, ARGO_QUERY *q, bool validate, int jobs){
+    LINES_WORKER *workers = calloc(jobs, sizeof(LINES_WORKER));
+    FILE **files = calloc(2 * jobs, sizeof(FILE *));
+    unsigned long line = 0, records = 0;
+    size_t started = 0, finished = 0;
+    int i, ret = 0;
+    bool more = true;
+    if (workers == NULL || files == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for %d workers\n", jobs);
+        more = false;
+        ret = -1;
+    }
+    for (i = 0; more && i < jobs; i++){
+        if ((*(files + 2*i) = tmpfile()) == NULL || (*(files + 2*i + 1) = tmpfile()) == NULL){
+            fprintf(stderr, "Error: Failed to create the output files of the workers\n");
+            more = false;
+            ret = -1;
+            break;
+        }
+        (workers + i)->out = fileno(*(files + 2*i));
+        (workers + i)->err = fileno(*(files + 2*i + 1));
+    }
+    //Nothing buffered may be left for the workers to inherit
+    fflush(out);
+    fflush(stderr);
+    while (true){
+        const unsigned char *chunk;
+        size_t length;
+        //Keep every worker busy, handing out the chunks in order. A stream's buffer can be refilled as soon
+        //as a worker has started, since the worker has its own copy of the chunk
+        while (more && started - finished < (size_t)jobs && (more = next_chunk(in, &chunk, &length))){
+            LINES_WORKER *wk = workers + started % jobs;
+            wk->line = line + 1;
+            if ((wk->pid = fork()) == 0) run_chunk(wk, chunk, length, line, records, q, validate);
+            if (wk->pid < 0){
+                fprintf(stderr, "Error: Failed to start a worker process\n");
+                more = false;
+                ret = -1;
+                break;
+            }
+            count_lines(chunk, length, &line, &records);
+            started++;
+        }
+        if (finished == started) break;
+        //The oldest chunk is the next one whose output is due
+        LINES_WORKER *wk = workers + finished++ % jobs;
+        int status;
+        //The status is only there to look at if the worker could be waited for
+        bool waited = waitpid(wk->pid, &status, 0) >= 0;
+        if (!waited || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ret = -1;
+        if (argo_worker_drain(wk->out, out) || argo_worker_drain(wk->err, stderr)) ret = -1;
+        if (waited && WIFEXITED(status) && WEXITSTATUS(status) > 1) fprintf(stderr, "Error: A worker failed to handle lines %lu and on\n", wk->line);
+    }
+    debug("Handled %lu lines in %lu chunks with %d workers\n", line, started, jobs);
+    for (i = 0; files != NULL && i < 2 * jobs; i++){
+        if (*(files+i) != NULL) fclose(*(files+i));
+    }
+    free(files);
+    free(workers);
+    if (fflush(out)) ret = -1;
+    return ret;
+}
+
+//Read the records of an input and validate, canonicalize, or query each of them, using argo_jobs processes
+static int run_lines(ARGO_INPUT *in, FILE *out, ARGO_QUERY *q, bool validate){
+    if (argo_jobs > 1) return run_parallel(in, out, q, validate, argo_jobs);
+    ARGO_LINES r;
+    ARGO_EVENT_WRITER w;
+    if (!validate && argo_writer_open(&w.out, out)) return -1;
+    argo_lines_open(&r, in);
+    int ret = run_records(&r, validate ? NULL : &w, q);
+    if (!validate && argo_writer_close(&w.out)) ret = -1;
+    return ret;
+}
+
+/**
+ * @brief  Validate each record of newline-delimited JSON.
+ * @details  Every record is checked, and each invalid one is reported on standard error.
+ * If argo_jobs is more than one, then the records are checked by that many processes
+ * in parallel, and the errors are reported in the same order as they would be otherwise.
+ *
+ * @param in  Input from which the records are to be read.
+ * @return  Zero if every record is valid, nonzero otherwise.
+ */
+int argo_validate_lines(ARGO_INPUT *in){
+    return run_lines(in, stdout, NULL, true);
+}
+
+/**
+ * @brief  Canonicalize each record of newline-delimited JSON.
+ * @details  Each valid record is written in canonical form (pretty printed if
+ * global_options says so), followed by a newline. Nothing is written for an invalid
+ * record: its output is held back by a mark on the writer until the record has been
+ * checked, and then discarded. No argo values are built, so the memory used doesn't
+ * grow with the number of records. If argo_jobs is more than one, then chunks of
+ * the input are canonicalized by that many processes in parallel, and their output
+ * is put back together in the order of the input.
+ *
+ * @param in  Input from which the records are to be read.
+ * @param out  Output stream to which JSON is to be written.
+ * @return  Zero if every record is valid and all of the output is written, nonzero otherwise.
+ */
+int argo_write_lines(ARGO_INPUT *in, FILE *out){
+    return run_lines(in, out, NULL, false);
+}
+
+/**
+ * @brief  Run a query against each record of newline-delimited JSON.
+ * @details  The values selected from each valid record are written as with
+ * argo_query_write. The argo values of a record are built in argo_value_arena,
+ * which is reset after every record, so the same space is used for all of them.
+ * argo_jobs is used as for argo_write_lines.
+ *
+ * @param q  Compiled query.
+ * @param in  Input from which the records are to be read.
+ * @param out  Output stream to which JSON is to be written.
+ * @return  Zero if every record is valid and all of the output is written, nonzero otherwise.
+ */
+int argo_query_lines(ARGO_QUERY *q, ARGO_INPUT *in, FILE *out){
+    return run_lines(in, out, q, false);
+}
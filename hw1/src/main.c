@@ -3,8 +3,16 @@
 
 #include "argo.h"
 #include "global.h"
+#include "options.h"
 #include "debug.h"
 #include "validity.h"
+#include "input.h"
+#include "events.h"
+#include "query.h"
+#include "lines.h"
+#include "split.h"
+#include "hash.h"
+#include "sort.h"
 
 #ifdef _STRING_H
 #error "Do not #include <string.h>. You will get a ZERO."
@@ -44,8 +52,11 @@ int main(int argc, char **argv)
         //(stdin) and validate that it is syntactically correct JSON. 
         case VALIDATE_OPTION:{
             debug("Reached -v case in main\n");
-            ARGO_VALUE* new_json = argo_read_value(stdin);
-            if (new_json == NULL) returnCode = -1;
+            //Validation doesn't need the values, so the input is only parsed into events
+            ARGO_INPUT in;
+            if (argo_input_open_file(&in, stdin, false)) returnCode = -1;
+            else if (argo_extra_options & LINES_OPTION ? argo_validate_lines(&in) : argo_validate_split(&in)) returnCode = -1;
+            argo_input_close(&in);
             break;
         }
         //default will handle the case of pretty print
@@ -53,13 +64,36 @@ int main(int argc, char **argv)
         default: {
             debug("reached -c case in main\n");
             level = 0; //Reset level before proceeding
-            ARGO_VALUE* new_json = argo_read_value(stdin);
-            if (new_json == NULL) return -1;
-            argo_write_value(new_json, stdout);
+            //The output is written while the input is being parsed, so no argo values are built
+            ARGO_INPUT in;
+            if (argo_extra_options & QUERY_OPTION){
+                //Queries select from the values of the whole document, so those are built (with compact strings)
+                ARGO_QUERY *q = argo_query_compile(argo_query_text);
+                if (q == NULL) return EXIT_FAILURE;
+                argo_utf8_strings = 1;
+                int ret = argo_input_open_file(&in, stdin, false)
+                          || (argo_extra_options & LINES_OPTION ? argo_query_lines(q, &in, stdout)
+                              : argo_extra_options & HASH_OPTION ? argo_hash_query(q, &in, stdout) : argo_query_write(q, &in, stdout));
+                argo_input_close(&in);
+                argo_query_free(q);
+                if (ret != 0) return EXIT_FAILURE;
+                break;
+            }
+            if (argo_input_open_file(&in, stdin, false)) return -1;
+            //Members can only be sorted once the whole value has been read, so values are built for it (with compact strings)
+            if (argo_extra_options & SORT_OPTION) argo_utf8_strings = 1;
+            //A hash is of the whole output, so the elements of an array aren't divided among workers for it
+            int ret = argo_extra_options & LINES_OPTION ? argo_write_lines(&in, stdout)
+                      : argo_extra_options & HASH_OPTION ? argo_hash_write(&in, stdout)
+                      : argo_extra_options & SORT_OPTION ? argo_write_sorted(&in, stdout) : argo_write_split(&in, stdout);
+            argo_input_close(&in);
+            if (ret != 0) return -1;
             break;
         }
     }
 
+    info("Peak arena usage: %lu values, %lu bytes (%lu bytes reserved)", argo_value_arena.peak_values,
+         argo_value_arena.peak, argo_value_arena.reserved);
     //if valid_args returns -1, then main() should return EXIT_FAILURE
     if (returnCode == -1) return EXIT_FAILURE;
     return returnCode;
@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "number.h"
+#include "dtoa.h"
+
+//Doubles represent every integer up to 2^53, and every power of ten up to 10^22, exactly
+#define EXACT_INT_LIMIT ((uint64_t)1 << 53)
+#define EXACT_POW10_MAX 22
+
+static const double exact_pow10[EXACT_POW10_MAX + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//Load eight bytes (in memory order) as a little-endian word
+static inline uint64_t read_eight(const unsigned char *p){
+    uint64_t word;
+    __builtin_memcpy(&word, p, 8);
+    return word;
+}
+
+//Check whether all eight bytes of a word are ASCII digits
+static inline bool is_eight_digits(uint64_t word){
+    return (((word & 0xF0F0F0F0F0F0F0F0ULL) | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+            == 0x3333333333333333ULL);
+}
+
+//Convert eight ASCII digits (the first one most significant) to their value, combining them pairwise in a word
+static inline uint64_t parse_eight_digits(uint64_t word){
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    return (((word & mask) * mul1) + (((word >> 16) & mask) * mul2)) >> 32;
+}
+
+//Consume a run of digits, accumulating them into *sig (which may wrap around if there are too many)
+static const unsigned char *parse_digits(const unsigned char *p, const unsigned char *end, uint64_t *sig){
+    uint64_t i = *sig;
+    while (end - p >= 8 && is_eight_digits(read_eight(p))){
+        i = i * 100000000 + parse_eight_digits(read_eight(p));
+        p += 8;
+    }
+    while (p < end && argo_is_digit(*p)){
+        i = i * 10 + (*p - ARGO_DIGIT0);
+        p++;
+    }
+    *sig = i;
+    return p;
+}
+
+//Full 64x64 -> 128 bit product, returned as its high word with the low word in *low
+static inline uint64_t multiply_128(uint64_t a, uint64_t b, uint64_t *low){
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *low = (uint64_t)product;
+    return (uint64_t)(product >> 64);
+}
+
+/*
+ * Eisel-Lemire: find the double nearest to sig * 10^q, where sig is nonzero. The significand is
+ * multiplied by a 128-bit approximation of 5^q, and the top 54 bits of the product (after
+ * normalization) give the rounded result, unless the product is too close to a halfway point
+ * for the truncated table entry to decide it. That happens very rarely, and is reported by
+ * returning false, in which case the caller has to use a slower exact method.
+ */
+static bool eisel_lemire(uint64_t sig, int64_t q, double *result){
+    uint64_t bits;
+    if (q < ARGO_POW5_MIN){
+        *result = 0.0;
+        return true;
+    }
+    if (q > ARGO_POW5_MAX){
+        *result = __builtin_inf();
+        return true;
+    }
+    int lz = __builtin_clzll(sig);
+    sig <<= lz;
+    const uint64_t *entry = argo_pow5_table + 2 * (q - ARGO_POW5_MIN);
+    uint64_t low, high = multiply_128(sig, *entry, &low);
+    //Only if the bits below the 55 that are kept are all ones could the low word of the table entry change them
+    if ((high & 0x1FF) == 0x1FF){
+        uint64_t low2, high2 = multiply_128(sig, *(entry+1), &low2);
+        low += high2;
+        if (high2 > low) high++;
+    }
+    //If the product is still ambiguous, then only exact arithmetic can round it
+    if (low == UINT64_MAX && (q < -27 || q > 55)) return false;
+    int upperbit = high >> 63;
+    uint64_t mantissa = high >> (upperbit + 9);
+    //Binary exponent of the result, biased as in an IEEE double: floor(q * log2(10)) + 63, less the normalization shift
+    int64_t power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+    if (power2 <= 0){
+        //The result is subnormal (or rounds to zero)
+        if (-power2 + 1 >= 64){
+            *result = 0.0;
+            return true;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < ((uint64_t)1 << 52) ? 0 : 1;
+        bits = (mantissa & ~((uint64_t)1 << 52)) | ((uint64_t)power2 << 52);
+        __builtin_memcpy(result, &bits, 8);
+        return true;
+    }
+    //A product that is exactly halfway between two doubles has to round to even, rather than up
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1){
+        if ((mantissa << (upperbit + 9)) == high) mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)2 << 52)){
+        mantissa = (uint64_t)1 << 52;
+        power2++;
+    }
+    mantissa &= ~((uint64_t)1 << 52);
+    if (power2 >= 0x7FF){
+        *result = __builtin_inf();
+        return true;
+    }
+    bits = mantissa | ((uint64_t)power2 << 52);
+    __builtin_memcpy(result, &bits, 8);
+    return true;
+}
+
+//Convert number text with strtod, which is always correctly rounded, but much slower
+static double slow_parse(const unsigned char *text, size_t length){
+    char space[64];
+    char *copy = length < sizeof(space) ? space : malloc(length + 1);
+    if (copy == NULL) return __builtin_nan("");
+    __builtin_memcpy(copy, text, length);
+    *(copy + length) = '\0';
+    double d = strtod(copy, NULL);
+    if (copy != space) free(copy);
+    return d;
+}
+
+/**
+ * @brief  Convert the text of a JSON number into an ARGO_NUMBER.
+ * @details  The text must consist of exactly one JSON number. A number without a
+ * fraction or exponent that fits in a long is given a valid integer value, and every
+ * number is given a valid floating point value, which is the double nearest to the
+ * number. The textual form is not filled in (valid_string is left zero); it can
+ * be made on demand with argo_number_string. Numbers too large in magnitude for
+ * a double are rejected. Errors are reported with the line count of the default context.
+ *
+ * @param text  Text of the number.
+ * @param length  Number of bytes of text.
+ * @param n  Number to fill in.
+ * @return  Zero if successful, nonzero if the text is not a valid number.
+ */
+int argo_parse_number(const unsigned char *text, size_t length, ARGO_NUMBER *n){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_parse_number(cx, text, length, n);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Convert the text of a JSON number into an ARGO_NUMBER, reporting errors with the line count of a context (see argo_parse_number)
+int argo_ctx_parse_number(ARGO_CTX *cx, const unsigned char *text, size_t length, ARGO_NUMBER *n){
+    const unsigned char *p = text, *end = text + length;
+    bool isNeg = false, isFloat = false;
+    n->string_value.capacity = 0;
+    n->string_value.length = 0;
+    n->string_value.content = NULL;
+    n->valid_string = 0;
+    if (p < end && *p == ARGO_MINUS) {isNeg = true; p++;}
+    const unsigned char *digits = p;
+    uint64_t sig = 0;
+    p = parse_digits(p, end, &sig);
+    int64_t digitCount = p - digits;
+    if (digitCount == 0){
+        fprintf(stderr, "Error: Number has no digits at line %d\n", cx->lines_read);
+        return -1;
+    }
+    if (*digits == ARGO_DIGIT0 && digitCount > 1){
+        fprintf(stderr, "Error: Numbers with leading zeros are not allowed\n");
+        return -1;
+    }
+    int64_t exp = 0;
+    //A fraction is accumulated into the same significand, with the exponent moved down by its length
+    if (p < end && *p == ARGO_PERIOD){
+        isFloat = true;
+        const unsigned char *fraction = ++p;
+        p = parse_digits(p, end, &sig);
+        exp = fraction - p;
+        if (exp == 0){
+            fprintf(stderr, "Error: Number has no digits after '.' at line %d\n", cx->lines_read);
+            return -1;
+        }
+        digitCount -= exp;
+    }
+    if (p < end && argo_is_exponent(*p)){
+        isFloat = true;
+        bool expNeg = false;
+        p++;
+        if (p < end && (*p == ARGO_MINUS || *p == ARGO_PLUS)) expNeg = *p++ == ARGO_MINUS;
+        if (p == end || !argo_is_digit(*p)){
+            fprintf(stderr, "Error parsing exponent at line %d\n", cx->lines_read);
+            return -1;
+        }
+        int64_t expNumber = 0;
+        while (p < end && argo_is_digit(*p)){
+            //Past this, the result is zero or infinite anyway
+            if (expNumber < 0x10000) expNumber = expNumber * 10 + (*p - ARGO_DIGIT0);
+            p++;
+        }
+        exp += expNeg ? -expNumber : expNumber;
+    }
+    if (p != end){
+        fprintf(stderr, "Error at line %d\n", cx->lines_read);
+        return -1;
+    }
+    //Leading zeros (as in 0.000123) aren't significant, so they don't count towards the limit
+    if (digitCount > ARGO_MAX_SIG_DIGITS){
+        const unsigned char *q = digits;
+        while (q < end && (*q == ARGO_DIGIT0 || *q == ARGO_PERIOD)){
+            if (*q == ARGO_DIGIT0) digitCount--;
+            q++;
+        }
+    }
+    bool tooManyDigits = digitCount > ARGO_MAX_SIG_DIGITS;
+
+    n->valid_int = 0;
+    n->valid_float = 1;
+    if (!isFloat && !tooManyDigits && (sig <= (uint64_t)INT64_MAX || (isNeg && sig == (uint64_t)INT64_MAX + 1))){
+        n->valid_int = 1;
+        n->int_value = isNeg ? (long)(0 - sig) : (long)sig;
+        //The conversion is correctly rounded by the hardware
+        n->float_value = isNeg ? -(double)sig : (double)sig;
+        return 0;
+    }
+    double d;
+    if (tooManyDigits) d = slow_parse(text, length);
+    else{
+        //Clinger's fast path: both operands are exact, so a single operation rounds correctly
+        if (sig <= EXACT_INT_LIMIT && exp >= -EXACT_POW10_MAX && exp <= EXACT_POW10_MAX){
+            d = (double)sig;
+            d = exp < 0 ? d / *(exact_pow10 - exp) : d * *(exact_pow10 + exp);
+        }
+        else if (sig == 0) d = 0.0;
+        else if (!eisel_lemire(sig, exp, &d)) d = slow_parse(text + isNeg, length - isNeg);
+        if (isNeg) d = -d;
+    }
+    if (__builtin_isinf(d) || __builtin_isnan(d)){
+        fprintf(stderr, "Error: Number out of range at line %d\n", cx->lines_read);
+        return -1;
+    }
+    n->float_value = d;
+    return 0;
+}
+
+/**
+ * @brief  Fill in the textual form of a number, if it hasn't been already.
+ * @details  The parser doesn't keep the text of numbers, so this makes the canonical
+ * text (as argo_write_number would write it) from the integer or floating point value.
+ *
+ * @param n  Number whose textual form is needed.
+ * @return  Zero if successful, nonzero if space couldn't be allocated
+ * or the number has no valid representation at all.
+ */
+int argo_number_string(ARGO_NUMBER *n){
+    char text[ARGO_DOUBLE_BUFFER];
+    int length;
+    if (n->valid_string) return 0;
+    if (n->valid_int) length = snprintf(text, sizeof(text), "%ld", n->int_value);
+    else if (n->valid_float) length = argo_format_double(n->float_value, text);
+    else return -1;
+    if (length <= 0) return -1;
+    n->string_value.capacity = 0;
+    n->string_value.length = 0;
+    if (argo_append_bytes(&n->string_value, (unsigned char *)text, length)) return -1;
+    n->valid_string = 1;
+    return 0;
+}
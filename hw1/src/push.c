@@ -0,0 +1,471 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "arena.h"
+#include "structural.h"
+#include "number.h"
+#include "events.h"
+#include "intern.h"
+#include "push.h"
+
+//What the parser expects to read next
+enum push_state {PUSH_VALUE, PUSH_FIRST_VALUE, PUSH_FIRST_KEY, PUSH_KEY, PUSH_COLON, PUSH_AFTER_VALUE};
+
+//Kinds of token that can be cut off by the end of a chunk
+enum push_token {PUSH_NO_TOKEN, PUSH_NAME, PUSH_STRING, PUSH_NUMBER, PUSH_LITERAL};
+
+//Invoke a callback (if the handler has one), evaluating to true if the callback asked to stop
+#define emit(h, cb, ctx, ...) ((h)->cb != NULL && (h)->cb((ctx), ##__VA_ARGS__) != 0)
+
+//Make room for one more entry in a growable array that has "used" of "*size" entries of "width" bytes
+static int grow(ARGO_CTX *cx, void **array, size_t used, size_t *size, size_t width){
+    if (used < *size) return 0;
+    size_t n = *size == 0 ? ARGO_PARSER_STACK : *size * 2;
+    void *grown = realloc(*array, n * width);
+    if (grown == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for the parser at line %d\n", cx->lines_read);
+        return -1;
+    }
+    *array = grown;
+    *size = n;
+    return 0;
+}
+
+//Start building a value, linking it into the container being built (if any), under the name given by the last key
+static ARGO_VALUE *build_new(ARGO_BUILDER *b, ARGO_VALUE_TYPE type){
+    ARGO_VALUE *v = argo_ctx_value_alloc(b->cx);
+    if (v == NULL) return NULL;
+    v->type = type;
+    v->name = b->name;
+    b->name.content = NULL;
+    b->name.length = 0;
+    if (b->depth > 0){
+        ARGO_VALUE *c = *(b->open + b->depth - 1);
+        ARGO_VALUE *sentinel = c->type == ARGO_OBJECT_TYPE ? c->content.object.member_list : c->content.array.element_list;
+        v->prev = sentinel->prev;
+        v->next = sentinel;
+        sentinel->prev->next = v;
+        sentinel->prev = v;
+    }
+    return v;
+}
+
+//Finish building a value: one at the top level joins the values waiting to be taken
+static int build_done(ARGO_BUILDER *b, ARGO_VALUE *v){
+    if (b->depth > 0) return 0;
+    if (grow(b->cx, (void **)&b->values, b->count, &b->capacity, sizeof(ARGO_VALUE *))) return -1;
+    *(b->values + b->count++) = v;
+    return 0;
+}
+
+//Copy the text of a string reported by the parser into the arena of the builder's context (an empty string keeps NULL content, like a name)
+static int build_copy(ARGO_BUILDER *b, ARGO_STRING *to, ARGO_STRING *from){
+    to->capacity = 0;
+    to->length = from->length;
+    to->content = NULL;
+    if (from->length == 0) return 0;
+    to->content = argo_arena_alloc(b->cx->arena, from->length * sizeof(ARGO_CHAR));
+    if (to->content == NULL) return -1;
+    __builtin_memcpy(to->content, from->content, from->length * sizeof(ARGO_CHAR));
+    return 0;
+}
+
+//Start building an object or array, which becomes the container that values are added to
+static int build_open(ARGO_BUILDER *b, ARGO_VALUE_TYPE type){
+    ARGO_VALUE *v = build_new(b, type);
+    ARGO_VALUE *sentinel = argo_ctx_value_alloc(b->cx);
+    if (v == NULL || sentinel == NULL) return -1;
+    sentinel->next = sentinel;
+    sentinel->prev = sentinel;
+    if (type == ARGO_OBJECT_TYPE) v->content.object.member_list = sentinel;
+    else v->content.array.element_list = sentinel;
+    if (grow(b->cx, (void **)&b->open, b->depth, &b->size, sizeof(ARGO_VALUE *))) return -1;
+    *(b->open + b->depth++) = v;
+    return 0;
+}
+
+//Finish the innermost container. The elements of an array are also recorded contiguously (see argo_array_at)
+static int build_close(ARGO_BUILDER *b){
+    ARGO_VALUE *v = *(b->open + --b->depth);
+    if (v->type == ARGO_ARRAY_TYPE){
+        ARGO_ARRAY *a = &v->content.array;
+        ARGO_VALUE *e;
+        size_t i = 0;
+        for (e = a->element_list->next; e != a->element_list; e = e->next) i++;
+        a->length = i;
+        if (i > 0){
+            a->elements = argo_arena_alloc(b->cx->arena, i * sizeof(ARGO_VALUE *));
+            if (a->elements == NULL) return -1;
+            for (i = 0, e = a->element_list->next; e != a->element_list; e = e->next) *(a->elements + i++) = e;
+        }
+    }
+    return build_done(b, v);
+}
+
+static int build_start_object(void *ctx) {return build_open(ctx, ARGO_OBJECT_TYPE);}
+static int build_start_array(void *ctx) {return build_open(ctx, ARGO_ARRAY_TYPE);}
+static int build_end(void *ctx) {return build_close(ctx);}
+
+static int build_key(void *ctx, ARGO_STRING *name){
+    ARGO_BUILDER *b = ctx;
+    return argo_ctx_intern_name(b->cx, &b->name, name->content, name->length);
+}
+
+static int build_string(void *ctx, ARGO_STRING *s){
+    ARGO_VALUE *v = build_new(ctx, ARGO_STRING_TYPE);
+    if (v == NULL || build_copy(ctx, &v->content.string, s)) return -1;
+    return build_done(ctx, v);
+}
+
+static int build_number(void *ctx, ARGO_NUMBER *n){
+    ARGO_VALUE *v = build_new(ctx, ARGO_NUMBER_TYPE);
+    if (v == NULL) return -1;
+    v->content.number = *n;
+    return build_done(ctx, v);
+}
+
+static int build_basic(void *ctx, ARGO_BASIC b){
+    ARGO_VALUE *v = build_new(ctx, ARGO_BASIC_TYPE);
+    if (v == NULL) return -1;
+    v->content.basic = b;
+    return build_done(ctx, v);
+}
+
+const ARGO_HANDLER argo_builder_handler = {
+    build_start_object, build_end, build_start_array, build_end,
+    build_key, build_string, build_number, build_basic
+};
+
+/**
+ * @brief  Start a push parser.
+ * @details  Input is then given to the parser with argo_parser_feed, as it arrives,
+ * and the end of the input is marked with argo_parser_finish. If a handler is given,
+ * then the values that are read are reported to it as events (see events.h). Otherwise,
+ * argo values are built from them (in the arena of the context that the input is fed
+ * in, which is argo_value_arena for argo_parser_feed), and each complete top level
+ * value can be taken with argo_parser_value as soon as its last byte has been fed.
+ *
+ * @param p  Parser to initialize.
+ * @param h  Handler to report events to, or NULL to build argo values.
+ * @param ctx  Passed unchanged as the first argument of each of the handler's callbacks.
+ * @return  Zero (this can't fail, since space is only allocated as it is needed).
+ */
+int argo_parser_open(ARGO_PARSER *p, const ARGO_HANDLER *h, void *ctx){
+    *p = (ARGO_PARSER){0};
+    p->handler = h != NULL ? h : &argo_builder_handler;
+    p->ctx = h != NULL ? ctx : &p->build;
+    p->state = PUSH_VALUE;
+    p->line = 1;
+    return 0;
+}
+
+//Report an error at the current line, after which the parser won't accept any more input
+static int push_error(ARGO_PARSER *p, const char *what){
+    if (what != NULL) fprintf(stderr, "Error: %s at line %d\n", what, p->line);
+    p->error = 1;
+    return -1;
+}
+
+//Keep the part of a token that has been received so far, until the rest of it arrives
+static int keep_text(ARGO_PARSER *p, const unsigned char *bytes, size_t n){
+    if (p->length + n > p->size){
+        size_t size = p->size == 0 ? ARGO_PARSER_STACK : p->size;
+        while (size < p->length + n) size *= 2;
+        unsigned char *grown = realloc(p->text, size);
+        if (grown == NULL) return push_error(p, "Failed to allocate space for a token");
+        p->text = grown;
+        p->size = size;
+    }
+    __builtin_memcpy(p->text + p->length, bytes, n);
+    p->length += n;
+    return 0;
+}
+
+//Move on from a complete value: to the next member or element, or to the next value at the top level
+static void value_done(ARGO_PARSER *p){
+    p->state = p->depth == 0 ? PUSH_VALUE : PUSH_AFTER_VALUE;
+}
+
+//Decode a whole string (with its quotes) and report it as a member name or a string value
+static int push_string(ARGO_CTX *cx, ARGO_PARSER *p, int kind, const unsigned char *text, size_t length){
+    size_t i;
+    int ret;
+    p->scratch.length = 0;
+    cx->lines_read = p->line;
+    //A string without escapes or control characters is its bytes, one character each, so it is just copied
+    for (i = 1; i < length - 1 && *(text+i) != ARGO_BSLASH && *(text+i) >= ARGO_SPACE; i++);
+    if (i == length - 1) ret = argo_append_bytes(&p->scratch, text + 1, length - 2);
+    else{
+        ARGO_INPUT in;
+        argo_input_open_mem(&in, (const char *)text, length);
+        argo_index_attach(&in, p->index);
+        ret = argo_read_string_append(cx, &p->scratch, &in);
+        p->index = argo_index_detach(&in);
+        argo_input_close(&in);
+    }
+    if (ret) return push_error(p, NULL);
+    if (kind == PUSH_NAME){
+        if (emit(p->handler, key, p->ctx, &p->scratch)) return push_error(p, NULL);
+        p->state = PUSH_COLON;
+        return 0;
+    }
+    if (emit(p->handler, string, p->ctx, &p->scratch)) return push_error(p, NULL);
+    value_done(p);
+    return 0;
+}
+
+//Convert a whole number or literal and report it
+static int push_scalar(ARGO_CTX *cx, ARGO_PARSER *p, int kind, const unsigned char *text, size_t length){
+    cx->lines_read = p->line;
+    if (kind == PUSH_NUMBER){
+        ARGO_NUMBER n;
+        if (argo_ctx_parse_number(cx, text, length, &n)) return push_error(p, NULL);
+        if (emit(p->handler, number, p->ctx, &n)) return push_error(p, NULL);
+    }
+    else{
+        ARGO_BASIC b;
+        if (length == 4 && __builtin_memcmp(text, ARGO_TRUE_TOKEN, 4) == 0) b = ARGO_TRUE;
+        else if (length == 5 && __builtin_memcmp(text, ARGO_FALSE_TOKEN, 5) == 0) b = ARGO_FALSE;
+        else if (length == 4 && __builtin_memcmp(text, ARGO_NULL_TOKEN, 4) == 0) b = ARGO_NULL;
+        else return push_error(p, "Invalid literal");
+        if (emit(p->handler, basic, p->ctx, b)) return push_error(p, NULL);
+    }
+    value_done(p);
+    return 0;
+}
+
+//Find the end of a token (or of the rest of a cut off token) that continues at s. Returns NULL if the chunk ends first
+static const unsigned char *token_end(ARGO_PARSER *p, int kind, const unsigned char *s, const unsigned char *end){
+    if (kind == PUSH_NAME || kind == PUSH_STRING){
+        bool escaped = p->escaped;
+        for (; s < end; s++){
+            if (escaped) escaped = false;
+            else if (*s == ARGO_BSLASH) escaped = true;
+            else if (*s == ARGO_QUOTE) return s + 1;
+        }
+        p->escaped = escaped;
+        return NULL;
+    }
+    if (kind == PUSH_NUMBER){
+        while (s < end && is_number_char(*s)) s++;
+    }
+    else{
+        while (s < end && *s >= 'a' && *s <= 'z') s++;
+    }
+    return s < end ? s : NULL;
+}
+
+//Read a token starting at s (or the rest of the cut off token, if there is one). Returns how far the chunk has been consumed
+static const unsigned char *push_token(ARGO_CTX *cx, ARGO_PARSER *p, int kind, const unsigned char *s, const unsigned char *end){
+    const unsigned char *start = s;
+    //The opening quote isn't part of the scan for the closing one
+    if (p->token == PUSH_NO_TOKEN && (kind == PUSH_NAME || kind == PUSH_STRING)) s++;
+    const unsigned char *stop = token_end(p, kind, s, end);
+    if (stop == NULL){
+        p->token = kind;
+        return keep_text(p, start, end - start) ? NULL : end;
+    }
+    p->escaped = false;
+    //A number or literal must be followed by whitespace, a comma, or a closing bracket
+    if ((kind == PUSH_NUMBER || kind == PUSH_LITERAL) && !argo_is_whitespace(*stop) && !is_close_comma(*stop)){
+        push_error(p, kind == PUSH_NUMBER ? "Invalid char in number" : "Invalid literal");
+        return NULL;
+    }
+    const unsigned char *text = start;
+    size_t length = stop - start;
+    if (p->token != PUSH_NO_TOKEN){
+        if (keep_text(p, start, stop - start)) return NULL;
+        text = p->text;
+        length = p->length;
+        p->token = PUSH_NO_TOKEN;
+        p->length = 0;
+    }
+    int ret = kind == PUSH_NAME || kind == PUSH_STRING ? push_string(cx, p, kind, text, length) : push_scalar(cx, p, kind, text, length);
+    return ret ? NULL : stop;
+}
+
+//Close the innermost container with the given character, if that is the one it was opened with
+static int push_close(ARGO_PARSER *p, int c){
+    char open = *(p->stack + p->depth - 1);
+    if (c != (open == ARGO_LBRACE ? ARGO_RBRACE : ARGO_RBRACK)){
+        fprintf(stderr, "Error: Expected ',' or '%c' at line %d\n", open == ARGO_LBRACE ? ARGO_RBRACE : ARGO_RBRACK, p->line);
+        return push_error(p, NULL);
+    }
+    p->depth--;
+    if (open == ARGO_LBRACE ? emit(p->handler, end_object, p->ctx) : emit(p->handler, end_array, p->ctx)) return push_error(p, NULL);
+    value_done(p);
+    return 0;
+}
+
+//Handle a byte that starts a value
+static const unsigned char *push_value(ARGO_CTX *cx, ARGO_PARSER *p, const unsigned char *s, const unsigned char *end){
+    int c = *s;
+    if (c == ARGO_LBRACE || c == ARGO_LBRACK){
+        if (cx->max_depth > 0 && p->depth >= (size_t)cx->max_depth){
+            fprintf(stderr, "Error: Nesting is deeper than %d at line %d\n", cx->max_depth, p->line);
+            push_error(p, NULL);
+            return NULL;
+        }
+        if (grow(cx, (void **)&p->stack, p->depth, &p->stack_size, 1)){
+            push_error(p, NULL);
+            return NULL;
+        }
+        *(p->stack + p->depth++) = c;
+        if (c == ARGO_LBRACE ? emit(p->handler, start_object, p->ctx) : emit(p->handler, start_array, p->ctx)){
+            push_error(p, NULL);
+            return NULL;
+        }
+        p->state = c == ARGO_LBRACE ? PUSH_FIRST_KEY : PUSH_FIRST_VALUE;
+        return s + 1;
+    }
+    if (c == ARGO_QUOTE) return push_token(cx, p, PUSH_STRING, s, end);
+    if (argo_is_digit(c) || c == ARGO_MINUS) return push_token(cx, p, PUSH_NUMBER, s, end);
+    if (c == ARGO_N || c == ARGO_T || c == ARGO_F) return push_token(cx, p, PUSH_LITERAL, s, end);
+    push_error(p, "Invalid char");
+    return NULL;
+}
+
+/**
+ * @brief  Give a push parser the next chunk of input.
+ * @details  The chunk is parsed as far as it goes, and events are reported for
+ * everything in it that is complete. A token that is cut off by the end of the chunk
+ * is kept until the rest of it is fed. The chunk itself isn't needed once this returns.
+ * Once the input has turned out to be invalid (an error message is then printed to
+ * standard error, as for argo_read_value), the parser fails any further input.
+ *
+ * @param p  Parser to feed.
+ * @param buf  Bytes of input.
+ * @param len  Number of bytes in buf (which may be zero).
+ * @return  Zero if the input is valid so far, nonzero otherwise.
+ */
+int argo_parser_feed(ARGO_PARSER *p, const char *buf, size_t len){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_parser_feed(cx, p, buf, len);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Give a push parser the next chunk of input, counting its lines in a context and building any values in its arena (see argo_parser_feed)
+int argo_ctx_parser_feed(ARGO_CTX *cx, ARGO_PARSER *p, const char *buf, size_t len){
+    const unsigned char *s = (const unsigned char *)buf, *end = s + len;
+    if (p->error) return -1;
+    p->build.cx = cx;
+    if (p->token != PUSH_NO_TOKEN && s < end) s = push_token(cx, p, p->token, s, end);
+    while (s != NULL && s < end){
+        int c = *s;
+        if (argo_is_whitespace(c)){
+            if (c == ARGO_LF) p->line++;
+            s++;
+            continue;
+        }
+        switch (p->state){
+            case PUSH_FIRST_KEY:
+                if (c == ARGO_RBRACE) {s = push_close(p, c) ? NULL : s + 1; break;}
+                //Otherwise a member name is due
+            case PUSH_KEY:
+                if (c != ARGO_QUOTE){
+                    push_error(p, "Expected a member name");
+                    return -1;
+                }
+                s = push_token(cx, p, PUSH_NAME, s, end);
+                break;
+            case PUSH_COLON:
+                if (c != ARGO_COLON){
+                    push_error(p, "Expected ':'");
+                    return -1;
+                }
+                p->state = PUSH_VALUE;
+                s++;
+                break;
+            case PUSH_FIRST_VALUE:
+                if (c == ARGO_RBRACK) {s = push_close(p, c) ? NULL : s + 1; break;}
+                //Otherwise an element is due
+            case PUSH_VALUE:
+                s = push_value(cx, p, s, end);
+                break;
+            case PUSH_AFTER_VALUE:
+                if (c == ARGO_COMMA){
+                    p->state = *(p->stack + p->depth - 1) == ARGO_LBRACE ? PUSH_KEY : PUSH_VALUE;
+                    s++;
+                }
+                else s = push_close(p, c) ? NULL : s + 1;
+                break;
+        }
+    }
+    return s == NULL ? -1 : 0;
+}
+
+/**
+ * @brief  Tell a push parser that the input has ended.
+ * @details  A number or literal that was cut off by the end of the last chunk is
+ * complete now, so it is reported. The input is valid if it ends between values.
+ *
+ * @param p  Parser that has been fed all of the input.
+ * @return  Zero if the whole input is valid, nonzero otherwise.
+ */
+int argo_parser_finish(ARGO_PARSER *p){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_parser_finish(cx, p);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Tell a push parser that the input has ended, in a context (see argo_parser_finish)
+int argo_ctx_parser_finish(ARGO_CTX *cx, ARGO_PARSER *p){
+    if (p->error) return -1;
+    p->build.cx = cx;
+    if (p->token == PUSH_NUMBER || p->token == PUSH_LITERAL){
+        int kind = p->token;
+        p->token = PUSH_NO_TOKEN;
+        int ret = push_scalar(cx, p, kind, p->text, p->length);
+        p->length = 0;
+        if (ret) return -1;
+    }
+    if (p->token != PUSH_NO_TOKEN){
+        fprintf(stderr, "Error: A closing quote for a string was not found on line %d\n", p->line);
+        return push_error(p, NULL);
+    }
+    if (p->depth > 0 || p->state != PUSH_VALUE) return push_error(p, "Premature EOF");
+    return 0;
+}
+
+/**
+ * @brief  Take the next complete top level value from a push parser that builds argo values.
+ *
+ * @param p  Parser opened without a handler.
+ * @return  The first value that has been completed but not yet taken, or NULL if there
+ * isn't one (yet). Values stay valid until the arena they were built in is reset.
+ */
+ARGO_VALUE *argo_parser_value(ARGO_PARSER *p){
+    ARGO_BUILDER *b = &p->build;
+    if (b->taken == b->count){
+        //Once all of the values have been taken, their space in the list is reused
+        b->taken = b->count = 0;
+        return NULL;
+    }
+    return *(b->values + b->taken++);
+}
+
+/**
+ * @brief  Release the space held by a push parser.
+ * @details  Argo values that it has built are left in the arenas they were built in.
+ *
+ * @param p  Parser to close.
+ */
+void argo_parser_close(ARGO_PARSER *p){
+    free(p->text);
+    free(p->stack);
+    if (p->scratch.capacity != 0) free(p->scratch.content);
+    free(p->index);
+    free(p->build.open);
+    free(p->build.values);
+    *p = (ARGO_PARSER){0};
+}
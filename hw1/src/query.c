@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "validity.h"
+#include "ctx.h"
+#include "input.h"
+#include "access.h"
+#include "writer.h"
+#include "sort.h"
+#include "query.h"
+
+//Position of an element given by a JSON Pointer token (digits without leading zeros), or -1 if it isn't one
+static long token_index(const unsigned char *token, size_t length){
+    long index = 0;
+    size_t i;
+    if (length == 0 || (length > 1 && *token == ARGO_DIGIT0)) return -1;
+    for (i = 0; i < length; i++){
+        if (!argo_is_digit(*(token+i)) || index > (__LONG_MAX__ - 9) / 10) return -1;
+        index = index * 10 + (*(token+i) - ARGO_DIGIT0);
+    }
+    return index;
+}
+
+//Finish a step that selects a member, whose decoded name has been written to "name"
+static void name_step(ARGO_STEP *step, ARGO_STEP_KIND kind, const unsigned char *name, size_t length){
+    step->kind = kind;
+    step->name = name;
+    step->length = length;
+    step->hash = argo_hash_bytes(name, length);
+    step->index = kind == ARGO_STEP_TOKEN ? token_index(name, length) : -1;
+}
+
+//Compile a JSON Pointer (RFC 6901), in which ~0 and ~1 stand for '~' and '/'
+static int compile_pointer(ARGO_QUERY *q, const char *p, unsigned char *names){
+    while (*p == ARGO_FSLASH){
+        p++;
+        size_t length = 0;
+        while (*p != '\0' && *p != ARGO_FSLASH){
+            if (*p == '~'){
+                if (*(p+1) != ARGO_DIGIT0 && *(p+1) != '1'){
+                    fprintf(stderr, "Error: Invalid escape in query (only ~0 and ~1 are allowed)\n");
+                    return -1;
+                }
+                *(names + length++) = *(p+1) == ARGO_DIGIT0 ? '~' : ARGO_FSLASH;
+                p += 2;
+            }
+            else *(names + length++) = *p++;
+        }
+        name_step(q->steps + q->count++, ARGO_STEP_TOKEN, names, length);
+        names += length;
+    }
+    return 0;
+}
+
+//Compile the part of a JSONPath after the '$': a sequence of .name, .*, [n], [*], and ['name'] (or ["name"])
+static int compile_path(ARGO_QUERY *q, const char *p, unsigned char *names){
+    while (*p != '\0'){
+        ARGO_STEP *step = q->steps + q->count++;
+        size_t length = 0;
+        if (*p == ARGO_PERIOD){
+            p++;
+            if (*p == '*'){
+                step->kind = ARGO_STEP_WILDCARD;
+                q->multiple = 1;
+                p++;
+                continue;
+            }
+            while (*p != '\0' && *p != ARGO_PERIOD && *p != ARGO_LBRACK) *(names + length++) = *p++;
+            if (length == 0){
+                fprintf(stderr, "Error: Missing member name after '.' in query\n");
+                return -1;
+            }
+            name_step(step, ARGO_STEP_NAME, names, length);
+            names += length;
+            continue;
+        }
+        if (*p != ARGO_LBRACK){
+            fprintf(stderr, "Error: Unexpected '%c' in query\n", *p);
+            return -1;
+        }
+        p++;
+        if (*p == '*'){
+            step->kind = ARGO_STEP_WILDCARD;
+            q->multiple = 1;
+            p++;
+        }
+        else if (*p == '\'' || *p == ARGO_QUOTE){
+            char quote = *p++;
+            while (*p != quote){
+                if (*p == '\0'){
+                    fprintf(stderr, "Error: Unterminated member name in query\n");
+                    return -1;
+                }
+                //A backslash makes the next character part of the name, even if it is a quote
+                if (*p == ARGO_BSLASH && *(p+1) != '\0') p++;
+                *(names + length++) = *p++;
+            }
+            p++;
+            name_step(step, ARGO_STEP_NAME, names, length);
+            names += length;
+        }
+        else{
+            bool negative = *p == ARGO_MINUS;
+            long index = 0;
+            if (negative) p++;
+            if (!argo_is_digit(*p)){
+                fprintf(stderr, "Error: Expected an index, '*', or a quoted name after '[' in query\n");
+                return -1;
+            }
+            while (argo_is_digit(*p)){
+                if (index > (__LONG_MAX__ - 9) / 10){
+                    fprintf(stderr, "Error: Index too large in query\n");
+                    return -1;
+                }
+                index = index * 10 + (*p++ - ARGO_DIGIT0);
+            }
+            step->kind = ARGO_STEP_INDEX;
+            step->index = negative ? -index : index;
+        }
+        if (*p != ARGO_RBRACK){
+            fprintf(stderr, "Error: Expected ']' in query\n");
+            return -1;
+        }
+        p++;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Compile a query.
+ * @details  The query is either a JSON Pointer, such as "/a/b/0" (or "" for the whole
+ * value), or a simple JSONPath starting with '$', made up of .name, ['name'], [n]
+ * (where a negative n counts from the end of the array), and the wildcards .* and [*].
+ * A pointer token selects an element if it is applied to an array, and a member
+ * otherwise, as in RFC 6901.
+ *
+ * @param expr  Text of the query.
+ * @return  The compiled query, to be freed with argo_query_free, or NULL (after an
+ * error message has been printed) if the query is invalid.
+ */
+ARGO_QUERY *argo_query_compile(const char *expr){
+    size_t length = 0;
+    while (*(expr+length) != '\0') length++;
+    //Every step takes up at least one character, and no decoded name is longer than the query
+    ARGO_QUERY *q = malloc(sizeof(ARGO_QUERY) + (length + 1) * sizeof(ARGO_STEP) + length + 1);
+    if (q == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for query\n");
+        return NULL;
+    }
+    unsigned char *names = (unsigned char *)(q->steps + length + 1);
+    int ret;
+    q->count = 0;
+    q->multiple = 0;
+    if (length == 0 || *expr == ARGO_FSLASH) ret = compile_pointer(q, expr, names);
+    else if (*expr == '$') ret = compile_path(q, expr + 1, names);
+    else{
+        fprintf(stderr, "Error: A query must start with '/' or '$'\n");
+        ret = -1;
+    }
+    if (ret){
+        free(q);
+        return NULL;
+    }
+    debug("Compiled query \"%s\" into %lu steps\n", expr, q->count);
+    return q;
+}
+
+/**
+ * @brief  Free a compiled query.
+ *
+ * @param q  Query returned by argo_query_compile (or NULL).
+ */
+void argo_query_free(ARGO_QUERY *q){
+    free(q);
+}
+
+//Run the steps of a query from step i on, starting at value v (read in context cx). Returns nonzero if the callback asked to stop
+static int eval_from(ARGO_CTX *cx, ARGO_QUERY *q, size_t i, ARGO_VALUE *v, int (*match)(void *, ARGO_VALUE *), void *ctx, size_t *count){
+    for (; i < q->count && v != NULL; i++){
+        ARGO_STEP *step = q->steps + i;
+        switch (step->kind){
+            case ARGO_STEP_NAME: v = argo_ctx_object_get_hashed(cx, v, step->name, step->length, step->hash); break;
+            case ARGO_STEP_INDEX: {
+                long index = step->index < 0 ? step->index + (long)argo_array_len(v) : step->index;
+                v = index < 0 ? NULL : argo_array_at(v, index);
+                break;
+            }
+            case ARGO_STEP_TOKEN: {
+                if (v->type == ARGO_ARRAY_TYPE) v = step->index < 0 ? NULL : argo_array_at(v, step->index);
+                else v = argo_ctx_object_get_hashed(cx, v, step->name, step->length, step->hash);
+                break;
+            }
+            case ARGO_STEP_WILDCARD: {
+                if (v->type != ARGO_OBJECT_TYPE && v->type != ARGO_ARRAY_TYPE) return 0;
+                ARGO_VALUE *sentinel = v->type == ARGO_OBJECT_TYPE ? v->content.object.member_list : v->content.array.element_list;
+                ARGO_VALUE *c;
+                for (c = sentinel->next; c != sentinel; c = c->next){
+                    if (eval_from(cx, q, i + 1, c, match, ctx, count)) return -1;
+                }
+                return 0;
+            }
+        }
+    }
+    if (v == NULL) return 0;
+    (*count)++;
+    return match(ctx, v);
+}
+
+/**
+ * @brief  Run a compiled query against a value, calling a function for each value selected.
+ * @details  Values are selected in document order. Members of objects are found
+ * through their hash indexes (see argo_object_get), which are built by the first
+ * query that needs them and then reused by later ones. The value must have been
+ * read in the default context (argo_ctx_query_eval queries one read in another).
+ *
+ * @param q  Compiled query.
+ * @param root  Value to run the query against.
+ * @param match  Function called with each selected value. It returns zero to
+ * continue, or nonzero to stop the query.
+ * @param ctx  Passed unchanged as the first argument of match.
+ * @return  The number of values that were selected (and passed to match).
+ */
+size_t argo_query_eval(ARGO_QUERY *q, ARGO_VALUE *root, int (*match)(void *ctx, ARGO_VALUE *v), void *ctx){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    size_t count = argo_ctx_query_eval(cx, q, root, match, ctx);
+    argo_default_ctx_leave(cx);
+    return count;
+}
+
+//Run a compiled query against a value read in a context, indexing its objects in the context's arena (see argo_query_eval)
+size_t argo_ctx_query_eval(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_VALUE *root, int (*match)(void *ctx, ARGO_VALUE *v), void *ctx){
+    size_t count = 0;
+    eval_from(cx, q, 0, root, match, ctx, &count);
+    return count;
+}
+
+//Callback for argo_query_first, which keeps the first value selected and stops
+static int keep_first(void *ctx, ARGO_VALUE *v){
+    *(ARGO_VALUE **)ctx = v;
+    return 1;
+}
+
+/**
+ * @brief  Run a compiled query against a value, returning the first value selected.
+ *
+ * @param q  Compiled query.
+ * @param root  Value to run the query against.
+ * @return  The first value selected, or NULL if there isn't one.
+ */
+ARGO_VALUE *argo_query_first(ARGO_QUERY *q, ARGO_VALUE *root){
+    ARGO_VALUE *first = NULL;
+    argo_query_eval(q, root, keep_first, &first);
+    return first;
+}
+
+//Run a compiled query against a value read in a context, returning the first value selected (see argo_query_first)
+ARGO_VALUE *argo_ctx_query_first(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_VALUE *root){
+    ARGO_VALUE *first = NULL;
+    argo_ctx_query_eval(cx, q, root, keep_first, &first);
+    return first;
+}
+
+/**
+ * @brief  Compile and run a query in one go, returning the first value selected.
+ * @details  Queries that are run repeatedly should be compiled once with
+ * argo_query_compile instead.
+ *
+ * @param root  Value to run the query against.
+ * @param expr  Text of the query (see argo_query_compile).
+ * @return  The first value selected, or NULL if there isn't one or the query is invalid.
+ */
+ARGO_VALUE *argo_query(ARGO_VALUE *root, const char *expr){
+    ARGO_QUERY *q = argo_query_compile(expr);
+    if (q == NULL) return NULL;
+    ARGO_VALUE *first = argo_query_first(q, root);
+    argo_query_free(q);
+    return first;
+}
+
+//Compile and run a query in one go against a value read in a context (see argo_query)
+ARGO_VALUE *argo_ctx_query(ARGO_CTX *cx, ARGO_VALUE *root, const char *expr){
+    ARGO_QUERY *q = argo_query_compile(expr);
+    if (q == NULL) return NULL;
+    ARGO_VALUE *first = argo_ctx_query_first(cx, q, root);
+    argo_query_free(q);
+    return first;
+}
+
+//Writer of argo_query_write, with the context whose level it writes the selected values at
+typedef struct query_writer {
+    ARGO_CTX *cx;
+    ARGO_WRITER *w;
+} QUERY_WRITER;
+
+//Callback for argo_query_write, which writes each selected value at the top level
+static int write_match(void *ctx, ARGO_VALUE *v){
+    QUERY_WRITER *qw = ctx;
+    ARGO_WRITER *w = qw->w;
+    //Only the value is written, not the name it has as a member
+    ARGO_VALUE copy = *v;
+    copy.name.content = NULL;
+    qw->cx->level = 0;
+    if (argo_ctx_writer_value(qw->cx, w, &copy)) return -1;
+    //Pretty printed values already end with a newline
+    if (w->indent < 0) argo_writer_put(w, ARGO_LF);
+    return 0;
+}
+
+/**
+ * @brief  Write the values selected from a value by a query.
+ * @details  Each selected value is written as canonical JSON (pretty printed if
+ * the writer is) on a line of its own. Nothing is written if no value is selected.
+ *
+ * @param q  Compiled query.
+ * @param root  Value to run the query against.
+ * @param w  Writer to which the selected values are written.
+ * @return  Zero if successful, nonzero if writing has failed.
+ */
+int argo_query_write_to(ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_query_write_to(cx, q, root, w);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Write the values selected by a query from a value read in a context (see argo_query_write_to)
+int argo_ctx_query_write_to(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_VALUE *root, ARGO_WRITER *w){
+    QUERY_WRITER qw = {cx, w};
+    size_t count = argo_ctx_query_eval(cx, q, root, write_match, &qw);
+    debug("Query selected %lu values\n", count);
+    return w->error;
+}
+
+/**
+ * @brief  Read a value from an input and write the values selected from it by a query.
+ * @details  See argo_query_write_to, which is given a writer on the output stream
+ * (pretty printing if global_options says so).
+ *
+ * @param q  Compiled query.
+ * @param in  Input from which JSON is to be read.
+ * @param out  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_query_write(ARGO_QUERY *q, ARGO_INPUT *in, FILE *out){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_query_write(cx, q, in, out);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Read a value from an input in a context and write the values selected from it by a query (see argo_query_write)
+int argo_ctx_query_write(ARGO_CTX *cx, ARGO_QUERY *q, ARGO_INPUT *in, FILE *out){
+    ARGO_VALUE *root = argo_ctx_read_value_canonical(cx, in);
+    if (root == NULL) return -1;
+    ARGO_WRITER w;
+    if (argo_ctx_writer_open(cx, &w, out)) return -1;
+    argo_ctx_query_write_to(cx, q, root, &w);
+    return argo_writer_close(&w);
+}
@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "validity.h"
+#include "ctx.h"
+#include "input.h"
+#include "writer.h"
+#include "split.h"
+#include "sort.h"
+
+/*
+ * Members of an object that are still to be put in order: they are already in order
+ * of the characters of their names before "index" (and of the bytes of the character
+ * at "index" before "byte"), which are the same for all of them.
+ */
+typedef struct sort_range {
+    size_t start;                    // Position of the first of the members.
+    size_t count;                    // Number of members.
+    size_t index;                    // Character of the names to sort by next.
+    int byte;                        // Byte of that character to sort by next (0 is the most significant).
+} SORT_RANGE;
+
+/*
+ * Space used while sorting, which is allocated once for all of the objects of a value.
+ */
+typedef struct sort_space {
+    ARGO_VALUE **members;            // Members of the object being sorted.
+    ARGO_VALUE **aux;                // Space the members are dealt into.
+    ARGO_CHAR *chars;                // Character of the name of each member that they are being sorted by (-1 once it has ended).
+    size_t members_size;             // Capacity of members.
+    size_t aux_size;                 // Capacity of aux.
+    size_t chars_size;               // Capacity of chars.
+    SORT_RANGE *ranges;              // Ranges of members left to sort.
+    size_t ranges_size;              // Capacity of ranges.
+    ARGO_VALUE **containers;         // Arrays and objects left to look in.
+    size_t containers_size;          // Capacity of containers.
+} SORT_SPACE;
+
+//Make room in a growing array for at least "need" items of "item" bytes, doubling its size as often as it takes
+static int sort_grow(void **items, size_t *size, size_t need, size_t item){
+    size_t grown = *size == 0 ? 64 : *size;
+    while (grown < need) grown *= 2;
+    if (grown == *size) return 0;
+    void *p = realloc(*items, grown * item);
+    if (p == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for sorting members\n");
+        return -1;
+    }
+    *items = p;
+    *size = grown;
+    return 0;
+}
+
+//Bucket of a member for a byte of a character of its name (zero if the name has ended)
+static inline int sort_digit(ARGO_CHAR c, int byte){
+    return c < 0 ? 0 : 1 + ((c >> (24 - 8*byte)) & 0xFF);
+}
+
+//Compare the names of two members, from a character on which they may differ
+static int name_compare(ARGO_STRING *a, ARGO_STRING *b, size_t i){
+    size_t n = a->length < b->length ? a->length : b->length;
+    for (; i < n; i++){
+        if (*(a->content+i) != *(b->content+i)) return *(a->content+i) < *(b->content+i) ? -1 : 1;
+    }
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+//Sort a few members by insertion (which keeps members with the same name in the order they had)
+static void insertion_sort(ARGO_VALUE **a, size_t n, size_t index){
+    size_t j, k;
+    for (j = 1; j < n; j++){
+        ARGO_VALUE *v = *(a+j);
+        for (k = j; k > 0 && name_compare(&(*(a+k-1))->name, &v->name, index) > 0; k--) *(a+k) = *(a+k-1);
+        *(a+k) = v;
+    }
+}
+
+//Add a range of members to the ranges left to sort
+static int push_range(SORT_SPACE *s, size_t *top, size_t start, size_t count, size_t index, int byte){
+    if (*top == s->ranges_size && sort_grow((void **)&s->ranges, &s->ranges_size, *top + 1, sizeof(SORT_RANGE))) return -1;
+    SORT_RANGE *r = s->ranges + (*top)++;
+    r->start = start;
+    r->count = count;
+    r->index = index;
+    r->byte = byte;
+    return 0;
+}
+
+//Add a range of members that have been sorted by a byte of their names, to be sorted by the byte after it
+static int push_next(SORT_SPACE *s, size_t *top, size_t start, size_t count, SORT_RANGE *r){
+    return r->byte == 3 ? push_range(s, top, start, count, r->index + 1, 0) : push_range(s, top, start, count, r->index, r->byte + 1);
+}
+
+//Sort the first n of s->members, dealing them into buckets a byte at a time. Members with the same name keep
+//the order they had. Instead of recursing on each bucket, the ranges of members left to sort are kept on a stack
+static int radix_sort(SORT_SPACE *s, size_t n){
+    size_t counts[ARGO_SORT_BUCKETS], top = 0;
+    int d;
+    if (push_range(s, &top, 0, n, 0, 0)) return -1;
+    while (top > 0){
+        SORT_RANGE r = *(s->ranges + --top);
+        ARGO_VALUE **a = s->members + r.start;
+        size_t j;
+        if (r.count <= ARGO_SORT_SMALL){
+            insertion_sort(a, r.count, r.index);
+            continue;
+        }
+        //The characters are fetched from the names once, so that the passes over them don't have to go through the members.
+        //The upper bytes of a character are skipped if they are zero in every name (as they are for text in Latin-1)
+        ARGO_CHAR *chars = s->chars + r.start, high = 0;
+        for (j = 0; j < r.count; j++){
+            ARGO_VALUE *v = *(a+j);
+            ARGO_CHAR c = r.index < v->name.length ? *(v->name.content + r.index) : -1;
+            *(chars+j) = c;
+            if (c > 0) high |= c >> 8;
+        }
+        if (r.byte == 0 && high == 0) r.byte = 3;
+        __builtin_memset(counts, 0, sizeof(counts));
+        for (j = 0; j < r.count; j++) (*(counts + sort_digit(*(chars+j), r.byte)))++;
+        //If they all have the same byte there is nothing to move, and if their names have all ended they are equal
+        d = sort_digit(*chars, r.byte);
+        if (*(counts+d) == r.count){
+            if (d != 0 && push_next(s, &top, r.start, r.count, &r)) return -1;
+            continue;
+        }
+        //Turn the counts into the positions where the buckets start, deal the members into them, and sort each bucket
+        size_t start = 0;
+        for (d = 0; d < ARGO_SORT_BUCKETS; d++){
+            size_t count = *(counts+d);
+            *(counts+d) = start;
+            if (d != 0 && count > 1 && push_next(s, &top, r.start + start, count, &r)) return -1;
+            start += count;
+        }
+        for (j = 0; j < r.count; j++) *(s->aux + (*(counts + sort_digit(*(chars+j), r.byte)))++) = *(a+j);
+        __builtin_memcpy(a, s->aux, r.count * sizeof(ARGO_VALUE *));
+    }
+    return 0;
+}
+
+//Sort the members of an object (which are in s->members), and link them back into its list in their new order
+static int sort_object(SORT_SPACE *s, ARGO_VALUE *sentinel, size_t n){
+    size_t j;
+    if (n <= ARGO_SORT_SMALL) insertion_sort(s->members, n, 0);
+    else if (radix_sort(s, n)) return -1;
+    ARGO_VALUE *prev = sentinel;
+    for (j = 0; j < n; j++){
+        ARGO_VALUE *v = *(s->members+j);
+        v->prev = prev;
+        prev->next = v;
+        prev = v;
+    }
+    prev->next = sentinel;
+    sentinel->prev = prev;
+    return 0;
+}
+
+/**
+ * @brief  Put the members of every object in a value in order of their names.
+ * @details  Names are compared by their characters (code points), and a name comes
+ * before the longer names that it is the beginning of. Members with the same name
+ * keep the order they had. The objects nested in the value are found without
+ * recursion, so any depth of nesting can be sorted.
+ *
+ * @param v  Value whose objects are to be sorted.
+ * @return  Zero if successful, nonzero if space for sorting couldn't be allocated.
+ */
+int argo_sort_members(ARGO_VALUE *v){
+    SORT_SPACE s = {0};
+    size_t top = 0;
+    int ret = 0;
+    if (v->type != ARGO_OBJECT_TYPE && v->type != ARGO_ARRAY_TYPE) return 0;
+    if (sort_grow((void **)&s.containers, &s.containers_size, 1, sizeof(ARGO_VALUE *))) return -1;
+    *(s.containers + top++) = v;
+    while (ret == 0 && top > 0){
+        ARGO_VALUE *c = *(s.containers + --top);
+        ARGO_VALUE *sentinel = c->type == ARGO_OBJECT_TYPE ? c->content.object.member_list : c->content.array.element_list;
+        size_t n = 0;
+        ARGO_VALUE *e;
+        for (e = sentinel->next; e != sentinel; e = e->next){
+            if (c->type == ARGO_OBJECT_TYPE){
+                if (n == s.members_size && (sort_grow((void **)&s.members, &s.members_size, n + 1, sizeof(ARGO_VALUE *))
+                                            || sort_grow((void **)&s.aux, &s.aux_size, s.members_size, sizeof(ARGO_VALUE *))
+                                            || sort_grow((void **)&s.chars, &s.chars_size, s.members_size, sizeof(ARGO_CHAR)))){
+                    ret = -1;
+                    break;
+                }
+                *(s.members + n++) = e;
+            }
+            if (e->type != ARGO_OBJECT_TYPE && e->type != ARGO_ARRAY_TYPE) continue;
+            if (top == s.containers_size && sort_grow((void **)&s.containers, &s.containers_size, top + 1, sizeof(ARGO_VALUE *))){
+                ret = -1;
+                break;
+            }
+            *(s.containers + top++) = e;
+        }
+        if (ret == 0 && c->type == ARGO_OBJECT_TYPE && n > 1) ret = sort_object(&s, sentinel, n);
+    }
+    free(s.members);
+    free(s.aux);
+    free(s.chars);
+    free(s.ranges);
+    free(s.containers);
+    return ret;
+}
+
+/**
+ * @brief  Read a value from an input, putting the members of its objects in order
+ * if the --sort-keys option (SORT_OPTION) was given.
+ * @details  A large array is read by argo_jobs threads (see argo_read_value_split).
+ *
+ * @param in  Input from which JSON is to be read.
+ * @return  The value read, or NULL if there is any error.
+ */
+ARGO_VALUE *argo_read_value_canonical(ARGO_INPUT *in){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    ARGO_VALUE *v = argo_ctx_read_value_canonical(cx, in);
+    argo_default_ctx_leave(cx);
+    return v;
+}
+
+//Read a value from an input into the arena of a context, putting the members of its objects in order if --sort-keys was given (see argo_read_value_canonical)
+ARGO_VALUE *argo_ctx_read_value_canonical(ARGO_CTX *cx, ARGO_INPUT *in){
+    ARGO_VALUE *v = argo_ctx_read_value_split(cx, in);
+    if (v == NULL || !(argo_extra_options & SORT_OPTION)) return v;
+    return argo_sort_members(v) ? NULL : v;
+}
+
+/**
+ * @brief  Read a value from an input and write it in sorted-keys canonical form.
+ * @details  The output is that of argo_write_value (pretty printed if global_options
+ * says so), with the members of each object in order of their names. Unlike
+ * argo_write_events, the whole value is read before any of it is written.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @param out  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_write_sorted(ARGO_INPUT *in, FILE *out){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_write_sorted(cx, in, out);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Read a value from an input in a context and write it in sorted-keys canonical form (see argo_write_sorted)
+int argo_ctx_write_sorted(ARGO_CTX *cx, ARGO_INPUT *in, FILE *out){
+    ARGO_VALUE *v = argo_ctx_read_value_split(cx, in);
+    if (v == NULL || argo_sort_members(v)) return -1;
+    cx->level = 0;
+    return argo_ctx_write_value(cx, v, out);
+}
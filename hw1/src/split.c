@@ -0,0 +1,499 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "arena.h"
+#include "structural.h"
+#include "events.h"
+#include "lines.h"
+#include "split.h"
+
+//Add a run of elements to a growing list of them, doubling its size if it is full
+static int add_slice(ARGO_SLICE **slices, size_t *count, size_t *size, size_t start, size_t end, unsigned long line){
+    if (*count == *size){
+        size_t grown = *size == 0 ? 64 : 2 * *size;
+        ARGO_SLICE *s = realloc(*slices, grown * sizeof(ARGO_SLICE));
+        if (s == NULL) return -1;
+        *slices = s;
+        *size = grown;
+    }
+    ARGO_SLICE *s = *slices + (*count)++;
+    s->start = start;
+    s->end = end;
+    s->line = line;
+    return 0;
+}
+
+//Check whether the bytes after a "\\u" at "at" are four hex digits. If they aren't, the parser takes them as the
+//digits anyway, even if one of them is a quote (which then doesn't end the string), and a scan of the masks can't follow that
+static bool hex_escape(const unsigned char *buf, size_t len, size_t at){
+    size_t i;
+    if (at + 4 >= len) return false;
+    for (i = 1; i <= 4; i++){
+        if (!argo_is_hex(*(buf + at + i))) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief  Divide the top level elements of an array into runs of about "chunk" bytes each.
+ * @details  The buffer is classified 64 bytes at a time, as the structural index does it,
+ * and only the brackets and commas outside of strings are looked at: a run ends at the
+ * first comma at the top level of the array once it is at least "chunk" bytes long. Nothing
+ * else is checked, so an invalid array is only found to be invalid when its runs are parsed
+ * (which, since a run starts where the parser would be if everything before it were valid,
+ * gives the same error as parsing the whole array would). Anything after the array is ignored.
+ * A backslash only escapes the byte after it here, so an array with a \u escape that isn't
+ * followed by four hex digits isn't split, as the parser may take a quote as one of its digits.
+ *
+ * @param buf  Bytes of the document, which must start with the array (after any whitespace).
+ * @param len  Number of bytes in buf.
+ * @param chunk  Size that a run has to reach before it is ended.
+ * @param slices  Set to a list of the runs, in order, which the caller frees.
+ * @param count  Set to the number of runs.
+ * @return  Zero if successful, nonzero if the document doesn't start with an array,
+ * the array doesn't end, it has a \u escape without four hex digits, or space couldn't be allocated.
+ */
+int argo_split_array(const unsigned char *buf, size_t len, size_t chunk, ARGO_SLICE **slices, size_t *count){
+    unsigned char padded[ARGO_BLOCK_SIZE];
+    uint64_t prev_escaped = 0, prev_in_string = 0;
+    size_t pos = 0, depth = 0, size = 0, start = 0;
+    unsigned long lines = 0, line = 0;
+    *slices = NULL;
+    *count = 0;
+    while (pos < len && argo_is_whitespace(*(buf+pos))) pos++;
+    if (pos == len || *(buf+pos) != ARGO_LBRACK) return -1;
+    //The whitespace in front of the array is classified too, to count its newlines
+    pos = 0;
+    while (pos < len){
+        const unsigned char *b = buf + pos;
+        size_t avail = len - pos, i;
+        //The last block is padded with NUL bytes, which are neither quotes, brackets, nor newlines
+        if (avail < ARGO_BLOCK_SIZE){
+            for (i = 0; i < ARGO_BLOCK_SIZE; i++) *(padded+i) = i < avail ? *(b+i) : 0;
+            b = padded;
+        }
+        ARGO_BLOCK_MASKS m;
+        argo_classify_block(b, &m);
+        uint64_t escaped = argo_find_escaped(m.bslash, &prev_escaped);
+        uint64_t in_string = argo_prefix_xor(m.quote & ~escaped) ^ prev_in_string;
+        prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+        while (escaped != 0){
+            int bit = __builtin_ctzll(escaped);
+            if (*(b + bit) == ARGO_U && !hex_escape(buf, len, pos + bit)) break;
+            escaped &= escaped - 1;
+        }
+        if (escaped != 0) break;
+        uint64_t ops = m.op & ~in_string;
+        while (ops != 0){
+            int bit = __builtin_ctzll(ops);
+            int c = *(b + bit);
+            size_t at = pos + bit;
+            //A run starting just after this byte starts on the line after the newlines up to it
+            unsigned long next = lines + __builtin_popcountll(m.nl & ((2ULL << bit) - 1)) + 1;
+            if (c == ARGO_LBRACE || c == ARGO_LBRACK){
+                if (depth++ == 0) {start = at + 1; line = next;}
+            }
+            else if (c == ARGO_RBRACE || c == ARGO_RBRACK){
+                //The array ends with the first bracket that closes it, whether or not it is the right kind
+                if (--depth == 0) return add_slice(slices, count, &size, start, at + 1, line);
+            }
+            else if (c == ARGO_COMMA && depth == 1 && at + 1 - start >= chunk){
+                if (add_slice(slices, count, &size, start, at + 1, line)) break;
+                start = at + 1;
+                line = next;
+            }
+            ops &= ops - 1;
+        }
+        if (ops != 0) break;
+        lines += __builtin_popcountll(m.nl);
+        pos += ARGO_BLOCK_SIZE;
+    }
+    free(*slices);
+    *slices = NULL;
+    *count = 0;
+    return -1;
+}
+
+//Validate or canonicalize (if there is a writer) the elements of one run in a worker process, and exit
+static void run_slice(LINES_WORKER *wk, ARGO_INPUT *in, ARGO_SLICE *s, bool first, bool validate){
+    ARGO_INPUT slice;
+    ARGO_EVENT_WRITER w;
+    //Error messages are collected along with the output, so that they come out in order too
+    if (dup2(wk->err, STDERR_FILENO) < 0 || (!validate && argo_writer_open_sink(&w.out, argo_worker_sink, &wk->out))) _exit(2);
+    argo_input_open_mem(&slice, (const char *)(in->buf + in->pos + s->start), s->end - s->start);
+    //The elements are written inside the array that the parent process has opened
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    w.cx = cx;
+    w.need_comma = !first;
+    w.after_key = 0;
+    cx->level = 1;
+    cx->lines_read += s->line;
+    int ret = -1;
+    while (true){
+        //The parser counts the line it starts on, which has already been counted
+        cx->lines_read--;
+        if (validate ? argo_ctx_validate(cx, &slice) : argo_ctx_parse_events(cx, &slice, &argo_writer_handler, &w)) break;
+        int c = argo_next_token(cx, &slice);
+        //The ',' or ']' that ends the run is its last byte
+        if ((c == ARGO_COMMA || c == ARGO_RBRACK) && slice.pos == slice.len) {ret = 0; break;}
+        if (c != ARGO_COMMA){
+            fprintf(stderr, "Error: Expected ',' or ']' at line %d\n", cx->lines_read);
+            break;
+        }
+    }
+    argo_default_ctx_leave(cx);
+    argo_input_close(&slice);
+    if (!validate && argo_writer_close(&w.out)) ret = -1;
+    _exit(ret ? 1 : 0);
+}
+
+/*
+ * Hand out the runs of elements of an array, in order, to "jobs" worker processes,
+ * and splice their output together between the brackets of the array. As with --lines,
+ * each worker has its own copy of the parser's state, and writes its output and error
+ * messages to temporary files, which are copied out in the order of the runs. Once
+ * a run turns out to be invalid, no more are started and the output of those after
+ * it is thrown away, so the output is the same as that of a single process.
+ */
+static int run_slices(ARGO_INPUT *in, FILE *out, ARGO_SLICE *slices, size_t count, bool validate, int jobs){
+    ARGO_EVENT_WRITER w;
+    if (!validate && argo_writer_open(&w.out, out)) return -1;
+    LINES_WORKER *workers = calloc(jobs, sizeof(LINES_WORKER));
+    FILE **files = calloc(2 * jobs, sizeof(FILE *));
+    size_t started = 0, finished = 0;
+    int i, ret = 0;
+    bool more = true;
+    if (workers == NULL || files == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for %d workers\n", jobs);
+        more = false;
+        ret = -1;
+    }
+    for (i = 0; more && i < jobs; i++){
+        if ((*(files + 2*i) = tmpfile()) == NULL || (*(files + 2*i + 1) = tmpfile()) == NULL){
+            fprintf(stderr, "Error: Failed to create the output files of the workers\n");
+            more = false;
+            ret = -1;
+            break;
+        }
+        (workers + i)->out = fileno(*(files + 2*i));
+        (workers + i)->err = fileno(*(files + 2*i + 1));
+    }
+    if (!validate){
+        w.cx = argo_default_ctx_enter();
+        w.need_comma = 0;
+        w.after_key = 0;
+        w.cx->level = 0;
+        argo_writer_handler.start_array(&w);
+        argo_writer_flush(&w.out);
+        argo_default_ctx_leave(w.cx);
+    }
+    //Nothing buffered may be left for the workers to inherit
+    fflush(out);
+    fflush(stderr);
+    while (true){
+        while (more && started - finished < (size_t)jobs && started < count){
+            LINES_WORKER *wk = workers + started % jobs;
+            if ((wk->pid = fork()) == 0) run_slice(wk, in, slices + started, started == 0, validate);
+            if (wk->pid < 0){
+                fprintf(stderr, "Error: Failed to start a worker process\n");
+                more = false;
+                ret = -1;
+                break;
+            }
+            started++;
+        }
+        if (finished == started) break;
+        //The oldest run is the next one whose output is due
+        LINES_WORKER *wk = workers + finished++ % jobs;
+        int status;
+        //After an invalid run, the workers still running are only waited for
+        if (ret != 0) kill(wk->pid, SIGKILL);
+        //The status is only there to look at if the worker could be waited for
+        bool waited = waitpid(wk->pid, &status, 0) >= 0;
+        bool ok = waited && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (ret != 0) continue;
+        if (argo_worker_drain(wk->out, out) || argo_worker_drain(wk->err, stderr)) ok = false;
+        if (waited && WIFEXITED(status) && WEXITSTATUS(status) > 1) fprintf(stderr, "Error: A worker failed to handle the elements from line %lu on\n", (slices + finished - 1)->line);
+        if (!ok){
+            more = false;
+            ret = -1;
+        }
+    }
+    debug("Handled %lu runs of elements with %d workers\n", started, jobs);
+    if (!validate){
+        //The array is only closed if all of its elements were written
+        if (ret == 0){
+            w.cx = argo_default_ctx_enter();
+            w.need_comma = 1;
+            argo_writer_handler.end_array(&w);
+            argo_default_ctx_leave(w.cx);
+        }
+        if (argo_writer_close(&w.out)) ret = -1;
+    }
+    for (i = 0; files != NULL && i < 2 * jobs; i++){
+        if (*(files+i) != NULL) fclose(*(files+i));
+    }
+    free(files);
+    free(workers);
+    if (fflush(out)) ret = -1;
+    return ret;
+}
+
+//Divide a document into runs of elements if there are workers to give them to and it is an array big enough
+//to be worth it (and it has no depth limit). The whole document is read in first. Nonzero is returned if it isn't to be divided
+static int split_input(ARGO_INPUT *in, int max_depth, ARGO_SLICE **slices, size_t *count){
+    size_t i = 0;
+    int c = EOF;
+    *slices = NULL;
+    *count = 0;
+    //The elements of a run would be nested one less deep than the parser sees them
+    if (argo_jobs <= 1 || max_depth != 0) return -1;
+    while ((c = argo_peek(in, i)) != EOF && argo_is_whitespace(c)) i++;
+    if (c != ARGO_LBRACK) return -1;
+    while (in->src != NULL){
+        size_t need = 2 * (in->len - in->pos) + ARGO_INPUT_BLOCK;
+        if (argo_input_refill(in, need) < (long)need) break;
+    }
+    //A document that can't be divided (including one that isn't valid) is handled the usual way
+    if (in->src == NULL && argo_split_array(in->buf + in->pos, in->len - in->pos, ARGO_SPLIT_CHUNK, slices, count) == 0 && *count > 1) return 0;
+    free(*slices);
+    *slices = NULL;
+    return -1;
+}
+
+//Validate or canonicalize a document, dividing it among argo_jobs processes if it is an array big enough to be worth it
+static int run_split(ARGO_INPUT *in, FILE *out, bool validate){
+    size_t count;
+    ARGO_SLICE *slices;
+    if (split_input(in, argo_max_depth, &slices, &count) == 0){
+        int ret = run_slices(in, out, slices, count, validate, argo_jobs);
+        free(slices);
+        return ret;
+    }
+    return validate ? argo_validate(in) : argo_write_events(in, out);
+}
+
+/*
+ * The elements read from one run by argo_read_value_split.
+ */
+typedef struct split_run {
+    ARGO_VALUE **elements;           // The elements, in order.
+    size_t count;                    // Number of elements.
+    size_t capacity;                 // Space for elements.
+} SPLIT_RUN;
+
+/*
+ * State shared by the threads of argo_read_value_split. Each thread takes the next
+ * run that no other thread has taken yet, until there are none left.
+ */
+typedef struct split_read {
+    ARGO_INPUT *in;                  // Input that holds the whole array.
+    ARGO_SLICE *slices;              // The runs.
+    SPLIT_RUN *runs;                 // What was read from each of them.
+    size_t count;                    // Number of runs.
+    size_t next;                     // Next run to be taken.
+    int failed;                      // Nonzero once a run has turned out to be invalid.
+    int utf8_strings;                // Whether strings are read as ARGO_UTF8 (as the context the array is read in says).
+} SPLIT_READ;
+
+/*
+ * A thread of argo_read_value_split, which reads its runs into an arena of its own.
+ */
+typedef struct split_thread {
+    pthread_t thread;
+    ARGO_CTX cx;                     // Context of the thread, whose arena the elements are read into.
+    SPLIT_READ *r;
+} SPLIT_THREAD;
+
+//Add an element to those read from a run, doubling the space for them if it is full
+static int add_element(SPLIT_RUN *run, ARGO_VALUE *v){
+    if (run->count == run->capacity){
+        size_t grown = run->capacity == 0 ? 256 : 2 * run->capacity;
+        ARGO_VALUE **e = realloc(run->elements, grown * sizeof(ARGO_VALUE *));
+        if (e == NULL) return -1;
+        run->elements = e;
+        run->capacity = grown;
+    }
+    *(run->elements + run->count++) = v;
+    return 0;
+}
+
+//Read the elements of run i into the arena of a context
+static int read_run(ARGO_CTX *cx, SPLIT_READ *r, size_t i){
+    ARGO_SLICE *s = r->slices + i;
+    ARGO_INPUT slice;
+    int ret = -1;
+    argo_input_open_mem(&slice, (const char *)(r->in->buf + r->in->pos + s->start), s->end - s->start);
+    //There is no point going on once another run is invalid
+    while (!__atomic_load_n(&r->failed, __ATOMIC_RELAXED)){
+        ARGO_VALUE *v = argo_ctx_read_value(cx, &slice);
+        if (v == NULL || add_element(r->runs + i, v)) break;
+        int c = argo_next_token(cx, &slice);
+        //The ',' or ']' that ends the run is its last byte
+        if ((c == ARGO_COMMA || c == ARGO_RBRACK) && slice.pos == slice.len) {ret = 0; break;}
+        if (c != ARGO_COMMA) break;
+    }
+    argo_input_close(&slice);
+    return ret;
+}
+
+//Body of a thread of argo_read_value_split
+static void *split_thread(void *arg){
+    SPLIT_THREAD *t = arg;
+    SPLIT_READ *r = t->r;
+    size_t i;
+    t->cx.utf8_strings = r->utf8_strings;
+    while ((i = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED)) < r->count){
+        if (read_run(&t->cx, r, i) == 0) continue;
+        __atomic_store_n(&r->failed, 1, __ATOMIC_RELAXED);
+        break;
+    }
+    return NULL;
+}
+
+//Make an array of the elements read from the runs, in order, in the arena of a context
+static ARGO_VALUE *splice_runs(ARGO_CTX *cx, SPLIT_RUN *runs, size_t count){
+    size_t total = 0, i, j, k = 0;
+    for (i = 0; i < count; i++) total += (runs+i)->count;
+    ARGO_VALUE *v = argo_ctx_value_alloc(cx), *h = argo_ctx_value_alloc(cx);
+    if (v == NULL || h == NULL) return NULL;
+    ARGO_VALUE **elements = argo_arena_alloc(cx->arena, total * sizeof(ARGO_VALUE *));
+    if (elements == NULL) return NULL;
+    v->type = ARGO_ARRAY_TYPE;
+    v->content.array.element_list = h;
+    v->content.array.elements = elements;
+    v->content.array.length = total;
+    h->next = h->prev = h;
+    for (i = 0; i < count; i++){
+        for (j = 0; j < (runs+i)->count; j++){
+            ARGO_VALUE *e = *((runs+i)->elements + j);
+            *(elements + k++) = e;
+            e->prev = h->prev;
+            e->next = h;
+            h->prev->next = e;
+            h->prev = e;
+        }
+    }
+    return v;
+}
+
+/*
+ * Read the runs of elements of an array with "jobs" threads, each with a context of its own,
+ * and make an array of them in a context cx. The arenas of the threads are moved into the arena
+ * of cx. NULL is returned if a run is invalid, without reporting why.
+ */
+static ARGO_VALUE *read_slices(ARGO_CTX *cx, ARGO_INPUT *in, ARGO_SLICE *slices, size_t count, int jobs){
+    SPLIT_READ r = {in, slices, calloc(count, sizeof(SPLIT_RUN)), count, 0, 0, cx->utf8_strings};
+    SPLIT_THREAD *threads = calloc(jobs, sizeof(SPLIT_THREAD));
+    ARGO_VALUE *v = NULL;
+    int started = 0, i;
+    if ((size_t)jobs > count) jobs = count;
+    if (r.runs == NULL || threads == NULL) r.failed = 1;
+    for (; !r.failed && started < jobs; started++){
+        SPLIT_THREAD *t = threads + started;
+        argo_ctx_init(&t->cx);
+        t->r = &r;
+        if (pthread_create(&t->thread, NULL, split_thread, t) == 0) continue;
+        argo_ctx_free(&t->cx);
+        r.failed = 1;
+        break;
+    }
+    for (i = 0; i < started; i++) pthread_join((threads+i)->thread, NULL);
+    debug("Read %lu runs of elements with %d threads\n", count, started);
+    if (!r.failed) v = splice_runs(cx, r.runs, count);
+    for (i = 0; i < started; i++){
+        if (v != NULL) argo_arena_adopt(cx->arena, (threads+i)->cx.arena);
+        argo_ctx_free(&(threads+i)->cx);
+    }
+    for (i = 0; r.runs != NULL && (size_t)i < count; i++) free((r.runs+i)->elements);
+    free(r.runs);
+    free(threads);
+    return v;
+}
+
+/**
+ * @brief  Check that an input is syntactically correct JSON, dividing the work among
+ * argo_jobs processes if the input is one large array.
+ * @details  The top level elements of the array are found by argo_split_array, and
+ * runs of them are validated in parallel. Errors are reported the same way as by
+ * argo_validate, which is used instead for any other input (or if argo_jobs is one,
+ * or there is a depth limit).
+ *
+ * @param in  Input from which JSON is to be read.
+ * @return  Zero if the input is valid, nonzero if there is any error.
+ */
+int argo_validate_split(ARGO_INPUT *in){
+    return run_split(in, stdout, true);
+}
+
+/**
+ * @brief  Write canonical JSON for the value read from an input, dividing the work
+ * among argo_jobs processes if the input is one large array.
+ * @details  The output (and any error) is the same as that of argo_write_events,
+ * which is used instead for any other input (or if argo_jobs is one, or there is a
+ * depth limit). The whole input is held in memory, so that the workers can be given
+ * their runs of elements without copying them.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @param out  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_write_split(ARGO_INPUT *in, FILE *out){
+    return run_split(in, out, false);
+}
+
+/**
+ * @brief  Read a value from an input, dividing the work among argo_jobs threads if
+ * the input is one large array.
+ * @details  The runs of elements found by argo_split_array are read by the threads,
+ * each into an arena of its own, and their elements are then put together into one
+ * array, whose arena (that of the default context) takes over the threads' arenas.
+ * argo_ctx_read_value_split does the same in another context.
+ * The value is the same as the one argo_read_value_input reads, which is used instead
+ * for any other input (or if argo_jobs is one, or there is a depth limit). If a run
+ * turns out to be invalid, the input is read again by argo_read_value_input, so that
+ * its first error is the one reported: the threads' own error messages are thrown away.
+ *
+ * @param in  Input from which JSON is to be read.
+ * @return  The value read, or NULL if there is any error.
+ */
+ARGO_VALUE *argo_read_value_split(ARGO_INPUT *in){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    ARGO_VALUE *v = argo_ctx_read_value_split(cx, in);
+    argo_default_ctx_leave(cx);
+    return v;
+}
+
+//Read a value from an input into the arena of a context, dividing the work among argo_jobs threads if it is one large array (see argo_read_value_split)
+ARGO_VALUE *argo_ctx_read_value_split(ARGO_CTX *cx, ARGO_INPUT *in){
+    size_t count;
+    ARGO_SLICE *slices;
+    if (split_input(in, cx->max_depth, &slices, &count)) return argo_ctx_read_value(cx, in);
+    ARGO_VALUE *v = NULL;
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO), null = open("/dev/null", O_WRONLY);
+    if (saved >= 0 && null >= 0 && dup2(null, STDERR_FILENO) >= 0){
+        v = read_slices(cx, in, slices, count, argo_jobs);
+        dup2(saved, STDERR_FILENO);
+    }
+    if (saved >= 0) close(saved);
+    if (null >= 0) close(null);
+    if (v != NULL) in->pos += (slices + count - 1)->end;
+    free(slices);
+    return v != NULL ? v : argo_ctx_read_value(cx, in);
+}
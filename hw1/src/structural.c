@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "ctx.h"
+#include "input.h"
+#include "structural.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ARGO_X86 1
+#endif
+
+//Classes of characters used by the lookup table for the scalar fallback
+#define CLASS_WS 0x01
+#define CLASS_NL 0x02
+#define CLASS_QUOTE 0x04
+#define CLASS_BSLASH 0x08
+#define CLASS_CTRL 0x10
+#define CLASS_OP 0x20
+
+static const unsigned char char_class[256] = {
+    [0 ... 31] = CLASS_CTRL,
+    [ARGO_HT] = CLASS_CTRL | CLASS_WS,
+    [ARGO_LF] = CLASS_CTRL | CLASS_WS | CLASS_NL,
+    [ARGO_CR] = CLASS_CTRL | CLASS_WS,
+    [ARGO_SPACE] = CLASS_WS,
+    [ARGO_QUOTE] = CLASS_QUOTE,
+    [ARGO_BSLASH] = CLASS_BSLASH,
+    [ARGO_LBRACE] = CLASS_OP, [ARGO_RBRACE] = CLASS_OP,
+    [ARGO_LBRACK] = CLASS_OP, [ARGO_RBRACK] = CLASS_OP,
+    [ARGO_COLON] = CLASS_OP, [ARGO_COMMA] = CLASS_OP
+};
+
+//Classify a block one byte at a time, for targets without SSE2. Unless "full" is set, only ws, nl and special are filled in
+static inline __attribute__((always_inline)) void scalar_masks(const unsigned char *p, ARGO_BLOCK_MASKS *m, bool full){
+    *m = (ARGO_BLOCK_MASKS){0};
+    int i;
+    for (i = 0; i < ARGO_BLOCK_SIZE; i++){
+        unsigned char c = *(char_class + *(p+i));
+        uint64_t bit = (uint64_t)1 << i;
+        if (c & CLASS_WS) m->ws |= bit;
+        if (c & CLASS_NL) m->nl |= bit;
+        if (c & (CLASS_QUOTE | CLASS_BSLASH | CLASS_CTRL)) m->special |= bit;
+        if (!full) continue;
+        if (c & CLASS_QUOTE) m->quote |= bit;
+        if (c & CLASS_BSLASH) m->bslash |= bit;
+        if (c & CLASS_CTRL) m->ctrl |= bit;
+        if (c & CLASS_OP) m->op |= bit;
+    }
+}
+
+static void classify_scalar(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    scalar_masks(p, m, true);
+}
+
+static void index_scalar(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    scalar_masks(p, m, false);
+}
+
+#if defined(ARGO_X86) && defined(__SSE2__)
+//Classify a block as four 16-byte vectors
+static inline __attribute__((always_inline)) void sse2_masks(const unsigned char *p, ARGO_BLOCK_MASKS *m, bool full){
+    *m = (ARGO_BLOCK_MASKS){0};
+    int i;
+    for (i = 0; i < 4; i++){
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16*i));
+        __m128i lf = _mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_LF));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_SPACE)), lf),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_HT)), _mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_CR))));
+        __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_QUOTE));
+        __m128i bslash = _mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_BSLASH));
+        //A byte is a control character if it is unchanged by taking the (unsigned) minimum with 0x1f
+        __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+        int shift = 16*i;
+        m->ws |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << shift;
+        m->nl |= (uint64_t)(uint16_t)_mm_movemask_epi8(lf) << shift;
+        m->special |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, bslash), ctrl)) << shift;
+        if (!full) continue;
+        //'{' | 0x20 is still '{' and '[' | 0x20 is '{', so one compare finds both (and likewise for '}' and ']')
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8(ARGO_LBRACE)), _mm_cmpeq_epi8(lower, _mm_set1_epi8(ARGO_RBRACE))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_COLON)), _mm_cmpeq_epi8(v, _mm_set1_epi8(ARGO_COMMA))));
+        m->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(quote) << shift;
+        m->bslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(bslash) << shift;
+        m->ctrl |= (uint64_t)(uint16_t)_mm_movemask_epi8(ctrl) << shift;
+        m->op |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << shift;
+    }
+}
+
+static void classify_sse2(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    sse2_masks(p, m, true);
+}
+
+static void index_sse2(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    sse2_masks(p, m, false);
+}
+
+//Classify a block as two 32-byte vectors, on CPUs that support AVX2
+__attribute__((target("avx2")))
+static inline __attribute__((always_inline)) void avx2_masks(const unsigned char *p, ARGO_BLOCK_MASKS *m, bool full){
+    *m = (ARGO_BLOCK_MASKS){0};
+    int i;
+    for (i = 0; i < 2; i++){
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + 32*i));
+        __m256i lf = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_LF));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_SPACE)), lf),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_HT)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_CR))));
+        __m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_QUOTE));
+        __m256i bslash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_BSLASH));
+        __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+        int shift = 32*i;
+        m->ws |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << shift;
+        m->nl |= (uint64_t)(uint32_t)_mm256_movemask_epi8(lf) << shift;
+        m->special |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(quote, bslash), ctrl)) << shift;
+        if (!full) continue;
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8(ARGO_LBRACE)), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8(ARGO_RBRACE))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_COLON)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ARGO_COMMA))));
+        m->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(quote) << shift;
+        m->bslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(bslash) << shift;
+        m->ctrl |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ctrl) << shift;
+        m->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    avx2_masks(p, m, true);
+}
+
+__attribute__((target("avx2")))
+static void index_avx2(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    avx2_masks(p, m, false);
+}
+#endif
+
+//Classifiers picked for this CPU the first time a block is classified (by whichever thread gets there first):
+//one that fills in all of the masks, and one that only fills in those that the index keeps
+static void (*classify)(const unsigned char *, ARGO_BLOCK_MASKS *);
+static void (*classify_index)(const unsigned char *, ARGO_BLOCK_MASKS *);
+
+//Pick the classifiers, if that hasn't been done yet
+static inline void pick_classifiers(void){
+    if (__atomic_load_n(&classify, __ATOMIC_ACQUIRE) != NULL) return;
+    void (*full)(const unsigned char *, ARGO_BLOCK_MASKS *) = classify_scalar;
+    void (*partial)(const unsigned char *, ARGO_BLOCK_MASKS *) = index_scalar;
+#if defined(ARGO_X86) && defined(__SSE2__)
+    bool avx2 = __builtin_cpu_supports("avx2");
+    full = avx2 ? classify_avx2 : classify_sse2;
+    partial = avx2 ? index_avx2 : index_sse2;
+#endif
+    __atomic_store_n(&classify_index, partial, __ATOMIC_RELAXED);
+    __atomic_store_n(&classify, full, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief  Classify the 64 bytes starting at p.
+ * @details  Uses AVX2 if the CPU supports it, SSE2 if the compiler targets it,
+ * and a lookup table otherwise. All 64 bytes must be readable.
+ *
+ * @param p  Start of the block.
+ * @param m  Masks to fill in.
+ */
+void argo_classify_block(const unsigned char *p, ARGO_BLOCK_MASKS *m){
+    pick_classifiers();
+    __atomic_load_n(&classify, __ATOMIC_RELAXED)(p, m);
+}
+
+/**
+ * @brief  Find the characters of a block that are escaped by a backslash.
+ * @details  A character is escaped if it follows an odd-length run of backslashes.
+ * Runs are found with a carrying add over the bits of the backslash mask, the same
+ * technique used by simdjson. The carry out tells whether the first byte of the
+ * next block is escaped.
+ *
+ * @param bslash  Mask of the backslashes in the block.
+ * @param prev_escaped  In: 1 if the first byte of this block is escaped. Out: same, for the next block.
+ * @return  Mask of the escaped characters in the block.
+ */
+uint64_t argo_find_escaped(uint64_t bslash, uint64_t *prev_escaped){
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    //A backslash that is itself escaped doesn't start a run
+    bslash &= ~*prev_escaped;
+    uint64_t follows_escape = (bslash << 1) | *prev_escaped;
+    uint64_t odd_starts = bslash & ~even_bits & ~follows_escape;
+    uint64_t even_starts;
+    *prev_escaped = __builtin_add_overflow(odd_starts, bslash, &even_starts);
+    uint64_t invert = even_starts << 1;
+    return (even_bits ^ invert) & follows_escape;
+}
+
+/**
+ * @brief  Compute the prefix xor of a mask.
+ * @details  Bit i of the result is the xor of bits 0 through i of x. Applied to the
+ * mask of unescaped quotes, this gives the bytes that are inside strings.
+ *
+ * @param x  Mask to scan.
+ * @return  The prefix xor of x.
+ */
+uint64_t argo_prefix_xor(uint64_t x){
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+//Index the next window of input, starting where the previous window ended
+static void index_next_window(ARGO_INPUT *in, ARGO_INDEX *x){
+    unsigned char padded[ARGO_BLOCK_SIZE];
+    size_t pos = x->end;
+    size_t blk;
+    x->base = pos;
+    pick_classifiers();
+    void (*classify_block)(const unsigned char *, ARGO_BLOCK_MASKS *) = __atomic_load_n(&classify_index, __ATOMIC_RELAXED);
+    for (blk = 0; blk < ARGO_INDEX_BLOCKS && pos < in->len; blk++){
+        const unsigned char *p = in->buf + pos;
+        size_t avail = in->len - pos;
+        //The last block of the available input is padded with NUL bytes, which are "special" and not whitespace,
+        //so a scan that reaches them stops there and lets argo_getc deal with the end of the buffer
+        if (avail < ARGO_BLOCK_SIZE){
+            size_t i;
+            for (i = 0; i < ARGO_BLOCK_SIZE; i++) *(padded+i) = i < avail ? *(p+i) : 0;
+            p = padded;
+        }
+        ARGO_BLOCK_MASKS m;
+        classify_block(p, &m);
+        *(x->ws + blk) = m.ws;
+        *(x->nl + blk) = m.nl;
+        *(x->special + blk) = m.special;
+        pos += avail < ARGO_BLOCK_SIZE ? avail : ARGO_BLOCK_SIZE;
+    }
+    x->end = pos;
+}
+
+//Return the index of the input, with a window that covers the next unread byte (or NULL if there is none)
+static ARGO_INDEX *index_window(ARGO_INPUT *in){
+    ARGO_INDEX *x = in->index;
+    if (in->pos >= in->len) return NULL;
+    if (x == NULL){
+        if ((x = malloc(sizeof(ARGO_INDEX))) == NULL) return NULL;
+        x->base = x->end = in->pos;
+        in->index = x;
+    }
+    //If the input was refilled, the window no longer lines up with the buffer, so start over from here
+    if (in->pos < x->base) x->base = x->end = in->pos;
+    while (in->pos >= x->end) index_next_window(in, x);
+    return x;
+}
+
+//Return the index if its window already covers the next unread byte, which is almost always the case
+static inline ARGO_INDEX *index_for(ARGO_INPUT *in){
+    ARGO_INDEX *x = in->index;
+    if (x != NULL && in->pos >= x->base && in->pos < x->end) return x;
+    return index_window(in);
+}
+
+//Account for "count" skipped bytes starting at bit "bit" of newline mask "nl"
+static void count_lines(ARGO_CTX *cx, uint64_t nl, size_t bit, size_t count){
+    uint64_t m = nl >> bit;
+    if (count < ARGO_BLOCK_SIZE) m &= ((uint64_t)1 << count) - 1;
+    if (m == 0){
+        cx->chars_read += count;
+        return;
+    }
+    cx->lines_read += __builtin_popcountll(m);
+    //Only the bytes after the last newline count towards the current line
+    cx->chars_read = count - (ARGO_BLOCK_SIZE - __builtin_clzll(m));
+}
+
+/**
+ * @brief  Skip whitespace and return the next character of input.
+ * @details  The whitespace is found with the index rather than one character
+ * at a time, and the context's line and character counts are updated for the skipped
+ * newlines. The character that is returned has been consumed, as if by argo_getc.
+ *
+ * @param cx  Context whose counts are updated.
+ * @param in  Input to read from.
+ * @return  The first non-whitespace character, or EOF if the input ends first.
+ */
+int argo_next_token(ARGO_CTX *cx, ARGO_INPUT *in){
+    //Most tokens aren't preceded by whitespace at all, so check for that before going to the index
+    if (in->pos < in->len && !argo_is_whitespace(*(in->buf + in->pos))){
+        cx->chars_read++;
+        return *(in->buf + in->pos++);
+    }
+    while (true){
+        //Make sure there is something to look at (this refills the buffer if needed)
+        if (in->pos >= in->len && argo_peek(in, 0) == EOF) return EOF;
+        ARGO_INDEX *x = index_for(in);
+        if (x == NULL) return argo_getc(in);
+        size_t off = in->pos - x->base;
+        size_t blk = off / ARGO_BLOCK_SIZE, bit = off % ARGO_BLOCK_SIZE;
+        uint64_t nonws = ~*(x->ws + blk) >> bit;
+        if (nonws != 0){
+            size_t skip = __builtin_ctzll(nonws);
+            count_lines(cx, *(x->nl + blk), bit, skip);
+            in->pos += skip;
+            //The scan may have stopped at the padding after the end of the buffer
+            if (in->pos < in->len){
+                cx->chars_read++;
+                return argo_getc(in);
+            }
+        }
+        else{
+            count_lines(cx, *(x->nl + blk), bit, ARGO_BLOCK_SIZE - bit);
+            in->pos += ARGO_BLOCK_SIZE - bit;
+        }
+    }
+}
+
+/**
+ * @brief  Measure the run of string content that can be copied verbatim.
+ * @details  Returns the number of bytes, starting at the next unread byte, that
+ * contain no quote, backslash, or control character. Nothing is consumed.
+ * The result may be short of the actual run if it crosses the end of the
+ * indexed window, so callers should simply ask again after consuming it.
+ *
+ * @param in  Input to read from.
+ * @return  Length of the verbatim run (zero if the next byte is special or not yet available).
+ */
+size_t argo_string_span(ARGO_INPUT *in){
+    ARGO_INDEX *x = index_for(in);
+    if (x == NULL) return 0;
+    size_t off = in->pos - x->base;
+    size_t span = 0;
+    while (x->base + off < x->end){
+        size_t blk = off / ARGO_BLOCK_SIZE, bit = off % ARGO_BLOCK_SIZE;
+        uint64_t special = *(x->special + blk) >> bit;
+        if (special != 0) return span + __builtin_ctzll(special);
+        span += ARGO_BLOCK_SIZE - bit;
+        off += ARGO_BLOCK_SIZE - bit;
+    }
+    //Don't count anything past the end of the window
+    return x->end - in->pos < span ? x->end - in->pos : span;
+}
+
+/**
+ * @brief  Note that the bytes of an input have moved.
+ * @details  Called when the input buffer is refilled. The next query re-indexes
+ * from the current position.
+ *
+ * @param in  Input whose buffer was refilled.
+ */
+void argo_index_invalidate(ARGO_INPUT *in){
+    if (in->index == NULL) return;
+    in->index->base = in->index->end = (size_t)-1;
+}
+
+/**
+ * @brief  Give an input an index that was detached from another input, so that it is reused.
+ * @details  This saves allocating a new index for each of a series of short inputs,
+ * such as the records of newline-delimited JSON. The index starts out empty, with
+ * the input's current position outside of any string.
+ *
+ * @param in  Input that doesn't have an index yet.
+ * @param x  Index returned by argo_index_detach (or NULL, in which case one is allocated on first use).
+ */
+void argo_index_attach(ARGO_INPUT *in, ARGO_INDEX *x){
+    if (x != NULL) x->base = x->end = in->pos;
+    in->index = x;
+}
+
+/**
+ * @brief  Take the index away from an input, so that it can be given to another one.
+ *
+ * @param in  Input whose index is no longer needed.
+ * @return  The index, to be passed to argo_index_attach (or freed), or NULL if the input didn't have one.
+ */
+ARGO_INDEX *argo_index_detach(ARGO_INPUT *in){
+    ARGO_INDEX *x = in->index;
+    in->index = NULL;
+    return x;
+}
+
+/**
+ * @brief  Free the index of an input.
+ *
+ * @param in  Input whose index is no longer needed.
+ */
+void argo_index_free(ARGO_INPUT *in){
+    free(in->index);
+    in->index = NULL;
+}
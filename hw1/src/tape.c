@@ -0,0 +1,869 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "utf8.h"
+#include "input.h"
+#include "writer.h"
+#include "events.h"
+#include "tape.h"
+
+//Initial capacity of the entries, and of the text, of a tape being saved (both double as needed)
+#define TAPE_FIRST_ENTRIES 1024
+#define TAPE_FIRST_TEXT 4096
+
+//Largest entry index that the start of a container can hold
+#define TAPE_MAX_INDEX 0xFFFFFFFFULL
+
+//Make an entry from a tag and a payload
+#define tape_entry(tag, payload) (((uint64_t)(tag) << 56) | (uint64_t)(payload))
+
+//Add an entry to a tape being built
+static int build_entry(ARGO_TAPE_BUILDER *b, uint64_t e){
+    if (b->count == b->size){
+        size_t size = b->size ? 2 * b->size : TAPE_FIRST_ENTRIES;
+        uint64_t *grown = realloc(b->entries, size * sizeof(uint64_t));
+        if (grown == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for the tape\n");
+            return -1;
+        }
+        b->entries = grown;
+        b->size = size;
+    }
+    *(b->entries + b->count++) = e;
+    return 0;
+}
+
+//Add the text of a string (its length, then its data, padded to a multiple of four bytes) and return its offset, or -1.
+//If data is NULL, then space is left for the caller to fill in
+static long build_text(ARGO_TAPE_BUILDER *b, const void *data, size_t length, size_t bytes){
+    if (length > UINT32_MAX){
+        fprintf(stderr, "Error: String is too long for a tape\n");
+        return -1;
+    }
+    size_t need = sizeof(uint32_t) + ((bytes + 3) & ~(size_t)3);
+    if (b->capacity - b->length < need){
+        size_t capacity = b->capacity ? b->capacity : TAPE_FIRST_TEXT;
+        while (capacity - b->length < need) capacity *= 2;
+        unsigned char *grown = realloc(b->text, capacity);
+        if (grown == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for the tape\n");
+            return -1;
+        }
+        b->text = grown;
+        b->capacity = capacity;
+    }
+    long offset = b->length;
+    uint32_t n = length;
+    __builtin_memcpy(b->text + b->length, &n, sizeof(n));
+    if (data != NULL && bytes > 0) __builtin_memcpy(b->text + b->length + sizeof(n), data, bytes);
+    __builtin_memset(b->text + b->length + sizeof(n) + bytes, 0, need - sizeof(n) - bytes);
+    b->length += need;
+    return offset;
+}
+
+//Add a string entry for an ARGO_STRING, as bytes if all of its characters fit in one
+static int build_string(ARGO_TAPE_BUILDER *b, ARGO_STRING *s){
+    size_t i;
+    for (i = 0; i < s->length; i++){
+        if (*(s->content+i) < 0 || *(s->content+i) > 0xFF) break;
+    }
+    long offset;
+    if (i < s->length){
+        offset = build_text(b, s->content, s->length, s->length * sizeof(uint32_t));
+        return offset < 0 ? -1 : build_entry(b, tape_entry(ARGO_TAPE_WIDE, offset));
+    }
+    offset = build_text(b, NULL, s->length, s->length);
+    if (offset < 0) return -1;
+    unsigned char *out = b->text + offset + sizeof(uint32_t);
+    for (i = 0; i < s->length; i++) *(out+i) = *(s->content+i);
+    return build_entry(b, tape_entry(ARGO_TAPE_BYTES, offset));
+}
+
+//Add the entries for a number (the integer, if there is one, or else the double)
+static int build_number(ARGO_TAPE_BUILDER *b, ARGO_NUMBER *n){
+    uint64_t bits;
+    if (n->valid_int){
+        if (build_entry(b, tape_entry(ARGO_TAPE_INT, 0))) return -1;
+        return build_entry(b, (uint64_t)n->int_value);
+    }
+    if (!n->valid_float){
+        fprintf(stderr, "Error: Number has no value to put on a tape\n");
+        return -1;
+    }
+    __builtin_memcpy(&bits, &n->float_value, sizeof(bits));
+    if (build_entry(b, tape_entry(ARGO_TAPE_DOUBLE, 0))) return -1;
+    return build_entry(b, bits);
+}
+
+//Add the start of a container, which is filled in when it is closed
+static int build_open(ARGO_TAPE_BUILDER *b, int tag){
+    if (b->depth == b->open_size){
+        size_t size = b->open_size ? 2 * b->open_size : ARGO_EVENT_STACK;
+        size_t *grown = realloc(b->open, size * sizeof(size_t));
+        if (grown == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for nesting depth %lu\n", b->depth);
+            return -1;
+        }
+        b->open = grown;
+        b->open_size = size;
+    }
+    *(b->open + b->depth++) = b->count;
+    return build_entry(b, tape_entry(tag, 0));
+}
+
+//Count one more element (or member) of the innermost open container
+static void build_count(ARGO_TAPE_BUILDER *b){
+    uint64_t *start = b->entries + *(b->open + b->depth - 1);
+    if (((*start >> 32) & ARGO_TAPE_MAX_COUNT) < ARGO_TAPE_MAX_COUNT) *start += (uint64_t)1 << 32;
+}
+
+//Add the end of the innermost open container, and record it in the container's start
+static int build_close(ARGO_TAPE_BUILDER *b){
+    size_t start = *(b->open + --b->depth);
+    if (b->count + 1 > TAPE_MAX_INDEX){
+        fprintf(stderr, "Error: Document is too large for a tape\n");
+        return -1;
+    }
+    int tag = argo_tape_tag(*(b->entries + start));
+    if (build_entry(b, tape_entry(tag == ARGO_TAPE_OBJECT ? ARGO_TAPE_OBJECT_END : ARGO_TAPE_ARRAY_END, start))) return -1;
+    *(b->entries + start) |= b->count;
+    return 0;
+}
+
+//Make room on one of the stacks below for one more frame (its capacity doubles as needed)
+static int tape_stack_grow(void **stack, size_t used, size_t *size, size_t width){
+    if (used < *size) return 0;
+    size_t n = *size == 0 ? ARGO_EVENT_STACK : *size * 2;
+    void *grown = realloc(*stack, n * width);
+    if (grown == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for nesting depth %lu\n", used);
+        return -1;
+    }
+    *stack = grown;
+    *size = n;
+    return 0;
+}
+
+//A container that build_value has open, with the member or element it is at (its frame is level with the container's start on the builder's stack)
+typedef struct save_frame {
+    ARGO_VALUE *sentinel;            // Sentinel of the container's member or element list.
+    ARGO_VALUE *child;               // Member or element reached so far (the sentinel before the first).
+} SAVE_FRAME;
+
+//Add the entries of a scalar value to a tape being built
+static int build_scalar(ARGO_TAPE_BUILDER *b, ARGO_VALUE *v){
+    long offset;
+    switch (v->type){
+        case ARGO_BASIC_TYPE:
+            return build_entry(b, tape_entry(v->content.basic == ARGO_TRUE ? ARGO_TAPE_TRUE :
+                                             v->content.basic == ARGO_FALSE ? ARGO_TAPE_FALSE : ARGO_TAPE_NULL, 0));
+        case ARGO_NUMBER_TYPE:
+            return build_number(b, &v->content.number);
+        case ARGO_STRING_TYPE:
+            return build_string(b, &v->content.string);
+        case ARGO_UTF8_TYPE:
+            offset = build_text(b, argo_utf8_bytes(&v->content.utf8), v->content.utf8.length, v->content.utf8.length);
+            return offset < 0 ? -1 : build_entry(b, tape_entry(ARGO_TAPE_BYTES, offset));
+        default:
+            fprintf(stderr, "Error: Value of unknown type %d can't be put on a tape\n", v->type);
+            return -1;
+    }
+}
+
+//Sentinel of the member or element list of a container
+#define list_of(v) ((v)->type == ARGO_OBJECT_TYPE ? (v)->content.object.member_list : (v)->content.array.element_list)
+
+//Add the entries of a value (and everything in it) to a tape being built.
+//Nested containers don't recurse: each one that is open has a frame on the builder's saved stack
+static int build_value(ARGO_TAPE_BUILDER *b, ARGO_VALUE *v){
+    size_t base = b->depth;
+    while (v != NULL){
+        if (v->type == ARGO_OBJECT_TYPE || v->type == ARGO_ARRAY_TYPE){
+            if (build_open(b, v->type == ARGO_OBJECT_TYPE ? ARGO_TAPE_OBJECT : ARGO_TAPE_ARRAY)) return -1;
+            if (tape_stack_grow((void **)&b->saved, b->depth - 1, &b->saved_size, sizeof(SAVE_FRAME))) return -1;
+            SAVE_FRAME *f = b->saved + b->depth - 1;
+            f->sentinel = list_of(v);
+            f->child = f->sentinel;
+        }
+        else if (build_scalar(b, v)) return -1;
+        //Move on to the next member or element of the innermost open container, closing each container that has none left
+        v = NULL;
+        while (v == NULL && b->depth > base){
+            SAVE_FRAME *f = b->saved + b->depth - 1;
+            bool object = argo_tape_tag(*(b->entries + *(b->open + b->depth - 1))) == ARGO_TAPE_OBJECT;
+            f->child = f->child->next;
+            if (f->child == f->sentinel){
+                if (build_close(b)) return -1;
+                continue;
+            }
+            build_count(b);
+            //A name without content takes no text, and is read back as an empty one
+            if (object && (f->child->name.content == NULL ? build_entry(b, tape_entry(ARGO_TAPE_BYTES, ARGO_TAPE_NO_TEXT))
+                                                          : build_string(b, &f->child->name))) return -1;
+            v = f->child;
+        }
+    }
+    return 0;
+}
+
+//Count a value as an element of the innermost open container, if that is an array (members are counted by their names)
+static void build_element(ARGO_TAPE_BUILDER *b){
+    if (b->depth > 0 && argo_tape_tag(*(b->entries + *(b->open + b->depth - 1))) == ARGO_TAPE_ARRAY) build_count(b);
+}
+
+//Callbacks of argo_tape_handler, which add each value to the tape as it is read
+static int tape_start_object(void *ctx) {build_element(ctx); return build_open(ctx, ARGO_TAPE_OBJECT);}
+static int tape_start_array(void *ctx) {build_element(ctx); return build_open(ctx, ARGO_TAPE_ARRAY);}
+static int tape_end(void *ctx) {return build_close(ctx);}
+static int tape_key(void *ctx, ARGO_STRING *name) {build_count(ctx); return build_string(ctx, name);}
+static int tape_string(void *ctx, ARGO_STRING *s) {build_element(ctx); return build_string(ctx, s);}
+static int tape_number(void *ctx, ARGO_NUMBER *n) {build_element(ctx); return build_number(ctx, n);}
+
+static int tape_basic(void *ctx, ARGO_BASIC v){
+    build_element(ctx);
+    return build_entry(ctx, tape_entry(v == ARGO_TRUE ? ARGO_TAPE_TRUE : v == ARGO_FALSE ? ARGO_TAPE_FALSE : ARGO_TAPE_NULL, 0));
+}
+
+const ARGO_HANDLER argo_tape_handler = {
+    tape_start_object, tape_end, tape_start_array, tape_end,
+    tape_key, tape_string, tape_number, tape_basic
+};
+
+/**
+ * @brief  Start building a tape.
+ * @details  Values are added to the tape by a parser that reports its events to
+ * argo_tape_handler with the builder as its context (or by argo_tape_save).
+ *
+ * @param b  Builder to open.
+ */
+void argo_tape_builder_open(ARGO_TAPE_BUILDER *b){
+    b->entries = NULL;
+    b->count = 0;
+    b->size = 0;
+    b->text = NULL;
+    b->length = 0;
+    b->capacity = 0;
+    b->open = NULL;
+    b->depth = 0;
+    b->open_size = 0;
+    b->saved = NULL;
+    b->saved_size = 0;
+}
+
+/**
+ * @brief  Hand the tape that a builder has built over to an ARGO_TAPE, so that it can be read.
+ * @details  The space of the tape is trimmed to fit, and belongs to the tape from then on
+ * (it is freed by argo_tape_close). The builder is left empty, ready to build another tape.
+ *
+ * @param b  Builder holding the tape.
+ * @param t  Tape to open on what was built.
+ * @return  Zero if successful, nonzero if nothing was built or a container is still open.
+ */
+int argo_tape_builder_finish(ARGO_TAPE_BUILDER *b, ARGO_TAPE *t){
+    if (b->count == 0 || b->depth > 0){
+        fprintf(stderr, "Error: Tape has no complete value\n");
+        return -1;
+    }
+    uint64_t *entries = realloc(b->entries, b->count * sizeof(uint64_t));
+    unsigned char *text = b->length > 0 ? realloc(b->text, b->length) : b->text;
+    t->entries = entries != NULL ? entries : b->entries;
+    t->count = b->count;
+    t->text = text != NULL ? text : b->text;
+    t->length = b->length;
+    t->map = NULL;
+    t->map_len = 0;
+    t->owned = true;
+    b->entries = NULL;
+    b->text = NULL;
+    b->count = b->size = b->length = b->capacity = 0;
+    return 0;
+}
+
+/**
+ * @brief  Free the space held by a builder (apart from any tape already handed over).
+ *
+ * @param b  Builder to close.
+ */
+void argo_tape_builder_close(ARGO_TAPE_BUILDER *b){
+    free(b->entries);
+    free(b->text);
+    free(b->open);
+    free(b->saved);
+    argo_tape_builder_open(b);
+}
+
+/**
+ * @brief  Read one JSON value from an input onto a tape, without building argo values.
+ * @details  The input is parsed by argo_parse_events, and each value is added to the
+ * tape as it is read. A scalar takes 8 bytes (16 for a number), and a string 8 bytes
+ * plus its text, against the ARGO_VALUE (and separately stored name) that each value
+ * of a tree takes. The values can then be visited in order with an ARGO_TAPE_ITER, or
+ * looked up with the other argo_tape_ functions. Errors are reported as for argo_read_value.
+ *
+ * @param t  Tape to open on the value.
+ * @param in  Input from which JSON is to be read.
+ * @return  Zero if successful, nonzero if there is any error.
+ */
+int argo_read_tape(ARGO_TAPE *t, ARGO_INPUT *in){
+    ARGO_TAPE_BUILDER b;
+    argo_tape_builder_open(&b);
+    int ret = argo_parse_events(in, &argo_tape_handler, &b) || argo_tape_builder_finish(&b, t);
+    argo_tape_builder_close(&b);
+    return ret ? -1 : 0;
+}
+
+//Write a header and the entries and text of a tape to a stream
+static int tape_write_file(const uint64_t *entries, size_t count, const unsigned char *text, size_t length, FILE *out){
+    ARGO_TAPE_HEADER h;
+    __builtin_memcpy(h.magic, ARGO_TAPE_MAGIC, sizeof(h.magic));
+    h.version = ARGO_TAPE_VERSION;
+    h.order = ARGO_TAPE_ORDER;
+    h.entries = count;
+    h.text = length;
+    if (fwrite(&h, sizeof(h), 1, out) != 1 || fwrite(entries, sizeof(uint64_t), count, out) != count
+        || fwrite(text, 1, length, out) != length){
+        fprintf(stderr, "Error: Failed to write the tape\n");
+        return -1;
+    }
+    debug("Saved a tape of %lu entries and %lu bytes of text\n", count, length);
+    return 0;
+}
+
+/**
+ * @brief  Save a value as a binary tape.
+ * @details  The tape is put together in memory and then written to the stream,
+ * header first. It can be read back with argo_tape_load (on a machine with the
+ * same byte order) without any parsing. Everything needed to write the value
+ * out again is kept, so argo_tape_write_value writes exactly what argo_write_value
+ * would have written for the value itself. Numbers keep only the representation
+ * that is written out (the integer, if there is one, or else the double).
+ *
+ * @param v  Value to save.
+ * @param out  Stream to write the tape to.
+ * @return  Zero if successful, nonzero if there is any error.
+ */
+int argo_tape_save(ARGO_VALUE *v, FILE *out){
+    ARGO_TAPE_BUILDER b;
+    argo_tape_builder_open(&b);
+    int ret = build_value(&b, v);
+    if (ret == 0) ret = tape_write_file(b.entries, b.count, b.text, b.length, out);
+    argo_tape_builder_close(&b);
+    return ret;
+}
+
+/**
+ * @brief  Save a tape that is open (such as one read by argo_read_tape) to a stream.
+ * @details  The file is the same as argo_tape_save writes, and is loaded with argo_tape_load.
+ *
+ * @param t  Tape to save.
+ * @param out  Stream to write the tape to.
+ * @return  Zero if successful, nonzero if there is any error.
+ */
+int argo_tape_dump(ARGO_TAPE *t, FILE *out){
+    return tape_write_file(t->entries, t->count, t->text, t->length, out);
+}
+
+/**
+ * @brief  Open a tape that is already in memory.
+ * @details  Only the header is checked, so opening takes constant time: the
+ * entries are trusted to be as argo_tape_save wrote them. The buffer must be
+ * aligned to 8 bytes, and must not change or go away while the tape is open.
+ *
+ * @param t  Tape to open.
+ * @param buf  Contents of a tape file.
+ * @param len  Number of bytes in buf.
+ * @return  Zero if successful, nonzero if buf doesn't hold a tape that can be read here.
+ */
+int argo_tape_open_mem(ARGO_TAPE *t, const void *buf, size_t len){
+    const ARGO_TAPE_HEADER *h = buf;
+    t->map = NULL;
+    t->map_len = 0;
+    t->owned = false;
+    if (len < sizeof(*h) || __builtin_memcmp(h->magic, ARGO_TAPE_MAGIC, sizeof(h->magic)) != 0){
+        fprintf(stderr, "Error: Input is not an argo tape\n");
+        return -1;
+    }
+    if (h->version != ARGO_TAPE_VERSION || h->order != ARGO_TAPE_ORDER){
+        fprintf(stderr, "Error: Tape was saved in a format (or byte order) that can't be read here\n");
+        return -1;
+    }
+    size_t body = len - sizeof(*h);
+    if (h->entries == 0 || h->entries > body / sizeof(uint64_t) || h->text != body - h->entries * sizeof(uint64_t)){
+        fprintf(stderr, "Error: Tape is truncated or corrupt\n");
+        return -1;
+    }
+    t->entries = (const uint64_t *)(h + 1);
+    t->count = h->entries;
+    t->text = (const unsigned char *)(t->entries + t->count);
+    t->length = h->text;
+    return 0;
+}
+
+/**
+ * @brief  Load a tape from a file by mapping it into memory.
+ * @details  Nothing is read or copied when the tape is loaded; pages of the file
+ * are brought in as the values on them are visited. The whole of the file must
+ * be a tape, and the stream can be closed once the tape has been loaded.
+ *
+ * @param t  Tape to load.
+ * @param f  Stream open on a tape file (which must be a regular file).
+ * @return  Zero if successful, nonzero if the file couldn't be mapped or isn't a tape.
+ */
+int argo_tape_load(ARGO_TAPE *t, FILE *f){
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0){
+        fprintf(stderr, "Error: Tape must be a regular file\n");
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (map == MAP_FAILED){
+        fprintf(stderr, "Error: Failed to map the tape\n");
+        return -1;
+    }
+    if (argo_tape_open_mem(t, map, st.st_size)){
+        munmap(map, st.st_size);
+        return -1;
+    }
+    t->map = map;
+    t->map_len = st.st_size;
+    debug("Mapped a tape of %lu entries and %lu bytes of text\n", t->count, t->length);
+    return 0;
+}
+
+/**
+ * @brief  Close a tape, unmapping it if it was loaded from a file, or freeing it if it was built in memory.
+ *
+ * @param t  Tape to close.
+ */
+void argo_tape_close(ARGO_TAPE *t){
+    if (t->map != NULL) munmap(t->map, t->map_len);
+    if (t->owned){
+        free((void *)t->entries);
+        free((void *)t->text);
+    }
+    t->owned = false;
+    t->map = NULL;
+    t->map_len = 0;
+    t->entries = NULL;
+    t->count = 0;
+    t->text = NULL;
+    t->length = 0;
+}
+
+//Tag of an entry, or zero if there is no such entry
+static inline int entry_tag(ARGO_TAPE *t, size_t v){
+    return v < t->count ? argo_tape_tag(*(t->entries+v)) : 0;
+}
+
+//Find the text of a string entry, returning its data and setting *length to its length, or NULL if the entry is corrupt
+static const unsigned char *entry_text(ARGO_TAPE *t, size_t v, size_t *length){
+    uint64_t offset = argo_tape_payload(*(t->entries+v));
+    uint32_t n;
+    *length = 0;
+    if (offset == ARGO_TAPE_NO_TEXT) return (const unsigned char *)"";
+    if (offset > t->length || t->length - offset < sizeof(n)) return NULL;
+    __builtin_memcpy(&n, t->text + offset, sizeof(n));
+    size_t bytes = argo_tape_tag(*(t->entries+v)) == ARGO_TAPE_WIDE ? (size_t)n * sizeof(uint32_t) : n;
+    if (t->length - offset - sizeof(n) < bytes) return NULL;
+    *length = n;
+    return t->text + offset + sizeof(n);
+}
+
+/**
+ * @brief  Get the type of a value on a tape.
+ *
+ * @param t  Tape the value is on.
+ * @param v  Index of the value.
+ * @return  Its type (ARGO_STRING_TYPE for strings of either kind),
+ * or ARGO_NO_TYPE if v isn't the index of a value.
+ */
+ARGO_VALUE_TYPE argo_tape_type(ARGO_TAPE *t, size_t v){
+    switch (entry_tag(t, v)){
+        case ARGO_TAPE_NULL: case ARGO_TAPE_TRUE: case ARGO_TAPE_FALSE: return ARGO_BASIC_TYPE;
+        case ARGO_TAPE_INT: case ARGO_TAPE_DOUBLE: return ARGO_NUMBER_TYPE;
+        case ARGO_TAPE_BYTES: case ARGO_TAPE_WIDE: return ARGO_STRING_TYPE;
+        case ARGO_TAPE_OBJECT: return ARGO_OBJECT_TYPE;
+        case ARGO_TAPE_ARRAY: return ARGO_ARRAY_TYPE;
+        default: return ARGO_NO_TYPE;
+    }
+}
+
+/**
+ * @brief  Find the entry just after a value on a tape.
+ * @details  Containers are skipped in one step, so this is how the elements
+ * of an array (or the names and values of an object) are stepped through.
+ *
+ * @param t  Tape the value is on.
+ * @param v  Index of the value.
+ * @return  Index of the entry after it, or ARGO_TAPE_NONE if v isn't the index of an entry.
+ */
+size_t argo_tape_next(ARGO_TAPE *t, size_t v){
+    switch (entry_tag(t, v)){
+        case 0: return ARGO_TAPE_NONE;
+        case ARGO_TAPE_INT: case ARGO_TAPE_DOUBLE: return v + 2;
+        case ARGO_TAPE_OBJECT: case ARGO_TAPE_ARRAY: return *(t->entries+v) & TAPE_MAX_INDEX;
+        default: return v + 1;
+    }
+}
+
+/**
+ * @brief  Get a basic value (true, false, or null) from a tape.
+ *
+ * @param t  Tape the value is on.
+ * @param v  Index of the value.
+ * @return  The value, or ARGO_NULL if v isn't a basic value.
+ */
+ARGO_BASIC argo_tape_basic(ARGO_TAPE *t, size_t v){
+    int tag = entry_tag(t, v);
+    return tag == ARGO_TAPE_TRUE ? ARGO_TRUE : tag == ARGO_TAPE_FALSE ? ARGO_FALSE : ARGO_NULL;
+}
+
+/**
+ * @brief  Get a number from a tape.
+ * @details  An integer has both its integer and floating point values set, and
+ * any other number only its floating point value. The text of the number isn't kept.
+ *
+ * @param t  Tape the value is on.
+ * @param v  Index of the value.
+ * @param n  Number to fill in.
+ * @return  Zero if successful, nonzero if v isn't a number.
+ */
+int argo_tape_number(ARGO_TAPE *t, size_t v, ARGO_NUMBER *n){
+    int tag = entry_tag(t, v);
+    if ((tag != ARGO_TAPE_INT && tag != ARGO_TAPE_DOUBLE) || v + 1 >= t->count) return -1;
+    uint64_t bits = *(t->entries+v+1);
+    n->string_value.capacity = 0;
+    n->string_value.length = 0;
+    n->string_value.content = NULL;
+    n->valid_string = 0;
+    n->valid_float = 1;
+    if (tag == ARGO_TAPE_INT){
+        n->int_value = (long)bits;
+        n->float_value = (double)n->int_value;
+        n->valid_int = 1;
+    }
+    else {
+        __builtin_memcpy(&n->float_value, &bits, sizeof(bits));
+        n->int_value = 0;
+        n->valid_int = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Get the bytes of a string (or member name) on a tape, where they lie.
+ * @details  This is the text of the string if every character of it is below
+ * 0x100 (such as a string read with argo_utf8_strings set, or without \u escapes),
+ * with one byte for each character.
+ *
+ * @param t  Tape the string is on.
+ * @param v  Index of the string.
+ * @param length  Set to the number of bytes.
+ * @return  The bytes (not null terminated), or NULL if v isn't a string that is held
+ * as bytes (in which case argo_tape_chars has to be used to get its characters).
+ */
+const unsigned char *argo_tape_bytes(ARGO_TAPE *t, size_t v, size_t *length){
+    *length = 0;
+    if (entry_tag(t, v) != ARGO_TAPE_BYTES) return NULL;
+    return entry_text(t, v, length);
+}
+
+/**
+ * @brief  Append the characters of a string (or member name) on a tape to an ARGO_STRING.
+ *
+ * @param t  Tape the string is on.
+ * @param v  Index of the string.
+ * @param out  String to append the characters to.
+ * @return  Zero if successful, nonzero if v isn't a string or space couldn't be allocated.
+ */
+int argo_tape_chars(ARGO_TAPE *t, size_t v, ARGO_STRING *out){
+    int tag = entry_tag(t, v);
+    size_t length, i;
+    if (tag != ARGO_TAPE_BYTES && tag != ARGO_TAPE_WIDE) return -1;
+    const unsigned char *text = entry_text(t, v, &length);
+    if (text == NULL) return -1;
+    for (i = 0; i < length; i++){
+        ARGO_CHAR c;
+        if (tag == ARGO_TAPE_WIDE) __builtin_memcpy(&c, text + i * sizeof(c), sizeof(c));
+        else c = *(text+i);
+        if (argo_append_char(out, c)) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Get the number of elements of an array on a tape.
+ * @details  This takes constant time, unless the array has more than
+ * ARGO_TAPE_MAX_COUNT elements, in which case they are counted.
+ *
+ * @param t  Tape the array is on.
+ * @param v  Index of the array.
+ * @return  The number of elements, or zero if v isn't an array.
+ */
+size_t argo_tape_array_len(ARGO_TAPE *t, size_t v){
+    if (entry_tag(t, v) != ARGO_TAPE_ARRAY) return 0;
+    size_t count = argo_tape_payload(*(t->entries+v)) >> 32;
+    if (count < ARGO_TAPE_MAX_COUNT) return count;
+    size_t e;
+    for (count = 0, e = v + 1; entry_tag(t, e) != ARGO_TAPE_ARRAY_END && e < t->count; e = argo_tape_next(t, e)) count++;
+    return count;
+}
+
+/**
+ * @brief  Get an element of an array on a tape by its position.
+ * @details  The elements before it are skipped one at a time (skipping any
+ * containers among them in one step), so this takes time proportional to i.
+ * To scan the elements in order, step from the first to the next with argo_tape_next.
+ *
+ * @param t  Tape the array is on.
+ * @param v  Index of the array.
+ * @param i  Position of the element (from zero).
+ * @return  Index of the element, or ARGO_TAPE_NONE if there is no such element.
+ */
+size_t argo_tape_array_at(ARGO_TAPE *t, size_t v, size_t i){
+    if (entry_tag(t, v) != ARGO_TAPE_ARRAY) return ARGO_TAPE_NONE;
+    size_t e = v + 1;
+    for (; i > 0 && e < t->count && entry_tag(t, e) != ARGO_TAPE_ARRAY_END; i--) e = argo_tape_next(t, e);
+    if (e >= t->count || entry_tag(t, e) == ARGO_TAPE_ARRAY_END) return ARGO_TAPE_NONE;
+    return e;
+}
+
+//Check whether a member name on a tape is exactly the given bytes
+static bool tape_name_equal(ARGO_TAPE *t, size_t name, const unsigned char *key, size_t length){
+    size_t n, i;
+    const unsigned char *text = entry_text(t, name, &n);
+    if (text == NULL || n != length) return false;
+    if (entry_tag(t, name) == ARGO_TAPE_BYTES) return __builtin_memcmp(text, key, length) == 0;
+    for (i = 0; i < length; i++){
+        ARGO_CHAR c;
+        __builtin_memcpy(&c, text + i * sizeof(c), sizeof(c));
+        if (c != *(key+i)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief  Find the member of an object on a tape with a given name.
+ * @details  The members are searched in order (skipping the value of each one
+ * that doesn't match in one step), and the first with the name is found,
+ * as argo_object_get finds it.
+ *
+ * @param t  Tape the object is on.
+ * @param v  Index of the object.
+ * @param key  Bytes of the name.
+ * @param length  Number of bytes in the name.
+ * @return  Index of the member's value, or ARGO_TAPE_NONE if there is no member with the name.
+ */
+size_t argo_tape_object_get_bytes(ARGO_TAPE *t, size_t v, const unsigned char *key, size_t length){
+    if (entry_tag(t, v) != ARGO_TAPE_OBJECT) return ARGO_TAPE_NONE;
+    size_t e = v + 1;
+    while (e + 1 < t->count && entry_tag(t, e) != ARGO_TAPE_OBJECT_END){
+        if (tape_name_equal(t, e, key, length)) return e + 1;
+        e = argo_tape_next(t, e + 1);
+    }
+    return ARGO_TAPE_NONE;
+}
+
+/**
+ * @brief  Find the member of an object on a tape with a given name.
+ * @details  See argo_tape_object_get_bytes.
+ *
+ * @param t  Tape the object is on.
+ * @param v  Index of the object.
+ * @param key  Name of the member (null terminated).
+ * @return  Index of the member's value, or ARGO_TAPE_NONE if there is no member with the name.
+ */
+size_t argo_tape_object_get(ARGO_TAPE *t, size_t v, const char *key){
+    size_t length = 0;
+    while (*(key+length) != '\0') length++;
+    return argo_tape_object_get_bytes(t, v, (const unsigned char *)key, length);
+}
+
+/**
+ * @brief  Start iterating over the elements of an array, or the members of an object, on a tape.
+ *
+ * @param it  Iterator to set up.
+ * @param t  Tape the container is on.
+ * @param v  Index of the container.
+ * @return  Zero if successful, nonzero if v isn't an array or object.
+ */
+int argo_tape_iter_open(ARGO_TAPE_ITER *it, ARGO_TAPE *t, size_t v){
+    int tag = entry_tag(t, v);
+    if (tag != ARGO_TAPE_OBJECT && tag != ARGO_TAPE_ARRAY) return -1;
+    it->tape = t;
+    it->pos = v + 1;
+    it->end = argo_tape_next(t, v) - 1;
+    it->object = tag == ARGO_TAPE_OBJECT;
+    return 0;
+}
+
+/**
+ * @brief  Step an iterator on to the next element (or member) of its container.
+ * @details  Each call takes constant time, as any container in between is skipped in one step.
+ *
+ * @param it  Iterator to step.
+ * @param name  If not NULL, set to the index of the member's name (a string), or to ARGO_TAPE_NONE for an element of an array.
+ * @return  Index of the element (or of the member's value), or ARGO_TAPE_NONE once there are no more.
+ */
+size_t argo_tape_iter_next(ARGO_TAPE_ITER *it, size_t *name){
+    if (name != NULL) *name = ARGO_TAPE_NONE;
+    if (it->pos >= it->end) return ARGO_TAPE_NONE;
+    size_t v = it->pos;
+    if (it->object){
+        if (name != NULL) *name = v;
+        v++;
+    }
+    it->pos = argo_tape_next(it->tape, v);
+    return v;
+}
+
+//Write a string on a tape as canonical JSON, as argo_writer_value writes the string it was saved from
+static int tape_writer_string(ARGO_WRITER *w, ARGO_TAPE *t, size_t v){
+    size_t length;
+    const unsigned char *text = entry_text(t, v, &length);
+    if (text == NULL) return -1;
+    if (entry_tag(t, v) == ARGO_TAPE_WIDE){
+        ARGO_STRING s = {0, length, (ARGO_CHAR *)text};
+        return argo_writer_string(w, &s);
+    }
+    //Bytes are written as an ARGO_UTF8 that isn't known to be ASCII, which writes each of them as the character with its value
+    ARGO_UTF8 s;
+    s.text.bytes = text;
+    s.length = length;
+    s.storage = ARGO_UTF8_SLICE;
+    s.ascii = 0;
+    return argo_writer_utf8(w, &s);
+}
+
+//Write the end of a container on a tape, which goes back to the indentation of its start
+static void tape_writer_close(ARGO_CTX *cx, ARGO_WRITER *w, int tag){
+    cx->level--;
+    argo_ctx_writer_newline(cx, w);
+    argo_writer_put(w, tag == ARGO_TAPE_OBJECT ? ARGO_RBRACE : ARGO_RBRACK);
+}
+
+//Write a value on a tape (with the name of the member it is, if name isn't ARGO_TAPE_NONE) as canonical JSON.
+//Nested containers don't recurse: the start of each one that is open is kept on the context's tape_stack
+static int tape_writer_member(ARGO_CTX *cx, ARGO_WRITER *w, ARGO_TAPE *t, size_t name, size_t v){
+    int ret = 0, tag;
+    size_t base = cx->tape_depth, root = v;
+    ARGO_NUMBER n;
+    while (true){
+        bool done = true; //done is set once v has been written in full
+        tag = entry_tag(t, v);
+        if (name != ARGO_TAPE_NONE){
+            if (tape_writer_string(w, t, name)) ret = -1;
+            else if (w->indent >= 0) argo_writer_bytes(w, ": ", 2);
+            else argo_writer_put(w, ARGO_COLON);
+        }
+        switch (ret ? -1 : tag){
+            case -1: break;
+            case ARGO_TAPE_NULL: case ARGO_TAPE_TRUE: case ARGO_TAPE_FALSE:
+                ret = argo_writer_basic(w, argo_tape_basic(t, v));
+                break;
+            case ARGO_TAPE_INT: case ARGO_TAPE_DOUBLE:
+                ret = argo_tape_number(t, v, &n) || argo_writer_number(w, &n);
+                break;
+            case ARGO_TAPE_BYTES: case ARGO_TAPE_WIDE:
+                ret = tape_writer_string(w, t, v);
+                break;
+            case ARGO_TAPE_OBJECT:
+            case ARGO_TAPE_ARRAY: {
+                cx->level++;
+                argo_writer_put(w, tag == ARGO_TAPE_OBJECT ? ARGO_LBRACE : ARGO_LBRACK);
+                argo_ctx_writer_newline(cx, w);
+                //An empty container is closed straight away
+                if (entry_tag(t, v + 1) == (tag == ARGO_TAPE_OBJECT ? ARGO_TAPE_OBJECT_END : ARGO_TAPE_ARRAY_END) ||
+                    (ret = tape_stack_grow((void **)&cx->tape_stack, cx->tape_depth, &cx->tape_size, sizeof(size_t)))) tape_writer_close(cx, w, tag);
+                else {
+                    *(cx->tape_stack + cx->tape_depth++) = v;
+                    name = tag == ARGO_TAPE_OBJECT ? v + 1 : ARGO_TAPE_NONE;
+                    v = tag == ARGO_TAPE_OBJECT ? v + 2 : v + 1;
+                    done = false;
+                }
+                break;
+            }
+            default:
+                fprintf(stderr, "Error: Tape is corrupt at entry %lu\n", v);
+                ret = -1;
+                break;
+        }
+        if (!done) continue;
+        //Move on to the next member or element of the innermost open container, closing each container that has none left
+        //(if there has been an error, then the open containers are all closed without writing anything more in them)
+        while (cx->tape_depth > base){
+            size_t start = *(cx->tape_stack + cx->tape_depth - 1);
+            int open = entry_tag(t, start);
+            if (ret == 0){
+                size_t e = argo_tape_next(t, v);
+                if (entry_tag(t, e) != (open == ARGO_TAPE_OBJECT ? ARGO_TAPE_OBJECT_END : ARGO_TAPE_ARRAY_END)){
+                    argo_writer_put(w, ARGO_COMMA);
+                    argo_ctx_writer_newline(cx, w);
+                    name = open == ARGO_TAPE_OBJECT ? e : ARGO_TAPE_NONE;
+                    v = open == ARGO_TAPE_OBJECT ? e + 1 : e;
+                    done = false;
+                    break;
+                }
+            }
+            cx->tape_depth--;
+            tape_writer_close(cx, w, open);
+            v = start;
+        }
+        if (done) break;
+    }
+    if (ret) return ret;
+    tag = entry_tag(t, root);
+    if (cx->level == 0 && tag != ARGO_TAPE_OBJECT && tag != ARGO_TAPE_ARRAY) argo_ctx_writer_newline(cx, w);
+    if (cx->level == 0 && w->indent >= 0) argo_writer_put(w, ARGO_LF);
+    return w->error;
+}
+
+/**
+ * @brief  Write canonical JSON representing a value on a tape to a writer.
+ * @details  The output is the same as argo_writer_value's for the value that
+ * the tape was saved from, including pretty printing if the writer was opened
+ * with it selected. As there, level should be zero for a value at the top level.
+ *
+ * @param w  Writer to write to.
+ * @param t  Tape the value is on.
+ * @param v  Index of the value.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_tape_writer_value(ARGO_WRITER *w, ARGO_TAPE *t, size_t v){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_tape_writer_value(cx, w, t, v);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Write canonical JSON representing a value on a tape to a writer, with the nesting of the output kept in a context
+//(see argo_tape_writer_value)
+int argo_ctx_tape_writer_value(ARGO_CTX *cx, ARGO_WRITER *w, ARGO_TAPE *t, size_t v){
+    return tape_writer_member(cx, w, t, ARGO_TAPE_NONE, v);
+}
+
+/**
+ * @brief  Write canonical JSON representing a value on a tape to an output stream.
+ * @details  See argo_tape_writer_value.
+ *
+ * @param t  Tape the value is on.
+ * @param v  Index of the value.
+ * @param f  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_tape_write_value(ARGO_TAPE *t, size_t v, FILE *f){
+    ARGO_WRITER w;
+    if (argo_writer_open(&w, f)) return -1;
+    int ret = argo_tape_writer_value(&w, t, v);
+    return argo_writer_close(&w) || ret ? -1 : 0;
+}
@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "arena.h"
+#include "structural.h"
+#include "intern.h"
+#include "utf8.h"
+#include "writer.h"
+
+//Escaped strings are decoded into the context's "decoded" space before they are stored, and member names are read
+//into its name_scratch. Both are reused for every string, so they only grow to the size of the longest one
+
+//Append a run of bytes to the decode buffer, which holds "*len" bytes so far
+static int decode_append(ARGO_CTX *cx, size_t *len, const unsigned char *bytes, size_t count){
+    //An empty run may come before anything has been allocated, and copying it from or to NULL is undefined
+    if (count == 0) return 0;
+    if (*len + count > cx->decoded_size){
+        size_t size = cx->decoded_size == 0 ? 256 : cx->decoded_size * 2;
+        while (size < *len + count) size *= 2;
+        unsigned char *grown = realloc(cx->decoded, size);
+        if (grown == NULL){
+            fprintf(stderr, "[%d] Failed to allocate space for string text\n", cx->lines_read);
+            return -1;
+        }
+        cx->decoded = grown;
+        cx->decoded_size = size;
+    }
+    __builtin_memcpy(cx->decoded + *len, bytes, count);
+    *len += count;
+    return 0;
+}
+
+//Append a single byte to the decode buffer
+static int decode_byte(ARGO_CTX *cx, size_t *len, unsigned char c){
+    return decode_append(cx, len, &c, 1);
+}
+
+//Check whether a run of bytes is all ASCII, eight bytes at a time
+static bool is_ascii(const unsigned char *p, size_t n){
+    uint64_t acc = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        uint64_t word;
+        __builtin_memcpy(&word, p + i, 8);
+        acc |= word;
+    }
+    for (; i < n; i++) acc |= *(p+i);
+    return (acc & 0x8080808080808080ULL) == 0;
+}
+
+//Value of a hex digit (which must already have been checked with argo_is_hex)
+static int hex_value(int c){
+    if (argo_is_digit(c)) return c - ARGO_DIGIT0;
+    if (is_lowercase_hex(c)) return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+/**
+ * @brief  Set the text of an ARGO_UTF8 string.
+ * @details  Text of up to ARGO_UTF8_INLINE bytes is copied into the string itself.
+ * Longer text is either referenced in place (if "borrow" is set, in which case the
+ * bytes must outlive the string) or copied into the context's arena.
+ *
+ * @param cx  Context whose arena a copy is allocated from.
+ * @param s  String to set.
+ * @param bytes  Text of the string.
+ * @param length  Number of bytes of text.
+ * @param borrow  Nonzero if the string may point at "bytes" rather than copy them.
+ * @return  Zero if successful, nonzero if space for a copy couldn't be allocated.
+ */
+int argo_utf8_set(ARGO_CTX *cx, ARGO_UTF8 *s, const unsigned char *bytes, size_t length, bool borrow){
+    s->length = length;
+    s->ascii = is_ascii(bytes, length);
+    if (length <= ARGO_UTF8_INLINE){
+        s->storage = ARGO_UTF8_SHORT;
+        if (length > 0) __builtin_memcpy(s->text.inline_bytes, bytes, length);
+    }
+    else if (borrow){
+        s->storage = ARGO_UTF8_SLICE;
+        s->text.bytes = bytes;
+    }
+    else{
+        unsigned char *copy = argo_arena_alloc(cx->arena, length);
+        if (copy == NULL) return -1;
+        __builtin_memcpy(copy, bytes, length);
+        s->storage = ARGO_UTF8_COPY;
+        s->text.bytes = copy;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Parse a JSON string literal from an input into a string value.
+ * @details  The value is normally given type ARGO_UTF8_TYPE. If the literal has no
+ * escapes and lies entirely within an input buffer that outlives the parse, then
+ * a long string is a slice of that buffer and nothing is copied at all. If the literal
+ * contains a \u escape for a non-ASCII character, then the value is given type
+ * ARGO_STRING_TYPE instead, and is read the same way as by argo_read_string.
+ *
+ * @param cx  Context to use.
+ * @param v  Value to hold the string.
+ * @param in  Input to read from, positioned at the opening quote.
+ * @return  Zero if successful, nonzero if there is any error.
+ */
+int argo_read_utf8_value(ARGO_CTX *cx, ARGO_VALUE *v, ARGO_INPUT *in){
+    if (argo_getc(in) != ARGO_QUOTE){
+        fprintf(stderr, "Error: Not a valid string\n");
+        return -1;
+    }
+    v->type = ARGO_UTF8_TYPE;
+    //Skip the run of ordinary bytes, which may take several windows of the index
+    size_t start = in->pos;
+    size_t span;
+    while ((span = argo_string_span(in)) > 0){
+        in->pos += span;
+        if (in->pos < in->index->end) break;
+    }
+    cx->chars_read += in->pos - start;
+    //If the run ends at the closing quote, then the text is exactly the bytes of the run
+    if (in->pos < in->len && *(in->buf + in->pos) == ARGO_QUOTE){
+        in->pos++;
+        return argo_utf8_set(cx, &v->content.utf8, in->buf + start, in->pos - 1 - start, in->stable);
+    }
+    //Otherwise there are escapes (or the buffer has to be refilled), so the text is decoded a piece at a time
+    size_t len = 0;
+    if (decode_append(cx, &len, in->buf + start, in->pos - start)) return -1;
+    int nextChar = argo_getc(in);
+    while (nextChar != ARGO_QUOTE){
+        if (nextChar == EOF){
+            fprintf(stderr, "Error: A closing quote for a string was not found on line %d\n.", cx->lines_read);
+            return -1;
+        }
+        if (nextChar == ARGO_BSLASH){
+            int after = argo_getc(in);
+            int c = -1;
+            switch (after){
+                case ARGO_T: c = ARGO_HT; break;
+                case ARGO_R: c = ARGO_CR; break;
+                case ARGO_QUOTE: c = ARGO_QUOTE; break;
+                case ARGO_BSLASH: c = ARGO_BSLASH; break;
+                case ARGO_F: c = ARGO_FF; break;
+                case ARGO_B: c = ARGO_BS; break;
+                case ARGO_N: c = ARGO_LF; break;
+                case ARGO_U: {
+                    //Same as parseUnicode: if four hex digits don't follow, then they are kept as they are
+                    if (!isUnicode(in)){
+                        int i;
+                        for (i = 0; i < 4; i++){
+                            int raw = argo_getc(in);
+                            if (raw != EOF && decode_byte(cx, &len, raw)) return -1;
+                        }
+                        break;
+                    }
+                    int i;
+                    c = 0;
+                    for (i = 0; i < 4; i++) c = c*16 + hex_value(argo_getc(in));
+                    //A non-ASCII character can't be told apart from raw input bytes, so switch to an ARGO_STRING
+                    if (c >= 0x80){
+                        ARGO_STRING *s = &v->content.string;
+                        v->type = ARGO_STRING_TYPE;
+                        //The text is read into the scratch space for names, then moved into the arena like a name is
+                        cx->name_scratch.length = 0;
+                        if ((len > 0 && argo_append_bytes(&cx->name_scratch, cx->decoded, len)) || argo_append_char(&cx->name_scratch, c)
+                            || argo_read_string_rest(cx, &cx->name_scratch, in)) return -1;
+                        s->capacity = 0;
+                        s->length = cx->name_scratch.length;
+                        s->content = argo_arena_alloc(cx->arena, s->length * sizeof(ARGO_CHAR));
+                        if (s->content == NULL) return -1;
+                        __builtin_memcpy(s->content, cx->name_scratch.content, s->length * sizeof(ARGO_CHAR));
+                        return 0;
+                    }
+                    break;
+                }
+                //Any other escape is kept as it is
+                default: {
+                    if (decode_byte(cx, &len, ARGO_BSLASH)) return -1;
+                    c = after;
+                    break;
+                }
+            }
+            if (c != EOF && decode_byte(cx, &len, c)) return -1;
+        }
+        //If a newline is found (ie, the ascii 10, not "\n"), then print error and return -1
+        else if (nextChar == ARGO_LF){
+            cx->lines_read++;
+            fprintf(stderr, "Error: Newline found in member on line %d\n", cx->lines_read);
+            return -1;
+        }
+        else if (decode_byte(cx, &len, nextChar)) return -1;
+        //Copy the next run of ordinary bytes in bulk
+        while ((span = argo_string_span(in)) > 0){
+            if (decode_append(cx, &len, in->buf + in->pos, span)) return -1;
+            in->pos += span;
+            cx->chars_read += span;
+            if (in->pos < in->index->end) break;
+        }
+        nextChar = argo_getc(in);
+    }
+    return argo_utf8_set(cx, &v->content.utf8, cx->decoded, len, false);
+}
+
+/**
+ * @brief  Parse a JSON string literal from an input as the name of a member.
+ * @details  The name is read the same way as by argo_read_string, but it is then
+ * interned (see intern.h), so members with the same name share a single copy of it
+ * in the context's arena, and no space is allocated for it separately. An empty name
+ * has NULL content.
+ *
+ * @param cx  Context to use.
+ * @param name  String to hold the name.
+ * @param in  Input to read from, positioned at the opening quote.
+ * @return  Zero if successful, nonzero if there is any error.
+ */
+int argo_read_name(ARGO_CTX *cx, ARGO_STRING *name, ARGO_INPUT *in){
+    cx->name_scratch.length = 0;
+    if (argo_read_string_append(cx, &cx->name_scratch, in)) return -1;
+    return argo_ctx_intern_name(cx, name, cx->name_scratch.content, cx->name_scratch.length);
+}
+
+/**
+ * @brief  Convert an ARGO_UTF8 string to an ARGO_STRING.
+ * @details  Each byte becomes one ARGO_CHAR, which is how argo_read_string
+ * represents the same text, so the two strings are written out identically.
+ *
+ * @param s  String to convert.
+ * @param out  String to hold the result (its previous content is ignored).
+ * @return  Zero if successful, nonzero if space couldn't be allocated.
+ */
+int argo_utf8_to_string(ARGO_UTF8 *s, ARGO_STRING *out){
+    out->capacity = 0;
+    out->length = 0;
+    if (s->length == 0) return 0;
+    return argo_append_bytes(out, argo_utf8_bytes(s), s->length);
+}
+
+/**
+ * @brief  Compare the text of an ARGO_UTF8 string with a run of bytes.
+ *
+ * @param s  String to compare.
+ * @param text  Bytes to compare it with.
+ * @param length  Number of bytes in text.
+ * @return  Nonzero if the string's text is exactly the given bytes.
+ */
+int argo_utf8_equal(ARGO_UTF8 *s, const char *text, size_t length){
+    return s->length == length && __builtin_memcmp(argo_utf8_bytes(s), text, length) == 0;
+}
+
+/**
+ * @brief  Write canonical JSON representing an ARGO_UTF8 string to a writer.
+ * @details  The output is the same as argo_write_string would produce for the
+ * same text. Runs of bytes that don't need escaping are copied in bulk.
+ *
+ * @param w  Writer to write to.
+ * @param s  String to write.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_writer_utf8(ARGO_WRITER *w, ARGO_UTF8 *s){
+    const unsigned char *text = argo_utf8_bytes(s);
+    size_t i = 0, run = 0;
+    argo_writer_put(w, ARGO_QUOTE);
+    while (i < s->length){
+        unsigned char c = *(text+i);
+        //Only quotes, backslashes, control characters and (outside of ASCII text) 0xFF are written differently
+        if (c >= 0x20 && c != ARGO_QUOTE && c != ARGO_BSLASH && (s->ascii || c != 0xFF)) {i++; continue;}
+        if (i > run) argo_writer_bytes(w, text + run, i - run);
+        argo_writer_char(w, c);
+        run = ++i;
+    }
+    if (i > run) argo_writer_bytes(w, text + run, i - run);
+    argo_writer_put(w, ARGO_QUOTE);
+    return w->error;
+}
+
+/**
+ * @brief  Write canonical JSON representing an ARGO_UTF8 string to an output stream.
+ * @details  See argo_writer_utf8.
+ *
+ * @param s  String to write.
+ * @param f  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_write_utf8(ARGO_UTF8 *s, FILE *f){
+    ARGO_WRITER w;
+    if (argo_writer_open(&w, f)) return -1;
+    int ret = argo_writer_utf8(&w, s);
+    return argo_writer_close(&w) || ret ? -1 : 0;
+}
@@ -2,6 +2,7 @@
 
 #include "argo.h"
 #include "global.h"
+#include "options.h"
 #include "debug.h"
 #include "validity.h"
 
@@ -10,6 +11,8 @@
 
 
 int argLengthParser(char* argument);
+static int extraArgs(int *argc, char **argv);
+static bool argIs(char* argument, char* option);
 
 /**
  * @brief Validates command line arguments passed to the program.
@@ -31,13 +34,29 @@ int validargs(int argc, char **argv) {
     debug("Entered valid args\n");
     // TO BE IMPLEMENTED
 
+    //Set initial value of global options to 0
+    global_options = 0;
+
+    //Options other than -h, -c, -v and -p are taken out first, so that the rest are checked as before
+    if (extraArgs(&argc, argv) == -1) return -1;
+    //A query, a hash, or sorting on its own reads the input as -c does
+    if (argc == 1 && (argo_extra_options & (QUERY_OPTION | HASH_OPTION | SORT_OPTION))){
+        global_options = CANONICALIZE_OPTION;
+        return EXIT_SUCCESS;
+    }
+    //They can be pretty printed without -c too, with -p and its indent as they would follow -c
+    if (argc <= 3 && argc > 1 && (argo_extra_options & (QUERY_OPTION | SORT_OPTION)) && argIs(*(argv+1), "-p")){
+        int indent = argc == 3 ? numParser(*(argv+2)) : 4;
+        //A hash is of the canonical form, so it can't be pretty printed
+        if (indent == -1 || (argo_extra_options & HASH_OPTION)) return -1;
+        global_options = 0x30000000 + indent;
+        return EXIT_SUCCESS;
+    }
+
     //This variable can be used to deterrmine which return code to return
     //Set the initial value of successOrFail to the condition of too few variables
     //argc being = to 1 means there are no arguments (since program name counts as a arg)
     bool successOrFail = !(argc == 1);
-
-    //Set initial value of global options to 0
-    global_options = 0;
     
     //If too many args and the first arg isnt -h, then -1 is returned and usage is called w it in main
     //If -h is the first arg, then EXIT_SUCCESS 
@@ -131,9 +150,84 @@ int validargs(int argc, char **argv) {
         else return -1;
     }
     debug("Reached the end of valid args\n");
+    //A query needs values to select from (and sorting, values to output), so neither can be combined with -v
+    if (successOrFail && global_options == VALIDATE_OPTION && (argo_extra_options & (QUERY_OPTION | SORT_OPTION))){
+        global_options = 0;
+        return -1;
+    }
+    //A hash is of the canonical form, so neither validating nor pretty printing go with it
+    if (successOrFail && (argo_extra_options & HASH_OPTION) && (global_options & (VALIDATE_OPTION | PRETTY_PRINT_OPTION))){
+        global_options = 0;
+        return -1;
+    }
     return (successOrFail ? EXIT_SUCCESS : -1);
 }
 
+//Check whether a command line argument is exactly the given option
+static bool argIs(char* argument, char* option){
+    while (*argument != 0 && *argument == *option){
+        argument++;
+        option++;
+    }
+    return *argument == *option;
+}
+
+//Parse a nesting depth (which, unlike an indent, can be more than 255), returning -1 if it isn't a number of at most 9 digits
+static int depthParser(char* arg){
+    int num = 0, digits = 0;
+    while (*arg != 0){
+        if (!argo_is_digit(*arg) || ++digits > 9) return -1;
+        num = num * 10 + (*arg - '0');
+        arg++;
+    }
+    return digits == 0 ? -1 : num;
+}
+
+//Take the options that aren't encoded in global_options out of the arguments (moving the rest down),
+//recording them in argo_extra_options. Returns -1 if one of them is missing its parameter
+static int extraArgs(int *argc, char **argv){
+    int i = 1, kept = 1;
+    argo_extra_options = 0;
+    argo_jobs = 1;
+    argo_max_depth = 0;
+    argo_hash_bits = 0;
+    while (i < *argc){
+        char* arg = *(argv+i);
+        if (argIs(arg, "-q")){
+            if (i + 1 >= *argc) return -1;
+            argo_extra_options |= QUERY_OPTION;
+            argo_query_text = *(argv+i+1);
+            i += 2;
+        }
+        else if (argIs(arg, "-j")){
+            if (i + 1 >= *argc || (argo_jobs = numParser(*(argv+i+1))) < 1) return -1;
+            argo_extra_options |= JOBS_OPTION;
+            i += 2;
+        }
+        else if (argIs(arg, "--depth")){
+            if (i + 1 >= *argc || (argo_max_depth = depthParser(*(argv+i+1))) < 1) return -1;
+            argo_extra_options |= DEPTH_OPTION;
+            i += 2;
+        }
+        else if (argIs(arg, "--hash") || argIs(arg, "--hash128")){
+            argo_extra_options |= HASH_OPTION;
+            argo_hash_bits = argIs(arg, "--hash") ? 64 : 128;
+            i++;
+        }
+        else if (argIs(arg, "--sort-keys")){
+            argo_extra_options |= SORT_OPTION;
+            i++;
+        }
+        else if (argIs(arg, "--lines")){
+            argo_extra_options |= LINES_OPTION;
+            i++;
+        }
+        else *(argv + kept++) = *(argv + i++);
+    }
+    *argc = kept;
+    return 0;
+}
+
 //Return the length of a command line argument
 int argLengthParser(char* argument){
     int counter=0;
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "input.h"
+#include "structural.h"
+#include "validate.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ARGO_X86 1
+#endif
+
+//Check bytes for UTF-8 one sequence at a time, skipping runs of ASCII a word at a time
+static bool utf8_valid_scalar(const unsigned char *p, size_t n){
+    size_t i = 0;
+    while (i < n){
+        if (i + 8 <= n){
+            uint64_t w;
+            __builtin_memcpy(&w, p + i, 8);
+            if ((w & 0x8080808080808080ULL) == 0) {i += 8; continue;}
+        }
+        unsigned char c = *(p+i);
+        if (c < 0x80) {i++; continue;}
+        //The second byte of some sequences has a narrower range, which rules out overlong forms, surrogates, and code points past 0x10FFFF
+        size_t len, k;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) len = 2;
+        else if (c >= 0xE0 && c <= 0xEF){
+            len = 3;
+            if (c == 0xE0) lo = 0xA0;
+            else if (c == 0xED) hi = 0x9F;
+        }
+        else if (c >= 0xF0 && c <= 0xF4){
+            len = 4;
+            if (c == 0xF0) lo = 0x90;
+            else if (c == 0xF4) hi = 0x8F;
+        }
+        else return false;
+        if (n - i < len || *(p+i+1) < lo || *(p+i+1) > hi) return false;
+        for (k = 2; k < len; k++){
+            if ((*(p+i+k) & 0xC0) != 0x80) return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+#if defined(ARGO_X86) && defined(__SSE2__)
+//Errors that a pair of adjacent bytes can show, one bit each (see utf8_valid_avx2)
+#define TOO_SHORT (1 << 0)           // A lead byte followed by something other than a continuation byte.
+#define TOO_LONG (1 << 1)            // A continuation byte after an ASCII byte.
+#define OVERLONG_3 (1 << 2)          // 11100000 100_____
+#define TOO_LARGE (1 << 3)           // 11110100 1001____ and above.
+#define SURROGATE (1 << 4)           // 11101101 101_____
+#define OVERLONG_2 (1 << 5)          // 1100000_ 10______
+#define TOO_LARGE_1000 (1 << 6)      // 11110101 1000____ and above.
+#define OVERLONG_4 (1 << 6)          // 11110000 1000____
+#define TWO_CONTS (1 << 7)           // Two continuation bytes, which is only right if an earlier lead byte calls for them.
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+//A 16-entry table, repeated in both halves of a vector (each half is looked up in on its own)
+#define utf8_table(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+//Table lookup with the high nibble of each byte
+#define high_nibble(v) _mm256_and_si256(_mm256_srli_epi16((v), 4), _mm256_set1_epi8(0x0F))
+//The 32 bytes that end "n" bytes before the bytes of v (prev holding the ones before v)
+#define prev_bytes(v, prev, n) _mm256_alignr_epi8((v), _mm256_permute2x128_si256((prev), (v), 0x21), 16 - (n))
+
+/*
+ * Check bytes for UTF-8 32 at a time, with the lookup technique of Keiser and Lemire
+ * ("Validating UTF-8 in less than one instruction per byte"). Three tables, indexed by
+ * the high and low nibbles of the previous byte and the high nibble of the current one,
+ * each give the errors that the pair of bytes could be part of. A pair is in error if all
+ * three agree. Whether a byte must be the second or third continuation byte of a sequence
+ * is found by looking two and three bytes back. Blocks of ASCII are passed over, only
+ * checking that the block before didn't end in the middle of a sequence.
+ */
+__attribute__((target("avx2")))
+static bool utf8_valid_avx2(const unsigned char *p, size_t n){
+    const __m256i byte_1_high = utf8_table(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS,
+        TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m256i byte_1_low = utf8_table(
+        (char)(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4), (char)(CARRY | OVERLONG_2), (char)CARRY, (char)CARRY,
+        (char)(CARRY | TOO_LARGE), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000));
+    const __m256i byte_2_high = utf8_table(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    //A block ends in the middle of a sequence if one of its last three bytes is a lead byte that needs more bytes than are left
+    const __m256i last_lead = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m256i prev = _mm256_setzero_si256(), error = _mm256_setzero_si256(), incomplete = _mm256_setzero_si256();
+    unsigned char tail[32];
+    size_t i, k;
+    for (i = 0; i < n; i += 32){
+        __m256i v;
+        if (n - i >= 32) v = _mm256_loadu_si256((const __m256i *)(p + i));
+        else{
+            //The last bytes are padded with NUL, which (being ASCII) ends any sequence that was left open
+            for (k = 0; k < 32; k++) *(tail+k) = i + k < n ? *(p+i+k) : 0;
+            v = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        if (_mm256_movemask_epi8(v) == 0) error = _mm256_or_si256(error, incomplete);
+        else{
+            __m256i prev1 = prev_bytes(v, prev, 1);
+            __m256i special = _mm256_and_si256(_mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, high_nibble(prev1)),
+                                                                _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+                                               _mm256_shuffle_epi8(byte_2_high, high_nibble(v)));
+            //Only bytes two after a lead byte of three or more, or three after one of four, are left with their high bit set
+            __m256i must_23 = _mm256_or_si256(_mm256_subs_epu8(prev_bytes(v, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80))),
+                                              _mm256_subs_epu8(prev_bytes(v, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80))));
+            must_23 = _mm256_and_si256(must_23, _mm256_set1_epi8((char)0x80));
+            error = _mm256_or_si256(error, _mm256_xor_si256(must_23, special));
+            incomplete = _mm256_subs_epu8(v, last_lead);
+        }
+        prev = v;
+    }
+    error = _mm256_or_si256(error, incomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+//Checker picked for this CPU the first time a long run of bytes is checked (by whichever thread gets there first)
+static bool (*utf8_valid)(const unsigned char *, size_t);
+
+/**
+ * @brief  Check that bytes are well-formed UTF-8.
+ * @details  Overlong forms, surrogates (0xD800 to 0xDFFF), code points past 0x10FFFF,
+ * and sequences that are cut short are all errors. Uses AVX2 if the CPU supports
+ * it, and otherwise goes through the bytes one sequence at a time (as it does for
+ * short runs, for which setting up the vectors would cost more than it saves).
+ *
+ * @param p  Bytes to check.
+ * @param n  Number of bytes.
+ * @return  Nonzero if the bytes are well-formed UTF-8.
+ */
+bool argo_utf8_valid(const unsigned char *p, size_t n){
+    if (n < 32) return utf8_valid_scalar(p, n);
+    bool (*picked)(const unsigned char *, size_t) = __atomic_load_n(&utf8_valid, __ATOMIC_RELAXED);
+    if (picked == NULL){
+        picked = utf8_valid_scalar;
+#if defined(ARGO_X86) && defined(__SSE2__)
+        if (__builtin_cpu_supports("avx2")) picked = utf8_valid_avx2;
+#endif
+        __atomic_store_n(&utf8_valid, picked, __ATOMIC_RELAXED);
+    }
+    return picked(p, n);
+}
+
+//Length of the run of bytes from the next unread one that holds no quote, backslash, or control character.
+//The whole run is made available in the buffer, without anything being consumed
+static size_t string_run(ARGO_INPUT *in){
+    //The structural index has usually classified the bytes already, and only a run that reaches the end of its window is looked at further
+    size_t run = argo_string_span(in);
+    if (in->index != NULL && in->pos + run < in->index->end) return run;
+    unsigned char padded[ARGO_BLOCK_SIZE];
+    while (true){
+        if (in->len - in->pos < run + ARGO_BLOCK_SIZE && in->src != NULL) argo_input_refill(in, run + ARGO_BLOCK_SIZE);
+        size_t avail = in->len - in->pos - run, i;
+        if (avail == 0) return run;
+        const unsigned char *b = in->buf + in->pos + run;
+        //The last block is padded with NUL bytes, which are control characters, so the run ends before them
+        if (avail < ARGO_BLOCK_SIZE){
+            for (i = 0; i < ARGO_BLOCK_SIZE; i++) *(padded+i) = i < avail ? *(b+i) : 0;
+            b = padded;
+        }
+        ARGO_BLOCK_MASKS m;
+        argo_classify_block(b, &m);
+        uint64_t special = m.special;
+        if (special != 0) return run + __builtin_ctzll(special);
+        run += ARGO_BLOCK_SIZE;
+    }
+}
+
+/**
+ * @brief  Check the rest of a string literal (after its opening quote) without decoding it.
+ * @details  This is stricter than argo_read_string_rest, as the JSON standard is: besides
+ * a raw newline, any other control character is an error, as is a byte sequence that
+ * isn't well-formed UTF-8, and a backslash that isn't followed by one of the characters
+ * of an escape (or by 'u' and four hex digits). The runs of ordinary bytes between the
+ * quotes, backslashes, and control characters are checked in bulk by argo_utf8_valid.
+ * A string can't span lines, so an error is reported with the line it starts on.
+ *
+ * @param cx  Context whose counts are updated.
+ * @param in  Input from which the string is to be read.
+ * @return  Zero if the string is valid, nonzero if there is any error.
+ */
+int argo_validate_string_rest(ARGO_CTX *cx, ARGO_INPUT *in){
+    while (true){
+        size_t run = string_run(in);
+        if (!argo_utf8_valid(in->buf + in->pos, run)){
+            fprintf(stderr, "Error: Invalid UTF-8 in string at line %d\n", cx->lines_read);
+            return -1;
+        }
+        in->pos += run;
+        cx->chars_read += run;
+        int c = argo_getc(in);
+        cx->chars_read++;
+        if (c == ARGO_QUOTE) return 0;
+        if (c == ARGO_BSLASH){
+            c = argo_getc(in);
+            cx->chars_read++;
+            if (c == ARGO_U && isUnicode(in)){
+                //The four hex digits have been looked at, so they are in the buffer
+                in->pos += 4;
+                cx->chars_read += 4;
+                continue;
+            }
+            if (c == ARGO_QUOTE || c == ARGO_BSLASH || c == ARGO_FSLASH || c == ARGO_B || c == ARGO_F ||
+                c == ARGO_N || c == ARGO_R || c == ARGO_T) continue;
+            if (c != EOF){
+                fprintf(stderr, "Error: Invalid escape in string at line %d\n", cx->lines_read);
+                return -1;
+            }
+        }
+        if (c == EOF) fprintf(stderr, "Error: A closing quote for a string was not found on line %d\n.", cx->lines_read);
+        else if (c == ARGO_LF){
+            cx->lines_read++;
+            fprintf(stderr, "Error: Newline found in member on line %d\n", cx->lines_read);
+        }
+        else fprintf(stderr, "Error: Control character in string at line %d\n", cx->lines_read);
+        return -1;
+    }
+}
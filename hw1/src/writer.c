@@ -0,0 +1,407 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "ctx.h"
+#include "validity.h"
+#include "dtoa.h"
+#include "utf8.h"
+#include "writer.h"
+#include "intern.h"
+
+//Number of characters of a string that are copied before checking again for space in the buffer
+#define STRING_CHUNK 4096
+
+//Most bytes that the decimal form of a long can take
+#define LONG_BUFFER 24
+
+//A newline followed by the longest run of indentation that is written in one piece
+#define SPACES_16 "                "
+#define SPACES_64 SPACES_16 SPACES_16 SPACES_16 SPACES_16
+static const char indent_run[ARGO_INDENT_RUN + 2] = "\n" SPACES_64 SPACES_64 SPACES_64 SPACES_64;
+
+//Set up a writer with an empty buffer, taking the pretty printing options from those of a context
+static int writer_init(ARGO_CTX *cx, ARGO_WRITER *w){
+    w->buf = malloc(ARGO_WRITER_BUFFER);
+    if (w->buf == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for output\n");
+        return -1;
+    }
+    w->len = 0;
+    w->size = ARGO_WRITER_BUFFER;
+    w->out = NULL;
+    w->sink = NULL;
+    w->sink_ctx = NULL;
+    w->error = 0;
+    w->mark = ARGO_NO_MARK;
+    w->frames = NULL;
+    w->depth = 0;
+    w->frames_size = 0;
+    w->indent = (cx->options & PRETTY_PRINT_OPTION) ? (cx->options & 0xFF) : -1;
+    return 0;
+}
+
+/**
+ * @brief  Open a writer that writes its output to a stream.
+ *
+ * @param w  Writer to open.
+ * @param out  Stream to write to. Output is only written to it when the
+ * writer's buffer fills up, or when the writer is flushed or closed.
+ * @return  Zero if successful, nonzero if space for the buffer couldn't be allocated.
+ */
+int argo_writer_open(ARGO_WRITER *w, FILE *out){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_writer_open(cx, w, out);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Open a writer that writes its output to a stream, pretty printing if the options of a context say so (see argo_writer_open)
+int argo_ctx_writer_open(ARGO_CTX *cx, ARGO_WRITER *w, FILE *out){
+    if (writer_init(cx, w)) return -1;
+    w->out = out;
+    return 0;
+}
+
+/**
+ * @brief  Open a writer that passes its output to a function rather than a stream.
+ * @details  The sink is called with each run of output as it is flushed, in order.
+ * It returns zero if successful, and nonzero to make the writer fail.
+ *
+ * @param w  Writer to open.
+ * @param sink  Function to pass output to.
+ * @param ctx  Passed unchanged as the first argument of sink.
+ * @return  Zero if successful, nonzero if space for the buffer couldn't be allocated.
+ */
+int argo_writer_open_sink(ARGO_WRITER *w, int (*sink)(void *, const unsigned char *, size_t), void *ctx){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_writer_open_sink(cx, w, sink, ctx);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Open a writer that passes its output to a function, pretty printing if the options of a context say so (see argo_writer_open_sink)
+int argo_ctx_writer_open_sink(ARGO_CTX *cx, ARGO_WRITER *w, int (*sink)(void *, const unsigned char *, size_t), void *ctx){
+    if (writer_init(cx, w)) return -1;
+    w->sink = sink;
+    w->sink_ctx = ctx;
+    return 0;
+}
+
+//Pass a run of output on to the writer's sink or stream
+static void writer_emit(ARGO_WRITER *w, const void *bytes, size_t n){
+    if (w->error || n == 0) return;
+    if (w->sink != NULL ? w->sink(w->sink_ctx, bytes, n) != 0 : fwrite(bytes, 1, n, w->out) != n){
+        fprintf(stderr, "Error: Failed to write output\n");
+        w->error = 1;
+    }
+}
+
+//Make room in the buffer for at least "need" more bytes, for output that is being held back
+static int writer_grow(ARGO_WRITER *w, size_t need){
+    size_t size = w->size;
+    while (size - w->len < need) size *= 2;
+    if (size == w->size) return 0;
+    unsigned char *grown = realloc(w->buf, size);
+    if (grown == NULL){
+        fprintf(stderr, "Error: Failed to allocate space for output\n");
+        w->error = 1;
+        //Without the space, the held back output has to go out after all
+        w->mark = ARGO_NO_MARK;
+        return -1;
+    }
+    w->buf = grown;
+    w->size = size;
+    return 0;
+}
+
+/**
+ * @brief  Write out everything in a writer's buffer, apart from any output held back by a mark.
+ * @details  Output held back is moved to the start of the buffer, and the buffer is grown
+ * if that leaves less than ARGO_WRITER_BUFFER bytes of room.
+ *
+ * @param w  Writer to flush.
+ * @return  Zero if successful, nonzero if any output has failed.
+ */
+int argo_writer_flush(ARGO_WRITER *w){
+    if (w->mark == ARGO_NO_MARK){
+        writer_emit(w, w->buf, w->len);
+        w->len = 0;
+        return w->error;
+    }
+    writer_emit(w, w->buf, w->mark);
+    if (w->mark > 0) __builtin_memmove(w->buf, w->buf + w->mark, w->len - w->mark);
+    w->len -= w->mark;
+    w->mark = 0;
+    if (writer_grow(w, ARGO_WRITER_BUFFER)) return argo_writer_flush(w);
+    return w->error;
+}
+
+/**
+ * @brief  Flush a writer and free its buffer.
+ * @details  Any output held back by a mark is written out as well.
+ *
+ * @param w  Writer to close.
+ * @return  Zero if all of the output was written successfully, nonzero otherwise.
+ */
+int argo_writer_close(ARGO_WRITER *w){
+    w->mark = ARGO_NO_MARK;
+    int ret = argo_writer_flush(w);
+    free(w->buf);
+    w->buf = NULL;
+    w->size = 0;
+    free(w->frames);
+    w->frames = NULL;
+    w->frames_size = 0;
+    return ret;
+}
+
+//Slow path of argo_writer_bytes, for runs that don't fit in the space left in the buffer
+void argo_writer_write(ARGO_WRITER *w, const void *bytes, size_t n){
+    argo_writer_flush(w);
+    if (w->mark != ARGO_NO_MARK && writer_grow(w, n)) argo_writer_flush(w);
+    if (n > w->size - w->len){
+        writer_emit(w, bytes, n);
+        return;
+    }
+    __builtin_memcpy(w->buf + w->len, bytes, n);
+    w->len += n;
+}
+
+//If pretty printing, write a newline and the indentation for the current level (that of the default context)
+void argo_writer_newline(ARGO_WRITER *w){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    argo_ctx_writer_newline(cx, w);
+    argo_default_ctx_leave(cx);
+}
+
+//If pretty printing, write a newline and the indentation for the level of a context
+void argo_ctx_writer_newline(ARGO_CTX *cx, ARGO_WRITER *w){
+    if (w->indent < 0) return;
+    size_t count = (size_t)w->indent * cx->level;
+    size_t n = count < ARGO_INDENT_RUN ? count : ARGO_INDENT_RUN;
+    argo_writer_bytes(w, indent_run, n + 1);
+    for (count -= n; count > 0; count -= n){
+        n = count < ARGO_INDENT_RUN ? count : ARGO_INDENT_RUN;
+        argo_writer_bytes(w, indent_run + 1, n);
+    }
+}
+
+//Write one character of a string as canonical JSON (escaped if necessary)
+void argo_writer_char(ARGO_WRITER *w, ARGO_CHAR c){
+    char escape[16];
+    const char *prefix;
+    switch (c){
+        case ARGO_LF: argo_writer_bytes(w, "\\n", 2); return;
+        case ARGO_BS: argo_writer_bytes(w, "\\b", 2); return;
+        case ARGO_HT: argo_writer_bytes(w, "\\t", 2); return;
+        case ARGO_FF: argo_writer_bytes(w, "\\f", 2); return;
+        case ARGO_CR: argo_writer_bytes(w, "\\r", 2); return;
+        case ARGO_QUOTE: argo_writer_bytes(w, "\\\"", 2); return;
+        case ARGO_BSLASH: argo_writer_bytes(w, "\\\\", 2); return;
+    }
+    if (c >= 31 && c < 0xFF){
+        argo_writer_put(w, c);
+        return;
+    }
+    //Everything else is a \u escape, with zeros hardcoded in front of the hex digits as they always have been
+    if (c < 31) prefix = c <= 16 ? "\\u000" : "\\u00";
+    else if (c == 0xFF) prefix = "\\u00";
+    else if (c <= 0xFFF) prefix = "\\u0";
+    else prefix = "\\u";
+    argo_writer_bytes(w, escape, snprintf(escape, sizeof(escape), "%s%x", prefix, c));
+}
+
+/**
+ * @brief  Write canonical JSON representing a string to a writer.
+ * @details  The output is the same as for argo_write_string. Runs of characters
+ * that are written as themselves are copied straight into the writer's buffer.
+ *
+ * @param w  Writer to write to.
+ * @param s  String to write.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_writer_string(ARGO_WRITER *w, ARGO_STRING *s){
+    const ARGO_CHAR *text = s->content;
+    size_t i = 0, length = s->length;
+    argo_writer_put(w, ARGO_QUOTE);
+    while (i < length){
+        size_t end = length - i < STRING_CHUNK ? length : i + STRING_CHUNK;
+        unsigned char *out = argo_writer_reserve(w, end - i);
+        size_t j = i;
+        while (j < end && is_plain_char(*(text+j))) *out++ = *(text+j++);
+        w->len += j - i;
+        i = j;
+        if (i < end) argo_writer_char(w, *(text+i++));
+    }
+    argo_writer_put(w, ARGO_QUOTE);
+    return w->error;
+}
+
+//Write a member name, copying the bytes of an interned name straight into the buffer when it has them
+static void writer_name(ARGO_WRITER *w, ARGO_STRING *name){
+    const unsigned char *plain = argo_name_interned(name) ? argo_interned(name)->plain : NULL;
+    if (plain == NULL || name->length > ARGO_WRITER_BUFFER - 2){
+        argo_writer_string(w, name);
+        return;
+    }
+    unsigned char *out = argo_writer_reserve(w, name->length + 2);
+    *out = ARGO_QUOTE;
+    __builtin_memcpy(out + 1, plain, name->length);
+    *(out + name->length + 1) = ARGO_QUOTE;
+    w->len += name->length + 2;
+}
+
+/**
+ * @brief  Write canonical JSON representing a number to a writer.
+ * @details  The output is the same as for argo_write_number: an integer if
+ * the number has a valid integer value, and argo_format_double's form otherwise.
+ *
+ * @param w  Writer to write to.
+ * @param n  Number to write.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_writer_number(ARGO_WRITER *w, ARGO_NUMBER *n){
+    if (n->valid_int){
+        unsigned char *out = argo_writer_reserve(w, LONG_BUFFER);
+        unsigned long magnitude = n->int_value < 0 ? 0UL - (unsigned long)n->int_value : (unsigned long)n->int_value;
+        char digits[LONG_BUFFER];
+        int count = 0;
+        do{
+            *(digits + count++) = ARGO_DIGIT0 + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude > 0);
+        if (n->int_value < 0) *out++ = ARGO_MINUS;
+        while (count > 0) *out++ = *(digits + --count);
+        w->len = out - w->buf;
+    }
+    else if (n->valid_float){
+        char *out = (char *)argo_writer_reserve(w, ARGO_DOUBLE_BUFFER);
+        int length = argo_format_double(n->float_value, out);
+        if (length < 0) return -1;
+        w->len += length;
+    }
+    else return -1;
+    return w->error;
+}
+
+/**
+ * @brief  Write one of the basic tokens (true, false, or null) to a writer.
+ *
+ * @param w  Writer to write to.
+ * @param b  Token to write.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_writer_basic(ARGO_WRITER *w, ARGO_BASIC b){
+    if (b == ARGO_NULL) argo_writer_bytes(w, ARGO_NULL_TOKEN, sizeof(ARGO_NULL_TOKEN) - 1);
+    else if (b == ARGO_TRUE) argo_writer_bytes(w, ARGO_TRUE_TOKEN, sizeof(ARGO_TRUE_TOKEN) - 1);
+    else argo_writer_bytes(w, ARGO_FALSE_TOKEN, sizeof(ARGO_FALSE_TOKEN) - 1);
+    return w->error;
+}
+
+//Write the end of a container, which goes back to the indentation of its start
+static void writer_close_container(ARGO_CTX *cx, ARGO_WRITER *w, ARGO_VALUE *v){
+    cx->level--;
+    argo_ctx_writer_newline(cx, w);
+    argo_writer_put(w, v->type == ARGO_OBJECT_TYPE ? ARGO_RBRACE : ARGO_RBRACK);
+}
+
+//Push a frame for a container whose members or elements are being written, starting with "child"
+static int writer_push(ARGO_WRITER *w, ARGO_VALUE *container, ARGO_VALUE *child){
+    if (w->depth == w->frames_size){
+        size_t size = w->frames_size == 0 ? 64 : w->frames_size * 2;
+        ARGO_WRITER_FRAME *grown = realloc(w->frames, size * sizeof(ARGO_WRITER_FRAME));
+        if (grown == NULL){
+            fprintf(stderr, "Error: Failed to allocate space for nesting depth %lu\n", w->depth);
+            return -1;
+        }
+        w->frames = grown;
+        w->frames_size = size;
+    }
+    ARGO_WRITER_FRAME *f = w->frames + w->depth++;
+    f->container = container;
+    f->child = child;
+    return 0;
+}
+
+/**
+ * @brief  Write canonical JSON representing a value to a writer.
+ * @details  The output is the same as for argo_write_value, including pretty
+ * printing if the writer was opened with it selected. The nesting of the value
+ * is tracked with level, which should be zero for a value at the top level.
+ *
+ * @param w  Writer to write to.
+ * @param v  Value to write.
+ * @return  Zero if the operation is completely successful, nonzero if there is any error.
+ */
+int argo_writer_value(ARGO_WRITER *w, ARGO_VALUE *v){
+    ARGO_CTX *cx = argo_default_ctx_enter();
+    int ret = argo_ctx_writer_value(cx, w, v);
+    argo_default_ctx_leave(cx);
+    return ret;
+}
+
+//Write canonical JSON representing a value to a writer, tracking its nesting with the level of a context (see argo_writer_value)
+int argo_ctx_writer_value(ARGO_CTX *cx, ARGO_WRITER *w, ARGO_VALUE *v){
+    int ret = 0;
+    size_t base = w->depth;
+    //Nested containers are written without recursing: each open one has a frame holding the member or element being written
+    while (true){
+        bool done = true; //done is set once v has been written in full
+        //Members of an object always have their names written (an empty one has no content, but is still written as "").
+        //A value written on its own only has its name written if it has one
+        if (w->depth > base ? (w->frames + w->depth - 1)->container->type == ARGO_OBJECT_TYPE : v->name.content != NULL){
+            writer_name(w, &v->name);
+            if (w->indent >= 0) argo_writer_bytes(w, ": ", 2);
+            else argo_writer_put(w, ARGO_COLON);
+        }
+        switch (v->type){
+            case ARGO_NO_TYPE: break;
+            case ARGO_BASIC_TYPE: ret = argo_writer_basic(w, v->content.basic); break;
+            case ARGO_NUMBER_TYPE: ret = argo_writer_number(w, &v->content.number); break;
+            case ARGO_STRING_TYPE: ret = argo_writer_string(w, &v->content.string); break;
+            case ARGO_UTF8_TYPE: ret = argo_writer_utf8(w, &v->content.utf8); break;
+            case ARGO_OBJECT_TYPE:
+            case ARGO_ARRAY_TYPE: {
+                ARGO_VALUE *sentinel = v->type == ARGO_ARRAY_TYPE ? v->content.array.element_list : v->content.object.member_list;
+                cx->level++;
+                argo_writer_put(w, v->type == ARGO_OBJECT_TYPE ? ARGO_LBRACE : ARGO_LBRACK);
+                argo_ctx_writer_newline(cx, w);
+                //An empty container is closed straight away
+                if (sentinel->next == sentinel || (ret = writer_push(w, v, sentinel->next))) writer_close_container(cx, w, v);
+                else {
+                    v = sentinel->next;
+                    done = false;
+                }
+                break;
+            }
+        }
+        if (!done) continue;
+        //Move on to the next member or element of the innermost open container, closing each container that has none left
+        //(if there has been an error, then the open containers are all closed without writing anything more in them)
+        while (w->depth > base){
+            ARGO_WRITER_FRAME *f = w->frames + w->depth - 1;
+            ARGO_VALUE *sentinel = f->container->type == ARGO_ARRAY_TYPE ? f->container->content.array.element_list : f->container->content.object.member_list;
+            if (ret == 0 && f->child->next != sentinel){
+                argo_writer_put(w, ARGO_COMMA);
+                argo_ctx_writer_newline(cx, w);
+                f->child = f->child->next;
+                v = f->child;
+                done = false;
+                break;
+            }
+            w->depth--;
+            writer_close_container(cx, w, f->container);
+            v = f->container;
+        }
+        if (done) break;
+    }
+    if (ret) return ret;
+    //A value at the top level is followed by a newline (twice, for scalars) when pretty printing
+    if (cx->level == 0 && v->type != ARGO_OBJECT_TYPE && v->type != ARGO_ARRAY_TYPE && v->type != ARGO_NO_TYPE) argo_ctx_writer_newline(cx, w);
+    if (cx->level == 0 && w->indent >= 0) argo_writer_put(w, ARGO_LF);
+    return w->error;
+}
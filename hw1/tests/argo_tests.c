@@ -0,0 +1,1128 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "argo.h"
+#include "global.h"
+#include "options.h"
+#include "input.h"
+#include "arena.h"
+#include "structural.h"
+#include "events.h"
+#include "utf8.h"
+#include "number.h"
+#include "dtoa.h"
+#include "writer.h"
+#include "validity.h"
+#include "access.h"
+#include "query.h"
+#include "lines.h"
+#include "push.h"
+#include "tape.h"
+#include "intern.h"
+#include "lazy.h"
+#include "split.h"
+#include "validate.h"
+#include "hash.h"
+#include "sort.h"
+#include "ctx.h"
+
+Test(argo_suite, read_value_mem_test) {
+    char *json = "{\"a\": [1, 2, 3], \"b\": \"text\"}";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    cr_assert_eq(v->type, ARGO_OBJECT_TYPE, "Expected an object. Got type %d", v->type);
+    ARGO_VALUE *a = v->content.object.member_list->next;
+    cr_assert_eq(a->type, ARGO_ARRAY_TYPE, "Expected member \"a\" to be an array. Got type %d", a->type);
+}
+
+Test(argo_suite, read_value_mem_eof_test) {
+    //A number or basic value can be terminated by the end of the buffer
+    ARGO_VALUE *v = argo_read_value_mem("42", 2);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for a number ending at EOF");
+    cr_assert_eq(v->content.number.int_value, 42, "Expected 42. Got %ld", v->content.number.int_value);
+    v = argo_read_value_mem("[1, 2", 5);
+    cr_assert_null(v, "argo_read_value_mem accepted an unterminated array");
+}
+
+Test(argo_suite, read_string_exact_test) {
+    //argo_read_string must not consume anything after the closing quote
+    FILE *f = fmemopen("\"abc\",rest", 10, "r");
+    ARGO_STRING s = {0};
+    int ret = argo_read_string(&s, f);
+    cr_assert_eq(ret, 0, "argo_read_string failed. Got: %d", ret);
+    cr_assert_eq(s.length, 3, "Expected a string of length 3. Got: %lu", s.length);
+    cr_assert_eq(fgetc(f), ',', "Stream was not left just after the string");
+    fclose(f);
+}
+
+Test(argo_suite, arena_reset_test) {
+    ARGO_ARENA a = {0};
+    int i;
+    //Allocate more than the first chunk holds, so that the arena has to grow
+    for (i = 0; i < 1000; i++) cr_assert_not_null(argo_arena_alloc(&a, 100), "Allocation %d failed", i);
+    size_t peak = a.peak;
+    cr_assert_geq(peak, 100000, "Peak usage not recorded. Got: %lu", peak);
+    void *first = argo_arena_alloc(&a, 16);
+    argo_arena_reset(&a);
+    cr_assert_eq(a.used, 0, "Arena not empty after reset");
+    cr_assert_eq(a.peak, peak + 16, "Peak usage lost on reset");
+    //After a reset, space is reused from the first chunk
+    void *p = argo_arena_alloc(&a, 16);
+    cr_assert_neq(p, first, "Allocation after reset did not start over");
+    cr_assert_eq(a.current, a.first, "Allocation after reset did not reuse the first chunk");
+    argo_arena_free(&a);
+}
+
+Test(argo_suite, structural_index_test) {
+    //The quote at offset 4 is escaped, so the ':' and ',' after it are inside the string
+    char *json = "{\"k\\\":,\":[1,\n{}]}";
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, json, 17);
+    //Asking for a string span builds the index without consuming anything (the span stops at the first quote)
+    cr_assert_eq(argo_string_span(&in), 1, "Span should stop at a quote");
+    cr_assert_not_null(in.index, "Index was not built");
+    cr_assert_eq(in.index->nl[0], 1 << 12, "Wrong newline mask. Got: 0x%lx", in.index->nl[0]);
+    cr_assert_eq(in.index->ws[0], 1 << 12, "Wrong whitespace mask. Got: 0x%lx", in.index->ws[0]);
+    //Past the end of the input, the block is padded with NUL bytes, which are special
+    uint64_t special = (1 << 1) | (1 << 3) | (1 << 4) | (1 << 7) | (1 << 12) | ~(uint64_t)0 << 17;
+    cr_assert_eq(in.index->special[0], special, "Wrong special mask. Got: 0x%lx | Expected: 0x%lx",
+		 in.index->special[0], special);
+    argo_input_close(&in);
+    //The structural characters outside of strings are found from the raw masks of the block
+    unsigned char block[ARGO_BLOCK_SIZE] = {0};
+    __builtin_memcpy(block, json, 17);
+    ARGO_BLOCK_MASKS m;
+    argo_classify_block(block, &m);
+    uint64_t prev_escaped = 0;
+    uint64_t quote = m.quote & ~argo_find_escaped(m.bslash, &prev_escaped);
+    cr_assert_eq(quote, (1 << 1) | (1 << 7), "Escaped quote was not excluded. Got: 0x%lx", quote);
+    uint64_t expected = (1 << 0) | (1 << 8) | (1 << 9) | (1 << 11) | (1 << 13) | (1 << 14) | (1 << 15) | (1 << 16);
+    uint64_t structural = m.op & ~argo_prefix_xor(quote);
+    cr_assert_eq(structural, expected, "Wrong structural mask. Got: 0x%lx | Expected: 0x%lx", structural, expected);
+}
+
+//Record each event as one character, so that the order of the events can be checked
+static int ev_obj(void *ctx) {char **p = ctx; *(*p)++ = '{'; return 0;}
+static int ev_end_obj(void *ctx) {char **p = ctx; *(*p)++ = '}'; return 0;}
+static int ev_arr(void *ctx) {char **p = ctx; *(*p)++ = '['; return 0;}
+static int ev_end_arr(void *ctx) {char **p = ctx; *(*p)++ = ']'; return 0;}
+static int ev_key(void *ctx, ARGO_STRING *s) {char **p = ctx; *(*p)++ = 'k'; return 0;}
+static int ev_str(void *ctx, ARGO_STRING *s) {char **p = ctx; *(*p)++ = 's'; return 0;}
+static int ev_num(void *ctx, ARGO_NUMBER *n) {char **p = ctx; *(*p)++ = 'n'; return n->int_value == 7 ? -1 : 0;}
+static int ev_basic(void *ctx, ARGO_BASIC b) {char **p = ctx; *(*p)++ = 'b'; return 0;}
+
+Test(argo_suite, parse_events_test) {
+    ARGO_HANDLER h = {ev_obj, ev_end_obj, ev_arr, ev_end_arr, ev_key, ev_str, ev_num, ev_basic};
+    char events[32] = {0};
+    char *p = events;
+    char *json = "{\"a\": [1, \"x\", {}], \"b\": null, \"c\": []}";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, json, len);
+    int ret = argo_parse_events(&in, &h, &p);
+    argo_input_close(&in);
+    cr_assert_eq(ret, 0, "argo_parse_events failed. Got: %d", ret);
+    cr_assert_str_eq(events, "{k[ns{}]kbk[]}", "Wrong events. Got: %s", events);
+    //A callback can stop the parse
+    p = events;
+    argo_input_open_mem(&in, "[7, 8]", 6);
+    ret = argo_parse_events(&in, &h, &p);
+    argo_input_close(&in);
+    cr_assert_neq(ret, 0, "Parse was not stopped by the callback");
+    cr_assert_eq(p - events, 2, "Events were reported after the callback stopped the parse");
+}
+
+Test(argo_suite, validate_test) {
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, "[1, {\"a\": true}]", 16);
+    cr_assert_eq(argo_validate(&in), 0, "Valid input was rejected");
+    argo_input_close(&in);
+    argo_input_open_mem(&in, "{\"a\" 1}", 7);
+    cr_assert_neq(argo_validate(&in), 0, "Missing ':' was accepted");
+    argo_input_close(&in);
+}
+
+//Send standard error to a temporary file, or (once "saved" is passed back) put it back and read what was written into "text"
+static FILE *capture_stderr(int *saved, FILE *f, char *text, size_t size){
+    fflush(stderr);
+    if (f == NULL){
+        f = tmpfile();
+        *saved = dup(2);
+        dup2(fileno(f), 2);
+        return f;
+    }
+    dup2(*saved, 2);
+    close(*saved);
+    rewind(f);
+    size_t n = fread(text, 1, size - 1, f);
+    *(text+n) = '\0';
+    fclose(f);
+    return NULL;
+}
+
+Test(argo_suite, container_error_test) {
+    //The tree reader and the event parser report an unterminated container the same way
+    char *json = "{\"a\": [1,\n2\n3]}";
+    char tree[128], events[128];
+    int saved;
+    argo_lines_read = 0;
+    FILE *f = capture_stderr(&saved, NULL, NULL, 0);
+    cr_assert_null(argo_read_value_mem(json, 15), "A missing ',' was accepted");
+    capture_stderr(&saved, f, tree, sizeof(tree));
+    argo_lines_read = 0;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, json, 15);
+    f = capture_stderr(&saved, NULL, NULL, 0);
+    cr_assert_neq(argo_validate(&in), 0, "A missing ',' was accepted");
+    capture_stderr(&saved, f, events, sizeof(events));
+    argo_input_close(&in);
+    cr_assert_str_eq(tree, "Error: Expected ',' or ']' at line 3\n", "Wrong error from the tree reader: %s", tree);
+    cr_assert_str_eq(events, tree, "The event parser reported: %s", events);
+}
+
+Test(argo_suite, truncated_input_test) {
+    //Input that ends before its value does is an error for the tree reader, reported as the event parser reports it
+    char *inputs[] = {"", "{", "[", "{\"a\"", "{\"a\":", "{\"a\":1,", "[1,", "[[1],\n", "{\"a\":{\"b\":["};
+    char tree[128], events[128];
+    int saved;
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); i++){
+        size_t len = __builtin_strlen(inputs[i]);
+        ARGO_INPUT in;
+        argo_lines_read = 0;
+        FILE *f = capture_stderr(&saved, NULL, NULL, 0);
+        cr_assert_null(argo_read_value_mem(inputs[i], len), "Truncated input was read: %s", inputs[i]);
+        capture_stderr(&saved, f, tree, sizeof(tree));
+        argo_lines_read = 0;
+        argo_input_open_mem(&in, inputs[i], len);
+        f = capture_stderr(&saved, NULL, NULL, 0);
+        cr_assert_neq(argo_validate(&in), 0, "Truncated input was validated: %s", inputs[i]);
+        capture_stderr(&saved, f, events, sizeof(events));
+        argo_input_close(&in);
+        cr_assert_str_eq(tree, events, "For %s, the tree reader reported: %s", inputs[i], tree);
+    }
+}
+
+Test(argo_suite, utf8_strings_test) {
+    char *json = "[\"short\", \"a string that is too long to be stored inline\", \"tab\\there\", \"\\u00e9\"]";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    argo_utf8_strings = 1;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    argo_utf8_strings = 0;
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    ARGO_VALUE *e = v->content.array.element_list->next;
+    cr_assert_eq(e->type, ARGO_UTF8_TYPE, "Expected a UTF-8 string. Got type %d", e->type);
+    cr_assert_eq(e->content.utf8.storage, ARGO_UTF8_SHORT, "Short string was not stored inline");
+    cr_assert(argo_utf8_equal(&e->content.utf8, "short", 5), "Wrong text for short string");
+    e = e->next;
+    cr_assert_eq(e->content.utf8.storage, ARGO_UTF8_SLICE, "Long string without escapes was copied");
+    cr_assert_eq(e->content.utf8.text.bytes, (unsigned char *)json + 11, "Slice does not point into the input");
+    e = e->next;
+    cr_assert(argo_utf8_equal(&e->content.utf8, "tab\there", 8), "Escape was not decoded");
+    //A non-ASCII escape falls back to an ARGO_STRING
+    e = e->next;
+    cr_assert_eq(e->type, ARGO_STRING_TYPE, "Expected an ARGO_STRING. Got type %d", e->type);
+    cr_assert_eq(*e->content.string.content, 0xe9, "Wrong character for \\u00e9");
+}
+
+Test(argo_suite, parse_number_test) {
+    ARGO_NUMBER n;
+    cr_assert_eq(argo_parse_number((unsigned char *)"9007199254740993", 16, &n), 0, "Valid integer was rejected");
+    cr_assert_eq(n.valid_int, 1, "Integer was not given an integer value");
+    cr_assert_eq(n.int_value, 9007199254740993L, "Integer was not exact. Got: %ld", n.int_value);
+    cr_assert_eq(n.valid_string, 0, "Textual form should be made on demand");
+    cr_assert_eq(argo_parse_number((unsigned char *)"-1.5E+2", 7, &n), 0, "Valid float was rejected");
+    cr_assert_eq(n.valid_int, 0, "Float was given an integer value");
+    cr_assert_eq(n.float_value, -150.0, "Got: %f", n.float_value);
+    //0.1 and 2.2250738585072011e-308 are not exact in binary, so they have to be correctly rounded
+    cr_assert_eq(argo_parse_number((unsigned char *)"0.1", 3, &n), 0, "Valid float was rejected");
+    cr_assert_eq(n.float_value, 0.1, "0.1 was not correctly rounded");
+    cr_assert_eq(argo_parse_number((unsigned char *)"2.2250738585072011e-308", 23, &n), 0, "Valid float was rejected");
+    cr_assert_eq(n.float_value, 2.2250738585072011e-308, "Smallest normal was not correctly rounded");
+    cr_assert_neq(argo_parse_number((unsigned char *)"01", 2, &n), 0, "Leading zero was accepted");
+    cr_assert_neq(argo_parse_number((unsigned char *)"1.", 2, &n), 0, "Missing fraction digits were accepted");
+    cr_assert_neq(argo_parse_number((unsigned char *)"1e400", 5, &n), 0, "Out of range number was accepted");
+    argo_parse_number((unsigned char *)"-42", 3, &n);
+    cr_assert_eq(argo_number_string(&n), 0, "argo_number_string failed");
+    cr_assert_eq(n.string_value.length, 3, "Wrong text length. Got: %lu", n.string_value.length);
+    cr_assert_eq(*n.string_value.content, '-', "Wrong text");
+}
+
+Test(argo_suite, format_double_test) {
+    char buf[ARGO_DOUBLE_BUFFER + 1];
+    double values[] = {1.234, -1.0, 1e-3, 0.0, 5e-324, 1.7976931348623157e308, 123456.0};
+    char *expected[] = {"0.1234e1", "-0.1e1", "0.1e-2", "0.0", "0.5e-323", "0.17976931348623157e309", "0.123456e6"};
+    int i;
+    for (i = 0; i < 7; i++){
+        int length = argo_format_double(*(values+i), buf);
+        cr_assert_geq(length, 0, "Formatting %g failed", *(values+i));
+        *(buf+length) = '\0';
+        cr_assert_str_eq(buf, *(expected+i), "Wrong format for %g. Got: %s | Expected: %s", *(values+i), buf, *(expected+i));
+    }
+    cr_assert_lt(argo_format_double(__builtin_inf(), buf), 0, "Infinity was formatted");
+}
+
+
+//Sink for writer_sink_test, which collects output and counts the flushes
+static unsigned char sink_bytes[2 * ARGO_WRITER_BUFFER];
+static size_t sink_length;
+static int sink_calls;
+
+static int collect_sink(void *ctx, const unsigned char *bytes, size_t len){
+    if (sink_length + len > sizeof(sink_bytes)) return -1;
+    __builtin_memcpy(sink_bytes + sink_length, bytes, len);
+    sink_length += len;
+    sink_calls++;
+    return 0;
+}
+
+Test(argo_suite, writer_sink_test) {
+    char *json = "[\"a\\u0001\\n\", -12, 0.5, {\"k\": null}]";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    global_options = CANONICALIZE_OPTION;
+    level = 0;
+    ARGO_WRITER w;
+    cr_assert_eq(argo_writer_open_sink(&w, collect_sink, NULL), 0, "argo_writer_open_sink failed");
+    cr_assert_eq(argo_writer_value(&w, v), 0, "argo_writer_value failed");
+    cr_assert_eq(sink_calls, 0, "Output was flushed before the writer was");
+    cr_assert_eq(argo_writer_close(&w), 0, "argo_writer_close failed");
+    char *expected = "[\"a\\u0001\\n\",-12,0.5,{\"k\":null}]";
+    size_t expectedLength = 0;
+    while (*(expected+expectedLength) != '\0') expectedLength++;
+    cr_assert_eq(sink_calls, 1, "Expected a single flush. Got: %d", sink_calls);
+    cr_assert_eq(sink_length, expectedLength, "Wrong output length. Got: %lu", sink_length);
+    cr_assert_eq(__builtin_memcmp(sink_bytes, expected, expectedLength), 0, "Wrong output");
+    //A run longer than the buffer goes straight to the sink
+    sink_length = 0;
+    sink_calls = 0;
+    argo_writer_open_sink(&w, collect_sink, NULL);
+    argo_writer_put(&w, ARGO_QUOTE);
+    argo_writer_bytes(&w, sink_bytes + ARGO_WRITER_BUFFER, ARGO_WRITER_BUFFER);
+    cr_assert_eq(argo_writer_close(&w), 0, "argo_writer_close failed");
+    cr_assert_eq(sink_length, ARGO_WRITER_BUFFER + 1, "Wrong output length. Got: %lu", sink_length);
+}
+
+Test(argo_suite, object_get_test) {
+    char *json = "{\"m0\": 0, \"m1\": 1, \"m2\": 2, \"m3\": 3, \"m4\": 4, \"m5\": 5, \"m6\": 6, "
+                 "\"m7\": 7, \"m8\": 8, \"m9\": 9, \"m1\": 10, \"\": 11, \"small\": {\"a\": true}}";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    ARGO_VALUE *small = argo_object_get(v, "small");
+    cr_assert_not_null(small, "Member \"small\" was not found");
+    cr_assert_not_null(v->content.object.index, "A wide object was not indexed");
+    cr_assert_not_null(argo_object_get(small, "a"), "Member of a small object was not found");
+    cr_assert_null(small->content.object.index, "A small object was indexed");
+    cr_assert_null(argo_object_get(small, "b"), "Missing member was found");
+    ARGO_VALUE *m = argo_object_get(v, "m9");
+    cr_assert_not_null(m, "Member \"m9\" was not found");
+    cr_assert_eq(m->content.number.int_value, 9, "Wrong member. Got: %ld", m->content.number.int_value);
+    m = argo_object_get(v, "m1");
+    cr_assert_eq(m->content.number.int_value, 1, "Expected the first of the duplicate members. Got: %ld", m->content.number.int_value);
+    m = argo_object_get(v, "");
+    cr_assert_not_null(m, "Member with an empty name was not found");
+    cr_assert_eq(m->content.number.int_value, 11, "Wrong member. Got: %ld", m->content.number.int_value);
+    cr_assert_null(argo_object_get(v, "m10"), "Missing member was found");
+    cr_assert_null(argo_object_get(m, "m1"), "A number was searched as an object");
+}
+
+Test(argo_suite, array_at_test) {
+    char *json = "[10, [], [1, [2, 3], 4], \"s\", 14]";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    cr_assert_eq(argo_array_len(v), 5, "Wrong length. Got: %lu", argo_array_len(v));
+    cr_assert_eq(argo_array_at(v, 0)->content.number.int_value, 10, "Wrong first element");
+    cr_assert_eq(argo_array_at(v, 4)->content.number.int_value, 14, "Wrong last element");
+    cr_assert_null(argo_array_at(v, 5), "Element past the end was found");
+    cr_assert_eq(argo_array_len(argo_array_at(v, 1)), 0, "Empty array has elements");
+    ARGO_VALUE *inner = argo_array_at(v, 2);
+    cr_assert_eq(argo_array_len(inner), 3, "Wrong length of nested array. Got: %lu", argo_array_len(inner));
+    cr_assert_eq(argo_array_at(argo_array_at(inner, 1), 1)->content.number.int_value, 3, "Wrong element of innermost array");
+    cr_assert_eq(argo_array_at(inner, 2)->content.number.int_value, 4, "Wrong element after a nested array");
+    //The elements are the same values as those in the list
+    ARGO_VALUE *e = v->content.array.element_list->next;
+    size_t i;
+    for (i = 0; i < argo_array_len(v); i++, e = e->next) cr_assert_eq(argo_array_at(v, i), e, "Element %lu differs from the list", i);
+    cr_assert_eq(argo_array_len(argo_array_at(v, 3)), 0, "A string has elements");
+}
+
+//Sink for query_test, which counts the values selected
+static int count_match(void *ctx, ARGO_VALUE *v){
+    (*(int *)ctx)++;
+    return 0;
+}
+
+Test(argo_suite, query_test) {
+    char *json = "{\"a\": {\"b\": [1, {\"c\": 7}, 3], \"x/y\": true}, \"n\": [4, 5, 6]}";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    ARGO_VALUE *m = argo_query(v, "/a/b/1/c");
+    cr_assert_not_null(m, "JSON Pointer selected nothing");
+    cr_assert_eq(m->content.number.int_value, 7, "Wrong value. Got: %ld", m->content.number.int_value);
+    cr_assert_eq(argo_query(v, "$.a.b[1].c"), m, "JSONPath selected a different value");
+    cr_assert_eq(argo_query(v, "$['a'].b[-2]['c']"), m, "Quoted names or negative indexes failed");
+    cr_assert_eq(argo_query(v, ""), v, "Empty pointer should select the whole value");
+    cr_assert_not_null(argo_query(v, "/a/x~1y"), "Escaped pointer token failed");
+    cr_assert_null(argo_query(v, "/n/3"), "Index past the end was selected");
+    cr_assert_null(argo_query(v, "/n/01"), "Index with a leading zero was selected");
+    cr_assert_null(argo_query_compile("a.b"), "Query without '/' or '$' was compiled");
+    cr_assert_null(argo_query_compile("$.a[1"), "Query without ']' was compiled");
+    ARGO_QUERY *q = argo_query_compile("$.n[*]");
+    cr_assert_not_null(q, "Wildcard query was not compiled");
+    cr_assert_eq(q->multiple, 1, "Wildcard query should be able to select several values");
+    int count = 0;
+    cr_assert_eq(argo_query_eval(q, v, count_match, &count), 3, "Wrong number of values selected");
+    cr_assert_eq(count, 3, "Callback was called %d times", count);
+    argo_query_free(q);
+}
+
+Test(argo_suite, lines_test) {
+    char *ndjson = "[1, 2]\n\n{\"a\": true}\n[3,\n4";
+    size_t len = 0;
+    while (*(ndjson+len) != '\0') len++;
+    global_options = CANONICALIZE_OPTION;
+    FILE *out = tmpfile();
+    cr_assert_not_null(out, "tmpfile failed");
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, ndjson, len);
+    cr_assert_neq(argo_write_lines(&in, out), 0, "An invalid record was not reported");
+    char *expected = "[1,2]\n{\"a\":true}\n4\n";
+    size_t expectedLength = 0;
+    while (*(expected+expectedLength) != '\0') expectedLength++;
+    char got[64];
+    rewind(out);
+    size_t gotLength = fread(got, 1, sizeof(got), out);
+    fclose(out);
+    //The invalid record on line 4 is left out, and the last line doesn't need a newline
+    cr_assert_eq(gotLength, expectedLength, "Wrong output length. Got: %lu", gotLength);
+    cr_assert_eq(__builtin_memcmp(got, expected, expectedLength), 0, "Wrong output");
+}
+
+Test(argo_suite, lines_jobs_test) {
+    char *ndjson = "{\"a\": [1, 2]}\n[3,\n\"b\"\n";
+    size_t len = 0;
+    while (*(ndjson+len) != '\0') len++;
+    global_options = CANONICALIZE_OPTION;
+    argo_jobs = 2;
+    FILE *out = tmpfile();
+    cr_assert_not_null(out, "tmpfile failed");
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, ndjson, len);
+    cr_assert_neq(argo_write_lines(&in, out), 0, "An invalid record was not reported by a worker");
+    argo_jobs = 1;
+    char *expected = "{\"a\":[1,2]}\n\"b\"\n";
+    size_t expectedLength = 0;
+    while (*(expected+expectedLength) != '\0') expectedLength++;
+    char got[64];
+    rewind(out);
+    size_t gotLength = fread(got, 1, sizeof(got), out);
+    fclose(out);
+    cr_assert_eq(gotLength, expectedLength, "Wrong output length. Got: %lu", gotLength);
+    cr_assert_eq(__builtin_memcmp(got, expected, expectedLength), 0, "Wrong output");
+}
+
+Test(argo_suite, push_parser_test) {
+    //Every token but the first is split between chunks
+    char *chunks[] = {"{\"a\": [1", "2, tr", "ue], \"b\": \"x\\", "ny\"} -", "7"};
+    ARGO_PARSER p;
+    ARGO_VALUE *obj = NULL;
+    argo_parser_open(&p, NULL, NULL);
+    int i;
+    for (i = 0; i < 5; i++){
+        size_t len = 0;
+        while (*(chunks[i]+len) != '\0') len++;
+        cr_assert_eq(argo_parser_feed(&p, chunks[i], len), 0, "Chunk %d was rejected", i);
+        if (i == 3) cr_assert_not_null(obj = argo_parser_value(&p), "The object wasn't ready as soon as it was closed");
+    }
+    ARGO_VALUE *a = argo_object_get(obj, "a");
+    cr_assert_eq(argo_array_len(a), 2, "Wrong number of elements. Got: %lu", argo_array_len(a));
+    cr_assert_eq(argo_array_at(a, 0)->content.number.int_value, 12, "A number split between chunks was misread");
+    cr_assert_eq(argo_array_at(a, 1)->content.basic, ARGO_TRUE, "A literal split between chunks was misread");
+    ARGO_VALUE *b = argo_object_get(obj, "b");
+    cr_assert_not_null(b, "Member b is missing");
+    cr_assert_eq(b->content.string.length, 3, "An escape split between chunks was misread");
+    cr_assert_eq(*(b->content.string.content+1), ARGO_LF, "An escape split between chunks was misread");
+    cr_assert_null(argo_parser_value(&p), "The number was ready before the end of the input");
+    cr_assert_eq(argo_parser_finish(&p), 0, "argo_parser_finish failed");
+    ARGO_VALUE *n = argo_parser_value(&p);
+    cr_assert_not_null(n, "The number wasn't ready at the end of the input");
+    cr_assert_eq(n->content.number.int_value, -7, "Wrong number. Got: %ld", n->content.number.int_value);
+    argo_parser_close(&p);
+    //A string cut off by the end of the input is an error
+    argo_parser_open(&p, NULL, NULL);
+    cr_assert_eq(argo_parser_feed(&p, "[\"ab", 4), 0, "Incomplete input was rejected early");
+    cr_assert_neq(argo_parser_finish(&p), 0, "An unterminated string was accepted");
+    argo_parser_close(&p);
+}
+
+Test(argo_suite, tape_test) {
+    char *json = "{\"a\": [1, -2.5, \"x\\u0101y\", null], \"b\": {\"c\": true}, \"s\": \"text\"}";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    FILE *f = tmpfile();
+    cr_assert_not_null(f, "tmpfile failed");
+    cr_assert_eq(argo_tape_save(v, f), 0, "argo_tape_save failed");
+    fflush(f);
+    ARGO_TAPE t;
+    cr_assert_eq(argo_tape_load(&t, f), 0, "argo_tape_load failed");
+    fclose(f);
+    cr_assert_eq(argo_tape_type(&t, 0), ARGO_OBJECT_TYPE, "Expected an object. Got type %d", argo_tape_type(&t, 0));
+    size_t a = argo_tape_object_get(&t, 0, "a");
+    cr_assert_eq(argo_tape_array_len(&t, a), 4, "Wrong length. Got: %lu", argo_tape_array_len(&t, a));
+    ARGO_NUMBER n;
+    cr_assert_eq(argo_tape_number(&t, argo_tape_array_at(&t, a, 1), &n), 0, "Element 1 isn't a number");
+    cr_assert(!n.valid_int && n.float_value == -2.5, "Wrong number. Got: %f", n.float_value);
+    //A string with a character above 0xFF is kept as characters rather than bytes
+    size_t wide = argo_tape_array_at(&t, a, 2), length;
+    cr_assert_null(argo_tape_bytes(&t, wide, &length), "A wide string was held as bytes");
+    ARGO_STRING chars = {0};
+    cr_assert_eq(argo_tape_chars(&t, wide, &chars), 0, "argo_tape_chars failed");
+    cr_assert(chars.length == 3 && *(chars.content+1) == 0x101, "Wrong characters of a wide string");
+    cr_assert_eq(argo_tape_array_at(&t, a, 4), ARGO_TAPE_NONE, "Element past the end was found");
+    //Members after a container are found by skipping it
+    const unsigned char *text = argo_tape_bytes(&t, argo_tape_object_get(&t, 0, "s"), &length);
+    cr_assert(text != NULL && length == 4 && *text == 't', "Wrong member after a container");
+    cr_assert_eq(argo_tape_basic(&t, argo_tape_object_get(&t, argo_tape_object_get(&t, 0, "b"), "c")), ARGO_TRUE, "Wrong nested member");
+    cr_assert_eq(argo_tape_object_get(&t, 0, "z"), ARGO_TAPE_NONE, "Missing member was found");
+    //Written out, the tape is the same as the value it was saved from
+    global_options = CANONICALIZE_OPTION;
+    char expected[128], got[128];
+    FILE *out = fmemopen(expected, sizeof(expected), "w");
+    argo_write_value(v, out);
+    size_t expectedLength = ftell(out);
+    fclose(out);
+    out = fmemopen(got, sizeof(got), "w");
+    cr_assert_eq(argo_tape_write_value(&t, 0, out), 0, "argo_tape_write_value failed");
+    size_t gotLength = ftell(out);
+    fclose(out);
+    cr_assert_eq(gotLength, expectedLength, "Wrong output length. Got: %lu", gotLength);
+    cr_assert_eq(__builtin_memcmp(got, expected, expectedLength), 0, "Wrong output");
+    argo_tape_close(&t);
+    cr_assert_neq(argo_tape_open_mem(&t, json, len), 0, "JSON text was opened as a tape");
+}
+
+Test(argo_suite, read_tape_test) {
+    char *json = "[{\"id\": 1, \"tags\": [\"a\", \"b\"]}, {\"id\": 2, \"tags\": []}, 3.5]";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, json, len);
+    ARGO_TAPE t;
+    cr_assert_eq(argo_read_tape(&t, &in), 0, "argo_read_tape failed for valid input");
+    cr_assert_eq(argo_tape_array_len(&t, 0), 3, "Wrong length. Got: %lu", argo_tape_array_len(&t, 0));
+    ARGO_TAPE_ITER it, members;
+    cr_assert_eq(argo_tape_iter_open(&it, &t, 0), 0, "Couldn't iterate over an array");
+    size_t e, m, name, length;
+    long ids = 0;
+    int count = 0;
+    while ((e = argo_tape_iter_next(&it, &name)) != ARGO_TAPE_NONE){
+        cr_assert_eq(name, ARGO_TAPE_NONE, "An element of an array has a name");
+        count++;
+        if (argo_tape_type(&t, e) != ARGO_OBJECT_TYPE) continue;
+        argo_tape_iter_open(&members, &t, e);
+        //The members come in order, with the array in between skipped
+        m = argo_tape_iter_next(&members, &name);
+        const unsigned char *text = argo_tape_bytes(&t, name, &length);
+        cr_assert(length == 2 && *text == 'i', "Wrong name of the first member");
+        ARGO_NUMBER n;
+        argo_tape_number(&t, m, &n);
+        ids += n.int_value;
+        cr_assert_eq(argo_tape_type(&t, argo_tape_iter_next(&members, &name)), ARGO_ARRAY_TYPE, "Expected the tags");
+        cr_assert_eq(argo_tape_iter_next(&members, &name), ARGO_TAPE_NONE, "Member past the end was found");
+    }
+    cr_assert_eq(count, 3, "Wrong number of elements visited: %d", count);
+    cr_assert_eq(ids, 3, "Wrong members visited");
+    //A tape read from the input can be saved and loaded like any other
+    FILE *f = tmpfile();
+    cr_assert_not_null(f, "tmpfile failed");
+    cr_assert_eq(argo_tape_dump(&t, f), 0, "argo_tape_dump failed");
+    fflush(f);
+    ARGO_TAPE loaded;
+    cr_assert_eq(argo_tape_load(&loaded, f), 0, "argo_tape_load failed");
+    fclose(f);
+    cr_assert_eq(loaded.count, t.count, "Wrong number of entries loaded");
+    cr_assert_eq(argo_tape_array_len(&loaded, argo_tape_object_get(&loaded, argo_tape_array_at(&loaded, 0, 0), "tags")), 2, "Wrong member of the loaded tape");
+    argo_tape_close(&loaded);
+    argo_tape_close(&t);
+    argo_input_open_mem(&in, "[1, {\"a\": ]", 11);
+    cr_assert_neq(argo_read_tape(&t, &in), 0, "argo_read_tape accepted invalid input");
+}
+
+Test(argo_suite, intern_test) {
+    char *json = "[{\"id\": 1, \"k\\\"ey\": 2}, {\"id\": 3, \"k\\\"ey\": 4, \"\": 5}]";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    argo_arena_reset(&argo_value_arena);
+    ARGO_VALUE *v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    ARGO_VALUE *a = argo_array_at(v, 0)->content.object.member_list->next;
+    ARGO_VALUE *b = argo_array_at(v, 1)->content.object.member_list->next;
+    //Members with the same name share its text, and are told apart from others by pointer
+    cr_assert(argo_name_interned(&a->name), "A member name was not interned");
+    cr_assert_eq(a->name.content, b->name.content, "Members with the same name don't share it");
+    cr_assert_eq(a->next->name.content, b->next->name.content, "Members with an escaped name don't share it");
+    cr_assert(argo_name_equal(&a->name, &b->name), "Equal names compared unequal");
+    cr_assert(!argo_name_equal(&a->name, &b->next->name), "Different names compared equal");
+    cr_assert_eq(argo_name_hash(&a->name), argo_hash_bytes((unsigned char *)"id", 2), "Wrong hash of an interned name");
+    cr_assert_null(argo_interned(&a->next->name)->plain, "A name with a quote has bytes to copy");
+    cr_assert_null(b->next->next->name.content, "An empty name has content");
+    cr_assert_not_null(argo_object_get(argo_array_at(v, 1), "k\"ey"), "Escaped member was not found");
+    //Names are interned again once the arena has been reset
+    argo_arena_reset(&argo_value_arena);
+    v = argo_read_value_mem(json, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL after a reset");
+    cr_assert_eq(argo_names.count, 2, "Names from before the reset were kept. Count: %lu", argo_names.count);
+    global_options = CANONICALIZE_OPTION;
+    char got[128];
+    FILE *out = fmemopen(got, sizeof(got), "w");
+    argo_write_value(v, out);
+    size_t gotLength = ftell(out);
+    fclose(out);
+    char *expected = "[{\"id\":1,\"k\\\"ey\":2},{\"id\":3,\"k\\\"ey\":4,\"\":5}]";
+    size_t expectedLength = 0;
+    while (*(expected+expectedLength) != '\0') expectedLength++;
+    cr_assert_eq(gotLength, expectedLength, "Wrong output length. Got: %lu", gotLength);
+    cr_assert_eq(__builtin_memcmp(got, expected, expectedLength), 0, "Wrong output");
+}
+
+Test(argo_suite, deep_nesting_test) {
+    //Nesting far deeper than the C stack would allow for a recursive parser
+    size_t depth = 200000, i;
+    char *json = malloc(2 * depth + 1);
+    for (i = 0; i < depth; i++) {*(json+i) = '['; *(json+depth+1+i) = ']';}
+    *(json+depth) = '1';
+    argo_max_depth = 0;
+    ARGO_VALUE *v = argo_read_value_mem(json, 2 * depth + 1);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for deeply nested input");
+    global_options = CANONICALIZE_OPTION;
+    level = 0;
+    char *got = malloc(2 * depth + 8);
+    FILE *out = fmemopen(got, 2 * depth + 8, "w");
+    int ret = argo_write_value(v, out);
+    size_t gotLength = ftell(out);
+    fclose(out);
+    cr_assert_eq(ret, 0, "argo_write_value failed. Got: %d", ret);
+    cr_assert_eq(gotLength, 2 * depth + 1, "Wrong output length. Got: %lu", gotLength);
+    cr_assert_eq(__builtin_memcmp(got, json, gotLength), 0, "Wrong output");
+    //Nesting deeper than argo_max_depth is refused, by the tree parser and the event parser alike
+    argo_max_depth = 1000;
+    cr_assert_null(argo_read_value_mem(json, 2 * depth + 1), "Input nested too deeply was accepted");
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, json, 2 * depth + 1);
+    ret = argo_validate(&in);
+    argo_input_close(&in);
+    cr_assert_neq(ret, 0, "argo_validate accepted input nested too deeply");
+    cr_assert_not_null(argo_read_value_mem(json + depth - 1000, 2001), "Input nested as deep as allowed was refused");
+    argo_max_depth = 0;
+    free(got);
+    free(json);
+}
+
+Test(argo_suite, lazy_test) {
+    char *json = "{\"skip\": {\"x\": [1, \"]}\\\"\", {\"y\": []}]}, \"n\\u0061me\": \"caf\\u00e9\", \"list\": [10, true, -2.5e1], \"id\": 7}";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_LAZY d;
+    argo_lazy_open(&d, json, len);
+    size_t root = argo_lazy_root(&d);
+    cr_assert_eq(argo_lazy_type(&d, root), ARGO_OBJECT_TYPE, "Expected an object. Got type %d", argo_lazy_type(&d, root));
+    //Members after a nested object (with brackets and quotes in its strings) are found by stepping over it
+    ARGO_NUMBER n;
+    size_t v = argo_lazy_object_get(&d, root, "id");
+    cr_assert_eq(argo_lazy_number(&d, v, &n), 0, "Member \"id\" is not a number");
+    cr_assert_eq(n.int_value, 7, "Expected 7. Got %ld", n.int_value);
+    cr_assert_eq(argo_lazy_object_get(&d, root, "missing"), ARGO_LAZY_NONE, "A missing member was found");
+    //Escaped names are compared by their characters
+    v = argo_lazy_object_get(&d, root, "name");
+    ARGO_STRING s = {0};
+    cr_assert_eq(argo_lazy_string(&d, v, &s), 0, "Member \"name\" is not a string");
+    cr_assert_eq(s.length, 4, "Expected a string of length 4. Got: %lu", s.length);
+    cr_assert_eq(*(s.content+3), 0xE9, "Escape was not decoded");
+    free(s.content);
+    v = argo_lazy_object_get(&d, root, "list");
+    ARGO_BASIC b;
+    cr_assert_eq(argo_lazy_basic(&d, argo_lazy_array_at(&d, v, 1), &b), 0, "Element 1 is not a basic value");
+    cr_assert_eq(b, ARGO_TRUE, "Expected true");
+    cr_assert_eq(argo_lazy_array_at(&d, v, 3), ARGO_LAZY_NONE, "Found an element past the end");
+    //Iteration gives each member, and a visited value can be turned into argo values
+    ARGO_LAZY_ITER it;
+    size_t name, count = 0;
+    cr_assert_eq(argo_lazy_iter_open(&it, &d, root), 0, "Failed to iterate over the object");
+    while ((v = argo_lazy_iter_next(&it, &name)) != ARGO_LAZY_NONE){
+        cr_assert_eq(*(json+name), '"', "Name offset doesn't point at a name");
+        count++;
+    }
+    cr_assert_eq(count, 4, "Expected 4 members. Got: %lu", count);
+    ARGO_VALUE *skipped = argo_lazy_value(&d, argo_lazy_object_get(&d, root, "skip"));
+    cr_assert_not_null(skipped, "Failed to parse a value of the document");
+    cr_assert_eq(argo_array_len(argo_object_get(skipped, "x")), 3, "Wrong number of elements");
+    argo_lazy_close(&d);
+}
+
+Test(argo_suite, split_array_test) {
+    char *json = " [1, \"a,]\\\"\",\n {\"b\": [2, 3]},\n[4], 5]x";
+    size_t len = 0;
+    while (*(json+len) != '\0') len++;
+    ARGO_SLICE *s;
+    size_t count;
+    //With runs of at least one byte, each element (commas in strings and nested containers aside) is a run of its own
+    cr_assert_eq(argo_split_array((unsigned char *)json, len, 1, &s, &count), 0, "Failed to split the array");
+    cr_assert_eq(count, 5, "Expected 5 runs. Got: %lu", count);
+    cr_assert_eq(*(json + (s+1)->start), ' ', "Run 1 starts in the wrong place");
+    cr_assert_eq(*(json + (s+1)->end - 1), ',', "Run 1 doesn't end with a comma");
+    //A run starts just after a comma, so on the line the comma is on
+    cr_assert_eq((s+2)->line, 1, "Expected run 2 to start on line 1. Got: %lu", (s+2)->line);
+    cr_assert_eq((s+4)->line, 3, "Expected run 4 to start on line 3. Got: %lu", (s+4)->line);
+    cr_assert_eq(*(json + (s+4)->end - 1), ']', "The last run doesn't end with the array");
+    free(s);
+    //Long runs take in several elements
+    cr_assert_eq(argo_split_array((unsigned char *)json, len, 16, &s, &count), 0, "Failed to split the array");
+    cr_assert_eq(count, 2, "Expected 2 runs. Got: %lu", count);
+    free(s);
+    //Other documents, and arrays that don't end, aren't split
+    cr_assert_neq(argo_split_array((unsigned char *)"{\"a\": 1}", 8, 1, &s, &count), 0, "Split an object");
+    cr_assert_neq(argo_split_array((unsigned char *)"[1, [2]", 7, 1, &s, &count), 0, "Split an array that doesn't end");
+}
+
+//Validate or canonicalize a document with -j 2 and serially, and check that the output, errors, and results are the same
+static void check_split_serial(const char *json, size_t len, bool validate, const char *error){
+    char out[2][256], err[2][256];
+    int ret[2], saved, k;
+    global_options = CANONICALIZE_OPTION;
+    for (k = 0; k < 2; k++){
+        ARGO_INPUT in;
+        FILE *o = tmpfile();
+        argo_input_open_mem(&in, json, len);
+        argo_lines_read = 0;
+        level = 0;
+        argo_jobs = k == 0 ? 2 : 1;
+        FILE *e = capture_stderr(&saved, NULL, NULL, 0);
+        if (k == 0) ret[k] = validate ? argo_validate_split(&in) : argo_write_split(&in, o);
+        else ret[k] = validate ? argo_validate(&in) : argo_write_events(&in, o);
+        capture_stderr(&saved, e, *(err+k), sizeof(*err));
+        argo_input_close(&in);
+        fflush(o);
+        //Only the end of the output is kept, which is where the runs would differ
+        fseek(o, 0, SEEK_END);
+        long size = ftell(o);
+        fseek(o, size > 255 ? size - 255 : 0, SEEK_SET);
+        *(*(out+k) + fread(*(out+k), 1, 255, o)) = '\0';
+        fclose(o);
+    }
+    argo_jobs = 1;
+    cr_assert_str_eq(*(err+1), error, "Wrong serial error: %s", *(err+1));
+    cr_assert_str_eq(*err, *(err+1), "-j reported: %s", *err);
+    cr_assert_str_eq(*out, *(out+1), "-j wrote: %s", *out);
+    cr_assert_eq(ret[0] != 0, ret[1] != 0, "-j gave a different result");
+}
+
+Test(argo_suite, split_serial_test) {
+    //Enough elements for two runs, with a newline right after each literal, and an error at the end
+    size_t n = 900000, i, len;
+    char *json = malloc(6 * n + 8);
+    *json = '[';
+    for (i = 0; i < n; i++) __builtin_memcpy(json + 1 + 6*i, "true\n,", 6);
+    __builtin_memcpy(json + 1 + 6*n, "x]", 2);
+    len = 6 * n + 3;
+    char error[64];
+    snprintf(error, sizeof(error), "Error: Invalid char at line %lu\n", n + 1);
+    check_split_serial(json, len, true, error);
+    check_split_serial(json, len, false, error);
+    //A string longer than a run, with a \u escape whose "digits" take in the quote that seems to end it
+    len = ARGO_SPLIT_CHUNK + 16;
+    json = realloc(json, len);
+    *json = '[';
+    *(json+1) = '"';
+    for (i = 2; i < len - 10; i++) *(json+i) = 'a';
+    __builtin_memcpy(json + len - 10, "\\u12\",\"x\"]", 10);
+    ARGO_SLICE *s;
+    size_t count;
+    cr_assert_neq(argo_split_array((unsigned char *)json, len, ARGO_SPLIT_CHUNK, &s, &count), 0, "Split an array with a bad \\u escape");
+    check_split_serial(json, len, false, "Error: Expected ',' or ']' at line 1\n");
+    free(json);
+}
+
+Test(argo_suite, split_read_test) {
+    //Enough objects for several runs, each read by a thread that interns the names in a table of its own
+    size_t n = 400000, i, j, k, len;
+    char *json = malloc(25 * n + 8);
+    *json = '[';
+    for (i = 0; i < n; i++){
+        char *e = json + 1 + 25*i;
+        __builtin_memcpy(e, "{\"k\":000000,\"v\":[true]},\n", 25);
+        //The numbers have no leading zeros
+        for (j = 0, k = 100000 + i; j < 6; j++, k /= 10) *(e + 10 - j) = '0' + k % 10;
+    }
+    *(json + 25*n - 1) = ']';
+    len = 25 * n;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, json, len);
+    argo_jobs = 4;
+    ARGO_VALUE *v = argo_read_value_split(&in);
+    cr_assert_eq(in.pos, len, "The array wasn't consumed");
+    argo_input_close(&in);
+    cr_assert_not_null(v, "Failed to read the array with threads");
+    cr_assert_eq(argo_array_len(v), n, "Expected %lu elements. Got: %lu", n, argo_array_len(v));
+    ARGO_VALUE *first = argo_array_at(v, 0), *last = argo_array_at(v, n - 1);
+    cr_assert_eq(first->prev, v->content.array.element_list, "The first element isn't linked to the sentinel");
+    cr_assert_eq(last->next, v->content.array.element_list, "The last element isn't linked to the sentinel");
+    cr_assert_eq(argo_object_get(last, "k")->content.number.int_value, 100000 + n - 1, "The last element was misread");
+    //The same name, interned by different threads, has different copies that are still equal
+    ARGO_STRING *a = &first->content.object.member_list->next->name, *b = &last->content.object.member_list->next->name;
+    cr_assert_neq(a->content, b->content, "The names of different runs share a copy");
+    cr_assert(argo_name_equal(a, b), "Names interned by different threads aren't equal");
+    //An invalid element is reported as a single thread reports it
+    *(json + 1 + 25*(n - 2) + 19) = 'x';
+    char tree[128], split[128];
+    int saved;
+    argo_lines_read = 0;
+    FILE *f = capture_stderr(&saved, NULL, NULL, 0);
+    cr_assert_null(argo_read_value_mem(json, len), "An invalid element was accepted");
+    capture_stderr(&saved, f, tree, sizeof(tree));
+    argo_lines_read = 0;
+    argo_input_open_mem(&in, json, len);
+    f = capture_stderr(&saved, NULL, NULL, 0);
+    cr_assert_null(argo_read_value_split(&in), "An invalid element was accepted by the threads");
+    capture_stderr(&saved, f, split, sizeof(split));
+    argo_input_close(&in);
+    argo_jobs = 1;
+    cr_assert_str_eq(split, tree, "The threads reported: %s", split);
+    free(json);
+}
+
+Test(argo_suite, validate_strings_test) {
+    //Long enough to take the block path, with the bad byte in the second block
+    unsigned char bytes[40];
+    size_t i;
+    for (i = 0; i < 40; i++) *(bytes+i) = 'a';
+    cr_assert(argo_utf8_valid(bytes, 40), "ASCII was rejected");
+    *(bytes+36) = 0xe2; *(bytes+37) = 0x82; *(bytes+38) = 0xac;
+    cr_assert(argo_utf8_valid(bytes, 40), "A 3-byte sequence was rejected");
+    cr_assert(!argo_utf8_valid(bytes, 38), "A cut sequence was accepted");
+    *(bytes+37) = 0x41;
+    cr_assert(!argo_utf8_valid(bytes, 40), "A missing continuation byte was accepted");
+    cr_assert(!argo_utf8_valid((unsigned char *)"\xc0\xaf", 2), "An overlong sequence was accepted");
+    cr_assert(!argo_utf8_valid((unsigned char *)"\xed\xa0\x80", 3), "A surrogate was accepted");
+    cr_assert(argo_utf8_valid((unsigned char *)"\xf0\x9f\x98\x80", 4), "A 4-byte sequence was rejected");
+    //-v checks the strings of a document strictly
+    ARGO_INPUT in;
+    char *good = "[\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9 \xc3\xa9\"]";
+    size_t len = 0;
+    while (*(good+len) != '\0') len++;
+    argo_input_open_mem(&in, good, len);
+    cr_assert_eq(argo_validate(&in), 0, "Valid strings were rejected");
+    argo_input_open_mem(&in, "[\"a\\x\"]", 7);
+    cr_assert_neq(argo_validate(&in), 0, "An unknown escape was accepted");
+    argo_input_open_mem(&in, "[\"\x01\"]", 5);
+    cr_assert_neq(argo_validate(&in), 0, "A control character was accepted");
+    argo_input_open_mem(&in, "[\"\xc3\"]", 5);
+    cr_assert_neq(argo_validate(&in), 0, "Invalid UTF-8 was accepted");
+}
+
+Test(argo_suite, hash_test) {
+    ARGO_HASH hash;
+    ARGO_DIGEST d;
+    char hex[ARGO_DIGEST_HEX];
+    //The 64-bit hash is XXH64
+    argo_hash_init(&hash, 64);
+    argo_hash_update(&hash, "abc", 3);
+    argo_hash_final(&hash, &d);
+    argo_digest_hex(&d, hex);
+    cr_assert_str_eq(hex, "44bc2cf5ad770999", "Wrong hash of \"abc\": %s", hex);
+    //and the 128-bit hash is XXH3-128
+    argo_hash_init(&hash, 128);
+    argo_hash_update(&hash, "abc", 3);
+    argo_hash_final(&hash, &d);
+    argo_digest_hex(&d, hex);
+    cr_assert_str_eq(hex, "06b05ab6733a618578af5f94892f3950", "Wrong 128-bit hash of \"abc\": %s", hex);
+    //However the input is divided up
+    char *text = "[1,{\"a\":true},\"a fairly long string, to fill a few stripes\"]";
+    size_t len = 0, i;
+    while (*(text+len) != '\0') len++;
+    ARGO_DIGEST whole, parts;
+    argo_hash_init(&hash, 128);
+    argo_hash_update(&hash, text, len);
+    argo_hash_final(&hash, &whole);
+    argo_hash_init(&hash, 128);
+    for (i = 0; i < len; i += 7) argo_hash_update(&hash, text + i, len - i < 7 ? len - i : 7);
+    argo_hash_final(&hash, &parts);
+    cr_assert(whole.low == parts.low && whole.high == parts.high, "The hash depends on how the input was divided");
+    //A document is hashed by its canonical form, and so is each value in it
+    char *json = "[1, {\"a\": true},\n \"a fairly long string, to fill a few stripes\"]";
+    size_t json_len = 0;
+    while (*(json+json_len) != '\0') json_len++;
+    ARGO_HASHER h;
+    ARGO_INPUT in;
+    cr_assert_eq(argo_hasher_open(&h, 128), 0, "Failed to open a hasher");
+    argo_input_open_mem(&in, json, json_len);
+    cr_assert_eq(argo_hash_events(&h, &in, &d), 0, "Failed to hash a document");
+    cr_assert(d.low == whole.low && d.high == whole.high, "The document wasn't hashed by its canonical form");
+    ARGO_VALUE *v = argo_read_value_mem(json, json_len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    cr_assert_eq(argo_hash_value(&h, v, &d), 0, "Failed to hash a value");
+    cr_assert(d.low == whole.low && d.high == whole.high, "The value wasn't hashed by its canonical form");
+    ARGO_VALUE *member = v->content.array.element_list->next->next->content.object.member_list->next;
+    argo_hash_init(&hash, 128);
+    argo_hash_update(&hash, "true", 4);
+    argo_hash_final(&hash, &whole);
+    cr_assert_eq(argo_hash_value(&h, member, &d), 0, "Failed to hash a member");
+    cr_assert(d.low == whole.low && d.high == whole.high, "The member wasn't hashed by its value alone");
+    argo_input_open_mem(&in, "[1,", 3);
+    cr_assert_neq(argo_hash_events(&h, &in, &d), 0, "Invalid input was hashed");
+    argo_hasher_close(&h);
+}
+
+Test(argo_suite, sort_members_test) {
+    //Enough members for the wide object to be radix sorted, with names that share beginnings,
+    //a name that is the beginning of another, characters beyond Latin-1, and a repeated name
+    char json[1024];
+    char *wide = "{\"b\": 1, \"ab\": 2, \"\\u20ac\": 3, \"a\": 4, \"b\": 5, \"abc\": 6, \"ba\": 7, \"\\u00e9\": 8, "
+                 "\"aa\": 9, \"c\": 10, \"cb\": 11, \"ca\": 12, \"\\u0100a\": 13, \"bb\": 14, \"abb\": 15, \"aab\": 16, "
+                 "\"z\": 17, \"y\": {\"q\": 18, \"p\": [{\"s\": 19, \"r\": 20}]}}";
+    size_t len = 0;
+    while (*(wide+len) != '\0') len++;
+    ARGO_VALUE *v = argo_read_value_mem(wide, len);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    cr_assert_eq(argo_sort_members(v), 0, "Failed to sort the members");
+    FILE *out = fmemopen(json, sizeof(json), "w");
+    global_options = CANONICALIZE_OPTION;
+    level = 0;
+    argo_write_value(v, out);
+    fclose(out);
+    char *sorted = "{\"a\":4,\"aa\":9,\"aab\":16,\"ab\":2,\"abb\":15,\"abc\":6,\"b\":1,\"b\":5,\"ba\":7,\"bb\":14,"
+                   "\"c\":10,\"ca\":12,\"cb\":11,\"y\":{\"p\":[{\"r\":20,\"s\":19}],\"q\":18},\"z\":17,"
+                   "\"\xe9\":8,\"\\u0100a\":13,\"\\u20ac\":3}";
+    cr_assert_str_eq(json, sorted, "Members were sorted wrongly: %s", json);
+    //The list of members still goes both ways
+    ARGO_VALUE *sentinel = v->content.object.member_list;
+    cr_assert_eq(sentinel->prev->content.number.int_value, 3, "The last member isn't linked back to the object");
+    cr_assert_eq(sentinel->prev->prev->next, sentinel->prev, "The members aren't linked both ways");
+}
+
+Test(argo_suite, empty_name_test) {
+    //A member with an empty name keeps it when the tree (sorted or not) or its tape is written out
+    char *json = "{\"x\":[],\"\":-1,\"y\":{\"\":2}}";
+    char got[64];
+    ARGO_VALUE *v = argo_read_value_mem(json, 25);
+    cr_assert_not_null(v, "argo_read_value_mem returned NULL for valid input");
+    FILE *out = fmemopen(got, sizeof(got), "w");
+    global_options = CANONICALIZE_OPTION;
+    level = 0;
+    argo_write_value(v, out);
+    fclose(out);
+    cr_assert_str_eq(got, json, "Wrong output: %s", got);
+    FILE *f = tmpfile();
+    cr_assert_not_null(f, "tmpfile failed");
+    cr_assert_eq(argo_tape_save(v, f), 0, "argo_tape_save failed");
+    fflush(f);
+    ARGO_TAPE t;
+    cr_assert_eq(argo_tape_load(&t, f), 0, "argo_tape_load failed");
+    fclose(f);
+    out = fmemopen(got, sizeof(got), "w");
+    argo_tape_write_value(&t, 0, out);
+    fclose(out);
+    argo_tape_close(&t);
+    cr_assert_str_eq(got, json, "Wrong output from the tape: %s", got);
+    cr_assert_eq(argo_sort_members(v), 0, "Failed to sort the members");
+    out = fmemopen(got, sizeof(got), "w");
+    argo_write_value(v, out);
+    fclose(out);
+    cr_assert_str_eq(got, "{\"\":-1,\"x\":[],\"y\":{\"\":2}}", "Wrong sorted output: %s", got);
+}
+
+Test(argo_suite, ctx_test) {
+    //Two documents are parsed in contexts of their own, one of them while the other's value is still in use
+    char *first = "{\"a\":\n[1,\n2]}";
+    char *second = "[\"x\",\n\"y\"\n";
+    char json[64];
+    ARGO_CTX one, two;
+    argo_ctx_init(&one);
+    argo_ctx_init(&two);
+    one.options = CANONICALIZE_OPTION;
+    argo_lines_read = 7;
+    global_options = 0;
+    ARGO_INPUT in;
+    argo_input_open_mem(&in, first, 13);
+    ARGO_VALUE *v = argo_ctx_read_value(&one, &in);
+    argo_input_close(&in);
+    cr_assert_not_null(v, "argo_ctx_read_value returned NULL for valid input");
+    argo_input_open_mem(&in, second, 10);
+    cr_assert_null(argo_ctx_read_value(&two, &in), "An unterminated array was read");
+    argo_input_close(&in);
+    cr_assert_eq(one.lines_read, 3, "Wrong line count in the first context: %d", one.lines_read);
+    cr_assert_eq(two.lines_read, 3, "Wrong line count in the second context: %d", two.lines_read);
+    FILE *out = fmemopen(json, sizeof(json), "w");
+    cr_assert_eq(argo_ctx_write_value(&one, v, out), 0, "argo_ctx_write_value failed");
+    fclose(out);
+    cr_assert_str_eq(json, "{\"a\":[1,2]}", "Wrong output: %s", json);
+    //The globals weren't touched, and are the state of the functions that don't take a context
+    cr_assert_eq(argo_lines_read, 7, "The line count of global.h was changed: %d", argo_lines_read);
+    cr_assert_eq(global_options, 0, "The options of global.h were changed");
+    argo_input_open_mem(&in, second, 10);
+    cr_assert_neq(argo_validate(&in), 0, "An unterminated array was validated");
+    argo_input_close(&in);
+    cr_assert_eq(argo_lines_read, 10, "The default context didn't count from argo_lines_read: %d", argo_lines_read);
+    cr_assert_eq(two.lines_read, 3, "The default context changed another one: %d", two.lines_read);
+    argo_ctx_free(&one);
+    argo_ctx_free(&two);
+}
+
+Test(argo_suite, ctx_access_test) {
+    //A wide object is built, indexed, queried and hashed in a context of its own, without using argo_value_arena
+    char *json = "{\"m0\":0,\"m1\":1,\"m2\":2,\"m3\":3,\"m4\":4,\"m5\":5,\"m6\":6,\"m7\":7,\"m8\":8,\"m9\":[10,\n11]}";
+    size_t len = __builtin_strlen(json);
+    ARGO_CTX cx;
+    ARGO_PARSER p;
+    ARGO_HASHER h;
+    ARGO_DIGEST d;
+    char hex[ARGO_DIGEST_HEX];
+    argo_ctx_init(&cx);
+    argo_arena_reset(&argo_value_arena);
+    size_t used = argo_value_arena.used;
+    argo_parser_open(&p, NULL, NULL);
+    cr_assert_eq(argo_ctx_parser_feed(&cx, &p, json, 40), 0, "The first chunk was rejected");
+    cr_assert_eq(argo_ctx_parser_feed(&cx, &p, json + 40, len - 40), 0, "The second chunk was rejected");
+    cr_assert_eq(argo_ctx_parser_finish(&cx, &p), 0, "argo_ctx_parser_finish failed");
+    ARGO_VALUE *obj = argo_parser_value(&p);
+    argo_parser_close(&p);
+    cr_assert_not_null(obj, "No value was built");
+    cr_assert_eq(cx.lines_read, 2, "The context didn't count the lines fed to the parser: %d", cx.lines_read);
+    ARGO_VALUE *m = argo_ctx_object_get(&cx, obj, "m8");
+    cr_assert(m != NULL && m->content.number.int_value == 8, "Member m8 wasn't found");
+    cr_assert_not_null(obj->content.object.index, "The wide object wasn't indexed");
+    cr_assert_eq(argo_ctx_query(&cx, obj, "/m9/1")->content.number.int_value, 11, "Wrong value selected");
+    cr_assert_eq(argo_hasher_open(&h, 64), 0, "argo_hasher_open failed");
+    cr_assert_eq(argo_ctx_hash_value(&cx, &h, argo_ctx_object_get(&cx, obj, "m9"), &d), 0, "argo_ctx_hash_value failed");
+    argo_hasher_close(&h);
+    argo_digest_hex(&d, hex);
+    cr_assert_str_eq(hex, "6fa7524b1065140f", "Wrong hash of [10,11]: %s", hex);
+    //The value and its index were allocated in the context, so resetting argo_value_arena leaves them alone
+    cr_assert_eq(argo_value_arena.used, used, "argo_value_arena was used: %lu bytes", argo_value_arena.used);
+    argo_arena_reset(&argo_value_arena);
+    cr_assert_eq(argo_ctx_object_get(&cx, obj, "m3")->content.number.int_value, 3, "Member m3 was lost");
+    //A value of a lazy document is read into the context too
+    ARGO_LAZY doc;
+    argo_lazy_open(&doc, json, len);
+    ARGO_VALUE *a = argo_ctx_lazy_value(&cx, &doc, argo_ctx_lazy_object_get(&cx, &doc, argo_lazy_root(&doc), "m9"));
+    argo_lazy_close(&doc);
+    cr_assert_eq(argo_array_len(a), 2, "Wrong array read from the lazy document");
+    cr_assert_eq(argo_value_arena.used, 0, "argo_value_arena was used: %lu bytes", argo_value_arena.used);
+    argo_ctx_free(&cx);
+}
+
+#define THREAD_RUNS 500
+
+//A document that a thread parses and writes over and over in a context of its own, with what it should come to
+typedef struct thread_doc {
+    char *json;
+    int options;                     // Options of the thread's context.
+    int max_depth;                   // Depth limit of the thread's context.
+    char *canonical;                 // What the document is written as, or NULL if it is invalid.
+    int lines;                       // Line count of the context once the document has been parsed.
+    int failures;                    // Runs that didn't come to the above.
+} THREAD_DOC;
+
+//Parse and write one document repeatedly, with both the tree reader and the event parser
+static void *doc_thread(void *arg){
+    THREAD_DOC *d = arg;
+    size_t length = __builtin_strlen(d->json);
+    char json[256];
+    ARGO_CTX cx;
+    ARGO_INPUT in;
+    argo_ctx_init(&cx);
+    cx.options = d->options;
+    cx.max_depth = d->max_depth;
+    for (int i = 0; i < THREAD_RUNS; i++){
+        cx.lines_read = 0;
+        argo_input_open_mem(&in, d->json, length);
+        ARGO_VALUE *v = argo_ctx_read_value(&cx, &in);
+        argo_input_close(&in);
+        bool ok = (v != NULL) == (d->canonical != NULL) && cx.lines_read == d->lines;
+        if (v != NULL){
+            FILE *out = fmemopen(json, sizeof(json), "w");
+            ok = argo_ctx_write_value(&cx, v, out) == 0 && ok;
+            fclose(out);
+            ok = ok && __builtin_strcmp(json, d->canonical) == 0;
+        }
+        cx.lines_read = 0;
+        argo_input_open_mem(&in, d->json, length);
+        FILE *out = fmemopen(json, sizeof(json), "w");
+        int ret = argo_ctx_write_events(&cx, &in, out);
+        fclose(out);
+        argo_input_close(&in);
+        ok = ok && (ret == 0) == (d->canonical != NULL) && cx.lines_read == d->lines;
+        ok = ok && (ret != 0 || __builtin_strcmp(json, d->canonical) == 0);
+        argo_arena_reset(cx.arena);
+        if (!ok) d->failures++;
+    }
+    argo_ctx_free(&cx);
+    return NULL;
+}
+
+Test(argo_suite, ctx_threads_test) {
+    //Different documents are parsed and written in several threads at once, each in a context of its own
+    THREAD_DOC docs[] = {
+        {"{\"a\" : [1, 2.5,\n\"x\"], \"b\": {}}", CANONICALIZE_OPTION, 0, "{\"a\":[1,0.25e1,\"x\"],\"b\":{}}", 2, 0},
+        {"\n\n[true, {\"k\": null}]", CANONICALIZE_OPTION | PRETTY_PRINT_OPTION | 2, 0,
+         "[\n  true,\n  {\n    \"k\": null\n  }\n]\n", 3, 0},
+        {"[1,\n2,\n3,\n", CANONICALIZE_OPTION, 0, NULL, 4, 0},
+        {"[[[0]]]", CANONICALIZE_OPTION, 2, NULL, 1, 0},
+    };
+    int n = sizeof(docs) / sizeof(*docs), i, saved;
+    pthread_t threads[sizeof(docs) / sizeof(*docs)];
+    static char errors[1 << 17];
+    FILE *f = capture_stderr(&saved, NULL, NULL, 0);
+    for (i = 0; i < n; i++) pthread_create(threads + i, NULL, doc_thread, docs + i);
+    for (i = 0; i < n; i++) pthread_join(*(threads + i), NULL);
+    capture_stderr(&saved, f, errors, sizeof(errors));
+    for (i = 0; i < n; i++) cr_assert_eq(docs[i].failures, 0, "Thread %d went wrong in %d runs", i, docs[i].failures);
+    //Each invalid document is reported once a run by each parser, with its own line (and the same message, unless it is too deep)
+    char *expected[] = {"Error: Premature EOF at line 4\n", "Error: Nesting is deeper than 2 on line 1\n",
+                        "Error: Nesting is deeper than 2 at line 1\n"};
+    int times[] = {2 * THREAD_RUNS, THREAD_RUNS, THREAD_RUNS};
+    int m = sizeof(expected) / sizeof(*expected), counts[sizeof(expected) / sizeof(*expected)] = {0}, others = 0;
+    char *line = errors;
+    while (*line != '\0'){
+        char *end = line;
+        while (*end != '\n' && *end != '\0') end++;
+        if (*end == '\n') end++;
+        for (i = 0; i < m; i++){
+            size_t length = __builtin_strlen(expected[i]);
+            if ((size_t)(end - line) == length && __builtin_memcmp(line, expected[i], length) == 0) break;
+        }
+        if (i < m) counts[i]++;
+        else others++;
+        line = end;
+    }
+    cr_assert_eq(others, 0, "Unexpected error messages: %s", errors);
+    for (i = 0; i < m; i++) cr_assert_eq(counts[i], times[i], "%s was reported %d times", expected[i], counts[i]);
+}
+
+Test(argo_suite, query_pretty_args_test) {
+    //A query is pretty printed with -p whether or not -c is also given
+    char *with_c[] = {"bin/argo", "-q", "$.a", "-c", "-p", "2", NULL};
+    char *without_c[] = {"bin/argo", "-q", "$.a", "-p", "2", NULL};
+    char *hashed[] = {"bin/argo", "--hash", "-q", "$.a", "-p", NULL};
+    cr_assert_eq(validargs(6, with_c), 0, "-q with -c -p 2 was rejected");
+    int expected = global_options;
+    cr_assert_eq(validargs(5, without_c), 0, "-q with -p 2 was rejected");
+    cr_assert_eq(global_options, expected, "Wrong options for -q with -p 2: 0x%x", global_options);
+    cr_assert_neq(validargs(5, hashed), 0, "A hash was pretty printed");
+    global_options = 0;
+    argo_extra_options = 0;
+}